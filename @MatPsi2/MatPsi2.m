@@ -225,6 +225,14 @@ classdef MatPsi2 < handle
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Integrals_IndicesForK', this.objectHandle, varargin{:});
         end
         
+        function varargout = Integrals_ERIThroughput(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Integrals_ERIThroughput', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = Integrals_BoysThroughput(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Integrals_BoysThroughput', this.objectHandle, varargin{:});
+        end
+        
         function varargout = JK_Initialize(this, varargin)
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('JK_Initialize', this.objectHandle, varargin{:});
         end
@@ -293,6 +301,22 @@ classdef MatPsi2 < handle
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('DFT_EnergyXC', this.objectHandle, varargin{:});
         end
         
+        function varargout = DFT_BlockStatistics(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('DFT_BlockStatistics', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = Points_Density(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Points_Density', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = Points_Orbitals(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Points_Orbitals', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = Points_ESP(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Points_ESP', this.objectHandle, varargin{:});
+        end
+        
         function varargout = SCF_SetSCFType(this, varargin)
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_SetSCFType', this.objectHandle, varargin{:});
         end
@@ -301,6 +325,10 @@ classdef MatPsi2 < handle
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_SetGuessOrb', this.objectHandle, varargin{:});
         end
         
+        function varargout = SCF_SetGuessDensity(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_SetGuessDensity', this.objectHandle, varargin{:});
+        end
+        
         function varargout = SCF_RunSCF(this, varargin)
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_RunSCF', this.objectHandle, varargin{:});
         end
@@ -329,14 +357,46 @@ classdef MatPsi2 < handle
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_DisableDIIS', this.objectHandle, varargin{:});
         end
         
+        function varargout = SCF_EnableSOSCF(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_EnableSOSCF', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = SCF_DisableSOSCF(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_DisableSOSCF', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = SCF_SetInitialAcceleration(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_SetInitialAcceleration', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = SCF_SetDensityUpdate(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_SetDensityUpdate', this.objectHandle, varargin{:});
+        end
+        
         function varargout = SCF_GuessSAD(this, varargin)
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_GuessSAD', this.objectHandle, varargin{:});
         end
         
+        function varargout = SCF_SetSADLibrary(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_SetSADLibrary', this.objectHandle, varargin{:});
+        end
+        
         function varargout = SCF_GuessCore(this, varargin)
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_GuessCore', this.objectHandle, varargin{:});
         end
         
+        function varargout = SCF_EnableSymmetry(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_EnableSymmetry', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = SCF_DisableSymmetry(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_DisableSymmetry', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = SCF_PointGroup(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_PointGroup', this.objectHandle, varargin{:});
+        end
+        
         function varargout = SCF_TotalEnergy(this, varargin)
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_TotalEnergy', this.objectHandle, varargin{:});
         end
@@ -381,10 +441,18 @@ classdef MatPsi2 < handle
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_Gradient', this.objectHandle, varargin{:});
         end
         
+        function varargout = SCF_Hessian(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_Hessian', this.objectHandle, varargin{:});
+        end
+        
         function varargout = SCF_GuessDensity(this, varargin)
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_GuessDensity', this.objectHandle, varargin{:});
         end
         
+        function varargout = SCF_NumFockBuilds(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_NumFockBuilds', this.objectHandle, varargin{:});
+        end
+        
         function varargout = SCF_RHF_J(this, varargin)
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_RHF_J', this.objectHandle, varargin{:});
         end
@@ -392,6 +460,62 @@ classdef MatPsi2 < handle
         function varargout = SCF_RHF_K(this, varargin)
             [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('SCF_RHF_K', this.objectHandle, varargin{:});
         end
+        
+        function varargout = BOMD_Initialize(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('BOMD_Initialize', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = BOMD_SetThermostat(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('BOMD_SetThermostat', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = BOMD_SetSCFIterations(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('BOMD_SetSCFIterations', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = BOMD_Run(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('BOMD_Run', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = BOMD_Velocities(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('BOMD_Velocities', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = BOMD_Time(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('BOMD_Time', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = Opt_Run(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Opt_Run', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = Batch_Submit(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Batch_Submit', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = Batch_Results(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Batch_Results', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = Batch_NumPending(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Batch_NumPending', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = Batch_EnergyGradient(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Batch_EnergyGradient', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = Diagnostics_Timings(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Diagnostics_Timings', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = Diagnostics_PhaseNames(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Diagnostics_PhaseNames', this.objectHandle, varargin{:});
+        end
+        
+        function varargout = Diagnostics_Reset(this, varargin)
+            [varargout{1:nargout}] = MatPsi2.MatPsi2_mex('Diagnostics_Reset', this.objectHandle, varargin{:});
+        end
 
     end
     
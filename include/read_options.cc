@@ -928,10 +928,13 @@ int read_options(const std::string &name, Options & options, bool suppress_print
     options.add_double("S_TOLERANCE",1E-7);
     /*- Minimum absolute value below which TEI are neglected. -*/
     options.add_double("INTS_TOLERANCE", 0.0);
+    /*- Integral screening for SCF_TYPE DIRECT. SCHWARZ uses the Cauchy-Schwarz
+    bound; QQR also tightens it by the distance between far-apart shell pairs. -*/
+    options.add_str("SCREENING", "SCHWARZ", "SCHWARZ QQR");
     /*- The type of guess orbitals.  Defaults to CORE except for geometry
     optimizations, in which case READ becomes the default after the first
     geometry step. -*/
-    options.add_str("GUESS", "CORE", "CORE GWH SAD READ ORBITAL");
+    options.add_str("GUESS", "CORE", "CORE GWH SAD READ ORBITAL DENSITY");
     /*- Do write a MOLDEN output file?  If so, the filename will end in
     .molden, and the prefix is determined by |globals__writer_file_label|
     (if set), or else by the name of the output file plus the name of
@@ -985,6 +988,39 @@ int read_options(const std::string &name, Options & options, bool suppress_print
     options.add_int("DIIS_MAX_VECS", 10);
     /*- Do use DIIS extrapolation to accelerate convergence? -*/
     options.add_bool("DIIS", true);
+    /*- Energy-based extrapolation (RHF and UHF) used far from convergence, e.g. from a
+        core guess, and blended into DIIS as the DIIS error falls. NONE keeps Pulay DIIS
+        throughout. -*/
+    options.add_str("SCF_INITIAL_ACCELERATION", "NONE", "NONE ADIIS EDIIS");
+    /*- The RMS DIIS error above which only |scf__scf_initial_acceleration| is used -*/
+    options.add_double("SCF_INITIAL_START_DIIS_TRANSITION", 1.0E-1);
+    /*- The RMS DIIS error below which only DIIS is used -*/
+    options.add_double("SCF_INITIAL_FINISH_DIIS_TRANSITION", 1.0E-4);
+    /*- Do replace DIIS and diagonalization by second-order (approximate Newton) orbital
+        steps once DIIS stalls below |scf__soscf_start_convergence|, i.e. two iterations in a
+        row raise the energy or fail to lower the orbital gradient? Each such step costs up to
+        |scf__soscf_max_iter| extra JK builds, so SCFs that DIIS converges steadily are left
+        to DIIS. -*/
+    options.add_bool("SOSCF", false);
+    /*- The RMS orbital gradient below which a stalled DIIS hands over to SOSCF steps -*/
+    options.add_double("SOSCF_START_CONVERGENCE", 1.0E-3);
+    /*- Maximum number of orbital Hessian products (JK builds) per SOSCF step -*/
+    options.add_int("SOSCF_MAX_ITER", 5);
+    /*- Relative residual at which the SOSCF Newton equations are considered solved -*/
+    options.add_double("SOSCF_CONV", 5.0E-3);
+    /*- Largest norm of an SOSCF orbital rotation (the initial trust radius) -*/
+    options.add_double("SOSCF_TRUST_RADIUS", 0.5);
+    /*- How each iteration's density is obtained from the Fock matrix (RHF and UHF). DIAGONALIZE
+        solves the full eigenproblem. PURIFICATION uses trace-correcting purification (matrix
+        products only). PARTIAL_EIGEN computes only the occupied and a few virtual eigenpairs.
+        Canonical orbitals are formed once, after the SCF has converged. -*/
+    options.add_str("SCF_DENSITY_UPDATE", "DIAGONALIZE", "DIAGONALIZE PURIFICATION PARTIAL_EIGEN");
+    /*- Virtual eigenpairs per irrep computed with |scf__scf_density_update| PARTIAL_EIGEN -*/
+    options.add_int("SCF_DENSITY_UPDATE_VIRTUALS", 4);
+    /*- Idempotency error tr(P - P^2) at which density purification stops -*/
+    options.add_double("PURIFICATION_CONVERGENCE", 1.0E-10);
+    /*- Maximum number of purification steps; F is diagonalized if they do not suffice -*/
+    options.add_int("PURIFICATION_MAX_ITER", 100);
     /*- The iteration to start MOM on (or 0 for no MOM) -*/
     options.add_int("MOM_START", 0);
     /*- The absolute indices of orbitals to excite from in MOM (+/- for alpha/beta) -*/
@@ -1090,6 +1126,9 @@ int read_options(const std::string &name, Options & options, bool suppress_print
     options.add_int("SAD_F_MIX_START", 50);
     /*- SAD Guess Cholesky Cutoff (for eliminating redundancies). !expert -*/
     options.add_double("SAD_CHOL_TOLERANCE", 1E-7);
+    /*- File of converged atomic SAD densities, read before and appended after atomic UHF runs, so
+    repeated runs skip them. Densities are also kept in memory for the whole process. !expert -*/
+    options.add_str_i("SAD_LIBRARY", "");
 
     /*- SUBSECTION DFT -*/
 
@@ -1128,8 +1167,24 @@ int read_options(const std::string &name, Options & options, bool suppress_print
     options.add_int("DFT_BLOCK_MIN_POINTS",1000);
     /*- The maximum radius to terminate subdivision of an octree block [au]. !expert -*/
     options.add_double("DFT_BLOCK_MAX_RADIUS",3.0);
-    /*- The blocking scheme for DFT. !expert -*/
-    options.add_str("DFT_BLOCK_SCHEME","OCTREE","NAIVE OCTREE");
+    /*- The blocking scheme for DFT. COST merges octree leaves while that lowers the modelled GEMM cost. !expert -*/
+    options.add_str("DFT_BLOCK_SCHEME","OCTREE","NAIVE OCTREE COST");
+    /*- Skip grid blocks whose bound on the density is below this value (0.0 disables screening). !expert -*/
+    options.add_double("DFT_DENSITY_TOLERANCE",0.0);
+    /*- Converge the SCF loosely on a coarse pruned grid before switching to the production grid? -*/
+    options.add_bool("DFT_ADAPTIVE_GRID",false);
+    /*- Number of radial points of the coarse grid in an adaptive-grid SCF. !expert -*/
+    options.add_int("DFT_ADAPTIVE_RADIAL_POINTS",50);
+    /*- Number of spherical points of the coarse grid in an adaptive-grid SCF. !expert -*/
+    options.add_int("DFT_ADAPTIVE_SPHERICAL_POINTS",110);
+    /*- Pruning Scheme of the coarse grid in an adaptive-grid SCF. !expert -*/
+    options.add_str("DFT_ADAPTIVE_PRUNING_SCHEME", "P_SLATER", "FLAT P_GAUSSIAN D_GAUSSIAN P_SLATER D_SLATER LOG_GAUSSIAN LOG_SLATER");
+    /*- Energy change below which the coarse grid stage is considered converged. !expert -*/
+    options.add_double("DFT_ADAPTIVE_E_CONVERGENCE",1.0E-4);
+    /*- RMS density change below which the coarse grid stage is considered converged. !expert -*/
+    options.add_double("DFT_ADAPTIVE_D_CONVERGENCE",1.0E-3);
+    /*- Include the derivative of the quadrature weights (moving grid) in the XC gradient? -*/
+    options.add_bool("DFT_WEIGHT_GRADIENT", false);
     /*- Parameters defining the dispersion correction. See Table
     :ref:`-D Functionals <table:dft_disp>` for default values and Table
     :ref:`Dispersion Corrections <table:dashd>` for the order in which
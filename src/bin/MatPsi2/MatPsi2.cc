@@ -1,6 +1,14 @@
 
 #include "MatPsi2.h"
 #include <read_options.cc>
+#include <physconst.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits>
+#include <map>
 
 namespace psi {
 #ifdef PSIDEBUG
@@ -84,6 +92,23 @@ MatPsi2::MatPsi2(SharedMatrix cartesian, const std::string& basisname, int charg
     
     // set default DFT functional as B3LYP
     process_environment_.options.set_global_str("DFT_FUNCTIONAL", "B3LYP");
+    
+    // no MD until BOMD_Initialize 
+    mdTimeStep_ = 0.0;
+    mdTime_ = 0.0;
+    mdTemperature_ = 0.0;
+    mdCouplingTime_ = 0.0;
+    mdSCFIterations_ = 4;
+    
+    // no batch until Batch_Submit 
+    batchShared_ = NULL;
+    batchBytes_ = 0;
+    batchNumJobs_ = 0;
+    batchNumSpins_ = 1;
+    
+    // C1 SCF until SCF_EnableSymmetry 
+    scfSymmetry_ = false;
+    scfSymmetryTolerance_ = 1.0e-5;
 }
 
 void MatPsi2::create_psio() {
@@ -109,10 +134,13 @@ void MatPsi2::create_basis_and_integral_factories() {
 
 // destructor 
 MatPsi2::~MatPsi2() {
+    batch_finish();
     if(wfn_ != NULL)
         wfn_->extern_finalize();
     if(jk_ != NULL)
         jk_->finalize();
+    if(scfJK_ != NULL)
+        scfJK_->finalize();
 }
 
 void MatPsi2::Settings_SetMaxNumCPUCores(int ncores) {
@@ -146,26 +174,28 @@ void MatPsi2::Molecule_Free() {
 
 void MatPsi2::Molecule_SetGeometry(SharedMatrix newGeom) {
     
-    // store the old geometry
-    Matrix oldgeom = molecule_->geometry();
-    molecule_->set_geometry(*(newGeom.get()));
+    if(newGeom->nrow() != molecule_->natom() || newGeom->ncol() != 3)
+        throw PSIEXCEPTION("Molecule_SetGeometry: The new geometry must be a natom by 3 matrix.");
     
-    // determine whether the new geometry will cause a problem (typically 2 atoms are at the same point) 
-    Matrix distmat = molecule_->distance_matrix();
+    // reject a geometry that would cause a problem (typically 2 atoms are at the same point) before touching the molecule, 
+    // so neither the old geometry nor a distance matrix has to be copied 
+    MatrixSlice xyz = newGeom->slice();
     for(int i = 0; i < molecule_->natom(); i++) {
-        for(int j = 0; j < i - 1; j++) {
-            if(distmat.get(i, j) == 0) {
-                molecule_->set_geometry(oldgeom);
+        for(int j = 0; j < i; j++) {
+            if(xyz(i, 0) == xyz(j, 0) && xyz(i, 1) == xyz(j, 1) && xyz(i, 2) == xyz(j, 2))
                 throw PSIEXCEPTION("Molecule_SetGeometry: The new geometry has (at least) two atoms at the same spot.");
-            }
         }
     }
+    molecule_->set_geometry(*(newGeom.get()));
     
     // update other objects 
     if(jk_ != NULL)
         jk_->finalize();
     jk_.reset();
+    release_scf_jk();
     wfn_.reset();
+    dftPotential_.reset();
+    dftGridContext_.reset();
     
     // re-initialize psio 
     create_psio();
@@ -283,7 +313,6 @@ SharedMatrix MatPsi2::Integrals_Overlap() {
     SharedMatrix sMat(matfac_->create_matrix("Overlap"));
     boost::shared_ptr<OneBodyAOInt> sOBI(intfac_->ao_overlap());
     sOBI->compute(sMat);
-    sMat->hermitivitize();
     return sMat;
 }
 
@@ -291,7 +320,6 @@ SharedMatrix MatPsi2::Integrals_Kinetic() {
     SharedMatrix tMat(matfac_->create_matrix("Kinetic"));
     boost::shared_ptr<OneBodyAOInt> tOBI(intfac_->ao_kinetic());
     tOBI->compute(tMat);
-    tMat->hermitivitize();
     return tMat;
 }
 
@@ -299,7 +327,6 @@ SharedMatrix MatPsi2::Integrals_Potential() {
     SharedMatrix vMat(matfac_->create_matrix("Potential"));
     boost::shared_ptr<OneBodyAOInt> vOBI(intfac_->ao_potential());
     vOBI->compute(vMat);
-    vMat->hermitivitize();
     return vMat;
 }
 
@@ -313,9 +340,6 @@ std::vector<SharedMatrix> MatPsi2::Integrals_Dipole() {
     ao_dipole.push_back(dipole_z);
     boost::shared_ptr<OneBodyAOInt> dipoleOBI(intfac_->ao_dipole());
     dipoleOBI->compute(ao_dipole);
-    ao_dipole[0]->hermitivitize();
-    ao_dipole[1]->hermitivitize();
-    ao_dipole[2]->hermitivitize();
     return ao_dipole;
 }
 
@@ -332,7 +356,6 @@ std::vector<SharedMatrix> MatPsi2::Integrals_PotentialEachCore() {
         viPtI->set_charge_field(Zxyz_rowi);
         viMatVec.push_back(matfac_->create_shared_matrix("PotentialEachCore"));
         viOBI->compute(viMatVec[i]);
-        viMatVec[i]->hermitivitize();
     }
     return viMatVec;
 }
@@ -343,7 +366,6 @@ SharedMatrix MatPsi2::Integrals_PotentialPtQ(SharedMatrix Zxyz_list) {
     viPtI->set_charge_field(Zxyz_list);
     SharedMatrix vZxyzListMat(matfac_->create_matrix("PotentialPointCharges"));
     viOBI->compute(vZxyzListMat);
-    vZxyzListMat->hermitivitize();
     return vZxyzListMat;
 }
 
@@ -438,43 +460,185 @@ void MatPsi2::Integrals_IndicesForK(double* indices1, double* indices2) {
     }
 }
 
+SharedMatrix MatPsi2::Integrals_ERIThroughput() {
+    ERI* eri = dynamic_cast<ERI*>(eri_.get());
+    if(eri == NULL)
+        throw PSIEXCEPTION("Integrals_ERIThroughput: the ERI object does not compute plain Coulomb integrals.");
+    // unique shell quartets grouped by libint's class (a b|c d), a >= b, c >= d, a + b <= c + d
+    std::map< std::vector<int>, std::vector<int> > classes;
+    AOShellCombinationsIterator shellIter = intfac_->shells_iterator();
+    for (shellIter.first(); shellIter.is_done() == false; shellIter.next()) {
+        int sh[4] = { shellIter.p(), shellIter.q(), shellIter.r(), shellIter.s() };
+        std::vector<int> am(4);
+        for(int k = 0; k < 4; k++)
+            am[k] = basis_->shell(sh[k]).am();
+        if(am[0] < am[1])
+            std::swap(am[0], am[1]);
+        if(am[2] < am[3])
+            std::swap(am[2], am[3]);
+        if(am[0] + am[1] > am[2] + am[3]) {
+            std::swap(am[0], am[2]);
+            std::swap(am[1], am[3]);
+        }
+        std::vector<int>& quartets = classes[am];
+        quartets.insert(quartets.end(), sh, sh + 4);
+    }
+    // time at most maxSample quartets of each class, repeated for at least minSeconds
+    const size_t maxSample = 20000;
+    const double minSeconds = 0.05;
+    SharedMatrix throughput(new Matrix("ERI throughput", classes.size(), 8));
+    int row = 0;
+    for(std::map< std::vector<int>, std::vector<int> >::iterator it = classes.begin(); it != classes.end(); it++, row++) {
+        const std::vector<int>& quartets = it->second;
+        size_t nquartet = quartets.size() / 4;
+        size_t nsample = std::min(nquartet, maxSample);
+        for(int k = 0; k < 4; k++)
+            throughput->set(row, k, it->first[k]);
+        throughput->set(row, 4, nquartet);
+        for(int libintOnly = 0; libintOnly < 2; libintOnly++) {
+            eri->set_lowam_kernels(!libintOnly);
+            size_t done = 0;
+            double start = omp_get_wtime();
+            double elapsed;
+            do {
+                for(size_t i = 0; i < nsample; i++)
+                    eri->compute_shell(quartets[4*i], quartets[4*i+1], quartets[4*i+2], quartets[4*i+3]);
+                done += nsample;
+                elapsed = omp_get_wtime() - start;
+            } while(elapsed < minSeconds);
+            throughput->set(row, 5 + libintOnly, done / elapsed);
+        }
+        // the same quartets as one compute_shells batch
+        eri->set_lowam_kernels(true);
+        size_t done = 0;
+        double start = omp_get_wtime();
+        double elapsed;
+        do {
+            eri->compute_shells(nsample, &quartets[0]);
+            done += nsample;
+            elapsed = omp_get_wtime() - start;
+        } while(elapsed < minSeconds);
+        throughput->set(row, 7, done / elapsed);
+    }
+    eri->set_lowam_kernels(true);
+    return throughput;
+}
+
+SharedMatrix MatPsi2::Integrals_BoysThroughput() {
+    const BoysFunction& boys = BoysFunction::instance();
+    // half log-spaced over [1e-8, 1e3], half uniform over [0, 60], which spans the Taylor and asymptotic ranges 
+    const int nsample = 4096;
+    std::vector<double> T(nsample);
+    for(int i = 0; i < nsample / 2; i++) {
+        T[i] = pow(10.0, -8.0 + 11.0 * (i + 0.5) / (nsample / 2));
+        T[nsample / 2 + i] = 60.0 * i / (nsample / 2);
+    }
+    const double minSeconds = 0.02;
+    int maxJ = boys.max_m();
+    SharedMatrix throughput(new Matrix("Boys throughput", maxJ + 1, 6));
+    std::vector<double> F((size_t)nsample * (maxJ + 1));
+    std::vector<double> reference(maxJ + 1);
+    double sink = 0.0;
+    for(int J = 0; J <= maxJ; J++) {
+        throughput->set(J, 0, J);
+        // the table one argument at a time, the table in one batch, and the series 
+        for(int method = 0; method < 3; method++) {
+            size_t done = 0;
+            double start = omp_get_wtime();
+            double elapsed;
+            do {
+                if(method == 0) {
+                    for(int i = 0; i < nsample; i++)
+                        boys.values(J, T[i], &F[(size_t)i * (J + 1)]);
+                } else if(method == 1) {
+                    boys.values(J, nsample, &T[0], &F[0]);
+                } else {
+                    for(int i = 0; i < nsample; i++)
+                        BoysFunction::series(J, T[i], &F[(size_t)i * (J + 1)]);
+                }
+                sink += F[J];
+                done += nsample;
+                elapsed = omp_get_wtime() - start;
+            } while(elapsed < minSeconds);
+            throughput->set(J, 1 + method, done / elapsed);
+        }
+        // largest error of F_0 .. F_J against the series 
+        boys.values(J, nsample, &T[0], &F[0]);
+        double maxAbsolute = 0.0, maxRelative = 0.0;
+        for(int i = 0; i < nsample; i++) {
+            BoysFunction::series(J, T[i], &reference[0]);
+            for(int j = 0; j <= J; j++) {
+                double error = fabs(F[(size_t)i * (J + 1) + j] - reference[j]);
+                maxAbsolute = max(maxAbsolute, error);
+                maxRelative = max(maxRelative, error / reference[j]);
+            }
+        }
+        throughput->set(J, 4, maxAbsolute);
+        throughput->set(J, 5, maxRelative);
+    }
+    // keeps the timed calls from being optimized away 
+    if(sink != sink)
+        throw PSIEXCEPTION("Integrals_BoysThroughput: The Boys function returned NaN.");
+    return throughput;
+}
+
 void MatPsi2::JK_Initialize(std::string jktype, std::string auxBasisName) {
     std::transform(jktype.begin(), jktype.end(), jktype.begin(), ::toupper);
     if(jk_ != NULL)
         jk_->finalize();
+    // the symmetric SCF builds its JK as jkType_, PKJK before the first call; only DFJK reads the auxiliary basis 
+    if(jktype != (jkType_.empty() ? std::string("PKJK") : jkType_) || (jktype == "DFJK" && auxBasisName != jkAuxBasisName_))
+        release_scf_jk();
+    jkType_ = jktype;
+    jkAuxBasisName_ = auxBasisName;
+    jk_ = create_jk(jktype, auxBasisName, psio_);
+}
+
+void MatPsi2::release_scf_jk() {
+    if(scfJK_ != NULL)
+        scfJK_->finalize();
+    scfJK_.reset();
+    scfPSIO_.reset();
+}
+
+boost::shared_ptr<JK> MatPsi2::create_jk(const std::string& jktype, const std::string& auxBasisName, boost::shared_ptr<PSIO> psio) {
     if(wfn_ == NULL) {
         std::string scfType = process_environment_.options.get_str("REFERENCE");
         if(scfType == "RHF" || scfType == "RKS") {
             if(molecule_->multiplicity() > 1)
-                throw PSIEXCEPTION("JK_Initialize: RHF or RKS can handle singlets only.");
+                throw PSIEXCEPTION("create_jk: RHF or RKS can handle singlets only.");
             wfn_ = boost::shared_ptr<scf::RHF>(new scf::RHF(process_environment_, basis_));
         } else if(scfType == "UHF" || scfType == "UKS") {
             wfn_ = boost::shared_ptr<scf::UHF>(new scf::UHF(process_environment_, basis_));
         } else {
-            throw PSIEXCEPTION("JK_Initialize: Reference SCF type not recognized.");
+            throw PSIEXCEPTION("create_jk: Reference SCF type not recognized.");
         }
         process_environment_.set_wavefunction(wfn_);
         wfn_->extern_finalize();
         wfn_.reset();
     }
+    boost::shared_ptr<JK> jk;
     if(jktype == "PKJK") {
-        jk_ = boost::shared_ptr<JK>(new PKJK(process_environment_, basis_, psio_));
+        jk = boost::shared_ptr<JK>(new PKJK(process_environment_, basis_, psio));
     } else if(jktype == "DFJK") {
+        boost::shared_ptr<PointGroup> group = molecule_->point_group();
         boost::shared_ptr<BasisSetParser> parser(new Gaussian94BasisSetParser());
         molecule_->set_basis_all_atoms(auxBasisName, "DF_BASIS_SCF");
         boost::shared_ptr<BasisSet> auxiliary = BasisSet::construct(process_environment_, parser, molecule_, "DF_BASIS_SCF");
-        jk_ = boost::shared_ptr<JK>(new DFJK(process_environment_, basis_, auxiliary, psio_));
+        molecule_->set_point_group(group); // constructing a basis set resets the point group 
+        jk = boost::shared_ptr<JK>(new DFJK(process_environment_, basis_, auxiliary, psio));
         molecule_->set_basis_all_atoms(basis_->name());
     } else if(jktype == "ICJK") {
-        jk_ = boost::shared_ptr<JK>(new ICJK(process_environment_, basis_));
+        jk = boost::shared_ptr<JK>(new ICJK(process_environment_, basis_));
     } else if(jktype == "DIRECTJK") {
-        jk_ = boost::shared_ptr<JK>(new DirectJK(process_environment_, basis_));
+        jk = boost::shared_ptr<JK>(new DirectJK(process_environment_, basis_));
     } else {
-        throw PSIEXCEPTION("JK_Initialize: JK type not recognized.");
+        throw PSIEXCEPTION("create_jk: JK type not recognized.");
     }
-    jk_->set_memory(process_environment_.get_memory());
-    jk_->set_cutoff(0.0);
-    jk_->initialize();
+    jk->set_memory(process_environment_.get_memory());
+    jk->set_cutoff(0.0);
+    jk->initialize();
+    return jk;
 }
 
 const std::string& MatPsi2::JK_Type() {
@@ -487,19 +651,19 @@ SharedMatrix DensToEigVectors(SharedMatrix density) {
     if(density == NULL) {
         return density;
     }
+    // Only the natural orbitals that contribute; the others would be zero columns
     int dim = density->ncol();
     SharedMatrix eigVectors(new Matrix(dim, dim));
     boost::shared_ptr<Vector> eigValues(new Vector(dim));
-    density->diagonalize(eigVectors, eigValues);
-    for(int i = 0; i < dim; i++) {
-        eigValues->set(i, sqrt(max(0.0, eigValues->get(i))));
-    }
-    for(int i = 0; i < dim; i++) {
-        for(int j = 0; j < dim; j++) {
-            eigVectors->set(i, j, eigVectors->get(i, j) * eigValues->get(j));
+    int nocc = density->diagonalize_above(eigVectors, eigValues, 1.0e-14)[0];
+    SharedMatrix occOrb(new Matrix(dim, max(nocc, 1)));
+    for(int j = 0; j < nocc; j++) {
+        double scale = sqrt(eigValues->get(j));
+        for(int i = 0; i < dim; i++) {
+            occOrb->set(i, j, eigVectors->get(i, j) * scale);
         }
     }
-    return eigVectors;
+    return occOrb;
 }
 
 std::vector<SharedMatrix> MatPsi2::JK_DensToJ(SharedMatrix densAlpha, SharedMatrix densBeta) {
@@ -598,7 +762,10 @@ void MatPsi2::DFT_Initialize(std::string functionalName) {
     } else {
         throw PSIEXCEPTION("DFT_Initialize: Reference SCF type not recognized.");
     }
-    dftPotential_ = VBase::build_V(process_environment_, process_environment_.options, dftType);
+    // the grid is kept across functionals and references, and only rebuilt when the geometry or grid options change 
+    if(dftGridContext_ == NULL)
+        dftGridContext_ = boost::shared_ptr<DFTGridContext>(new DFTGridContext(process_environment_, basis_, process_environment_.options));
+    dftPotential_ = VBase::build_V(process_environment_, process_environment_.options, dftType, dftGridContext_);
     dftPotential_->initialize();
 }
 
@@ -627,6 +794,34 @@ double MatPsi2::DFT_EnergyXC() {
     return quad["FUNCTIONAL"];
 }
 
+SharedMatrix MatPsi2::DFT_BlockStatistics() {
+    if(dftPotential_ == NULL)
+        DFT_Initialize(process_environment_.options.get_str("DFT_FUNCTIONAL"));
+    return dftPotential_->grid()->block_statistics();
+}
+
+SharedMatrix MatPsi2::Points_Density(SharedMatrix points, SharedMatrix densAlpha, SharedMatrix densBeta) {
+    SharedMatrix densTotal = densAlpha->clone();
+    densTotal->add(densBeta == NULL ? densAlpha : densBeta);
+    PointProp prop(basis_, process_environment_.options.get_double("DFT_BASIS_TOLERANCE"));
+    prop.set_nthreads(process_environment_.get_n_threads());
+    return prop.compute_density(points, densTotal);
+}
+
+SharedMatrix MatPsi2::Points_Orbitals(SharedMatrix points, SharedMatrix orbitals) {
+    PointProp prop(basis_, process_environment_.options.get_double("DFT_BASIS_TOLERANCE"));
+    prop.set_nthreads(process_environment_.get_n_threads());
+    return prop.compute_orbitals(points, orbitals);
+}
+
+SharedVector MatPsi2::Points_ESP(SharedMatrix points, SharedMatrix densAlpha, SharedMatrix densBeta) {
+    SharedMatrix densTotal = densAlpha->clone();
+    densTotal->add(densBeta == NULL ? densAlpha : densBeta);
+    PointProp prop(basis_);
+    prop.set_nthreads(process_environment_.get_n_threads());
+    return prop.compute_esp(points, densTotal);
+}
+
 void MatPsi2::SCF_SetSCFType(std::string scfType) {
     std::transform(scfType.begin(), scfType.end(), scfType.begin(), ::toupper);
     process_environment_.options.set_global_str("REFERENCE", scfType);
@@ -641,34 +836,171 @@ void MatPsi2::SCF_SetGuessOrb(SharedMatrix guessOrbAlpha, SharedMatrix guessOrbB
         guessOrbital_.push_back(guessOrbBeta);
 }
 
-void MatPsi2::create_wfn() {
-    if(jk_ == NULL)
-        JK_Initialize("PKJK");
+void MatPsi2::SCF_SetGuessDensity(SharedMatrix guessDensAlpha, SharedMatrix guessDensBeta) {
+    process_environment_.options.set_global_str("GUESS", "DENSITY");
+    guessDensity_.clear();
+    guessDensity_.push_back(guessDensAlpha);
+    if(guessDensBeta != NULL)
+        guessDensity_.push_back(guessDensBeta);
+}
+
+void MatPsi2::create_wfn(boost::shared_ptr<JK> jk) {
+    if(jk == NULL) {
+        if(jk_ == NULL)
+            JK_Initialize("PKJK");
+        jk = jk_;
+    }
     std::string scfType = process_environment_.options.get_str("REFERENCE");
     if(scfType == "RHF") {
         if(molecule_->multiplicity() > 1)
             throw PSIEXCEPTION("create_wfn: RHF can handle singlets only.");
-        wfn_ = boost::shared_ptr<scf::RHF>(new scf::RHF(process_environment_, jk_));
+        wfn_ = boost::shared_ptr<scf::RHF>(new scf::RHF(process_environment_, jk));
     } else if(scfType == "UHF") {
-        wfn_ = boost::shared_ptr<scf::UHF>(new scf::UHF(process_environment_, jk_));
+        wfn_ = boost::shared_ptr<scf::UHF>(new scf::UHF(process_environment_, jk));
     } else if(scfType == "RKS") {
         if(molecule_->multiplicity() > 1)
             throw PSIEXCEPTION("create_wfn: RKS can handle singlets only.");
-        wfn_ = boost::shared_ptr<scf::RKS>(new scf::RKS(process_environment_, jk_));
+        wfn_ = boost::shared_ptr<scf::RKS>(new scf::RKS(process_environment_, jk));
     } else if(scfType == "UKS") {
-        wfn_ = boost::shared_ptr<scf::UKS>(new scf::UKS(process_environment_, jk_));
+        wfn_ = boost::shared_ptr<scf::UKS>(new scf::UKS(process_environment_, jk));
     } else {
         throw PSIEXCEPTION("create_wfn: SCF type not recognized.");
     }
+    scfPointGroup_ = molecule_->point_group()->symbol();
+}
+
+boost::shared_ptr<PointGroup> MatPsi2::scf_point_group() {
+    boost::shared_ptr<PointGroup> c1group(new PointGroup("C1"));
+    if(!scfSymmetry_)
+        return c1group;
+    // operations about the origin and the axes of the geometry as given; the molecule is never reoriented 
+    boost::shared_ptr<PointGroup> group = molecule_->find_highest_point_group(scfSymmetryTolerance_);
+    if(group->bits() == PointGroups::C1)
+        return c1group;
+    
+    // remove the noise within the tolerance, so the SO basis is exact 
+    molecule_->set_point_group(group);
+    SharedMatrix geometry(new Matrix(molecule_->geometry()));
+    molecule_->symmetrize();
+    SharedMatrix symmetric(new Matrix(molecule_->geometry()));
+    molecule_->set_point_group(c1group);
+    geometry->subtract(symmetric);
+    if(geometry->rms() > 0.0)
+        Molecule_SetGeometry(symmetric);
+    return group;
+}
+
+SharedMatrix MatPsi2::scf_ao_matrix(SharedMatrix soMatrix) {
+    if(wfn_->nirrep() == 1)
+        return soMatrix;
+    // sum over irreps of U M U^T; the AO to SO transformation U is orthogonal 
+    SharedMatrix aotoso = wfn_->aotoso();
+    int nao = basis_->nbf();
+    SharedMatrix aoMatrix(new Matrix(soMatrix->name(), nao, nao));
+    SharedMatrix temp(new Matrix(nao, aotoso->max_ncol()));
+    for(int h = 0; h < wfn_->nirrep(); h++) {
+        int nso = aotoso->colspi()[h];
+        if(nso == 0)
+            continue;
+        C_DGEMM('N', 'N', nao, nso, nso, 1.0, aotoso->pointer(h)[0], nso, soMatrix->pointer(h)[0], nso, 0.0, temp->pointer()[0], nso);
+        C_DGEMM('N', 'T', nao, nao, nso, 1.0, temp->pointer()[0], nso, aotoso->pointer(h)[0], nso, 1.0, aoMatrix->pointer()[0], nao);
+    }
+    return aoMatrix;
+}
+
+SharedMatrix MatPsi2::scf_so_matrix(SharedMatrix aoMatrix) {
+    SharedMatrix aotoso = wfn_->aotoso();
+    int nao = basis_->nbf();
+    SharedMatrix soMatrix(new Matrix(aoMatrix->name(), aotoso->colspi(), aotoso->colspi()));
+    SharedMatrix temp(new Matrix(nao, aotoso->max_ncol()));
+    for(int h = 0; h < wfn_->nirrep(); h++) {
+        int nso = aotoso->colspi()[h];
+        if(nso == 0)
+            continue;
+        C_DGEMM('N', 'N', nao, nso, nao, 1.0, aoMatrix->pointer()[0], nao, aotoso->pointer(h)[0], nso, 0.0, temp->pointer()[0], nso);
+        C_DGEMM('T', 'N', nso, nso, nao, 1.0, aotoso->pointer(h)[0], nso, temp->pointer()[0], nso, 0.0, soMatrix->pointer(h)[0], nso);
+    }
+    return soMatrix;
+}
+
+void MatPsi2::check_scf_guess() {
+    int nbf = basis_->nbf();
+    std::string guessType = process_environment_.options.get_str("GUESS");
+    if(guessType == "DENSITY") {
+        for(int s = 0; s < guessDensity_.size(); s++)
+            if(guessDensity_[s]->nrow() != nbf || guessDensity_[s]->ncol() != nbf)
+                throw PSIEXCEPTION("SCF_RunSCF: The guess density must be NumBasisFunctions by NumBasisFunctions.");
+    } else if(guessType == "ORBITAL" && guessOrbital_.size() == 2) {
+        int nocc[] = { wfn_->nalpha(), wfn_->nbeta() };
+        for(int s = 0; s < 2; s++)
+            if(guessOrbital_[s]->nrow() != nbf || guessOrbital_[s]->ncol() < nocc[s])
+                throw PSIEXCEPTION("SCF_RunSCF: The guess orbitals must be NumBasisFunctions by at least the number of occupied orbitals.");
+    }
 }
 
 double MatPsi2::SCF_RunSCF() {
-    create_wfn();
-    if(process_environment_.options.get_str("GUESS") == "ORBITAL") {
-        wfn_->SetGuessOrbital(guessOrbital_);
+    boost::shared_ptr<PointGroup> group = scf_point_group();
+    if(group->bits() == PointGroups::C1) {
+        create_wfn();
+        check_scf_guess();
+        if(process_environment_.options.get_str("GUESS") == "ORBITAL") {
+            wfn_->SetGuessOrbital(guessOrbital_);
+        } else if(process_environment_.options.get_str("GUESS") == "DENSITY") {
+            wfn_->SetGuessDensity(guessDensity_);
+        }
+        process_environment_.set_wavefunction(wfn_);
+        return wfn_->compute_energy();
     }
-    process_environment_.set_wavefunction(wfn_);
-    return wfn_->compute_energy();
+    
+    // the SCF and its own JK work in the SO basis of the group, while the molecule has it; 
+    // jk_ and the other objects stay C1, and the files of jk_ are not touched 
+    Options& options = process_environment_.options;
+    std::string guessType = options.get_str("GUESS");
+    boost::shared_ptr<PointGroup> c1group(new PointGroup("C1"));
+    wfn_.reset();
+    double energy;
+    try {
+        molecule_->set_point_group(group);
+        // kept until the geometry, the JK type or the symmetry tolerance changes, like jk_ in C1 
+        if(scfJK_ == NULL) {
+            scfPSIO_ = boost::shared_ptr<PSIO>(new PSIO);
+            scfJK_ = create_jk(jkType_.empty() ? std::string("PKJK") : jkType_, jkAuxBasisName_, scfPSIO_);
+        }
+        create_wfn(scfJK_);
+        check_scf_guess();
+        
+        // a C1 AO guess enters as its totally symmetric part, U^T D U; orbitals give their density 
+        int nbf = basis_->nbf();
+        std::vector<SharedMatrix> guess;
+        if(guessType == "DENSITY") {
+            guess = guessDensity_;
+        } else if(guessType == "ORBITAL" && guessOrbital_.size() == 2) {
+            int nocc[] = { wfn_->nalpha(), wfn_->nbeta() };
+            for(int s = 0; s < 2; s++) {
+                SharedMatrix density(new Matrix(nbf, nbf));
+                C_DGEMM('N', 'T', nbf, nbf, nocc[s], 1.0, guessOrbital_[s]->pointer()[0], guessOrbital_[s]->ncol(), 
+                    guessOrbital_[s]->pointer()[0], guessOrbital_[s]->ncol(), 0.0, density->pointer()[0], nbf);
+                guess.push_back(density);
+            }
+        }
+        if(!guess.empty()) {
+            for(int s = 0; s < guess.size(); s++)
+                guess[s] = scf_so_matrix(guess[s]);
+            wfn_->SetGuessDensity(guess);
+            options.set_global_str("GUESS", "DENSITY");
+        } else if(guessType == "ORBITAL") {
+            wfn_->SetGuessOrbital(guessOrbital_);
+        }
+        process_environment_.set_wavefunction(wfn_);
+        energy = wfn_->compute_energy();
+    } catch(...) {
+        options.set_global_str("GUESS", guessType);
+        molecule_->set_point_group(c1group);
+        throw;
+    }
+    options.set_global_str("GUESS", guessType);
+    molecule_->set_point_group(c1group);
+    return energy;
 }
 
 void MatPsi2::SCF_EnableMOM(int mom_start) {
@@ -689,6 +1021,31 @@ void MatPsi2::SCF_EnableDIIS() {
     process_environment_.options.set_global_int("MAXITER", 100);
 }
 
+void MatPsi2::SCF_EnableSOSCF(double start_convergence) {
+    process_environment_.options.set_global_bool("SOSCF", true);
+    process_environment_.options.set_global_double("SOSCF_START_CONVERGENCE", start_convergence);
+}
+
+void MatPsi2::SCF_DisableSOSCF() {
+    process_environment_.options.set_global_bool("SOSCF", false);
+}
+
+void MatPsi2::SCF_SetInitialAcceleration(const std::string& type) {
+    std::string upper = type;
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+    if (upper != "NONE" && upper != "ADIIS" && upper != "EDIIS")
+        throw PSIEXCEPTION("SCF_SetInitialAcceleration: type must be ADIIS, EDIIS or NONE.");
+    process_environment_.options.set_global_str("SCF_INITIAL_ACCELERATION", upper);
+}
+
+void MatPsi2::SCF_SetDensityUpdate(const std::string& type) {
+    std::string upper = type;
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+    if (upper != "DIAGONALIZE" && upper != "PURIFICATION" && upper != "PARTIAL_EIGEN")
+        throw PSIEXCEPTION("SCF_SetDensityUpdate: type must be DIAGONALIZE, PURIFICATION or PARTIAL_EIGEN.");
+    process_environment_.options.set_global_str("SCF_DENSITY_UPDATE", upper);
+}
+
 void MatPsi2::SCF_GuessSAD() {
     process_environment_.options.set_global_str("GUESS", "SAD");
 }
@@ -697,6 +1054,28 @@ void MatPsi2::SCF_GuessCore() {
     process_environment_.options.set_global_str("GUESS", "CORE");
 }
 
+void MatPsi2::SCF_EnableSymmetry(double tolerance) {
+    // atoms are mapped onto each other within 0.05 Bohr when the SO basis is built 
+    if(tolerance <= 0.0 || tolerance >= 0.05)
+        throw PSIEXCEPTION("SCF_EnableSymmetry: The tolerance must be positive and below 0.05 Bohr.");
+    // another tolerance may find another group 
+    if(tolerance != scfSymmetryTolerance_)
+        release_scf_jk();
+    scfSymmetry_ = true;
+    scfSymmetryTolerance_ = tolerance;
+}
+
+void MatPsi2::SCF_DisableSymmetry() {
+    scfSymmetry_ = false;
+}
+
+const std::string& MatPsi2::SCF_PointGroup() {
+    if(wfn_ == NULL) {
+        SCF_RunSCF();
+    }
+    return scfPointGroup_;
+}
+
 double MatPsi2::SCF_TotalEnergy() { 
     if(wfn_ == NULL) {
         SCF_RunSCF();
@@ -704,10 +1083,19 @@ double MatPsi2::SCF_TotalEnergy() {
     return wfn_->EHF(); 
 }
 
+int MatPsi2::SCF_NumFockBuilds() { 
+    if(wfn_ == NULL) {
+        SCF_RunSCF();
+    }
+    return wfn_->fock_builds(); 
+}
+
 SharedMatrix MatPsi2::SCF_OrbitalAlpha() { 
     if(wfn_ == NULL) {
         SCF_RunSCF();
     }
+    if(wfn_->nirrep() > 1)
+        return wfn_->Ca_subset("AO", "ALL");
     return wfn_->Ca(); 
 }
 
@@ -715,6 +1103,8 @@ SharedMatrix MatPsi2::SCF_OrbitalBeta() {
     if(wfn_ == NULL) {
         SCF_RunSCF();
     }
+    if(wfn_->nirrep() > 1)
+        return wfn_->Cb_subset("AO", "ALL");
     return wfn_->Cb(); 
 }
 
@@ -722,6 +1112,8 @@ SharedVector MatPsi2::SCF_OrbEigValAlpha() {
     if(wfn_ == NULL) {
         SCF_RunSCF();
     }
+    if(wfn_->nirrep() > 1)
+        return wfn_->epsilon_a_subset("AO", "ALL");
     return wfn_->epsilon_a(); 
 }
 
@@ -729,6 +1121,8 @@ SharedVector MatPsi2::SCF_OrbEigValBeta() {
     if(wfn_ == NULL) {
         SCF_RunSCF();
     }
+    if(wfn_->nirrep() > 1)
+        return wfn_->epsilon_b_subset("AO", "ALL");
     return wfn_->epsilon_b(); 
 }
 
@@ -736,36 +1130,187 @@ SharedMatrix MatPsi2::SCF_DensityAlpha() {
     if(wfn_ == NULL) {
         SCF_RunSCF();
     }
-    return wfn_->Da(); 
+    return scf_ao_matrix(wfn_->Da()); 
 }
 
 SharedMatrix MatPsi2::SCF_DensityBeta() { 
     if(wfn_ == NULL) {
         SCF_RunSCF();
     }
-    return wfn_->Db(); 
+    return scf_ao_matrix(wfn_->Db()); 
 }
 
 SharedMatrix MatPsi2::SCF_FockAlpha() { 
     if(wfn_ == NULL) {
         SCF_RunSCF();
     }
-    return wfn_->Fa(); 
+    return scf_ao_matrix(wfn_->Fa()); 
 }
 
 SharedMatrix MatPsi2::SCF_FockBeta() { 
     if(wfn_ == NULL) {
         SCF_RunSCF();
     }
-    return wfn_->Fb(); 
+    return scf_ao_matrix(wfn_->Fb()); 
 }
 
 SharedMatrix MatPsi2::SCF_Gradient() {
     if(wfn_ == NULL) {
         SCF_RunSCF();
     }
-    scfgrad::SCFGrad scfgrad_ = scfgrad::SCFGrad(process_environment_);
-    return scfgrad_.compute_gradient();
+    // the two-electron gradient is computed with the JK algorithm of the energy 
+    Options& options = process_environment_.options;
+    std::string oldScfType = options.get_str("SCF_TYPE");
+    options.set_global_str("SCF_TYPE", jkType_ == "DFJK" ? "DF" : "DIRECT");
+    SharedMatrix gradient;
+    try {
+        scfgrad::SCFGrad scfgrad_ = scfgrad::SCFGrad(process_environment_);
+        gradient = scfgrad_.compute_gradient();
+    } catch(...) {
+        options.set_global_str("SCF_TYPE", oldScfType);
+        throw;
+    }
+    options.set_global_str("SCF_TYPE", oldScfType);
+    return gradient;
+}
+
+namespace {
+
+void run_worker_thread(boost::function<void ()> worker, int numThreads) {
+    omp_set_num_threads(numThreads);
+    try {
+        worker();
+    } catch(...) {
+    }
+}
+
+}
+
+void MatPsi2::release_worker_objects() {
+    process_environment_.set_wavefunction(boost::shared_ptr<Wavefunction>());
+    wfn_.reset();
+    jk_.reset();
+    scfJK_.reset();
+    scfPSIO_.reset();
+}
+
+std::vector<pid_t> MatPsi2::fork_workers(int numWorkers, int threadsPerWorker, boost::function<void ()> worker) {
+    fflush(outfile);
+    std::vector<pid_t> workers;
+    for(int w = 0; w < numWorkers; w++) {
+        pid_t pid = fork();
+        if(pid == 0) {
+            // a worker never returns into the caller 
+            try {
+                // the inherited PSIO objects list the scratch files of the parent, and the inherited JKs and wavefunction 
+                // share its descriptors; the lists are emptied and the objects dropped without finalize, so nothing 
+                // of the parent is closed or unlinked, and the worker opens its files in a directory of its own 
+                psio_->_psio_manager_ = boost::shared_ptr<PSIOManager>(new PSIOManager);
+                if(scfPSIO_ != NULL)
+                    scfPSIO_->_psio_manager_ = boost::shared_ptr<PSIOManager>(new PSIOManager);
+                release_worker_objects();
+                create_psio();
+                Settings_SetMaxNumCPUCores(threadsPerWorker);
+                process_environment_.set_memory(process_environment_.get_memory() / numWorkers);
+                // scratch files of this process are kept apart from those of the other workers 
+                PSIO::set_default_namespace("worker" + boost::lexical_cast<std::string>(getpid()));
+                // the OpenMP thread pool of this process does not survive fork, but a new thread starts a new one 
+                boost::thread thread(boost::bind(run_worker_thread, worker, threadsPerWorker));
+                thread.join();
+                // _exit runs no destructor; dropping the last references removes the files and the directory of the worker 
+                release_worker_objects();
+                process_environment_.set_psio(boost::shared_ptr<PSIO>());
+                psio_.reset();
+            } catch(...) {
+            }
+            _exit(0);
+        }
+        if(pid > 0)
+            workers.push_back(pid);
+    }
+    return workers;
+}
+
+void MatPsi2::hessian_worker(SharedMatrix geom, double displacement, const std::vector<SharedMatrix>& density, 
+        double* gradients, int* status, int* next) {
+    int ncart = 3 * molecule_->natom();
+    int ndisp = 2 * ncart;
+    while(true) {
+        int d = __sync_fetch_and_add(next, 1);
+        if(d >= ndisp)
+            break;
+        try {
+            // displacement d moves coordinate d / 2, forward when d is even 
+            SharedMatrix displaced = geom->clone();
+            displaced->add((d / 2) / 3, (d / 2) % 3, d % 2 ? -displacement : displacement);
+            Molecule_SetGeometry(displaced);
+            if(!jkType_.empty())
+                JK_Initialize(jkType_, jkAuxBasisName_);
+            SCF_SetGuessDensity(density[0], density.size() > 1 ? density[1] : SharedMatrix());
+            SCF_RunSCF();
+            SharedMatrix gradient = SCF_Gradient();
+            for(int i = 0; i < ncart; i++)
+                gradients[(size_t)d * ncart + i] = gradient->get(i / 3, i % 3);
+            status[d] = 1;
+        } catch(...) {
+            status[d] = -1;
+        }
+    }
+}
+
+SharedMatrix MatPsi2::SCF_Hessian(int numWorkers, double displacement) {
+    if(numWorkers < 1)
+        numWorkers = process_environment_.get_n_threads();
+    if(displacement <= 0.0)
+        throw PSIEXCEPTION("SCF_Hessian: The displacement must be positive.");
+    if(wfn_ == NULL)
+        SCF_RunSCF();
+    int ncart = 3 * molecule_->natom();
+    int ndisp = 2 * ncart;
+    SharedMatrix geom(new Matrix(molecule_->geometry()));
+    std::vector<SharedMatrix> density = scf_densities();
+    
+    // gradients and status (0 pending, 1 done, -1 failed) of every displacement, and the next one to take 
+    size_t bytes = sizeof(double) * ndisp * ncart + sizeof(int) * (ndisp + 1);
+    void* shared = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(shared == MAP_FAILED)
+        throw PSIEXCEPTION("SCF_Hessian: Could not map memory shared with the workers.");
+    double* gradients = (double*)shared;
+    int* status = (int*)(gradients + (size_t)ndisp * ncart);
+    int* next = status + ndisp;
+    
+    // the cores are split between the workers; this object is left as it is 
+    int threadsPerWorker = max(1, process_environment_.get_n_threads() / numWorkers);
+    std::vector<pid_t> workers = fork_workers(numWorkers, threadsPerWorker, 
+        boost::bind(&MatPsi2::hessian_worker, this, geom, displacement, density, gradients, status, next));
+    for(int w = 0; w < workers.size(); w++)
+        while(waitpid(workers[w], NULL, 0) < 0 && errno == EINTR);
+    
+    int numFailed = 0;
+    for(int d = 0; d < ndisp; d++)
+        if(status[d] != 1)
+            numFailed++;
+    if(workers.empty() || numFailed > 0) {
+        munmap(shared, bytes);
+        if(workers.empty())
+            throw PSIEXCEPTION("SCF_Hessian: No worker process could be started.");
+        throw PSIEXCEPTION("SCF_Hessian: " + boost::lexical_cast<std::string>(numFailed) + " displaced gradients failed.");
+    }
+    
+    // H_ij = (g_i(x + h e_j) - g_i(x - h e_j)) / 2h, then symmetrized 
+    SharedMatrix hessian(new Matrix("Hessian", ncart, ncart));
+    for(int j = 0; j < ncart; j++)
+        for(int i = 0; i < ncart; i++)
+            hessian->set(i, j, (gradients[(size_t)(2 * j) * ncart + i] - gradients[(size_t)(2 * j + 1) * ncart + i]) / (2.0 * displacement));
+    munmap(shared, bytes);
+    for(int i = 0; i < ncart; i++) {
+        for(int j = 0; j < i; j++) {
+            double average = 0.5 * (hessian->get(i, j) + hessian->get(j, i));
+            hessian->set(i, j, average);
+            hessian->set(j, i, average);
+        }
+    }
+    return hessian;
 }
 
 SharedMatrix MatPsi2::SCF_GuessDensity() {
@@ -780,7 +1325,7 @@ SharedMatrix MatPsi2::SCF_RHF_J() {
     }
     if(dynamic_cast<scf::RHF*>(wfn_.get()) == NULL)
         throw PSIEXCEPTION("SCF_RHF_J: This function works only for RHF.");
-    return boost::static_pointer_cast<scf::RHF>(wfn_)->J(); 
+    return scf_ao_matrix(boost::static_pointer_cast<scf::RHF>(wfn_)->J()); 
 }
 
 SharedMatrix MatPsi2::SCF_RHF_K() { 
@@ -789,7 +1334,509 @@ SharedMatrix MatPsi2::SCF_RHF_K() {
     }
     if(dynamic_cast<scf::RHF*>(wfn_.get()) == NULL)
         throw PSIEXCEPTION("SCF_RHF_K: This function works only for RHF.");
-    return boost::static_pointer_cast<scf::RHF>(wfn_)->K(); 
+    return scf_ao_matrix(boost::static_pointer_cast<scf::RHF>(wfn_)->K()); 
+}
+
+
+
+namespace {
+
+// XL-BOMD dissipation for K = 5 (Niklasson et al., J. Chem. Phys. 130, 214109 (2009)) 
+const int XLBOMD_K = 5;
+const double XLBOMD_KAPPA = 1.82;
+const double XLBOMD_ALPHA = 0.018;
+const double XLBOMD_C[XLBOMD_K + 1] = { -6.0, 14.0, -8.0, -3.0, 4.0, -1.0 };
+
+// Boltzmann constant in Hartree per Kelvin 
+const double KB_HARTREE = pc_kb / pc_hartree2J;
+
+// Y += a X for C1 matrices 
+void add_scaled(SharedMatrix Y, double a, SharedMatrix X) {
+    double* Yp = Y->pointer()[0];
+    double* Xp = X->pointer()[0];
+    size_t size = (size_t) Y->nrow() * Y->ncol();
+    for(size_t i = 0; i < size; i++)
+        Yp[i] += a * Xp[i];
+}
+
+double kinetic_energy(SharedMatrix velocities, const std::vector<double>& masses) {
+    double ekin = 0.0;
+    for(int a = 0; a < velocities->nrow(); a++)
+        for(int x = 0; x < 3; x++)
+            ekin += 0.5 * masses[a] * velocities->get(a, x) * velocities->get(a, x);
+    return ekin;
+}
+
+}
+
+std::vector<SharedMatrix> MatPsi2::scf_densities() {
+    std::vector<SharedMatrix> densities;
+    densities.push_back(scf_ao_matrix(wfn_->Da())->clone());
+    if(wfn_->Db() != wfn_->Da())
+        densities.push_back(scf_ao_matrix(wfn_->Db())->clone());
+    return densities;
+}
+
+void MatPsi2::BOMD_Initialize(SharedMatrix velocities, double timeStep) {
+    if(velocities->nrow() != molecule_->natom() || velocities->ncol() != 3)
+        throw PSIEXCEPTION("BOMD_Initialize: Velocities must be a NumAtoms by 3 matrix.");
+    if(timeStep <= 0.0)
+        throw PSIEXCEPTION("BOMD_Initialize: The time step must be positive.");
+    mdVelocities_ = velocities->clone();
+    mdTimeStep_ = timeStep;
+    mdTime_ = 0.0;
+    
+    // a converged start: forces, and an auxiliary density history at rest 
+    SCF_RunSCF();
+    mdForces_ = SCF_Gradient();
+    mdForces_->scale(-1.0);
+    mdSCFDensity_ = scf_densities();
+    mdDensityHistory_.clear();
+    for(int k = 0; k <= XLBOMD_K; k++) {
+        std::vector<SharedMatrix> P;
+        for(int s = 0; s < mdSCFDensity_.size(); s++)
+            P.push_back(mdSCFDensity_[s]->clone());
+        mdDensityHistory_.push_back(P);
+    }
+}
+
+void MatPsi2::BOMD_SetThermostat(double temperature, double couplingTime) {
+    if(temperature < 0.0)
+        throw PSIEXCEPTION("BOMD_SetThermostat: The temperature must not be negative.");
+    mdTemperature_ = temperature;
+    mdCouplingTime_ = couplingTime;
+}
+
+SharedMatrix MatPsi2::BOMD_Velocities() {
+    if(mdVelocities_ == NULL)
+        throw PSIEXCEPTION("BOMD_Velocities: BOMD_Initialize has not been called.");
+    return mdVelocities_->clone();
+}
+
+std::vector<SharedMatrix> MatPsi2::BOMD_Run(int numSteps) {
+    if(mdVelocities_ == NULL)
+        throw PSIEXCEPTION("BOMD_Run: BOMD_Initialize has not been called.");
+    if(mdSCFIterations_ < 1)
+        throw PSIEXCEPTION("BOMD_Run: At least one SCF iteration per step is needed.");
+    int natom = molecule_->natom();
+    std::vector<double> masses(natom);
+    for(int a = 0; a < natom; a++)
+        masses[a] = molecule_->mass(a) / pc_au2amu;
+    double dt = mdTimeStep_;
+    
+    SharedMatrix energies(new Matrix("BOMD Energies", numSteps, 5));
+    SharedMatrix positions(new Matrix("BOMD Positions", numSteps, 3 * natom));
+    SharedMatrix forces(new Matrix("BOMD Forces", numSteps, 3 * natom));
+    
+    // each step's SCF is short, and starts from the propagated density 
+    Options& options = process_environment_.options;
+    std::string oldGuess = options.get_str("GUESS");
+    int oldMaxIter = options.get_int("MAXITER");
+    bool oldFailOnMaxIter = options.get_bool("FAIL_ON_MAXITER");
+    options.set_global_int("MAXITER", mdSCFIterations_);
+    options.set_global_bool("FAIL_ON_MAXITER", false);
+    
+    try {
+        for(int step = 0; step < numSteps; step++) {
+            // velocity Verlet: half kick and drift 
+            SharedMatrix geom(new Matrix(molecule_->geometry()));
+            for(int a = 0; a < natom; a++) {
+                for(int x = 0; x < 3; x++) {
+                    mdVelocities_->add(a, x, 0.5 * dt * mdForces_->get(a, x) / masses[a]);
+                    geom->add(a, x, dt * mdVelocities_->get(a, x));
+                }
+            }
+            // integrals, sieves and DF tensors depend on the nuclei and are rebuilt; the JK algorithm is kept 
+            Molecule_SetGeometry(geom);
+            if(!jkType_.empty())
+                JK_Initialize(jkType_, jkAuxBasisName_);
+            
+            // P(t + dt) = 2P(t) - P(t - dt) + kappa (D(t) - P(t)) + alpha sum_k c_k P(t - k dt) 
+            std::vector<SharedMatrix> P;
+            for(int s = 0; s < mdSCFDensity_.size(); s++) {
+                SharedMatrix Pnew = mdDensityHistory_[0][s]->clone();
+                Pnew->scale(2.0 - XLBOMD_KAPPA);
+                add_scaled(Pnew, -1.0, mdDensityHistory_[1][s]);
+                add_scaled(Pnew, XLBOMD_KAPPA, mdSCFDensity_[s]);
+                for(int k = 0; k <= XLBOMD_K; k++)
+                    add_scaled(Pnew, XLBOMD_ALPHA * XLBOMD_C[k], mdDensityHistory_[k][s]);
+                P.push_back(Pnew);
+            }
+            mdDensityHistory_.pop_back();
+            mdDensityHistory_.insert(mdDensityHistory_.begin(), P);
+            
+            SCF_SetGuessDensity(P[0], P.size() > 1 ? P[1] : SharedMatrix());
+            double epot = SCF_RunSCF();
+            mdSCFDensity_ = scf_densities();
+            mdForces_ = SCF_Gradient();
+            mdForces_->scale(-1.0);
+            
+            // second half kick, then the Berendsen velocity scaling 
+            for(int a = 0; a < natom; a++)
+                for(int x = 0; x < 3; x++)
+                    mdVelocities_->add(a, x, 0.5 * dt * mdForces_->get(a, x) / masses[a]);
+            double ekin = kinetic_energy(mdVelocities_, masses);
+            double temperature = 2.0 * ekin / (3.0 * natom * KB_HARTREE);
+            if(mdCouplingTime_ > 0.0 && temperature > 0.0) {
+                double lambda = 1.0 + dt / mdCouplingTime_ * (mdTemperature_ / temperature - 1.0);
+                mdVelocities_->scale(sqrt(max(0.0, lambda)));
+                ekin = kinetic_energy(mdVelocities_, masses);
+                temperature = 2.0 * ekin / (3.0 * natom * KB_HARTREE);
+            }
+            mdTime_ += dt;
+            
+            energies->set(step, 0, mdTime_);
+            energies->set(step, 1, epot);
+            energies->set(step, 2, ekin);
+            energies->set(step, 3, epot + ekin);
+            energies->set(step, 4, temperature);
+            for(int a = 0; a < natom; a++) {
+                for(int x = 0; x < 3; x++) {
+                    positions->set(step, 3 * a + x, molecule_->xyz(a, x));
+                    forces->set(step, 3 * a + x, mdForces_->get(a, x));
+                }
+            }
+        }
+    } catch(...) {
+        options.set_global_str("GUESS", oldGuess);
+        options.set_global_int("MAXITER", oldMaxIter);
+        options.set_global_bool("FAIL_ON_MAXITER", oldFailOnMaxIter);
+        throw;
+    }
+    options.set_global_str("GUESS", oldGuess);
+    options.set_global_int("MAXITER", oldMaxIter);
+    options.set_global_bool("FAIL_ON_MAXITER", oldFailOnMaxIter);
+    
+    std::vector<SharedMatrix> trajectory;
+    trajectory.push_back(energies);
+    trajectory.push_back(positions);
+    trajectory.push_back(forces);
+    return trajectory;
 }
 
+SharedMatrix MatPsi2::Opt_Run(int maxIter, double convergence) {
+    if(maxIter < 1)
+        throw PSIEXCEPTION("Opt_Run: At least one step is needed.");
+    int natom = molecule_->natom();
+    std::vector<int> atomicNumbers(natom);
+    for(int a = 0; a < natom; a++)
+        atomicNumbers[a] = molecule_->true_atomic_number(a);
+    SharedMatrix geom(new Matrix(molecule_->geometry()));
+    RFOptimizer optimizer(InternalCoordinates(geom, atomicNumbers));
+    const InternalCoordinates& coords = optimizer.coordinates();
+    SharedMatrix P(new Matrix(coords.size(), coords.size()));
+    SharedMatrix steps(new Matrix("Optimization Steps", maxIter, 10));
+    
+    Options& options = process_environment_.options;
+    std::string oldGuess = options.get_str("GUESS");
+    double maxDisplacement = 0.0, rmsDisplacement = 0.0;
+    int numSteps = 0;
+    try {
+        for(int step = 0; step < maxIter; step++) {
+            double start = omp_get_wtime();
+            double energy;
+            {
+                diagnostics::PhaseTimer timer("Opt: SCF");
+                energy = SCF_RunSCF();
+            }
+            double scfEnd = omp_get_wtime();
+            SharedMatrix gradient;
+            {
+                diagnostics::PhaseTimer timer("Opt: Gradient");
+                gradient = SCF_Gradient();
+            }
+            double gradientEnd = omp_get_wtime();
+            
+            std::vector<double> q = coords.values(geom);
+            std::vector<double> g = coords.gradient(geom, gradient, P);
+            double maxForce = 0.0, rmsForce = 0.0;
+            for(int i = 0; i < g.size(); i++) {
+                maxForce = max(maxForce, fabs(g[i]));
+                rmsForce += g[i] * g[i];
+            }
+            rmsForce = sqrt(rmsForce / g.size());
+            steps->set(step, 0, step);
+            steps->set(step, 1, energy);
+            steps->set(step, 2, maxForce);
+            steps->set(step, 3, rmsForce);
+            steps->set(step, 4, maxDisplacement);
+            steps->set(step, 5, rmsDisplacement);
+            steps->set(step, 6, SCF_NumFockBuilds());
+            numSteps = step + 1;
+            
+            // Gaussian-style criteria, scaled from the maximum force 
+            bool converged = (maxForce < convergence && rmsForce < convergence * 2.0 / 3.0
+                && maxDisplacement < convergence * 4.0 && rmsDisplacement < convergence * 8.0 / 3.0)
+                || maxForce < convergence * 0.01;
+            if(!converged && step < maxIter - 1) {
+                diagnostics::PhaseTimer timer("Opt: Step");
+                SharedMatrix newGeom = coords.displace(geom, optimizer.step(q, energy, g, P));
+                maxDisplacement = rmsDisplacement = 0.0;
+                for(int a = 0; a < natom; a++) {
+                    for(int x = 0; x < 3; x++) {
+                        double dx = newGeom->get(a, x) - geom->get(a, x);
+                        maxDisplacement = max(maxDisplacement, fabs(dx));
+                        rmsDisplacement += dx * dx;
+                    }
+                }
+                rmsDisplacement = sqrt(rmsDisplacement / (3 * natom));
+                
+                // the next SCF starts from this converged density; the JK algorithm is kept 
+                std::vector<SharedMatrix> D = scf_densities();
+                Molecule_SetGeometry(newGeom);
+                if(!jkType_.empty())
+                    JK_Initialize(jkType_, jkAuxBasisName_);
+                SCF_SetGuessDensity(D[0], D.size() > 1 ? D[1] : SharedMatrix());
+                geom = newGeom;
+            }
+            double end = omp_get_wtime();
+            steps->set(step, 7, scfEnd - start);
+            steps->set(step, 8, gradientEnd - scfEnd);
+            steps->set(step, 9, end - gradientEnd);
+            fprintf(outfile, "  @Opt step %3d: E = %20.14f, max force %10.3e, rms force %10.3e, SCF %8.3f s, gradient %8.3f s\n",
+                step, energy, maxForce, rmsForce, scfEnd - start, gradientEnd - scfEnd);
+            if(converged)
+                break;
+        }
+    } catch(...) {
+        options.set_global_str("GUESS", oldGuess);
+        throw;
+    }
+    options.set_global_str("GUESS", oldGuess);
+    
+    SharedMatrix taken(new Matrix("Optimization Steps", numSteps, 10));
+    for(int i = 0; i < numSteps; i++)
+        for(int j = 0; j < 10; j++)
+            taken->set(i, j, steps->get(i, j));
+    return taken;
+}
+
+MatPsi2::BatchView MatPsi2::batch_view() {
+    size_t ncart = 3 * molecule_->natom();
+    size_t nbf2 = (size_t)basis_->nbf() * basis_->nbf();
+    BatchView view;
+    view.energies = (double*)batchShared_;
+    view.gradients = view.energies + batchNumJobs_;
+    view.densities = view.gradients + batchNumJobs_ * ncart;
+    view.status = (volatile int*)(view.densities + batchNumJobs_ * batchNumSpins_ * nbf2);
+    view.next = (int*)(view.status + batchNumJobs_);
+    return view;
+}
+
+void MatPsi2::batch_worker(SharedMatrix geometries, const std::vector<SharedMatrix>& reference) {
+    BatchView view = batch_view();
+    int natom = molecule_->natom();
+    int ncart = 3 * natom;
+    int nbf = basis_->nbf();
+    size_t nbf2 = (size_t)nbf * nbf;
+    SharedMatrix geom(new Matrix(natom, 3));
+    while(true) {
+        int job = __sync_fetch_and_add(view.next, 1);
+        if(job >= batchNumJobs_)
+            break;
+        view.status[job] = 1;
+        try {
+            for(int c = 0; c < ncart; c++)
+                geom->set(c / 3, c % 3, geometries->get(job, c));
+            
+            // start from the density of the nearest geometry already converged, by any worker 
+            int nearest = -1;
+            double nearestDistance = 0.0;
+            for(int j = 0; j < batchNumJobs_; j++) {
+                if(view.status[j] != 2)
+                    continue;
+                double distance = 0.0;
+                for(int c = 0; c < ncart; c++)
+                    distance += (geometries->get(job, c) - geometries->get(j, c)) * (geometries->get(job, c) - geometries->get(j, c));
+                if(nearest < 0 || distance < nearestDistance) {
+                    nearest = j;
+                    nearestDistance = distance;
+                }
+            }
+            __sync_synchronize();
+            Molecule_SetGeometry(geom);
+            if(!jkType_.empty())
+                JK_Initialize(jkType_, jkAuxBasisName_);
+            if(nearest >= 0) {
+                std::vector<SharedMatrix> density;
+                for(int s = 0; s < batchNumSpins_; s++) {
+                    density.push_back(SharedMatrix(new Matrix(nbf, nbf)));
+                    memcpy(density[s]->pointer()[0], view.densities + (nearest * batchNumSpins_ + s) * nbf2, nbf2 * sizeof(double));
+                }
+                SCF_SetGuessDensity(density[0], density.size() > 1 ? density[1] : SharedMatrix());
+            } else if(!reference.empty()) {
+                SCF_SetGuessDensity(reference[0], reference.size() > 1 ? reference[1] : SharedMatrix());
+            }
+            
+            view.energies[job] = SCF_RunSCF();
+            SharedMatrix gradient = SCF_Gradient();
+            for(int c = 0; c < ncart; c++)
+                view.gradients[(size_t)job * ncart + c] = gradient->get(c / 3, c % 3);
+            std::vector<SharedMatrix> density = scf_densities();
+            for(int s = 0; s < batchNumSpins_; s++)
+                memcpy(view.densities + (job * batchNumSpins_ + s) * nbf2, density[min(s, (int)density.size() - 1)]->pointer()[0], nbf2 * sizeof(double));
+            __sync_synchronize();
+            view.status[job] = 2;
+        } catch(...) {
+            view.status[job] = -1;
+        }
+    }
+}
+
+void MatPsi2::batch_finish() {
+    // workers of a batch not read to the end take no further job; they finish the current one rather than 
+    // being killed, so they still remove their scratch files 
+    if(batchShared_ != NULL && Batch_NumPending() > 0)
+        __sync_lock_test_and_set(batch_view().next, batchNumJobs_);
+    for(int w = 0; w < batchWorkers_.size(); w++)
+        while(waitpid(batchWorkers_[w], NULL, 0) < 0 && errno == EINTR);
+    batchWorkers_.clear();
+    if(batchShared_ != NULL)
+        munmap(batchShared_, batchBytes_);
+    batchShared_ = NULL;
+    batchBytes_ = 0;
+    batchNumJobs_ = 0;
+    batchDelivered_.clear();
+}
+
+void MatPsi2::Batch_Submit(SharedMatrix geometries, int threadsPerJob) {
+    int ncart = 3 * molecule_->natom();
+    if(geometries->nrow() < 1 || geometries->ncol() != ncart)
+        throw PSIEXCEPTION("Batch_Submit: Geometries must be rows of 3 * NumAtoms coordinates.");
+    if(threadsPerJob < 1)
+        throw PSIEXCEPTION("Batch_Submit: At least one thread per job is needed.");
+    batch_finish();
+    
+    std::string reference = process_environment_.options.get_str("REFERENCE");
+    batchNumSpins_ = (reference == "RHF" || reference == "RKS") ? 1 : 2;
+    batchNumJobs_ = geometries->nrow();
+    size_t nbf2 = (size_t)basis_->nbf() * basis_->nbf();
+    batchBytes_ = sizeof(double) * batchNumJobs_ * (1 + ncart + batchNumSpins_ * nbf2) + sizeof(int) * (batchNumJobs_ + 1);
+    batchShared_ = mmap(NULL, batchBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(batchShared_ == MAP_FAILED) {
+        batchShared_ = NULL;
+        batchNumJobs_ = 0;
+        throw PSIEXCEPTION("Batch_Submit: Could not map memory shared with the workers.");
+    }
+    batchDelivered_.assign(batchNumJobs_, false);
+    
+    // the converged density of this object, if there is one, starts the jobs with no converged neighbour yet 
+    std::vector<SharedMatrix> referenceDensity;
+    if(wfn_ != NULL && wfn_->Da() != NULL && wfn_->Da()->rms() > 0.0)
+        referenceDensity = scf_densities();
+    int numWorkers = max(1, min(batchNumJobs_, process_environment_.get_n_threads() / threadsPerJob));
+    batchWorkers_ = fork_workers(numWorkers, threadsPerJob, 
+        boost::bind(&MatPsi2::batch_worker, this, geometries->clone(), referenceDensity));
+    if(batchWorkers_.empty()) {
+        batch_finish();
+        throw PSIEXCEPTION("Batch_Submit: No worker process could be started.");
+    }
+}
+
+int MatPsi2::Batch_NumPending() {
+    int numPending = 0;
+    for(int j = 0; j < batchDelivered_.size(); j++)
+        if(!batchDelivered_[j])
+            numPending++;
+    return numPending;
+}
+
+std::vector<SharedMatrix> MatPsi2::Batch_Results(bool wait) {
+    int ncart = 3 * molecule_->natom();
+    std::vector<int> finished;
+    if(batchShared_ != NULL) {
+        BatchView view = batch_view();
+        while(true) {
+            // jobs left behind by workers that died have failed 
+            for(int w = batchWorkers_.size() - 1; w >= 0; w--)
+                if(waitpid(batchWorkers_[w], NULL, WNOHANG) > 0)
+                    batchWorkers_.erase(batchWorkers_.begin() + w);
+            bool workersLeft = !batchWorkers_.empty();
+            for(int j = 0; j < batchNumJobs_; j++) {
+                if(batchDelivered_[j])
+                    continue;
+                if(!workersLeft && view.status[j] != 2)
+                    view.status[j] = -1;
+                if(view.status[j] == 2 || view.status[j] == -1)
+                    finished.push_back(j);
+            }
+            if(!finished.empty() || !wait)
+                break;
+            usleep(10000);
+        }
+    }
+    
+    SharedMatrix indices(new Matrix("Batch Jobs", finished.size(), 1));
+    SharedMatrix energies(new Matrix("Batch Energies", finished.size(), 1));
+    SharedMatrix gradients(new Matrix("Batch Gradients", finished.size(), ncart));
+    if(!finished.empty()) {
+        __sync_synchronize();
+        BatchView view = batch_view();
+        for(int i = 0; i < finished.size(); i++) {
+            int j = finished[i];
+            bool failed = view.status[j] != 2;
+            indices->set(i, 0, j);
+            energies->set(i, 0, failed ? std::numeric_limits<double>::quiet_NaN() : view.energies[j]);
+            for(int c = 0; c < ncart; c++)
+                gradients->set(i, c, failed ? std::numeric_limits<double>::quiet_NaN() : view.gradients[(size_t)j * ncart + c]);
+            batchDelivered_[j] = true;
+        }
+        if(Batch_NumPending() == 0)
+            batch_finish();
+    }
+    
+    std::vector<SharedMatrix> results;
+    results.push_back(indices);
+    results.push_back(energies);
+    results.push_back(gradients);
+    return results;
+}
+
+std::vector<SharedMatrix> MatPsi2::Batch_EnergyGradient(SharedMatrix geometries, int threadsPerJob) {
+    Batch_Submit(geometries, threadsPerJob);
+    int numJobs = geometries->nrow();
+    SharedMatrix energies(new Matrix("Batch Energies", numJobs, 1));
+    SharedMatrix gradients(new Matrix("Batch Gradients", numJobs, geometries->ncol()));
+    int numFailed = 0;
+    while(Batch_NumPending() > 0) {
+        std::vector<SharedMatrix> finished = Batch_Results(true);
+        for(int i = 0; i < finished[0]->nrow(); i++) {
+            int j = (int)finished[0]->get(i, 0);
+            energies->set(j, 0, finished[1]->get(i, 0));
+            for(int c = 0; c < geometries->ncol(); c++)
+                gradients->set(j, c, finished[2]->get(i, c));
+            if(finished[1]->get(i, 0) != finished[1]->get(i, 0))
+                numFailed++;
+        }
+    }
+    if(numFailed > 0)
+        throw PSIEXCEPTION("Batch_EnergyGradient: " + boost::lexical_cast<std::string>(numFailed) + " geometries failed.");
+    
+    std::vector<SharedMatrix> results;
+    results.push_back(energies);
+    results.push_back(gradients);
+    return results;
+}
+
+SharedMatrix MatPsi2::Diagnostics_Timings(std::string traceFile) {
+    if(!traceFile.empty())
+        diagnostics::write_chrome_trace(traceFile);
+    std::vector<diagnostics::PhaseRecord> table = diagnostics::phase_table();
+    SharedMatrix timings(new Matrix(table.size(), 3 + diagnostics::NumCounters));
+    for(int i = 0; i < table.size(); i++) {
+        timings->set(i, 0, table[i].iteration);
+        timings->set(i, 1, table[i].calls);
+        timings->set(i, 2, table[i].wall);
+        for(int c = 0; c < diagnostics::NumCounters; c++)
+            timings->set(i, 3 + c, table[i].counters[c]);
+    }
+    return timings;
+}
 
+std::vector<std::string> MatPsi2::Diagnostics_PhaseNames() {
+    std::vector<diagnostics::PhaseRecord> table = diagnostics::phase_table();
+    std::vector<std::string> names;
+    for(int i = 0; i < table.size(); i++)
+        names.push_back(table[i].name);
+    return names;
+}
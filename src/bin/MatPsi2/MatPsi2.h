@@ -1,18 +1,26 @@
 #include <libmints/mints.h>
 #include <libfock/jk.h>
 #include <libfock/v.h>
+#include <libfock/cubature.h>
+#include <libfock/pointprop.h>
 #include <psi4-dec.h>
 #include <libparallel/parallel.h>
 #include <boost/shared_array.hpp>
 #include <libpsio/psio.h>
 #include <libpsio/psio.hpp>
+#include <libqt/diagnostics.h>
 #include <libscf_solver/rhf.h>
 #include <libscf_solver/ks.h>
 #include <boost/regex.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <sys/types.h>
 
 #include <libscfgrad/scf_grad.h>
+#include "optimizer.h"
 
 
 using namespace std;
@@ -34,9 +42,63 @@ protected:
     boost::shared_ptr<MatrixFactory> matfac_;
     boost::shared_ptr<JK> jk_;
     boost::shared_ptr<VBase> dftPotential_;
+    boost::shared_ptr<DFTGridContext> dftGridContext_; // grid shared by all DFT_Initialize calls 
     boost::shared_ptr<scf::HF> wfn_;
     
     std::vector<SharedMatrix> guessOrbital_;
+    std::vector<SharedMatrix> guessDensity_;
+    
+    // JK algorithm and auxiliary basis of the last JK_Initialize, restored after each MD step 
+    std::string jkType_;
+    std::string jkAuxBasisName_;
+    
+    // point-group symmetry of the SCF; everything else stays in C1 
+    bool scfSymmetry_;
+    double scfSymmetryTolerance_; // Bohr 
+    std::string scfPointGroup_; // point group of the current wavefunction 
+    boost::shared_ptr<JK> scfJK_; // JK in the SO basis of a symmetric SCF, with scratch files of its own 
+    boost::shared_ptr<PSIO> scfPSIO_; // scratch files of scfJK_ 
+    
+    // Born-Oppenheimer MD state, atomic units 
+    double mdTimeStep_;
+    double mdTime_;
+    double mdTemperature_; // Berendsen target temperature (K) 
+    double mdCouplingTime_; // Berendsen coupling time; NVE if not positive 
+    int mdSCFIterations_;
+    SharedMatrix mdVelocities_;
+    SharedMatrix mdForces_;
+    std::vector<SharedMatrix> mdSCFDensity_; // SCF density (alpha, and beta if unrestricted) of the current step 
+    std::vector< std::vector<SharedMatrix> > mdDensityHistory_; // XL-BOMD auxiliary densities P(t), P(t - dt), ... 
+    
+    // SCF densities of the current wavefunction 
+    std::vector<SharedMatrix> scf_densities();
+    
+    // batch of geometries evaluated by forked workers, which write into memory shared with this process 
+    struct BatchView {
+        double* energies; // per job 
+        double* gradients; // per job, 3 natom 
+        double* densities; // per job, alpha (and beta if unrestricted) nbf by nbf 
+        volatile int* status; // per job: 0 pending, 1 running, 2 done, -1 failed 
+        int* next; // next job to take 
+    };
+    void* batchShared_;
+    size_t batchBytes_;
+    int batchNumJobs_;
+    int batchNumSpins_;
+    std::vector<bool> batchDelivered_;
+    std::vector<pid_t> batchWorkers_;
+    BatchView batch_view();
+    void batch_worker(SharedMatrix geometries, const std::vector<SharedMatrix>& reference);
+    void batch_finish(); // stop and reap the workers, and unmap the shared memory 
+    
+    // fork copies of this object that each run worker with threadsPerWorker threads and exit 
+    std::vector<pid_t> fork_workers(int numWorkers, int threadsPerWorker, boost::function<void ()> worker);
+    // drop the wavefunction and the JKs with their PSIO references, without finalize 
+    void release_worker_objects();
+    
+    // forked Hessian worker: takes displacements from the shared counter until none are left 
+    void hessian_worker(SharedMatrix geom, double displacement, const std::vector<SharedMatrix>& density, 
+        double* gradients, int* status, int* next);
     
     // create psio object 
     void create_psio();
@@ -44,7 +106,24 @@ protected:
     // create basis object and one & two electron integral factories 
     void create_basis_and_integral_factories();
     
-    void create_wfn();
+    // JK object of the current point group of the molecule 
+    boost::shared_ptr<JK> create_jk(const std::string& jktype, const std::string& auxBasisName, boost::shared_ptr<PSIO> psio);
+    
+    void create_wfn(boost::shared_ptr<JK> jk = boost::shared_ptr<JK>());
+    
+    // finalize and drop scfJK_ and its scratch files 
+    void release_scf_jk();
+    
+    // throws when the guess of the GUESS option does not fit the basis and the occupation of wfn_ 
+    void check_scf_guess();
+    
+    // highest Abelian point group of the geometry as it is (C1 if symmetry is off), which is symmetrized to it 
+    boost::shared_ptr<PointGroup> scf_point_group();
+    
+    // a totally symmetric matrix of the current wavefunction, in the C1 AO basis 
+    SharedMatrix scf_ao_matrix(SharedMatrix soMatrix);
+    // and its totally symmetric part in the SO basis, U^T M U 
+    SharedMatrix scf_so_matrix(SharedMatrix aoMatrix);
     
     // exception function for DFJK utilities
     void jk_DFException(std::string functionName);
@@ -112,6 +191,8 @@ public:
     void Integrals_AllTEIs(double*); // all (repetitive) TEIs in a 4D-array 
     void Integrals_IndicesForK(double*, double*); // pre-arrange TEI vectors for forming K 
     // ## HIGH MEMORY COST METHODS ## 
+    SharedMatrix Integrals_ERIThroughput(); // per ERI class (a b|c d): a, b, c, d, unique quartets, quartets/s as dispatched, quartets/s with libint only, quartets/s through compute_shells 
+    SharedMatrix Integrals_BoysThroughput(); // per order J of F_0(T) .. F_J(T): J, calls/s of the table one T at a time, of the table batched, of the series, then the max absolute and relative error against the series 
     
     
     //*** JK related
@@ -139,12 +220,20 @@ public:
     std::vector<SharedMatrix> DFT_DensToV(SharedMatrix, SharedMatrix = SharedMatrix());
     std::vector<SharedMatrix> DFT_OccOrbToV(SharedMatrix, SharedMatrix = SharedMatrix());
     double DFT_EnergyXC();
+    SharedMatrix DFT_BlockStatistics();
+    
+    
+    //*** Properties on a list of points (npoints by 3, Bohr)
+    SharedMatrix Points_Density(SharedMatrix points, SharedMatrix densAlpha, SharedMatrix densBeta = SharedMatrix()); // rho and its gradient, npoints by 4 
+    SharedMatrix Points_Orbitals(SharedMatrix points, SharedMatrix orbitals); // values of the given orbital columns 
+    SharedVector Points_ESP(SharedMatrix points, SharedMatrix densAlpha, SharedMatrix densBeta = SharedMatrix()); // nuclear + electronic electrostatic potential 
     
     
     //*** SCF related
     // method of doing RHF calculations 
     void SCF_SetSCFType(std::string scfType);
     void SCF_SetGuessOrb(SharedMatrix, SharedMatrix = SharedMatrix());
+    void SCF_SetGuessDensity(SharedMatrix, SharedMatrix = SharedMatrix()); // start from a density; need not be idempotent 
     double SCF_RunSCF();
     
     // methods controlling RHF algorithm 
@@ -152,8 +241,16 @@ public:
     void SCF_EnableDamping(double damping_percentage);
     void SCF_EnableDIIS();
     void SCF_DisableDIIS();
+    void SCF_EnableSOSCF(double start_convergence); // Newton steps once DIIS stalls below an RMS orbital gradient of start_convergence 
+    void SCF_DisableSOSCF();
+    void SCF_SetInitialAcceleration(const std::string& type); // "ADIIS", "EDIIS" (blended into DIIS far from convergence) or "NONE" 
+    void SCF_SetDensityUpdate(const std::string& type); // "DIAGONALIZE", "PURIFICATION" or "PARTIAL_EIGEN" (orbitals formed only at convergence) 
     void SCF_GuessSAD();
+    void SCF_SetSADLibrary(const std::string& path) { process_environment_.options.set_global_str("SAD_LIBRARY", path); } // file of atomic SAD densities shared between runs; "" for memory only 
     void SCF_GuessCore();
+    void SCF_EnableSymmetry(double tolerance = 1.0e-5); // SCF in the highest Abelian subgroup of the geometry as given (no reorientation), symmetrized within tolerance (Bohr); results stay in the C1 AO basis 
+    void SCF_DisableSymmetry();
+    const std::string& SCF_PointGroup(); // point group the SCF ran in 
     
     // methods extracting restricted Hartree-Fock results
     double SCF_TotalEnergy();
@@ -167,10 +264,41 @@ public:
     SharedMatrix SCF_FockAlpha();
     SharedMatrix SCF_FockBeta();
     SharedMatrix SCF_GuessDensity();
+    int SCF_NumFockBuilds(); // Fock (JK) builds of the last SCF, SOSCF Hessian products included 
     
     SharedMatrix SCF_Gradient();
+    SharedMatrix SCF_Hessian(int numWorkers = 0, double displacement = 0.005); // symmetrized central differences of gradients over forked workers, one per core by default 
     
     SharedMatrix SCF_RHF_J();
     SharedMatrix SCF_RHF_K();
     
+    
+    //*** Born-Oppenheimer molecular dynamics with extended-Lagrangian density propagation (XL-BOMD), atomic units 
+    void BOMD_Initialize(SharedMatrix velocities, double timeStep); // natom by 3 velocities; runs a converged SCF and gradient 
+    void BOMD_SetThermostat(double temperature, double couplingTime); // Berendsen; couplingTime <= 0 for NVE 
+    void BOMD_SetSCFIterations(int iterations) { mdSCFIterations_ = iterations; } // SCF iterations per step, from the propagated density 
+    std::vector<SharedMatrix> BOMD_Run(int numSteps); // {time Epot Ekin Etotal temperature; positions; forces}, one row per step 
+    SharedMatrix BOMD_Velocities();
+    double BOMD_Time() { return mdTime_; }
+    
+    
+    //*** Geometry optimization in redundant internal coordinates (RFO with BFGS updates), atomic units 
+    // one row per step: step energy maxForce rmsForce maxDisplacement rmsDisplacement FockBuilds SCFSeconds gradientSeconds stepSeconds (step and geometry update) 
+    // the molecule is left at the last geometry 
+    SharedMatrix Opt_Run(int maxIter, double convergence = 4.5E-4);
+    
+    
+    //*** Energies and gradients of many geometries of this molecule (rows of natom * 3, Bohr) by forked workers, 
+    // each SCF starting from the density of the nearest geometry already converged 
+    void Batch_Submit(SharedMatrix geometries, int threadsPerJob = 1); // returns at once; cores / threadsPerJob workers 
+    std::vector<SharedMatrix> Batch_Results(bool wait = true); // {job indices; energies; gradients} finished since the last call, NaN if failed 
+    int Batch_NumPending(); // jobs not yet returned by Batch_Results 
+    std::vector<SharedMatrix> Batch_EnergyGradient(SharedMatrix geometries, int threadsPerJob = 1); // {energies; gradients}, one row per geometry 
+    
+    
+    //*** Performance diagnostics (process-wide, since the last reset)
+    SharedMatrix Diagnostics_Timings(std::string traceFile = ""); // per iteration and phase: iteration, calls, wall seconds, then one column per counter; traceFile gets the last 4096 phases 
+    std::vector<std::string> Diagnostics_PhaseNames(); // phase name of each Diagnostics_Timings row 
+    void Diagnostics_Reset() { diagnostics::reset(); }
+    
 };
@@ -50,6 +50,12 @@ void OutputScalar(mxArray*& Mat_m, double scalar) {
     *Mat_m_pt = scalar;
 }
 
+void OutputStrings(mxArray*& Cell_m, const std::vector<std::string>& strings) {
+    Cell_m = mxCreateCellMatrix(strings.size(), 1);
+    for(int i = 0; i < strings.size(); i++)
+        mxSetCell(Cell_m, i, mxCreateString(strings[i].c_str()));
+}
+
 void OutputVectorOfSymmMatrices(mxArray*& Mat_m, std::vector<SharedMatrix> vecOfMats) {
 	int ndim1 = vecOfMats[0]->ncol();
 	int ndim2 = vecOfMats[0]->nrow();
@@ -65,6 +71,23 @@ void OutputVectorOfSymmMatrices(mxArray*& Mat_m, std::vector<SharedMatrix> vecOf
 	}
 }
 
+// each row of Mat_c holds the lower triangle of a symmetric ndim x ndim matrix; unpacked straight into an ndim x ndim x nrow array 
+void OutputPackedSymmMatrices(mxArray*& Mat_m, SharedMatrix Mat_c, int ndim) {
+	int nmat = Mat_c->nrow();
+	mwSize dims[3] = {ndim, ndim, nmat};
+	Mat_m = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+	double* Mat_m_pt = mxGetPr(Mat_m);
+	for(int imat = 0; imat < nmat; imat++) {
+		const double* tri = Mat_c->pointer()[imat];
+		double* full = Mat_m_pt + (size_t)imat * ndim * ndim;
+		for(int i = 0; i < ndim; i++) {
+			for(int j = 0; j <= i; j++) {
+				full[(size_t)i * ndim + j] = full[(size_t)j * ndim + i] = tri[(size_t)i * (i + 1) / 2 + j];
+			}
+		}
+	}
+}
+
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
     // Get the command string
     char cmd[64];
@@ -335,6 +358,14 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
         MatPsi_obj->Integrals_IndicesForK(matpt1, matpt2);
         return;
     }
+    if (!strcmp("Integrals_ERIThroughput", cmd)) {
+        OutputMatrix(plhs[0], MatPsi_obj->Integrals_ERIThroughput());
+        return;
+    }
+    if (!strcmp("Integrals_BoysThroughput", cmd)) {
+        OutputMatrix(plhs[0], MatPsi_obj->Integrals_BoysThroughput());
+        return;
+    }
     
     //*** JK related  
     if (!strcmp("JK_Initialize", cmd)) {
@@ -427,7 +458,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
         return;
     }
     if (!strcmp("JK_DFTensor_AuxPriPri", cmd)) {
-        OutputVectorOfSymmMatrices(plhs[0], MatPsi_obj->JK_DFTensor_AuxPriPri());
+        OutputPackedSymmMatrices(plhs[0], MatPsi_obj->JK_DFTensor_AuxPriPairs(), MatPsi_obj->BasisSet_NumFunctions());
         return;
     }
     if (!strcmp("JK_DFMetric_InvJHalf", cmd)) {
@@ -469,6 +500,36 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
         OutputScalar(plhs[0], MatPsi_obj->DFT_EnergyXC());
         return;
     }
+    if (!strcmp("DFT_BlockStatistics", cmd)) {
+        OutputMatrix(plhs[0], MatPsi_obj->DFT_BlockStatistics());
+        return;
+    }
+    
+    //*** Properties on points 
+    if (!strcmp("Points_Density", cmd)) {
+        if (nrhs==4 && mxGetN(prhs[2]) == 3 && mxGetM(prhs[3]) == nbf && mxGetN(prhs[3]) == nbf)
+            OutputMatrix(plhs[0], MatPsi_obj->Points_Density(InputMatrix(prhs[2]), InputMatrix(prhs[3])));
+        else if (nrhs==5 && mxGetN(prhs[2]) == 3 && mxGetM(prhs[3]) == nbf && mxGetN(prhs[3]) == nbf && mxGetM(prhs[4]) == nbf && mxGetN(prhs[4]) == nbf)
+            OutputMatrix(plhs[0], MatPsi_obj->Points_Density(InputMatrix(prhs[2]), InputMatrix(prhs[3]), InputMatrix(prhs[4])));
+        else
+            mexErrMsgTxt("Points_Density(points, densAlpha, densBeta): npoints by 3 matrix and 1 or 2 nbf by nbf matrix(ces) input expected.");
+        return;
+    }
+    if (!strcmp("Points_Orbitals", cmd)) {
+        if (nrhs!=4 || mxGetN(prhs[2]) != 3 || mxGetM(prhs[3]) != nbf)
+            mexErrMsgTxt("Points_Orbitals(points, orbitals): npoints by 3 matrix and nbf by any matrix input expected.");
+        OutputMatrix(plhs[0], MatPsi_obj->Points_Orbitals(InputMatrix(prhs[2]), InputMatrix(prhs[3])));
+        return;
+    }
+    if (!strcmp("Points_ESP", cmd)) {
+        if (nrhs==4 && mxGetN(prhs[2]) == 3 && mxGetM(prhs[3]) == nbf && mxGetN(prhs[3]) == nbf)
+            OutputVector(plhs[0], MatPsi_obj->Points_ESP(InputMatrix(prhs[2]), InputMatrix(prhs[3])));
+        else if (nrhs==5 && mxGetN(prhs[2]) == 3 && mxGetM(prhs[3]) == nbf && mxGetN(prhs[3]) == nbf && mxGetM(prhs[4]) == nbf && mxGetN(prhs[4]) == nbf)
+            OutputVector(plhs[0], MatPsi_obj->Points_ESP(InputMatrix(prhs[2]), InputMatrix(prhs[3]), InputMatrix(prhs[4])));
+        else
+            mexErrMsgTxt("Points_ESP(points, densAlpha, densBeta): npoints by 3 matrix and 1 or 2 nbf by nbf matrix(ces) input expected.");
+        return;
+    }
     
     //*** SCF related 
     if (!strcmp("SCF_SetSCFType", cmd)) {
@@ -487,6 +548,15 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
             mexErrMsgTxt("SCF_SetGuessOrb(occOrbAlpha, occOrbBeta): 1 or 2 nbf by any matrix(ces) input expected.");
         return;
     }
+    if (!strcmp("SCF_SetGuessDensity", cmd)) {
+        if (nrhs==3 && mxGetM(prhs[2]) == nbf && mxGetN(prhs[2]) == nbf)
+            MatPsi_obj->SCF_SetGuessDensity(InputMatrix(prhs[2]));
+        else if (nrhs==4 && mxGetM(prhs[2]) == nbf && mxGetN(prhs[2]) == nbf && mxGetM(prhs[3]) == nbf && mxGetN(prhs[3]) == nbf)
+            MatPsi_obj->SCF_SetGuessDensity(InputMatrix(prhs[2]), InputMatrix(prhs[3]));
+        else
+            mexErrMsgTxt("SCF_SetGuessDensity(densAlpha, densBeta): 1 or 2 nbf by nbf matrix(ces) input expected.");
+        return;
+    }
     
     
     if (!strcmp("SCF_RunSCF", cmd)) {
@@ -529,14 +599,64 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
         MatPsi_obj->SCF_DisableDIIS();
         return;
     }
+    if (!strcmp("SCF_EnableSOSCF", cmd)) {
+        if (nrhs == 2) {
+            MatPsi_obj->SCF_EnableSOSCF(1.0e-3);
+            return;
+        }
+        if (nrhs!=3 || mxGetM(prhs[2])!=1 || mxGetN(prhs[2])!=1)
+            mexErrMsgTxt("SCF_EnableSOSCF(start_convergence): 1 double input expected.");
+        MatPsi_obj->SCF_EnableSOSCF(InputScalar(prhs[2]));
+        return;
+    }
+    if (!strcmp("SCF_DisableSOSCF", cmd)) {
+        MatPsi_obj->SCF_DisableSOSCF();
+        return;
+    }
+    if (!strcmp("SCF_SetInitialAcceleration", cmd)) {
+        if (nrhs!=3 || !mxIsChar(prhs[2]))
+            mexErrMsgTxt("SCF_SetInitialAcceleration(type): 1 string input expected.");
+        MatPsi_obj->SCF_SetInitialAcceleration((std::string)mxArrayToString(prhs[2]));
+        return;
+    }
+    if (!strcmp("SCF_SetDensityUpdate", cmd)) {
+        if (nrhs!=3 || !mxIsChar(prhs[2]))
+            mexErrMsgTxt("SCF_SetDensityUpdate(type): 1 string input expected.");
+        MatPsi_obj->SCF_SetDensityUpdate((std::string)mxArrayToString(prhs[2]));
+        return;
+    }
     if (!strcmp("SCF_GuessSAD", cmd)) {
         MatPsi_obj->SCF_GuessSAD();
         return;
     }
+    if (!strcmp("SCF_SetSADLibrary", cmd)) {
+        if (nrhs!=3 || !mxIsChar(prhs[2]))
+            mexErrMsgTxt("SCF_SetSADLibrary(\"path\"): Library file name string expected (empty for memory only).");
+        MatPsi_obj->SCF_SetSADLibrary((std::string)mxArrayToString(prhs[2]));
+        return;
+    }
     if (!strcmp("SCF_GuessCore", cmd)) {
         MatPsi_obj->SCF_GuessCore();
         return;
     }
+    if (!strcmp("SCF_EnableSymmetry", cmd)) {
+        if (nrhs == 2) {
+            MatPsi_obj->SCF_EnableSymmetry();
+            return;
+        }
+        if (nrhs!=3 || mxGetM(prhs[2])!=1 || mxGetN(prhs[2])!=1)
+            mexErrMsgTxt("SCF_EnableSymmetry(tolerance): No input, or 1 double input (Bohr) expected.");
+        MatPsi_obj->SCF_EnableSymmetry(InputScalar(prhs[2]));
+        return;
+    }
+    if (!strcmp("SCF_DisableSymmetry", cmd)) {
+        MatPsi_obj->SCF_DisableSymmetry();
+        return;
+    }
+    if (!strcmp("SCF_PointGroup", cmd)) {
+        plhs[0] = mxCreateString((MatPsi_obj->SCF_PointGroup()).c_str());
+        return;
+    }
     if (!strcmp("SCF_TotalEnergy", cmd)) {
         OutputScalar(plhs[0], MatPsi_obj->SCF_TotalEnergy());
         return;
@@ -577,10 +697,25 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
         OutputMatrix(plhs[0], MatPsi_obj->SCF_Gradient());
         return;
     }
+    if (!strcmp("SCF_Hessian", cmd)) {
+        if (nrhs==2)
+            OutputMatrix(plhs[0], MatPsi_obj->SCF_Hessian());
+        else if (nrhs==3 && mxGetM(prhs[2])==1 && mxGetN(prhs[2])==1)
+            OutputMatrix(plhs[0], MatPsi_obj->SCF_Hessian((int)InputScalar(prhs[2])));
+        else if (nrhs==4 && mxGetM(prhs[2])==1 && mxGetN(prhs[2])==1 && mxGetM(prhs[3])==1 && mxGetN(prhs[3])==1)
+            OutputMatrix(plhs[0], MatPsi_obj->SCF_Hessian((int)InputScalar(prhs[2]), InputScalar(prhs[3])));
+        else
+            mexErrMsgTxt("SCF_Hessian(numWorkers, displacement): No input, an integer number of workers, and optionally a scalar displacement in Bohr, expected.");
+        return;
+    }
     if (!strcmp("SCF_GuessDensity", cmd)) {
         OutputMatrix(plhs[0], MatPsi_obj->SCF_GuessDensity());
         return;
     }
+    if (!strcmp("SCF_NumFockBuilds", cmd)) {
+        OutputScalar(plhs[0], MatPsi_obj->SCF_NumFockBuilds());
+        return;
+    }
     if (!strcmp("SCF_RHF_J", cmd)) {
         OutputMatrix(plhs[0], MatPsi_obj->SCF_RHF_J());
         return;
@@ -590,6 +725,120 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
         return;
     }
     
+    //*** Born-Oppenheimer molecular dynamics 
+    if (!strcmp("BOMD_Initialize", cmd)) {
+        if (nrhs!=4 || mxGetM(prhs[2]) != MatPsi_obj->Molecule_NumAtoms() || mxGetN(prhs[2]) != 3 || mxGetM(prhs[3])!=1 || mxGetN(prhs[3])!=1)
+            mexErrMsgTxt("BOMD_Initialize(velocities, timeStep): NumAtoms by 3 matrix and 1 scalar input expected.");
+        MatPsi_obj->BOMD_Initialize(InputMatrix(prhs[2]), InputScalar(prhs[3]));
+        return;
+    }
+    if (!strcmp("BOMD_SetThermostat", cmd)) {
+        if (nrhs!=4 || mxGetM(prhs[2])!=1 || mxGetN(prhs[2])!=1 || mxGetM(prhs[3])!=1 || mxGetN(prhs[3])!=1)
+            mexErrMsgTxt("BOMD_SetThermostat(temperature, couplingTime): 2 scalar inputs expected.");
+        MatPsi_obj->BOMD_SetThermostat(InputScalar(prhs[2]), InputScalar(prhs[3]));
+        return;
+    }
+    if (!strcmp("BOMD_SetSCFIterations", cmd)) {
+        if (nrhs!=3 || mxGetM(prhs[2])!=1 || mxGetN(prhs[2])!=1)
+            mexErrMsgTxt("BOMD_SetSCFIterations(iterations): Integer input expected.");
+        MatPsi_obj->BOMD_SetSCFIterations((int)InputScalar(prhs[2]));
+        return;
+    }
+    if (!strcmp("BOMD_Run", cmd)) {
+        if (nrhs!=3 || mxGetM(prhs[2])!=1 || mxGetN(prhs[2])!=1)
+            mexErrMsgTxt("BOMD_Run(numSteps): Integer input expected.");
+        std::vector<SharedMatrix> trajectory = MatPsi_obj->BOMD_Run((int)InputScalar(prhs[2]));
+        OutputMatrix(plhs[0], trajectory[0]);
+        if (nlhs > 1)
+            OutputMatrix(plhs[1], trajectory[1]);
+        if (nlhs > 2)
+            OutputMatrix(plhs[2], trajectory[2]);
+        return;
+    }
+    if (!strcmp("BOMD_Velocities", cmd)) {
+        OutputMatrix(plhs[0], MatPsi_obj->BOMD_Velocities());
+        return;
+    }
+    if (!strcmp("BOMD_Time", cmd)) {
+        OutputScalar(plhs[0], MatPsi_obj->BOMD_Time());
+        return;
+    }
+    
+    //*** Geometry optimization 
+    if (!strcmp("Opt_Run", cmd)) {
+        if (nrhs==3 && mxGetM(prhs[2])==1 && mxGetN(prhs[2])==1)
+            OutputMatrix(plhs[0], MatPsi_obj->Opt_Run((int)InputScalar(prhs[2])));
+        else if (nrhs==4 && mxGetM(prhs[2])==1 && mxGetN(prhs[2])==1 && mxGetM(prhs[3])==1 && mxGetN(prhs[3])==1)
+            OutputMatrix(plhs[0], MatPsi_obj->Opt_Run((int)InputScalar(prhs[2]), InputScalar(prhs[3])));
+        else
+            mexErrMsgTxt("Opt_Run(maxIter, convergence): Integer maximum number of steps, and optionally a scalar force threshold, expected.");
+        return;
+    }
+    
+    //*** Batched energies and gradients 
+    if (!strcmp("Batch_Submit", cmd)) {
+        if (nrhs==3 && mxGetN(prhs[2]) == 3 * MatPsi_obj->Molecule_NumAtoms())
+            MatPsi_obj->Batch_Submit(InputMatrix(prhs[2]));
+        else if (nrhs==4 && mxGetN(prhs[2]) == 3 * MatPsi_obj->Molecule_NumAtoms() && mxGetM(prhs[3])==1 && mxGetN(prhs[3])==1)
+            MatPsi_obj->Batch_Submit(InputMatrix(prhs[2]), (int)InputScalar(prhs[3]));
+        else
+            mexErrMsgTxt("Batch_Submit(geometries, threadsPerJob): NumGeometries by 3*NumAtoms matrix, and optionally an integer number of threads per job, expected.");
+        return;
+    }
+    if (!strcmp("Batch_Results", cmd)) {
+        std::vector<SharedMatrix> results;
+        if (nrhs==2)
+            results = MatPsi_obj->Batch_Results();
+        else if (nrhs==3 && mxGetM(prhs[2])==1 && mxGetN(prhs[2])==1)
+            results = MatPsi_obj->Batch_Results(InputScalar(prhs[2]) != 0);
+        else
+            mexErrMsgTxt("Batch_Results(wait): No input or a scalar wait flag expected.");
+        OutputMatrix(plhs[0], results[0]);
+        if (nlhs > 1)
+            OutputMatrix(plhs[1], results[1]);
+        if (nlhs > 2)
+            OutputMatrix(plhs[2], results[2]);
+        return;
+    }
+    if (!strcmp("Batch_NumPending", cmd)) {
+        OutputScalar(plhs[0], MatPsi_obj->Batch_NumPending());
+        return;
+    }
+    if (!strcmp("Batch_EnergyGradient", cmd)) {
+        std::vector<SharedMatrix> results;
+        if (nrhs==3 && mxGetN(prhs[2]) == 3 * MatPsi_obj->Molecule_NumAtoms())
+            results = MatPsi_obj->Batch_EnergyGradient(InputMatrix(prhs[2]));
+        else if (nrhs==4 && mxGetN(prhs[2]) == 3 * MatPsi_obj->Molecule_NumAtoms() && mxGetM(prhs[3])==1 && mxGetN(prhs[3])==1)
+            results = MatPsi_obj->Batch_EnergyGradient(InputMatrix(prhs[2]), (int)InputScalar(prhs[3]));
+        else
+            mexErrMsgTxt("Batch_EnergyGradient(geometries, threadsPerJob): NumGeometries by 3*NumAtoms matrix, and optionally an integer number of threads per job, expected.");
+        OutputMatrix(plhs[0], results[0]);
+        if (nlhs > 1)
+            OutputMatrix(plhs[1], results[1]);
+        return;
+    }
+    
+    //*** Performance diagnostics 
+    if (!strcmp("Diagnostics_Timings", cmd)) {
+        if (nrhs==2)
+            OutputMatrix(plhs[0], MatPsi_obj->Diagnostics_Timings());
+        else if (nrhs==3 && mxIsChar(prhs[2]))
+            OutputMatrix(plhs[0], MatPsi_obj->Diagnostics_Timings((std::string)mxArrayToString(prhs[2])));
+        else
+            mexErrMsgTxt("Diagnostics_Timings(\"traceFile\"): No input or a Chrome trace file name string expected.");
+        if (nlhs == 2)
+            OutputStrings(plhs[1], MatPsi_obj->Diagnostics_PhaseNames());
+        return;
+    }
+    if (!strcmp("Diagnostics_PhaseNames", cmd)) {
+        OutputStrings(plhs[0], MatPsi_obj->Diagnostics_PhaseNames());
+        return;
+    }
+    if (!strcmp("Diagnostics_Reset", cmd)) {
+        MatPsi_obj->Diagnostics_Reset();
+        return;
+    }
+    
     // Got here, so command not recognized
     mexErrMsgTxt("Command not recognized.");
 }
@@ -0,0 +1,475 @@
+#include "optimizer.h"
+#include <cov_radii.h>
+#include <physconst.h>
+#include <exception.h>
+#include <cmath>
+#include <algorithm>
+
+using namespace psi;
+
+namespace {
+
+// bends beyond this many degrees are treated as linear
+const double LINEAR_BEND_DEGREES = 175.0;
+// bonded if closer than this times the sum of the covalent radii
+const double BOND_SCALE = 1.3;
+// eigenvalues of G = B B^T below this are redundant
+const double REDUNDANCY_THRESHOLD = 1.0E-8;
+
+inline double dot3(const double* a, const double* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+inline void cross3(const double* a, const double* b, double* c) {
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// r = geom[a] - geom[b], returns |r|
+inline double displacement(SharedMatrix geom, int a, int b, double* r) {
+    for(int x = 0; x < 3; x++)
+        r[x] = geom->get(a, x) - geom->get(b, x);
+    return sqrt(dot3(r, r));
+}
+
+double bend_degrees(SharedMatrix geom, int a, int b, int c) {
+    double u[3], v[3];
+    double lu = displacement(geom, a, b, u);
+    double lv = displacement(geom, c, b, v);
+    double cosine = std::max(-1.0, std::min(1.0, dot3(u, v) / (lu * lv)));
+    return acos(cosine) * 180.0 / M_PI;
+}
+
+bool bend_is_usable(SharedMatrix geom, int a, int b, int c) {
+    double angle = bend_degrees(geom, a, b, c);
+    return angle < LINEAR_BEND_DEGREES && angle > 180.0 - LINEAR_BEND_DEGREES;
+}
+
+int find_root(std::vector<int>& parent, int i) {
+    while(parent[i] != i)
+        i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+double wrap_angle(double angle) {
+    while(angle > M_PI)
+        angle -= 2.0 * M_PI;
+    while(angle <= -M_PI)
+        angle += 2.0 * M_PI;
+    return angle;
+}
+
+}
+
+InternalCoordinates::InternalCoordinates(SharedMatrix geom, const std::vector<int>& atomicNumbers) {
+    int natom = geom->nrow();
+    if(natom < 2)
+        throw PSIEXCEPTION("InternalCoordinates: At least two atoms are needed.");
+    std::vector< std::vector<int> > neighbours(natom);
+    std::vector<int> parent(natom);
+    for(int a = 0; a < natom; a++)
+        parent[a] = a;
+
+    // covalent bonds
+    double r[3];
+    for(int a = 0; a < natom; a++) {
+        for(int b = 0; b < a; b++) {
+            double ra = cov_radii[std::min(atomicNumbers[a], LAST_COV_RADII_INDEX)];
+            double rb = cov_radii[std::min(atomicNumbers[b], LAST_COV_RADII_INDEX)];
+            if(displacement(geom, a, b, r) < BOND_SCALE * (ra + rb) / pc_bohr2angstroms) {
+                Coordinate stretch = { Stretch, { a, b, -1, -1 }, { 0.0, 0.0, 0.0 } };
+                coords_.push_back(stretch);
+                neighbours[a].push_back(b);
+                neighbours[b].push_back(a);
+                parent[find_root(parent, a)] = find_root(parent, b);
+            }
+        }
+    }
+
+    // join the fragments through their shortest contacts
+    while(true) {
+        int bestA = -1, bestB = -1;
+        double bestDistance = 0.0;
+        for(int a = 0; a < natom; a++) {
+            for(int b = 0; b < a; b++) {
+                if(find_root(parent, a) == find_root(parent, b))
+                    continue;
+                double distance = displacement(geom, a, b, r);
+                if(bestA < 0 || distance < bestDistance) {
+                    bestA = a;
+                    bestB = b;
+                    bestDistance = distance;
+                }
+            }
+        }
+        if(bestA < 0)
+            break;
+        Coordinate stretch = { Stretch, { bestA, bestB, -1, -1 }, { 0.0, 0.0, 0.0 } };
+        coords_.push_back(stretch);
+        neighbours[bestA].push_back(bestB);
+        neighbours[bestB].push_back(bestA);
+        parent[find_root(parent, bestA)] = find_root(parent, bestB);
+    }
+
+    add_bends_and_torsions(geom, neighbours);
+}
+
+void InternalCoordinates::add_bends_and_torsions(SharedMatrix geom, const std::vector< std::vector<int> >& neighbours) {
+    int natom = geom->nrow();
+    for(int b = 0; b < natom; b++) {
+        const std::vector<int>& nb = neighbours[b];
+        for(int i = 0; i < nb.size(); i++) {
+            for(int j = 0; j < i; j++) {
+                int a = nb[i], c = nb[j];
+                if(bend_degrees(geom, a, b, c) < LINEAR_BEND_DEGREES) {
+                    Coordinate bend = { Bend, { a, b, c, -1 }, { 0.0, 0.0, 0.0 } };
+                    coords_.push_back(bend);
+                    continue;
+                }
+                // two bends perpendicular to the a-c axis, about fixed directions
+                double d[3], e[3] = { 0.0, 0.0, 0.0 }, w[3];
+                double ld = displacement(geom, c, a, d);
+                for(int x = 0; x < 3; x++)
+                    d[x] /= ld;
+                int smallest = 0;
+                for(int x = 1; x < 3; x++)
+                    if(fabs(d[x]) < fabs(d[smallest]))
+                        smallest = x;
+                e[smallest] = 1.0;
+                double ed = dot3(e, d);
+                for(int x = 0; x < 3; x++)
+                    e[x] -= ed * d[x];
+                double le = sqrt(dot3(e, e));
+                for(int x = 0; x < 3; x++)
+                    e[x] /= le;
+                cross3(d, e, w);
+                Coordinate bend1 = { LinearBend, { a, b, c, -1 }, { e[0], e[1], e[2] } };
+                Coordinate bend2 = { LinearBend, { a, b, c, -1 }, { w[0], w[1], w[2] } };
+                coords_.push_back(bend1);
+                coords_.push_back(bend2);
+            }
+        }
+    }
+
+    // proper torsions about every bond
+    int nstretch = coords_.size();
+    for(int s = 0; s < nstretch; s++) {
+        if(coords_[s].type != Stretch)
+            continue;
+        int b = coords_[s].atoms[0], c = coords_[s].atoms[1];
+        for(int i = 0; i < neighbours[b].size(); i++) {
+            int a = neighbours[b][i];
+            if(a == c || !bend_is_usable(geom, a, b, c))
+                continue;
+            for(int j = 0; j < neighbours[c].size(); j++) {
+                int d = neighbours[c][j];
+                if(d == b || d == a || !bend_is_usable(geom, b, c, d))
+                    continue;
+                Coordinate torsion = { Torsion, { a, b, c, d }, { 0.0, 0.0, 0.0 } };
+                coords_.push_back(torsion);
+            }
+        }
+    }
+
+    // out-of-plane torsions at planar three-coordinate centres, which bends see only to second order
+    for(int b = 0; b < natom; b++) {
+        const std::vector<int>& nb = neighbours[b];
+        if(nb.size() != 3)
+            continue;
+        double angleSum = bend_degrees(geom, nb[0], b, nb[1]) + bend_degrees(geom, nb[1], b, nb[2]) + bend_degrees(geom, nb[2], b, nb[0]);
+        if(angleSum < 355.0)
+            continue;
+        if(!bend_is_usable(geom, nb[0], nb[1], b) || !bend_is_usable(geom, nb[1], b, nb[2]))
+            continue;
+        Coordinate torsion = { Torsion, { nb[0], nb[1], b, nb[2] }, { 0.0, 0.0, 0.0 } };
+        coords_.push_back(torsion);
+    }
+}
+
+std::vector<double> InternalCoordinates::values(SharedMatrix geom) const {
+    std::vector<double> q(coords_.size());
+    for(int i = 0; i < coords_.size(); i++) {
+        const Coordinate& coord = coords_[i];
+        const int* at = coord.atoms;
+        double u[3], v[3];
+        if(coord.type == Stretch) {
+            q[i] = displacement(geom, at[0], at[1], u);
+        } else if(coord.type == Bend) {
+            q[i] = bend_degrees(geom, at[0], at[1], at[2]) * M_PI / 180.0;
+        } else if(coord.type == LinearBend) {
+            double lu = displacement(geom, at[0], at[1], u);
+            double lv = displacement(geom, at[2], at[1], v);
+            q[i] = dot3(coord.axis, u) / lu + dot3(coord.axis, v) / lv;
+        } else {
+            double F[3], G[3], H[3], A[3], B[3], BA[3];
+            displacement(geom, at[0], at[1], F);
+            double lG = displacement(geom, at[1], at[2], G);
+            displacement(geom, at[3], at[2], H);
+            cross3(F, G, A);
+            cross3(H, G, B);
+            cross3(B, A, BA);
+            q[i] = atan2(dot3(BA, G) / lG, dot3(A, B));
+        }
+    }
+    return q;
+}
+
+SharedMatrix InternalCoordinates::B(SharedMatrix geom) const {
+    int natom = geom->nrow();
+    SharedMatrix Bmat(new Matrix("Wilson B", coords_.size(), 3 * natom));
+    double** Bp = Bmat->pointer();
+    for(int i = 0; i < coords_.size(); i++) {
+        const Coordinate& coord = coords_[i];
+        const int* at = coord.atoms;
+        double u[3], v[3];
+        if(coord.type == Stretch) {
+            double lu = displacement(geom, at[0], at[1], u);
+            for(int x = 0; x < 3; x++) {
+                Bp[i][3 * at[0] + x] = u[x] / lu;
+                Bp[i][3 * at[1] + x] = -u[x] / lu;
+            }
+        } else if(coord.type == Bend) {
+            double lu = displacement(geom, at[0], at[1], u);
+            double lv = displacement(geom, at[2], at[1], v);
+            for(int x = 0; x < 3; x++) {
+                u[x] /= lu;
+                v[x] /= lv;
+            }
+            double cosine = std::max(-1.0, std::min(1.0, dot3(u, v)));
+            double sine = std::max(sqrt(1.0 - cosine * cosine), 1.0E-8);
+            for(int x = 0; x < 3; x++) {
+                double da = (cosine * u[x] - v[x]) / (lu * sine);
+                double dc = (cosine * v[x] - u[x]) / (lv * sine);
+                Bp[i][3 * at[0] + x] = da;
+                Bp[i][3 * at[2] + x] = dc;
+                Bp[i][3 * at[1] + x] = -da - dc;
+            }
+        } else if(coord.type == LinearBend) {
+            double lu = displacement(geom, at[0], at[1], u);
+            double lv = displacement(geom, at[2], at[1], v);
+            for(int x = 0; x < 3; x++) {
+                u[x] /= lu;
+                v[x] /= lv;
+            }
+            double wu = dot3(coord.axis, u);
+            double wv = dot3(coord.axis, v);
+            for(int x = 0; x < 3; x++) {
+                double da = (coord.axis[x] - wu * u[x]) / lu;
+                double dc = (coord.axis[x] - wv * v[x]) / lv;
+                Bp[i][3 * at[0] + x] = da;
+                Bp[i][3 * at[2] + x] = dc;
+                Bp[i][3 * at[1] + x] = -da - dc;
+            }
+        } else {
+            // Blondel and Karplus, J. Comput. Chem. 17, 1132 (1996)
+            double F[3], G[3], H[3], A[3], B[3];
+            displacement(geom, at[0], at[1], F);
+            double lG = displacement(geom, at[1], at[2], G);
+            displacement(geom, at[3], at[2], H);
+            cross3(F, G, A);
+            cross3(H, G, B);
+            double A2 = std::max(dot3(A, A), 1.0E-16);
+            double B2 = std::max(dot3(B, B), 1.0E-16);
+            double FG = dot3(F, G) / (A2 * lG);
+            double HG = dot3(H, G) / (B2 * lG);
+            for(int x = 0; x < 3; x++) {
+                Bp[i][3 * at[0] + x] = -lG / A2 * A[x];
+                Bp[i][3 * at[3] + x] = lG / B2 * B[x];
+                Bp[i][3 * at[1] + x] = lG / A2 * A[x] + FG * A[x] - HG * B[x];
+                Bp[i][3 * at[2] + x] = -lG / B2 * B[x] - FG * A[x] + HG * B[x];
+            }
+        }
+    }
+    return Bmat;
+}
+
+std::vector<double> InternalCoordinates::difference(const std::vector<double>& a, const std::vector<double>& b) const {
+    std::vector<double> d(a.size());
+    for(int i = 0; i < a.size(); i++)
+        d[i] = coords_[i].type == Torsion ? wrap_angle(a[i] - b[i]) : a[i] - b[i];
+    return d;
+}
+
+SharedMatrix InternalCoordinates::guess_hessian() const {
+    SharedMatrix H(new Matrix("Internal Hessian", coords_.size(), coords_.size()));
+    for(int i = 0; i < coords_.size(); i++) {
+        if(coords_[i].type == Stretch)
+            H->set(i, i, 0.5);
+        else if(coords_[i].type == Torsion)
+            H->set(i, i, 0.1);
+        else
+            H->set(i, i, 0.2);
+    }
+    return H;
+}
+
+SharedMatrix InternalCoordinates::G_inverse(SharedMatrix B, SharedMatrix P) {
+    int n = B->nrow();
+    SharedMatrix G(new Matrix(n, n));
+    G->gemm(false, true, 1.0, B, B, 0.0);
+    SharedMatrix vectors(new Matrix(n, n));
+    boost::shared_ptr<Vector> lambda(new Vector(n));
+    G->diagonalize(vectors, lambda);
+    SharedMatrix Ginv(new Matrix("G inverse", n, n));
+    if(P != NULL)
+        P->zero();
+    double** Vp = vectors->pointer();
+    for(int k = 0; k < n; k++) {
+        double l = lambda->get(k);
+        if(l < REDUNDANCY_THRESHOLD)
+            continue;
+        for(int i = 0; i < n; i++) {
+            for(int j = 0; j < n; j++) {
+                Ginv->add(i, j, Vp[i][k] * Vp[j][k] / l);
+                if(P != NULL)
+                    P->add(i, j, Vp[i][k] * Vp[j][k]);
+            }
+        }
+    }
+    return Ginv;
+}
+
+std::vector<double> InternalCoordinates::gradient(SharedMatrix geom, SharedMatrix gradientCart, SharedMatrix P) const {
+    SharedMatrix Bmat = B(geom);
+    SharedMatrix Ginv = G_inverse(Bmat, P);
+    int n = Bmat->nrow(), ncart = Bmat->ncol();
+    std::vector<double> Bg(n, 0.0), g(n, 0.0);
+    double* gx = gradientCart->pointer()[0];
+    for(int i = 0; i < n; i++)
+        for(int x = 0; x < ncart; x++)
+            Bg[i] += Bmat->get(i, x) * gx[x];
+    for(int i = 0; i < n; i++)
+        for(int j = 0; j < n; j++)
+            g[i] += Ginv->get(i, j) * Bg[j];
+    return g;
+}
+
+SharedMatrix InternalCoordinates::displace(SharedMatrix geom, const std::vector<double>& dq) const {
+    int n = coords_.size(), ncart = 3 * geom->nrow();
+    std::vector<double> target = values(geom);
+    for(int i = 0; i < n; i++)
+        target[i] += dq[i];
+
+    // x <- x + B^T G^- (q_target - q(x)); the first-order step is kept if the iterations do not settle
+    SharedMatrix x = geom->clone();
+    SharedMatrix firstOrder;
+    double lastRms = 0.0;
+    for(int iter = 0; iter < 50; iter++) {
+        std::vector<double> remaining = difference(target, values(x));
+        SharedMatrix Bmat = B(x);
+        SharedMatrix Ginv = G_inverse(Bmat);
+        std::vector<double> Gq(n, 0.0);
+        for(int i = 0; i < n; i++)
+            for(int j = 0; j < n; j++)
+                Gq[i] += Ginv->get(i, j) * remaining[j];
+        double* xp = x->pointer()[0];
+        double rms = 0.0;
+        for(int c = 0; c < ncart; c++) {
+            double dx = 0.0;
+            for(int i = 0; i < n; i++)
+                dx += Bmat->get(i, c) * Gq[i];
+            xp[c] += dx;
+            rms += dx * dx;
+        }
+        rms = sqrt(rms / ncart);
+        if(iter == 0)
+            firstOrder = x->clone();
+        else if(rms > lastRms)
+            return firstOrder;
+        if(rms < 1.0E-10)
+            return x;
+        lastRms = rms;
+    }
+    return firstOrder;
+}
+
+
+
+RFOptimizer::RFOptimizer(const InternalCoordinates& coords, double trustRadius) :
+    coords_(coords), trust_(trustRadius), hasLast_(false), energyLast_(0.0), predictedLast_(0.0)
+{
+    H_ = coords_.guess_hessian();
+}
+
+std::vector<double> RFOptimizer::step(const std::vector<double>& q, double energy, const std::vector<double>& g, SharedMatrix P) {
+    int n = q.size();
+    double** Hp = H_->pointer();
+    if(hasLast_) {
+        std::vector<double> s = coords_.difference(q, qLast_);
+        std::vector<double> y(n), Hs(n, 0.0);
+        for(int i = 0; i < n; i++)
+            y[i] = g[i] - gLast_[i];
+        for(int i = 0; i < n; i++)
+            for(int j = 0; j < n; j++)
+                Hs[i] += Hp[i][j] * s[j];
+        double ys = 0.0, sHs = 0.0, ss = 0.0;
+        for(int i = 0; i < n; i++) {
+            ys += y[i] * s[i];
+            sHs += s[i] * Hs[i];
+            ss += s[i] * s[i];
+        }
+        // BFGS, skipped unless the curvature condition holds
+        if(ys > 1.0E-8 * ss && sHs > 1.0E-12) {
+            for(int i = 0; i < n; i++)
+                for(int j = 0; j < n; j++)
+                    Hp[i][j] += y[i] * y[j] / ys - Hs[i] * Hs[j] / sHs;
+        }
+        // trust radius from the agreement of the model with the actual energy change
+        double ratio = fabs(predictedLast_) > 1.0E-12 ? (energy - energyLast_) / predictedLast_ : 1.0;
+        double stepLength = sqrt(ss);
+        if(ratio < 0.25)
+            trust_ = std::max(0.01, 0.25 * stepLength);
+        else if(ratio > 0.75 && stepLength > 0.8 * trust_)
+            trust_ = std::min(1.0, 2.0 * trust_);
+    }
+
+    // projected Hessian P H P + 1000 (1 - P) and gradient P g
+    SharedMatrix HP(new Matrix(n, n));
+    SharedMatrix PHP(new Matrix(n, n));
+    HP->gemm(false, false, 1.0, H_, P, 0.0);
+    PHP->gemm(false, false, 1.0, P, HP, 0.0);
+    std::vector<double> Pg(n, 0.0);
+    for(int i = 0; i < n; i++)
+        for(int j = 0; j < n; j++)
+            Pg[i] += P->get(i, j) * g[j];
+
+    // lowest root of the augmented Hessian [[H g], [g^T 0]]
+    SharedMatrix aug(new Matrix(n + 1, n + 1));
+    for(int i = 0; i < n; i++) {
+        for(int j = 0; j < n; j++)
+            aug->set(i, j, PHP->get(i, j) + 1000.0 * ((i == j ? 1.0 : 0.0) - P->get(i, j)));
+        aug->set(i, n, Pg[i]);
+        aug->set(n, i, Pg[i]);
+    }
+    SharedMatrix vectors(new Matrix(n + 1, n + 1));
+    boost::shared_ptr<Vector> lambda(new Vector(n + 1));
+    aug->diagonalize(vectors, lambda);
+    std::vector<double> step(n), dq(n, 0.0);
+    double last = vectors->get(n, 0);
+    for(int i = 0; i < n; i++)
+        step[i] = fabs(last) > 1.0E-8 ? vectors->get(i, 0) / last : -Pg[i];
+    for(int i = 0; i < n; i++)
+        for(int j = 0; j < n; j++)
+            dq[i] += P->get(i, j) * step[j];
+
+    // restricted step
+    double length = 0.0;
+    for(int i = 0; i < n; i++)
+        length += dq[i] * dq[i];
+    length = sqrt(length);
+    if(length > trust_)
+        for(int i = 0; i < n; i++)
+            dq[i] *= trust_ / length;
+
+    // quadratic model change, g^T dq + dq^T H dq / 2
+    predictedLast_ = 0.0;
+    for(int i = 0; i < n; i++) {
+        predictedLast_ += Pg[i] * dq[i];
+        for(int j = 0; j < n; j++)
+            predictedLast_ += 0.5 * dq[i] * PHP->get(i, j) * dq[j];
+    }
+    hasLast_ = true;
+    energyLast_ = energy;
+    qLast_ = q;
+    gLast_ = g;
+    return dq;
+}
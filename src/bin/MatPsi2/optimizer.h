@@ -0,0 +1,72 @@
+#ifndef _matpsi2_optimizer_h_
+#define _matpsi2_optimizer_h_
+
+#include <libmints/mints.h>
+#include <vector>
+
+namespace psi {
+
+/// Redundant internal coordinates (stretches, bends, linear bends, torsions) of a C1 molecule, in Bohr and radians
+class InternalCoordinates {
+public:
+    enum Type { Stretch, Bend, LinearBend, Torsion };
+
+protected:
+    struct Coordinate {
+        Type type;
+        int atoms[4];
+        double axis[3]; // fixed bending direction of a linear bend
+    };
+    std::vector<Coordinate> coords_;
+
+    void add_bends_and_torsions(SharedMatrix geom, const std::vector< std::vector<int> >& neighbours);
+
+public:
+    /// Bonds from covalent radii, then the shortest contacts joining fragments
+    InternalCoordinates(SharedMatrix geom, const std::vector<int>& atomicNumbers);
+
+    int size() const { return coords_.size(); }
+    Type type(int i) const { return coords_[i].type; }
+
+    /// Values of all coordinates
+    std::vector<double> values(SharedMatrix geom) const;
+    /// Wilson B matrix, ncoord by 3 natom
+    SharedMatrix B(SharedMatrix geom) const;
+    /// a - b, with torsion differences wrapped into (-pi, pi]
+    std::vector<double> difference(const std::vector<double>& a, const std::vector<double>& b) const;
+    /// Diagonal model Hessian (stretch 0.5, bend 0.2, torsion 0.1 Hartree per unit^2)
+    SharedMatrix guess_hessian() const;
+
+    /// Generalized inverse of G = B B^T; P = G G^- projects onto the non-redundant space
+    static SharedMatrix G_inverse(SharedMatrix B, SharedMatrix P = SharedMatrix());
+    /// Cartesian gradient to internal gradient, G^- B gx; fills the projector P if given
+    std::vector<double> gradient(SharedMatrix geom, SharedMatrix gradientCart, SharedMatrix P = SharedMatrix()) const;
+    /// Cartesian geometry whose internals are q(geom) + dq, by iterative back-transformation
+    SharedMatrix displace(SharedMatrix geom, const std::vector<double>& dq) const;
+};
+
+/// Rational-function optimization on a BFGS-updated internal-coordinate Hessian, with a trust radius
+class RFOptimizer {
+protected:
+    InternalCoordinates coords_;
+    SharedMatrix H_;
+    double trust_;
+    bool hasLast_;
+    double energyLast_;
+    double predictedLast_; // model energy change of the last step
+    std::vector<double> qLast_;
+    std::vector<double> gLast_;
+
+public:
+    RFOptimizer(const InternalCoordinates& coords, double trustRadius = 0.3);
+
+    const InternalCoordinates& coordinates() const { return coords_; }
+    double trust_radius() const { return trust_; }
+
+    /// Internal step from the energy, internal gradient and redundancy projector at q; updates the Hessian and trust radius first
+    std::vector<double> step(const std::vector<double>& q, double energy, const std::vector<double>& g, SharedMatrix P);
+};
+
+}
+
+#endif
@@ -40,6 +40,8 @@ DIISEntry::DIISEntry(std::string label, int ID, int orderAdded,
         _errorVectorSize(errorVectorSize),
         _vector(vector),
         _errorVector(errorVector),
+        _energy(0.0),
+        _density(NULL),
         _ID(ID),
         _orderAdded(orderAdded),
         _label(label),
@@ -54,6 +56,27 @@ DIISEntry::DIISEntry(std::string label, int ID, int orderAdded,
     _label = s.str();
 }
 
+void
+DIISEntry::reset(int orderAdded, double *errorVector, double *vector)
+{
+    free_vector_memory();
+    free_error_vector_memory();
+    delete[] _density;
+    _density = NULL;
+    _energy = 0.0;
+    _vector = vector;
+    _errorVector = errorVector;
+    _orderAdded = orderAdded;
+    // The map nodes are kept, so refilling the dot products does not allocate
+    std::map<int, bool>::iterator it;
+    for (it = _knownDotProducts.begin(); it != _knownDotProducts.end(); ++it)
+        it->second = false;
+    double sumSQ = C_DDOT(_errorVectorSize, _errorVector, 1, _errorVector, 1);
+    _rmsError = sqrt(sumSQ / _errorVectorSize);
+    _dotProducts[_ID] = sumSQ;
+    _knownDotProducts[_ID] = true;
+}
+
 void
 DIISEntry::open_psi_file()
 {
@@ -137,6 +160,8 @@ DIISEntry::~DIISEntry()
         delete[] _vector;
     if(_errorVector != NULL)
         delete[] _errorVector;
+    if(_density != NULL)
+        delete[] _density;
 }
 
 } // Namespace
@@ -60,6 +60,8 @@ class DIISEntry{
         DIISEntry(std::string label, int ID, int count, int vectorSize, double *vector,
                   int errorVectorSize, double *errorVector, boost::shared_ptr<PSIO> psio);
         ~DIISEntry();
+        /// Take new vectors (owned) in place of the current ones, keeping the label and ID
+        void reset(int orderAdded, double *errorVector, double *vector);
         /// Whether the dot product of this entry's and the nth entry's error vector is known
         bool dot_is_known_with(int n) {return _knownDotProducts[n];}
         /// The dot product of this entry's and the nth entry's error vectors
@@ -84,6 +86,10 @@ class DIISEntry{
         void dump_error_vector_to_disk();
         /// Allocate error vector memory and read from disk
         void read_error_vector_from_disk();
+        /// Hand over the in-core vector, error vector or density (for reuse by a new entry)
+        double *take_vector() {double *vec = _vector; _vector = NULL; return vec;}
+        double *take_error_vector() {double *vec = _errorVector; _errorVector = NULL; return vec;}
+        double *take_density() {double *vec = _density; _density = NULL; return vec;}
         /// Free vector memory
         void free_vector_memory();
         /// Free error vector memory
@@ -92,6 +98,14 @@ class DIISEntry{
         const double *errorVector() {read_error_vector_from_disk(); return _errorVector;}
         /// Returns the vector
         const double *vector() {read_vector_from_disk(); return _vector;}
+        /// Attach the energy and density (owned, always kept in core) this entry's vector was built from
+        void set_energy_and_density(double energy, double *density) {delete[] _density; _energy = energy; _density = density;}
+        /// Whether an energy and density have been attached
+        bool has_density() {return _density != NULL;}
+        /// The energy this entry's vector was built from
+        double energy() {return _energy;}
+        /// The density this entry's vector was built from
+        const double *density() {return _density;}
         /// Open the psi file, if needed.
         void open_psi_file();
         /// Close the psi file, if needed.
@@ -115,6 +129,9 @@ class DIISEntry{
         double *_errorVector;
         /// The error vector
         double *_vector;
+        /// The energy and density the vector was built from, if attached
+        double _energy;
+        double *_density;
         /// The label used for disk storage
         std::string _label;
         /// PSIO object
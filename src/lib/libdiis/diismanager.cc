@@ -27,16 +27,40 @@
 #include <libdpd/dpd.h>
 #include <libmints/matrix.h>
 #include <libmints/vector.h>
+#include <libmints/workspace.h>
 #include <libciomr/libciomr.h>
 #include <libqt/qt.h>
+#include <libqt/diagnostics.h>
 #include <psifiles.h>
 
 #include <math.h>
+#include <algorithm>
+#include <functional>
 
 using namespace psi;
 using namespace boost;
 
 namespace psi{
+
+namespace {
+
+/// Euclidean projection of v onto the simplex sum(c) = 1, c >= 0 (v and c may alias; u is n of scratch)
+void project_on_simplex(int n, const double *v, double *c, double *u)
+{
+    std::copy(v, v + n, u);
+    std::sort(u, u + n, std::greater<double>());
+    double sum = 0.0;
+    double theta = 0.0;
+    for(int j = 0; j < n; ++j){
+        sum += u[j];
+        double t = (sum - 1.0) / (j + 1);
+        if(u[j] - t > 0.0) theta = t;
+    }
+    for(int i = 0; i < n; ++i)
+        c[i] = std::max(v[i] - theta, 0.0);
+}
+
+}
 /**
  *
  * @param maxSubspaceSize Maximum number of vectors allowed in the subspace
@@ -57,8 +81,79 @@ DIISManager::DIISManager(Process::Environment& process_environment_in, int maxSu
             _vectorSize(0),
             _psio(psio_in),
             _entryCount(0),
+            _lastEntryID(-1),
+            _initialAcceleration(NoInitialAcceleration),
+            _densityFactor(1.0),
+            _accelerationStart(1.0E-1),
+            _accelerationFinish(1.0E-4),
+            _spareDensity(NULL),
             _label(label)
 {
+    _workspace = boost::shared_ptr<MatrixWorkspace>(new MatrixWorkspace("DIIS"));
+}
+
+/**
+ * Switches on energy-based extrapolation far from convergence.  While the RMS error of the
+ * newest entry exceeds start only the ADIIS/EDIIS coefficients are used, below finish only
+ * the DIIS ones, and in between the two are mixed linearly in the error.  Every entry needs
+ * its energy and density, see set_entry_energy_and_density().
+ * @param type: the energy model to minimize
+ * @param densityFactor: 2 if the densities are per spin but stand for both spins (restricted), 1 otherwise
+ * @param start: the RMS error above which DIIS is not used at all
+ * @param finish: the RMS error below which only DIIS is used
+ */
+void
+DIISManager::set_initial_acceleration(InitialAcceleration type, double densityFactor, double start, double finish)
+{
+    if(finish >= start && type != NoInitialAcceleration)
+        throw SanityCheckError("The DIIS transition must finish below where it starts",
+                               __FILE__, __LINE__);
+    _initialAcceleration = type;
+    _densityFactor = densityFactor;
+    _accelerationStart = start;
+    _accelerationFinish = finish;
+}
+
+/**
+ * Attaches the energy and densities the last added vector was built from, as needed by
+ * ADIIS and EDIIS.  The densities are passed as Matrix pointers, one for each component of
+ * the vector (e.g. Da and Db for Fa and Fb), and are always kept in core.
+ */
+void
+DIISManager::set_entry_energy_and_density(double energy, int numQuantities, ...)
+{
+    if(!_maxSubspaceSize || _lastEntryID < 0) return;
+    if(numQuantities != _numVectorComponents)
+        throw SanityCheckError("The number of densities and vector components are inconsistent",
+                               __FILE__, __LINE__);
+
+    // Reuse the density of the last entry that was replaced
+    double *densityPtr = _spareDensity ? _spareDensity : new double[_vectorSize];
+    _spareDensity = NULL;
+    double *arrayPtr = densityPtr;
+    va_list args;
+    va_start(args, numQuantities);
+    for(int i = 0; i < numQuantities; ++i) {
+        Matrix *matrix = va_arg(args, Matrix*);
+        size_t size = 0;
+        for(int h = 0; h < matrix->nirrep(); ++h)
+            size += matrix->rowspi()[h] * matrix->colspi()[h];
+        if(size != _componentSizes[i + _numErrorVectorComponents]){
+            va_end(args);
+            delete[] densityPtr;
+            throw SanityCheckError("The density and vector component sizes are inconsistent",
+                                   __FILE__, __LINE__);
+        }
+        for(int h = 0; h < matrix->nirrep(); ++h){
+            for(int row = 0; row < matrix->rowspi()[h]; ++row){
+                for(int col = 0; col < matrix->colspi()[h]; ++col){
+                    *arrayPtr++ = matrix->get(h, row, col);
+                }
+            }
+        }
+    }
+    va_end(args);
+    _subspace[_lastEntryID]->set_energy_and_density(energy, densityPtr);
 }
 
 int DIISManager::subspace_size()
@@ -215,8 +310,18 @@ DIISManager::add_entry(int numQuantities, ...)
     double *array;
     va_list args;
     va_start(args, numQuantities);
-    double *errorVectorPtr = new double [_errorVectorSize];
-    double *vectorPtr      = new double [_vectorSize];
+    int entryID = get_next_entry_id();
+    double *errorVectorPtr = NULL;
+    double *vectorPtr = NULL;
+    if(_subspace.size() == _maxSubspaceSize && _storagePolicy == InCore){
+        // Reuse the memory of the entry being replaced
+        errorVectorPtr = _subspace[entryID]->take_error_vector();
+        vectorPtr = _subspace[entryID]->take_vector();
+        delete[] _spareDensity;
+        _spareDensity = _subspace[entryID]->take_density();
+    }
+    if(!errorVectorPtr) errorVectorPtr = new double [_errorVectorSize];
+    if(!vectorPtr) vectorPtr = new double [_vectorSize];
     double *arrayPtr = errorVectorPtr;
     for(int i = 0; i < numQuantities; ++i) {
         DIISEntry::InputType type = _componentTypes[i];
@@ -278,16 +383,12 @@ DIISManager::add_entry(int numQuantities, ...)
     }
     va_end(args);
 
-    int entryID = get_next_entry_id();
     if(_subspace.size() < _maxSubspaceSize){
         _subspace.push_back(new DIISEntry(_label, entryID, _entryCount++,
                             _errorVectorSize, errorVectorPtr,
                             _vectorSize, vectorPtr, _psio));
     }else{
-        delete _subspace[entryID];
-        _subspace[entryID] = new DIISEntry(_label, entryID, _entryCount++,
-                                           _errorVectorSize, errorVectorPtr,
-                                           _vectorSize, vectorPtr, _psio);
+        _subspace[entryID]->reset(_entryCount++, errorVectorPtr, vectorPtr);
     }
 
     if(_storagePolicy == OnDisk) {
@@ -295,6 +396,8 @@ DIISManager::add_entry(int numQuantities, ...)
         _subspace[entryID]->dump_error_vector_to_disk();
     }
 
+    _lastEntryID = entryID;
+
     // Make we don't know any inner products involving this new entry
     for(int i = 0; i < _subspace.size(); ++i)
         if(i != entryID) _subspace[i]->invalidate_dot(entryID);
@@ -339,6 +442,95 @@ DIISManager::get_next_entry_id()
 }
 
 
+/**
+ * Minimizes the ADIIS or EDIIS energy model over convex combinations of the subspace entries.
+ * Both models are quadratic in the coefficients, built from the energies and the products
+ * D_i.F_j of the stored densities and vectors (Fock matrices); the minimization is done by
+ * projected gradient steps on the simplex, starting from the best entry.
+ * @param coefficients: on return, the coefficient of each entry
+ * @return false (coefficients untouched) if an entry has no density attached
+ */
+bool
+DIISManager::initial_acceleration_coefficients(double *coefficients)
+{
+    int n = _subspace.size();
+    int newest = _lastEntryID;
+    for(int i = 0; i < n; ++i)
+        if(!_subspace[i]->has_density()) return false;
+
+    // DF[i][j] = D_i . F_j, reading each vector once
+    SharedMatrix DF = _workspace->acquire("D.F", n, n);
+    double **DFp = DF->pointer();
+    for(int j = 0; j < n; ++j){
+        const double *F = _subspace[j]->vector();
+        for(int i = 0; i < n; ++i)
+            DFp[i][j] = C_DDOT(_vectorSize, const_cast<double*>(_subspace[i]->density()), 1,
+                               const_cast<double*>(F), 1);
+        if(_storagePolicy == OnDisk) _subspace[j]->free_vector_memory();
+    }
+
+    // Model energy a.c + 1/2 c.Q.c, up to a constant
+    double k = _densityFactor;
+    SharedMatrix Q = _workspace->acquire("Q", n, n);
+    double **Qp = Q->pointer();
+    SharedMatrix scratch = _workspace->acquire("ADIIS scratch", 4, n);
+    double *a = scratch->pointer()[0];
+    double *c = scratch->pointer()[1];
+    double *trial = scratch->pointer()[2];
+    double *sorted = scratch->pointer()[3];
+    for(int i = 0; i < n; ++i){
+        for(int j = 0; j < n; ++j){
+            if(_initialAcceleration == ADIIS){
+                // E_n + k (D - D_n).F_n + k/2 (D - D_n).(F - F_n)
+                double dij = DFp[i][j] - DFp[i][newest] - DFp[newest][j] + DFp[newest][newest];
+                double dji = DFp[j][i] - DFp[j][newest] - DFp[newest][i] + DFp[newest][newest];
+                Qp[i][j] = 0.5 * k * (dij + dji);
+            }else{
+                // sum_i c_i E_i - k/4 sum_ij c_i c_j (D_i - D_j).(F_i - F_j)
+                Qp[i][j] = -0.5 * k * (DFp[i][i] - DFp[i][j] - DFp[j][i] + DFp[j][j]);
+            }
+        }
+        if(_initialAcceleration == ADIIS)
+            a[i] = k * (DFp[i][newest] - DFp[newest][newest]);
+        else
+            a[i] = _subspace[i]->energy() - _subspace[newest]->energy();
+    }
+
+    // Steps of 1/L, where L bounds the curvature, never raise the model energy
+    double L = 0.0;
+    int start = 0;
+    for(int i = 0; i < n; ++i){
+        double row = 0.0;
+        for(int j = 0; j < n; ++j) row += fabs(Qp[i][j]);
+        L = std::max(L, row);
+        if(a[i] + 0.5 * Qp[i][i] < a[start] + 0.5 * Qp[start][start]) start = i;
+    }
+
+    for(int i = 0; i < n; ++i) c[i] = 0.0;
+    c[start] = 1.0;
+    for(int iter = 0; L > 0.0 && iter < 1000; ++iter){
+        for(int i = 0; i < n; ++i){
+            double g = a[i];
+            for(int j = 0; j < n; ++j) g += Qp[i][j] * c[j];
+            trial[i] = c[i] - g / L;
+        }
+        project_on_simplex(n, trial, trial, sorted);
+        double change = 0.0;
+        for(int i = 0; i < n; ++i){
+            change = std::max(change, fabs(trial[i] - c[i]));
+            c[i] = trial[i];
+        }
+        if(change < 1.0E-10) break;
+    }
+
+    for(int i = 0; i < n; ++i) coefficients[i] = c[i];
+    _workspace->release(DF);
+    _workspace->release(Q);
+    _workspace->release(scratch);
+    return true;
+}
+
+
 /**
  * Performs the extapolation, based on the current subspace
  * @param numQuantitites - the number of quantities that the vector comprises.
@@ -351,13 +543,17 @@ DIISManager::extrapolate(int numQuantities, ...)
 {
     if(!_subspace.size()) return false;
 
-    //~ timer_on("DIISManager::extrapolate");
+    diagnostics::phase_on("DIISManager::extrapolate");
 
     int dimension = _subspace.size() + 1;
-    SharedMatrix B(new Matrix("B (DIIS Connectivity Matrix", dimension, dimension));
+    SharedMatrix B = _workspace->acquire("B (DIIS Connectivity Matrix", dimension, dimension);
     double **bMatrix = B->pointer();
-    double *coefficients = init_array(dimension);
-    double *force = init_array(dimension);
+    SharedMatrix scratch = _workspace->acquire("DIIS scratch", 4, dimension);
+    double *coefficients = scratch->pointer()[0];
+    double *force = scratch->pointer()[1];
+    double *Sp = scratch->pointer()[2];
+    double *energyCoefficients = scratch->pointer()[3];
+    ::memset((void*) force, '\0', dimension * sizeof(double));
 
     //~ timer_on("DIISManager::extrapolate: bMatrix setup");
 
@@ -393,9 +589,6 @@ DIISManager::extrapolate(int numQuantities, ...)
 
     double** Bp = B->pointer();
 
-    SharedVector S(new Vector("S", dimension));
-    double* Sp = S->pointer();
-
     // Trap an explicit zero
     bool is_zero = false;
     for (int i = 0; i < dimension - 1; i++) {
@@ -431,6 +624,26 @@ DIISManager::extrapolate(int numQuantities, ...)
 
     //~ timer_off(("DIISManager::extrapolate: bMatrix pseudoinverse");
 
+    // => Far from convergence, mix in (or use only) the energy-based coefficients <= //
+
+    if(_initialAcceleration != NoInitialAcceleration && _subspace.size() > 1 && _lastEntryID >= 0){
+        double error = _subspace[_lastEntryID]->rmsError();
+        if(error > _accelerationFinish){
+            if(initial_acceleration_coefficients(energyCoefficients)){
+                double weight = 1.0;
+                if(error < _accelerationStart)
+                    weight = (error - _accelerationFinish) / (_accelerationStart - _accelerationFinish);
+                if(process_environment_.options.get_int("PRINT") > 2){
+                    fprintf(outfile, "%s coefficients (weight %.3f): ", _initialAcceleration == ADIIS ? "ADIIS" : "EDIIS", weight);
+                    for(int i = 0; i < _subspace.size(); ++i) fprintf(outfile, " %.3f ", energyCoefficients[i]);
+                    fprintf(outfile, "\n");
+                }
+                for(int i = 0; i < _subspace.size(); ++i)
+                    coefficients[i] = weight * energyCoefficients[i] + (1.0 - weight) * coefficients[i];
+            }
+        }
+    }
+
     //~ timer_on("DIISManager::extrapolate: form new data");
 
     dpdfile2 *file2;
@@ -526,10 +739,10 @@ DIISManager::extrapolate(int numQuantities, ...)
     //~ timer_off(("DIISManager::extrapolate: form new data");
 
     if(print > 2) fprintf(outfile, "\n");
-    free(coefficients);
-    free(force);
+    _workspace->release(B);
+    _workspace->release(scratch);
 
-    //~ timer_off(("DIISManager::extrapolate");
+    diagnostics::phase_off("DIISManager::extrapolate");
 
     return true;
 }
@@ -543,6 +756,9 @@ DIISManager::reset_subspace()
 {
     for(int i = 0; i < _subspace.size(); ++i) delete _subspace[i];
     _subspace.clear();
+    _lastEntryID = -1;
+    delete[] _spareDensity;
+    _spareDensity = NULL;
 }
 
 /**
@@ -564,6 +780,7 @@ DIISManager::~DIISManager()
         delete temp;
     }
     _subspace.clear();
+    delete[] _spareDensity;
     if (_psio->open_check(PSIF_LIBDIIS))
         _psio->close(PSIF_LIBDIIS, 1);
 }
@@ -38,6 +38,7 @@ namespace psi{
 
 class DIISEntry;
 class PSIO;
+class MatrixWorkspace;
 
   /**
      @Brief The DIISManager class handles DIIS extrapolations.
@@ -59,11 +60,19 @@ class DIISManager{
          * OldestFirst - A first-in-first-out policy is used
          */
         enum RemovalPolicy {LargestError, OldestAdded};
+        /**
+         * @brief How the coefficients are chosen far from convergence, before handing over to DIIS
+         *
+         * NoInitialAcceleration - Pulay DIIS throughout
+         * ADIIS - Minimize the augmented Roothaan-Hall energy model about the newest entry
+         * EDIIS - Minimize the energy interpolated between all entries
+         */
+        enum InitialAcceleration {NoInitialAcceleration, ADIIS, EDIIS};
 
         DIISManager(Process::Environment& process_environment_in, int maxSubspaceSize, const std::string& label, boost::shared_ptr<PSIO> psio_in,
                     RemovalPolicy = LargestError,
                     StoragePolicy = OnDisk);
-        DIISManager(Process::Environment& process_environment_in) : process_environment_(process_environment_in) {_maxSubspaceSize = 0;}
+        DIISManager(Process::Environment& process_environment_in) : process_environment_(process_environment_in) {_maxSubspaceSize = 0; _initialAcceleration = NoInitialAcceleration; _spareDensity = NULL;}
         ~DIISManager();
 
         void set_error_vector_size(int numQuantities, ...);
@@ -71,15 +80,24 @@ class DIISManager{
         bool extrapolate(int numQuatities, ...);
         bool add_entry(int numQuatities, ...);
         int remove_entry();
+        /// Attach the energy and the densities (laid out like the vector) the last added vector was built from
+        void set_entry_energy_and_density(double energy, int numQuantities, ...);
+        /// Blend ADIIS/EDIIS into DIIS as the newest RMS error falls from start to finish;
+        /// densityFactor is 2 when one density stands for both spins, 1 otherwise
+        void set_initial_acceleration(InitialAcceleration type, double densityFactor, double start, double finish);
         void reset_subspace();
         void delete_diis_file();
         /// The number of vectors currently in the subspace
         int subspace_size();
+        /// Draw the extrapolation temporaries from this workspace, instead of the manager's own
+        void set_workspace(boost::shared_ptr<MatrixWorkspace> workspace) {_workspace = workspace;}
     protected:
         
         Process::Environment& process_environment_;
         
         int get_next_entry_id();
+        /// ADIIS/EDIIS coefficients of the subspace entries, or false if an entry lacks its density
+        bool initial_acceleration_coefficients(double *coefficients);
 
         /// How the vectors are handled in memory
         StoragePolicy _storagePolicy;
@@ -97,6 +115,19 @@ class DIISManager{
         int _numVectorComponents;
         /// The counter that keeps track of how many entries have been added
         int _entryCount;
+        /// The subspace slot of the last added entry
+        int _lastEntryID;
+        /// The energy-based extrapolation used far from convergence
+        InitialAcceleration _initialAcceleration;
+        /// 2 if the densities stand for both spins, 1 otherwise
+        double _densityFactor;
+        /// The RMS errors above which only ADIIS/EDIIS, and below which only DIIS, is used
+        double _accelerationStart;
+        double _accelerationFinish;
+        /// Density memory of the last replaced entry, reused by the next one
+        double *_spareDensity;
+        /// Pool of the extrapolation temporaries
+        boost::shared_ptr<MatrixWorkspace> _workspace;
         /// The DIIS entries
         std::vector<DIISEntry*> _subspace;
         /// The types used in building the vector and the error vector
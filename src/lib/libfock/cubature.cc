@@ -31,6 +31,7 @@
 #include <sstream>
 #include <cstdio>
 #include <limits>
+#include <algorithm>
 #include <ctype.h>
 
 using namespace boost;
@@ -2674,6 +2675,8 @@ class NuclearWeightMgr
 
     static double BeckeStepFunction(double x);
     static double StratmannStepFunction(double mu);
+    static double BeckeStepDerivative(double x);
+    static double StratmannStepDerivative(double mu);
 
     // Becke says u = (chi-1)/(chi+1), a = u/(u^2-1), then clip so that |a| <= 1/2.
     // We can save a step and find `a' directly from chi.
@@ -2687,6 +2690,7 @@ public:
     ~NuclearWeightMgr();
     double GetStratmannCutoff(int A) const;
     double computeNuclearWeight(MassPoint mp, int A, double stratmannCutoff) const;
+    double computeNuclearWeightGradient(MassPoint mp, int A, double stratmannCutoff, double** dW, double* work) const;
 };
 
 const char *NuclearWeightMgr::nuclearschemenames[] = {"NAIVE", "BECKE", "TREUTLER", "STRATMANN"}; // Must match `enum NuclearSchemes' !
@@ -2767,6 +2771,23 @@ double NuclearWeightMgr::StratmannStepFunction(double mu)
     return (1 - z)/2; // We are a medium distance from atom i.
 }
 
+double NuclearWeightMgr::BeckeStepDerivative(double x)
+{
+    double   px =   x*(3-  x*x  )/2;
+    double  ppx =  px*(3- px*px )/2;
+    return -0.5 * (1.5*(1-ppx*ppx)) * (1.5*(1-px*px)) * (1.5*(1-x*x));
+}
+
+double NuclearWeightMgr::StratmannStepDerivative(double mu)
+{
+    const double a = 0.64;
+    if (mu < -a || mu > a)
+        return 0;
+    double x = mu / a;
+    double t = 1 - x*x;
+    return -0.5 * (35.0/16.0) * t*t*t / a;
+}
+
 // If the distance between a grid point and its parent atom is less than the number
 // returned by `stratmannCutoff', then the stratmann weighting scheme will assign a
 // weight of 1 to this grid point and we can skip a lot of crazy calculations.
@@ -2860,6 +2881,83 @@ double NuclearWeightMgr::computeNuclearWeight(MassPoint mp, int A, double stratm
     return numerator/denominator;
 }
 
+// Gradient of the weight of point mp (held fixed) w.r.t. the nuclear coordinates, dW is natom x 3.
+// With P_i = prod_j s(nu_ij) and W_A = P_A / sum_i P_i, only the pairs (i,j) move nu_ij.
+// work is caller-owned scratch of 11*natom doubles, reused from point to point.
+double NuclearWeightMgr::computeNuclearWeightGradient(MassPoint mp, int A, double stratmannCutoff, double** dW, double* work) const
+{
+    int natom = molecule_->natom();
+    for (int C = 0; C < natom; C++)
+        dW[C][0] = dW[C][1] = dW[C][2] = 0.0;
+
+    if (scheme_ == STRATMANN && distToAtom(mp, A) <= stratmannCutoff)
+        return 1;
+
+    double (*stepFunction)(double) = (scheme_ == STRATMANN) ? StratmannStepFunction : BeckeStepFunction;
+    double (*stepDerivative)(double) = (scheme_ == STRATMANN) ? StratmannStepDerivative : BeckeStepDerivative;
+
+    // Distances and unit vectors (3 per atom) from the atoms to the point
+    double* dist = work;
+    double* e = dist + natom;
+    double* P = e + 3*natom;
+    double* dZ = P + natom;
+    double* dPA = dZ + 3*natom;
+    for (int l = 0; l < natom; l++) {
+        dist[l] = distToAtom(mp, l);
+        e[3*l + 0] = (mp.x - molecule_->x(l)) / dist[l];
+        e[3*l + 1] = (mp.y - molecule_->y(l)) / dist[l];
+        e[3*l + 2] = (mp.z - molecule_->z(l)) / dist[l];
+    }
+
+    double Z = 0;
+    for (int i = 0; i < natom; i++) {
+        double prod = 1;
+        for (int j = 0; j < natom; j++) {
+            if (i == j)
+                continue;
+            double mu = (dist[i] - dist[j])*inv_dist_[i][j];
+            prod *= stepFunction(mu + amatrix_[i][j]*(1-mu*mu));
+            if (prod == 0)
+                break;
+        }
+        P[i] = prod;
+        Z += prod;
+    }
+
+    for (int l = 0; l < 3*natom; l++)
+        dZ[l] = dPA[l] = 0.0;
+    for (int i = 0; i < natom; i++) {
+        if (P[i] == 0)
+            continue; // Then some s(nu_ij) is zero, where s' vanishes too
+        for (int j = 0; j < natom; j++) {
+            if (i == j)
+                continue;
+            double inv = inv_dist_[i][j];
+            double mu = (dist[i] - dist[j])*inv;
+            double nu = mu + amatrix_[i][j]*(1-mu*mu);
+            double g = P[i] * stepDerivative(nu) / stepFunction(nu) * (1 - 2*amatrix_[i][j]*mu);
+            for (int k = 0; k < 3; k++) {
+                double n = (molecule_->xyz(i)[k] - molecule_->xyz(j)[k]) * inv;
+                double gi = g * (-e[3*i + k] * inv - mu * n * inv);
+                double gj = g * ( e[3*j + k] * inv + mu * n * inv);
+                dZ[3*i + k] += gi;
+                dZ[3*j + k] += gj;
+                if (i == A) {
+                    dPA[3*i + k] += gi;
+                    dPA[3*j + k] += gj;
+                }
+            }
+        }
+    }
+
+    for (int C = 0; C < natom; C++) {
+        for (int k = 0; k < 3; k++) {
+            dW[C][k] = dPA[3*C + k] / Z - P[A] * dZ[3*C + k] / (Z * Z);
+        }
+    }
+    return P[A]/Z;
+}
+
 class OrientationMgr
 {
     // "Local" vector, matrix, atom, and molecule definitions.
@@ -3444,6 +3542,18 @@ OrientationMgr::OrientationMgr(Process::Environment& process_environment_in, boo
 
 namespace psi {
 
+/// A grid's nuclear weight scheme and per-atom Stratmann cutoffs, shared read-only by the blocks of a gradient
+class NuclearWeights {
+public:
+    NuclearWeights(boost::shared_ptr<Molecule> mol, int scheme) : mgr(mol, scheme), cutoff(mol->natom())
+    {
+        for (int A = 0; A < mol->natom(); A++)
+            cutoff[A] = mgr.GetStratmannCutoff(A);
+    }
+    NuclearWeightMgr mgr;
+    std::vector<double> cutoff;
+};
+
 class RadialPruneMgr {
 private:
     int nominal_order_;
@@ -3511,6 +3621,7 @@ void MolecularGrid::buildGridFromOptions(MolecularGridOptions const& opt)
     options_ = opt; // Save a copy
 
     std::vector<MassPoint> grid; // This is just for the first pass.
+    std::vector<int> parent; // Parent atom of each point
 
     OrientationMgr std_orientation(process_environment_, molecule_);
     RadialPruneMgr prune(opt);
@@ -3533,8 +3644,10 @@ void MolecularGrid::buildGridFromOptions(MolecularGridOptions const& opt)
                     MassPoint mp = { r[i] * anggrid[j].x, r[i]*anggrid[j].y, r[i]*anggrid[j].z, wr[i]*anggrid[j].w };
                     mp = std_orientation.MoveIntoPosition(mp, A);
                     mp.w *= nuc.computeNuclearWeight(mp, A, stratmannCutoff);
-                    if (mp.w != 0) // Skip points with weight zero
+                    if (mp.w != 0) { // Skip points with weight zero
                         grid.push_back(mp);
+                        parent.push_back(A);
+                    }
                     assert(!isnan(mp.w));
                 }
             }
@@ -3546,8 +3659,10 @@ void MolecularGrid::buildGridFromOptions(MolecularGridOptions const& opt)
             for (int i = 0; i < npts; i++) {
                 MassPoint mp = std_orientation.MoveIntoPosition(sg[i], A);
                 mp.w *= nuc.computeNuclearWeight(mp, A, stratmannCutoff);
-                if (mp.w != 0) // Skip points with weight zero
+                if (mp.w != 0) { // Skip points with weight zero
                     grid.push_back(mp);
+                    parent.push_back(A);
+                }
                 assert(!isnan(mp.w));
             }
         }
@@ -3558,11 +3673,13 @@ void MolecularGrid::buildGridFromOptions(MolecularGridOptions const& opt)
     y_ = new double[npoints_];
     z_ = new double[npoints_];
     w_ = new double[npoints_];
+    index_ = new int[npoints_];
     for (int i = 0; i < npoints_; i++) {
         x_[i] = grid[i].x;
         y_[i] = grid[i].y;
         z_[i] = grid[i].z;
         w_[i] = grid[i].w;
+        index_[i] = parent[i];
     }
 }
 
@@ -3718,8 +3835,8 @@ void BasisExtents::print(FILE* out)
     }
     fprintf(out, "\n\n");
 }
-BlockOPoints::BlockOPoints(int npoints, double* x, double* y, double* z, double* w, boost::shared_ptr<BasisExtents> extents) :
-    npoints_(npoints), x_(x), y_(y), z_(z), w_(w), extents_(extents)
+BlockOPoints::BlockOPoints(int npoints, double* x, double* y, double* z, double* w, int* index, boost::shared_ptr<BasisExtents> extents) :
+    npoints_(npoints), x_(x), y_(y), z_(z), w_(w), index_(index), extents_(extents)
 {
     bound();
     populate();
@@ -3834,23 +3951,93 @@ DFTGrid::DFTGrid(Process::Environment& process_environment_in, boost::shared_ptr
                  Options& options) :
     MolecularGrid(process_environment_in, molecule), primary_(primary), options_(options)
 {
-    buildGridFromOptions();
+    buildGridFromOptions(std::map<std::string, int>(), std::map<std::string, std::string>());
+}
+DFTGrid::DFTGrid(Process::Environment& process_environment_in, boost::shared_ptr<Molecule> molecule,
+                 boost::shared_ptr<BasisSet> primary,
+                 const std::map<std::string, int>& int_opts_map,
+                 const std::map<std::string, std::string>& str_opts_map,
+                 Options& options) :
+    MolecularGrid(process_environment_in, molecule), primary_(primary), options_(options)
+{
+    buildGridFromOptions(int_opts_map, str_opts_map);
 }
 DFTGrid::~DFTGrid()
 {
 }
+DFTGridContext::DFTGridContext(Process::Environment& process_environment_in, boost::shared_ptr<BasisSet> primary, Options& options) :
+    process_environment_(process_environment_in), options_(options), primary_(primary)
+{
+}
+DFTGridContext::~DFTGridContext()
+{
+}
+std::string DFTGridContext::grid_key(const std::map<std::string, int>& int_opts_map,
+                                     const std::map<std::string, std::string>& str_opts_map) const
+{
+    std::stringstream key;
+    key.precision(12);
 
-void DFTGrid::buildGridFromOptions()
+    boost::shared_ptr<Molecule> mol = primary_->molecule();
+    for (int A = 0; A < mol->natom(); A++) {
+        key << mol->Z(A) << " " << mol->x(A) << " " << mol->y(A) << " " << mol->z(A) << ";";
+    }
+
+    const char* int_keys[] = {"DFT_RADIAL_POINTS", "DFT_SPHERICAL_POINTS", "DFT_BLOCK_MAX_POINTS", "DFT_BLOCK_MIN_POINTS"};
+    const char* str_keys[] = {"DFT_RADIAL_SCHEME", "DFT_PRUNING_SCHEME", "DFT_NUCLEAR_SCHEME", "DFT_GRID_NAME", "DFT_BLOCK_SCHEME"};
+    const char* double_keys[] = {"DFT_BS_RADIUS_ALPHA", "DFT_PRUNING_ALPHA", "DFT_BLOCK_MAX_RADIUS", "DFT_BASIS_TOLERANCE"};
+    for (int i = 0; i < 4; i++) {
+        std::map<std::string, int>::const_iterator it = int_opts_map.find(int_keys[i]);
+        key << (it == int_opts_map.end() ? options_.get_int(int_keys[i]) : it->second) << ";";
+    }
+    for (int i = 0; i < 5; i++) {
+        std::map<std::string, std::string>::const_iterator it = str_opts_map.find(str_keys[i]);
+        key << (it == str_opts_map.end() ? options_.get_str(str_keys[i]) : it->second) << ";";
+    }
+    for (int i = 0; i < 4; i++) {
+        key << options_.get_double(double_keys[i]) << ";";
+    }
+
+    return key.str();
+}
+boost::shared_ptr<DFTGrid> DFTGridContext::grid(const std::map<std::string, int>& int_opts_map,
+                                                const std::map<std::string, std::string>& str_opts_map)
 {
+    std::string key = grid_key(int_opts_map, str_opts_map);
+    if (!grid_ || key != key_) {
+        grid_ = boost::shared_ptr<DFTGrid>(new DFTGrid(process_environment_, primary_->molecule(), primary_, int_opts_map, str_opts_map, options_));
+        key_ = key;
+    }
+    return grid_;
+}
+
+void DFTGrid::buildGridFromOptions(const std::map<std::string, int>& int_opts_map,
+                                   const std::map<std::string, std::string>& str_opts_map)
+{
+    // Overrides take precedence over the global options
+    std::map<std::string, int> int_opts;
+    int_opts["DFT_RADIAL_POINTS"] = options_.get_int("DFT_RADIAL_POINTS");
+    int_opts["DFT_SPHERICAL_POINTS"] = options_.get_int("DFT_SPHERICAL_POINTS");
+    for (std::map<std::string, int>::const_iterator it = int_opts_map.begin(); it != int_opts_map.end(); ++it)
+        int_opts[it->first] = it->second;
+
+    std::map<std::string, std::string> str_opts;
+    str_opts["DFT_RADIAL_SCHEME"] = options_.get_str("DFT_RADIAL_SCHEME");
+    str_opts["DFT_PRUNING_SCHEME"] = options_.get_str("DFT_PRUNING_SCHEME");
+    str_opts["DFT_NUCLEAR_SCHEME"] = options_.get_str("DFT_NUCLEAR_SCHEME");
+    str_opts["DFT_GRID_NAME"] = options_.get_str("DFT_GRID_NAME");
+    for (std::map<std::string, std::string>::const_iterator it = str_opts_map.begin(); it != str_opts_map.end(); ++it)
+        str_opts[it->first] = it->second;
+
     MolecularGridOptions opt;
     opt.bs_radius_alpha = options_.get_double("DFT_BS_RADIUS_ALPHA");
     opt.pruning_alpha = options_.get_double("DFT_PRUNING_ALPHA");
-    opt.radscheme = RadialGridMgr::WhichScheme(options_.get_str("DFT_RADIAL_SCHEME").c_str());
-    opt.prunescheme = RadialPruneMgr::WhichPruneScheme(options_.get_str("DFT_PRUNING_SCHEME").c_str());
-    opt.nucscheme = NuclearWeightMgr::WhichScheme(options_.get_str("DFT_NUCLEAR_SCHEME").c_str());
-    opt.namedGrid = StandardGridMgr::WhichGrid(options_.get_str("DFT_GRID_NAME").c_str());
-    opt.nradpts = options_.get_int("DFT_RADIAL_POINTS");
-    opt.nangpts = options_.get_int("DFT_SPHERICAL_POINTS");
+    opt.radscheme = RadialGridMgr::WhichScheme(str_opts["DFT_RADIAL_SCHEME"].c_str());
+    opt.prunescheme = RadialPruneMgr::WhichPruneScheme(str_opts["DFT_PRUNING_SCHEME"].c_str());
+    opt.nucscheme = NuclearWeightMgr::WhichScheme(str_opts["DFT_NUCLEAR_SCHEME"].c_str());
+    opt.namedGrid = StandardGridMgr::WhichGrid(str_opts["DFT_GRID_NAME"].c_str());
+    opt.nradpts = int_opts["DFT_RADIAL_POINTS"];
+    opt.nangpts = int_opts["DFT_SPHERICAL_POINTS"];
 
     if (LebedevGridMgr::findOrderByNPoints(opt.nangpts) < -1) {
         LebedevGridMgr::PrintHelp(); // Tell what the admissible values are.
@@ -4106,6 +4293,7 @@ MolecularGrid::~MolecularGrid()
         delete[] y_;
         delete[] z_;
         delete[] w_;
+        delete[] index_;
     }
 }
 
@@ -4117,9 +4305,11 @@ void MolecularGrid::block(int max_points, int min_points, double max_radius)
     // Reassign
     boost::shared_ptr<GridBlocker> blocker;
     if (options_.get_str("DFT_BLOCK_SCHEME") == "NAIVE") {
-        blocker = boost::shared_ptr<GridBlocker>(new NaiveGridBlocker(npoints_,x_,y_,z_,w_,max_points,min_points,max_radius,extents_));
+        blocker = boost::shared_ptr<GridBlocker>(new NaiveGridBlocker(npoints_,x_,y_,z_,w_,index_,max_points,min_points,max_radius,extents_));
     } else if (options_.get_str("DFT_BLOCK_SCHEME") == "OCTREE") {
-        blocker = boost::shared_ptr<GridBlocker>(new OctreeGridBlocker(npoints_,x_,y_,z_,w_,max_points,min_points,max_radius,extents_));
+        blocker = boost::shared_ptr<GridBlocker>(new OctreeGridBlocker(npoints_,x_,y_,z_,w_,index_,max_points,min_points,max_radius,extents_));
+    } else if (options_.get_str("DFT_BLOCK_SCHEME") == "COST") {
+        blocker = boost::shared_ptr<GridBlocker>(new CostGridBlocker(npoints_,x_,y_,z_,w_,index_,max_points,min_points,max_radius,extents_));
     }
 
     blocker->set_print(options_.get_int("PRINT"));
@@ -4132,11 +4322,13 @@ void MolecularGrid::block(int max_points, int min_points, double max_radius)
     delete[] y_;
     delete[] z_;
     delete[] w_;
+    delete[] index_;
 
     x_ = blocker->x();
     y_ = blocker->y();
     z_ = blocker->z();
     w_ = blocker->w();
+    index_ = blocker->index();
 
     npoints_ = blocker->npoints();
     max_points_ = blocker->max_points();
@@ -4178,6 +4370,7 @@ void MolecularGrid::remove_distant_points(double Rmax)
             y_[offset] = y_[Q];
             z_[offset] = z_[Q];
             w_[offset] = w_[Q];
+            index_[offset] = index_[Q];
             offset++;
         }
     }
@@ -4196,6 +4389,54 @@ void MolecularGrid::postProcess(boost::shared_ptr<BasisExtents> extents, int max
     block(max_points, min_points, max_radius);
 }
 
+boost::shared_ptr<NuclearWeights> MolecularGrid::nuclear_weights() const
+{
+    return boost::shared_ptr<NuclearWeights>(new NuclearWeights(molecule_, options_.nucscheme));
+}
+
+void MolecularGrid::weight_gradient(boost::shared_ptr<BlockOPoints> block, double* f, double** G, const NuclearWeights& nuc) const
+{
+    int natom = molecule_->natom();
+    std::vector<double> work(11*natom);
+    double** dW = block_matrix(natom, 3);
+    int npoints = block->npoints();
+    double* x = block->x();
+    double* y = block->y();
+    double* z = block->z();
+    double* w = block->w();
+    int* index = block->index();
+    for (int P = 0; P < npoints; P++) {
+        int A = index[P];
+        MassPoint mp = { x[P], y[P], z[P], w[P] };
+        double W = nuc.mgr.computeNuclearWeightGradient(mp, A, nuc.cutoff[A], dW, &work[0]);
+        if (W == 0.0) continue;
+        double scale = f[P] * w[P] / W;
+        // The point rides along with A, so A takes the negative sum (translational invariance)
+        for (int C = 0; C < natom; C++) {
+            if (C == A) continue;
+            for (int k = 0; k < 3; k++) {
+                G[C][k] += scale * dW[C][k];
+                G[A][k] -= scale * dW[C][k];
+            }
+        }
+    }
+    free_block(dW);
+}
+
+boost::shared_ptr<Matrix> MolecularGrid::block_statistics() const
+{
+    boost::shared_ptr<Matrix> stats(new Matrix("Block Statistics", blocks_.size(), 3));
+    double** statsp = stats->pointer();
+    for (int Q = 0; Q < blocks_.size(); Q++) {
+        int npoints = blocks_[Q]->npoints();
+        int nfunctions = blocks_[Q]->functions_local_to_global().size();
+        statsp[Q][0] = npoints;
+        statsp[Q][1] = nfunctions;
+        statsp[Q][2] = GridBlocker::gemm_flops(npoints, nfunctions);
+    }
+    return stats;
+}
+
 void MolecularGrid::print(FILE* out, int print) const
 {
     fprintf(out,"   => Molecular Quadrature <=\n\n");
@@ -4212,12 +4453,29 @@ void MolecularGrid::print(FILE* out, int print) const
     fprintf(out,"    Max Points       = %14d\n", max_points_);
     fprintf(out,"    Max Functions    = %14d\n", max_functions_);
     fprintf(out,"\n");
+
+    if (print > 2 && blocks_.size()) {
+        int min_functions = max_functions_;
+        double nfunctions = 0.0;
+        double flops = 0.0;
+        for (int Q = 0; Q < blocks_.size(); Q++) {
+            int nf = blocks_[Q]->functions_local_to_global().size();
+            min_functions = (nf < min_functions ? nf : min_functions);
+            nfunctions += nf;
+            flops += GridBlocker::gemm_flops(blocks_[Q]->npoints(), nf);
+        }
+        fprintf(out,"    Mean Points      = %14.1f\n", npoints_ / (double) blocks_.size());
+        fprintf(out,"    Mean Functions   = %14.1f\n", nfunctions / blocks_.size());
+        fprintf(out,"    Min Functions    = %14d\n", min_functions);
+        fprintf(out,"    GEMM GFlops/V    = %14.3f\n", flops / 1.0E9);
+        fprintf(out,"\n");
+    }
 }
 
 GridBlocker::GridBlocker(const int npoints_ref, double const* x_ref, double const* y_ref, double const* z_ref,
-    double const* w_ref, const int max_points, const int min_points, const double max_radius,
+    double const* w_ref, int const* index_ref, const int max_points, const int min_points, const double max_radius,
     boost::shared_ptr<BasisExtents> extents) :
-    npoints_ref_(npoints_ref), x_ref_(x_ref), y_ref_(y_ref), z_ref_(z_ref), w_ref_(w_ref),
+    npoints_ref_(npoints_ref), x_ref_(x_ref), y_ref_(y_ref), z_ref_(z_ref), w_ref_(w_ref), index_ref_(index_ref),
     tol_max_points_(max_points), tol_min_points_(min_points), tol_max_radius_(max_radius),
     extents_(extents), print_(1), debug_(0)
 {
@@ -4226,9 +4484,9 @@ GridBlocker::~GridBlocker()
 {
 }
 NaiveGridBlocker::NaiveGridBlocker(const int npoints_ref, double const* x_ref, double const* y_ref, double const* z_ref,
-    double const* w_ref, const int max_points, const int min_points, const double max_radius,
+    double const* w_ref, int const* index_ref, const int max_points, const int min_points, const double max_radius,
     boost::shared_ptr<BasisExtents> extents) :
-    GridBlocker(npoints_ref,x_ref,y_ref,z_ref,w_ref,max_points,min_points,max_radius,extents)
+    GridBlocker(npoints_ref,x_ref,y_ref,z_ref,w_ref,index_ref,max_points,min_points,max_radius,extents)
 {
 }
 NaiveGridBlocker::~NaiveGridBlocker()
@@ -4244,22 +4502,24 @@ void NaiveGridBlocker::block()
     y_ = new double[npoints_];
     z_ = new double[npoints_];
     w_ = new double[npoints_];
+    index_ = new int[npoints_];
 
     ::memcpy((void*)x_,(void*)x_ref_, sizeof(double)*npoints_);
     ::memcpy((void*)y_,(void*)y_ref_, sizeof(double)*npoints_);
     ::memcpy((void*)z_,(void*)z_ref_, sizeof(double)*npoints_);
     ::memcpy((void*)w_,(void*)w_ref_, sizeof(double)*npoints_);
+    ::memcpy((void*)index_,(void*)index_ref_, sizeof(int)*npoints_);
 
     blocks_.clear();
     for (int Q = 0; Q < npoints_; Q += max_points_) {
         int n = (Q + max_points_ >= npoints_ ? npoints_ - Q : max_points_);
-        blocks_.push_back(boost::shared_ptr<BlockOPoints>(new BlockOPoints(n,&x_[Q],&y_[Q],&z_[Q],&w_[Q], extents_)));
+        blocks_.push_back(boost::shared_ptr<BlockOPoints>(new BlockOPoints(n,&x_[Q],&y_[Q],&z_[Q],&w_[Q],&index_[Q], extents_)));
     }
 }
 OctreeGridBlocker::OctreeGridBlocker(const int npoints_ref, double const* x_ref, double const* y_ref, double const* z_ref,
-    double const* w_ref, const int max_points, const int min_points, const double max_radius,
+    double const* w_ref, int const* index_ref, const int max_points, const int min_points, const double max_radius,
     boost::shared_ptr<BasisExtents> extents) :
-    GridBlocker(npoints_ref,x_ref,y_ref,z_ref,w_ref,max_points,min_points,max_radius,extents)
+    GridBlocker(npoints_ref,x_ref,y_ref,z_ref,w_ref,index_ref,max_points,min_points,max_radius,extents)
 {
 }
 OctreeGridBlocker::~OctreeGridBlocker()
@@ -4362,9 +4622,9 @@ void OctreeGridBlocker::block()
                     // Determine radius of bounding sphere
                     double RC2 = 0.0;
                     for (int Q = 0; Q < left.size(); Q++) {
-                        double dx = x[Q] - XC[0];
-                        double dy = y[Q] - XC[1];
-                        double dz = z[Q] - XC[2];
+                        double dx = x[left[Q]] - XC[0];
+                        double dy = y[left[Q]] - XC[1];
+                        double dz = z[left[Q]] - XC[2];
                         double R2 = dx * dx + dy * dy + dz * dz;
                         RC2 = (RC2 > R2 ? RC2 : R2);
                     }
@@ -4372,7 +4632,6 @@ void OctreeGridBlocker::block()
                     // Terminate if necessary
                     if (RC2 < T2) {
                         completed_tree.push_back(left);
-                        continue;
                     } else {
                         new_leaves.push_back(left);
                     }
@@ -4397,9 +4656,9 @@ void OctreeGridBlocker::block()
                     // Determine radius of bounding sphere
                     double RC2 = 0.0;
                     for (int Q = 0; Q < right.size(); Q++) {
-                        double dx = x[Q] - XC[0];
-                        double dy = y[Q] - XC[1];
-                        double dz = z[Q] - XC[2];
+                        double dx = x[right[Q]] - XC[0];
+                        double dy = y[right[Q]] - XC[1];
+                        double dz = z[right[Q]] - XC[2];
                         double R2 = dx * dx + dy * dy + dz * dz;
                         RC2 = (RC2 > R2 ? RC2 : R2);
                     }
@@ -4407,7 +4666,6 @@ void OctreeGridBlocker::block()
                     // Terminate if necessary
                     if (RC2 < T2) {
                         completed_tree.push_back(right);
-                        continue;
                     } else {
                         new_leaves.push_back(right);
                     }
@@ -4430,6 +4688,7 @@ void OctreeGridBlocker::block()
     y_ = new double[npoints_];
     z_ = new double[npoints_];
     w_ = new double[npoints_];
+    index_ = new int[npoints_];
 
     int index = 0;
     int unique_block = 0;
@@ -4446,6 +4705,7 @@ void OctreeGridBlocker::block()
             y_[index] = y[delta];
             z_[index] = z[delta];
             w_[index] = w[delta];
+            index_[index] = index_ref_[delta];
             if (bench_) fprintf(fh_blocks, "   %4d %15.6E %15.6E %15.6E %15.6E\n", unique_block, x_[index], y_[index], z_[index], w_[index]);
             index++;
         }
@@ -4458,7 +4718,7 @@ void OctreeGridBlocker::block()
     for (int A = 0; A < completed_tree.size(); A++) {
         std::vector<int> block = completed_tree[A];
         if (!block.size()) continue;
-        blocks_.push_back(boost::shared_ptr<BlockOPoints>(new BlockOPoints(block.size(),&x_[index],&y_[index],&z_[index],&w_[index],extents_)));
+        blocks_.push_back(boost::shared_ptr<BlockOPoints>(new BlockOPoints(block.size(),&x_[index],&y_[index],&z_[index],&w_[index],&index_[index],extents_)));
         if (max_points_ < block.size()) {
             max_points_ = block.size();
         }
@@ -4503,4 +4763,150 @@ void OctreeGridBlocker::block()
     }
 }
 
+
+CostGridBlocker::CostGridBlocker(const int npoints_ref, double const* x_ref, double const* y_ref, double const* z_ref,
+    double const* w_ref, int const* index_ref, const int max_points, const int min_points, const double max_radius,
+    boost::shared_ptr<BasisExtents> extents) :
+    OctreeGridBlocker(npoints_ref,x_ref,y_ref,z_ref,w_ref,index_ref,max_points,min_points,max_radius,extents)
+{
+}
+CostGridBlocker::~CostGridBlocker()
+{
+}
+double CostGridBlocker::block_cost(int npoints, int nfunctions)
+{
+    // DGEMM reaches half of peak at about this inner dimension
+    const double gemm_half = 32.0;
+    // Per-block setup (extents, functional, scatter/gather) in flop equivalents
+    const double block_overhead = 2.0E5;
+
+    double m = (npoints < nfunctions ? npoints : nfunctions);
+    double efficiency = m / (m + gemm_half);
+    if (efficiency == 0.0) return block_overhead;
+    return GridBlocker::gemm_flops(npoints, nfunctions) / efficiency + block_overhead;
+}
+void CostGridBlocker::block()
+{
+    // => Octree leaves <= //
+    OctreeGridBlocker::block();
+
+    int nblocks = blocks_.size();
+    if (nblocks < 2) return;
+
+    // => Morton order of the leaf centers <= //
+    double xmin = x_[0], xmax = x_[0];
+    double ymin = y_[0], ymax = y_[0];
+    double zmin = z_[0], zmax = z_[0];
+    for (int P = 1; P < npoints_; P++) {
+        xmin = (x_[P] < xmin ? x_[P] : xmin); xmax = (x_[P] > xmax ? x_[P] : xmax);
+        ymin = (y_[P] < ymin ? y_[P] : ymin); ymax = (y_[P] > ymax ? y_[P] : ymax);
+        zmin = (z_[P] < zmin ? z_[P] : zmin); zmax = (z_[P] > zmax ? z_[P] : zmax);
+    }
+    double span = std::max(xmax - xmin, std::max(ymax - ymin, zmax - zmin));
+    if (span == 0.0) span = 1.0;
+
+    // 10 bits per dimension
+    const unsigned long long nbin = 1024;
+    std::vector<std::pair<unsigned long long, int> > keys(nblocks);
+    std::vector<int> offsets(nblocks);
+    int offset = 0;
+    for (int A = 0; A < nblocks; A++) {
+        boost::shared_ptr<BlockOPoints> B = blocks_[A];
+        offsets[A] = offset;
+        offset += B->npoints();
+        double xc = 0.0, yc = 0.0, zc = 0.0;
+        for (int P = 0; P < B->npoints(); P++) {
+            xc += B->x()[P];
+            yc += B->y()[P];
+            zc += B->z()[P];
+        }
+        unsigned long long c[3];
+        c[0] = (unsigned long long) ((xc / B->npoints() - xmin) / span * (nbin - 1));
+        c[1] = (unsigned long long) ((yc / B->npoints() - ymin) / span * (nbin - 1));
+        c[2] = (unsigned long long) ((zc / B->npoints() - zmin) / span * (nbin - 1));
+        unsigned long long key = 0L;
+        for (int bit = 0; bit < 10; bit++) {
+            for (int k = 0; k < 3; k++) {
+                key |= ((c[k] >> bit) & 1ULL) << (3 * bit + k);
+            }
+        }
+        keys[A] = std::make_pair(key, A);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    // => Reorder the points along the curve <= //
+    double* x2 = new double[npoints_];
+    double* y2 = new double[npoints_];
+    double* z2 = new double[npoints_];
+    double* w2 = new double[npoints_];
+    int* index2 = new int[npoints_];
+    std::vector<int> sizes(nblocks);
+    offset = 0;
+    for (int A2 = 0; A2 < nblocks; A2++) {
+        int A = keys[A2].second;
+        int n = blocks_[A]->npoints();
+        ::memcpy((void*) &x2[offset], (void*) &x_[offsets[A]], sizeof(double) * n);
+        ::memcpy((void*) &y2[offset], (void*) &y_[offsets[A]], sizeof(double) * n);
+        ::memcpy((void*) &z2[offset], (void*) &z_[offsets[A]], sizeof(double) * n);
+        ::memcpy((void*) &w2[offset], (void*) &w_[offsets[A]], sizeof(double) * n);
+        ::memcpy((void*) &index2[offset], (void*) &index_[offsets[A]], sizeof(int) * n);
+        sizes[A2] = n;
+        offset += n;
+    }
+    std::vector<boost::shared_ptr<BlockOPoints> > leaves(nblocks);
+    for (int A2 = 0; A2 < nblocks; A2++) {
+        leaves[A2] = blocks_[keys[A2].second];
+    }
+    delete[] x_;
+    delete[] y_;
+    delete[] z_;
+    delete[] w_;
+    delete[] index_;
+    x_ = x2;
+    y_ = y2;
+    z_ = z2;
+    w_ = w2;
+    index_ = index2;
+
+    // => Greedy merge of curve neighbors <= //
+    blocks_.clear();
+    int start = 0;
+    int npoints = sizes[0];
+    boost::shared_ptr<BlockOPoints> current(new BlockOPoints(npoints,&x_[start],&y_[start],&z_[start],&w_[start],&index_[start],extents_));
+    double cost = block_cost(npoints, current->functions_local_to_global().size());
+    for (int A = 1; A < nblocks; A++) {
+        int n = sizes[A];
+        double next_cost = block_cost(n, leaves[A]->functions_local_to_global().size());
+        if (npoints + n <= tol_max_points_) {
+            boost::shared_ptr<BlockOPoints> merged(new BlockOPoints(npoints + n,&x_[start],&y_[start],&z_[start],&w_[start],&index_[start],extents_));
+            double merged_cost = block_cost(npoints + n, merged->functions_local_to_global().size());
+            if (merged_cost <= cost + next_cost) {
+                current = merged;
+                cost = merged_cost;
+                npoints += n;
+                continue;
+            }
+        }
+        blocks_.push_back(current);
+        start += npoints;
+        npoints = n;
+        current = boost::shared_ptr<BlockOPoints>(new BlockOPoints(npoints,&x_[start],&y_[start],&z_[start],&w_[start],&index_[start],extents_));
+        cost = next_cost;
+    }
+    blocks_.push_back(current);
+
+    max_points_ = 0;
+    max_functions_ = 0;
+    for (int A = 0; A < blocks_.size(); A++) {
+        if (max_points_ < blocks_[A]->npoints())
+            max_points_ = blocks_[A]->npoints();
+        if (max_functions_ < blocks_[A]->functions_local_to_global().size())
+            max_functions_ = blocks_[A]->functions_local_to_global().size();
+    }
+
+    if (print_ > 1) {
+        fprintf(outfile, "  Cost blocking: %d octree leaves merged into %zu blocks.\n\n", nblocks, blocks_.size());
+    }
+}
+
 }
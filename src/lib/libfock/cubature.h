@@ -26,6 +26,8 @@
 #include <psi4-dec.h>
 #include <psiconfig.h>
 #include <libmints/vector3.h>
+#include <map>
+#include <string>
 
 namespace psi {
 
@@ -37,6 +39,7 @@ class IntVector;
 class Vector3;
 class BasisExtents;
 class BlockOPoints;
+class NuclearWeights;
 
 class MolecularGrid {
 protected:
@@ -59,6 +62,8 @@ protected:
     double* z_;
     /// Full weights
     double* w_;
+    /// Parent atom of each point
+    int* index_;
  
     /// Vector of blocks 
     std::vector<boost::shared_ptr<BlockOPoints> > blocks_;
@@ -115,6 +120,16 @@ public:
     double* z() const { return z_; }
     /// The weights, normalized to 1 on R3. You do not own this 
     double* w() const { return w_; }
+    /// The parent atom of each point. You do not own this 
+    int* index() const { return index_; }
+
+    /// The nuclear weight scheme and per-atom cutoffs, built once per gradient for weight_gradient
+    boost::shared_ptr<NuclearWeights> nuclear_weights() const;
+    /// Add sum_P f_P dw_P/dR to G (natom x 3), the points of block moving with their parent atoms
+    void weight_gradient(boost::shared_ptr<BlockOPoints> block, double* f, double** G, const NuclearWeights& nuc) const;
+
+    /// Per-block statistics (nblocks x 3): points, significant functions, estimated GEMM flops
+    boost::shared_ptr<Matrix> block_statistics() const;
 
     /// Pointer to basis extents
     boost::shared_ptr<BasisExtents> extents() const { return extents_; }
@@ -160,7 +175,8 @@ protected:
     /// The primary basis 
     boost::shared_ptr<BasisSet> primary_; 
     /// Master builder methods
-    void buildGridFromOptions();
+    void buildGridFromOptions(const std::map<std::string, int>& int_opts_map,
+                              const std::map<std::string, std::string>& str_opts_map);
     /// The Options object
     Options& options_;
 
@@ -168,9 +184,48 @@ public:
     DFTGrid(Process::Environment& process_environment_in, boost::shared_ptr<Molecule> molecule,
             boost::shared_ptr<BasisSet> primary,
             Options& options);
+    /// Build with some DFT_* grid options overridden (e.g. a coarse grid), keyed by option name
+    DFTGrid(Process::Environment& process_environment_in, boost::shared_ptr<Molecule> molecule,
+            boost::shared_ptr<BasisSet> primary,
+            const std::map<std::string, int>& int_opts_map,
+            const std::map<std::string, std::string>& str_opts_map,
+            Options& options);
     virtual ~DFTGrid();
 };
 
+/**
+ * Shareable owner of a DFTGrid (points, extents and blocking) on one basis.
+ * Potentials that borrow the context (different functionals, RV or UV)
+ * reuse the grid as long as the geometry and the DFT_* grid options match.
+ */
+class DFTGridContext {
+
+protected:
+    Process::Environment& process_environment_;
+    Options& options_;
+    /// The primary basis, shared by all borrowing potentials
+    boost::shared_ptr<BasisSet> primary_;
+    /// The current grid and the signature it was built for
+    boost::shared_ptr<DFTGrid> grid_;
+    std::string key_;
+
+    /// Geometry + grid options (+ overrides) the grid depends on
+    std::string grid_key(const std::map<std::string, int>& int_opts_map,
+                         const std::map<std::string, std::string>& str_opts_map) const;
+
+public:
+    DFTGridContext(Process::Environment& process_environment_in, boost::shared_ptr<BasisSet> primary, Options& options);
+    virtual ~DFTGridContext();
+
+    /// The primary basis
+    boost::shared_ptr<BasisSet> basis() const { return primary_; }
+    /// The grid for these overrides, built only if the cached one no longer matches
+    boost::shared_ptr<DFTGrid> grid(const std::map<std::string, int>& int_opts_map,
+                                    const std::map<std::string, std::string>& str_opts_map);
+    /// Drop the cached grid
+    void reset() { grid_.reset(); key_.clear(); }
+};
+
 class BlockOPoints {
 
 protected:
@@ -184,6 +239,8 @@ protected:
     double* z_;
     /// Pointer to w (does not own)
     double* w_;
+    /// Pointer to the parent atoms (does not own)
+    int* index_;
     /// Relevant shells, local -> global 
     std::vector<int> shells_local_to_global_;
     /// Relevant functions, local -> global 
@@ -202,7 +259,7 @@ protected:
     void bound();
 
 public:
-    BlockOPoints(int npoints, double* x, double* y, double* z, double* w, 
+    BlockOPoints(int npoints, double* x, double* y, double* z, double* w, int* index,
         boost::shared_ptr<BasisExtents> extents);     
     virtual ~BlockOPoints();
 
@@ -222,6 +279,8 @@ public:
     double* z() const { return z_; }
     /// The weights. You do not own this 
     double* w() const { return w_; }
+    /// The parent atoms. You do not own this 
+    int* index() const { return index_; }
 
     /// Relevant shells, local -> global 
     const std::vector<int>& shells_local_to_global() const { return shells_local_to_global_; }
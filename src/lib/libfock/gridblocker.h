@@ -56,6 +56,7 @@ protected:
     double const* y_ref_;  
     double const* z_ref_;  
     double const* w_ref_;  
+    int const* index_ref_;  
 
     const int tol_max_points_;
     const int tol_min_points_;
@@ -70,12 +71,13 @@ protected:
     double* y_;
     double* z_;
     double* w_;
+    int* index_;
     std::vector<boost::shared_ptr<BlockOPoints> > blocks_;
     
 public:
     
     GridBlocker(const int npoints_ref, double const* x_ref, double const* y_ref, double const* z_ref,
-        double const* w_ref, const int max_points, const int min_points, const double max_radius,
+        double const* w_ref, int const* index_ref, const int max_points, const int min_points, const double max_radius,
         boost::shared_ptr<BasisExtents> extents);
     virtual ~GridBlocker();
     
@@ -88,8 +90,12 @@ public:
     double* y() const { return y_; }
     double* z() const { return z_; }
     double* w() const { return w_; }
+    int* index() const { return index_; }
     const std::vector<boost::shared_ptr<BlockOPoints> >& blocks() const { return blocks_; }
 
+    /// Flops of the two npoints x nfunctions x nfunctions GEMMs a block costs per V build (density and potential)
+    static double gemm_flops(int npoints, int nfunctions) { return 4.0 * npoints * (double) nfunctions * nfunctions; }
+
     void set_print(int print) { print_ = print; }
     void set_debug(int debug) { debug_ = debug; }
     void set_bench(int bench) { bench_ = bench; }
@@ -104,7 +110,7 @@ class NaiveGridBlocker : public GridBlocker {
 public:
     
     NaiveGridBlocker(const int npoints_ref, double const* x_ref, double const* y_ref, double const* z_ref,
-        double const* w_ref, const int max_points, const int min_points, const double max_radius,
+        double const* w_ref, int const* index_ref, const int max_points, const int min_points, const double max_radius,
         boost::shared_ptr<BasisExtents> extents);
     virtual ~NaiveGridBlocker();
     
@@ -119,13 +125,33 @@ class OctreeGridBlocker : public GridBlocker {
 public:
     
     OctreeGridBlocker(const int npoints_ref, double const* x_ref, double const* y_ref, double const* z_ref,
-        double const* w_ref, const int max_points, const int min_points, const double max_radius,
+        double const* w_ref, int const* index_ref, const int max_points, const int min_points, const double max_radius,
         boost::shared_ptr<BasisExtents> extents);
     virtual ~OctreeGridBlocker();
     
     virtual void block();
 };
 
+/**
+ * Octree blocking, then neighboring leaves (in Morton order) are merged
+ * while that lowers the modelled GEMM time of the blocks
+ */
+class CostGridBlocker : public OctreeGridBlocker {
+
+protected:
+    /// Modelled time (in flops at peak) of a block: GEMM flops at a size-dependent efficiency, plus a fixed overhead
+    static double block_cost(int npoints, int nfunctions);
+
+public:
+    
+    CostGridBlocker(const int npoints_ref, double const* x_ref, double const* y_ref, double const* z_ref,
+        double const* w_ref, int const* index_ref, const int max_points, const int min_points, const double max_radius,
+        boost::shared_ptr<BasisExtents> extents);
+    virtual ~CostGridBlocker();
+    
+    virtual void block();
+};
+
 }
 #endif
 
@@ -26,9 +26,11 @@
 #include <libpsio/psio.h>
 #include <libpsio/aiohandler.h>
 #include <libqt/qt.h>
+#include <libqt/diagnostics.h>
 #include <psi4-dec.h>
 #include <psifiles.h>
 #include <libmints/sieve.h>
+#include <libmints/workspace.h>
 #include <libiwl/iwl.hpp>
 #include "jk.h"
 #include "cubature.h"
@@ -37,6 +39,7 @@
 #include<lib3index/cholesky.h>
 
 #include <sstream>
+#include <algorithm>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -181,6 +184,8 @@ boost::shared_ptr<JK> JK::build_JK(Process::Environment& process_environment_in,
             jk->set_bench(options.get_int("BENCH"));
         if (options["DF_INTS_NUM_THREADS"].has_changed())
             jk->set_df_ints_num_threads(options.get_int("DF_INTS_NUM_THREADS"));
+        if (options["SCREENING"].has_changed())
+            jk->set_qqr(options.get_str("SCREENING") == "QQR");
 
         return boost::shared_ptr<JK>(jk);
 
@@ -207,6 +212,8 @@ void JK::common_init()
     #endif
     cutoff_ = 1.0E-12;
 
+    workspace_ = boost::shared_ptr<MatrixWorkspace>(new MatrixWorkspace("JK"));
+
     do_J_ = true;
     do_K_ = true;
     do_wK_ = false;
@@ -439,18 +446,18 @@ void JK::USO2AO()
     C_left_ao_.clear();
     C_right_ao_.clear();
     for (int N = 0; N < D_.size(); ++N) {
-        std::stringstream s;
-        s << "C Left " << N << " (AO)";
+        char label[32];
+        sprintf(label, "C Left %d (AO)", N);
         int ncol = 0;
         for (int h = 0; h < C_left_[N]->nirrep(); ++h) ncol += C_left_[N]->colspi()[h];
-        C_left_ao_.push_back(SharedMatrix(new Matrix(s.str(),AO2USO_->rowspi()[0], ncol)));
+        C_left_ao_.push_back(workspace_->acquire(label,AO2USO_->rowspi()[0], ncol));
     }
     for (int N = 0; (N < D_.size()) && (!lr_symmetric_); ++N) {
-        std::stringstream s;
-        s << "C Right " << N << " (AO)";
+        char label[32];
+        sprintf(label, "C Right %d (AO)", N);
         int ncol = 0;
         for (int h = 0; h < C_right_[N]->nirrep(); ++h) ncol += C_right_[N]->colspi()[h];
-        C_right_ao_.push_back(SharedMatrix(new Matrix(s.str(),AO2USO_->rowspi()[0], ncol)));
+        C_right_ao_.push_back(workspace_->acquire(label,AO2USO_->rowspi()[0], ncol));
     }
 
     // Alias pointers if lr_symmetric_
@@ -459,7 +466,8 @@ void JK::USO2AO()
     }
 
     // Transform D
-    double* temp = new double[AO2USO_->max_ncol() * AO2USO_->max_nrow()];
+    SharedMatrix T = workspace_->acquire("USO2AO temp", AO2USO_->max_ncol(), AO2USO_->max_nrow());
+    double* temp = T->pointer()[0];
     for (int N = 0; N < D_.size(); ++N) {
         D_ao_[N]->zero();
         int symm = D_[N]->symmetry();
@@ -476,7 +484,7 @@ void JK::USO2AO()
             C_DGEMM('N','N',nao,nao,nsol,1.0,Ulp[0],nsol,temp,nao,1.0,DAOp[0],nao);
         }
     }
-    delete[] temp;
+    workspace_->release(T);
 
     // Transform C
     for (int N = 0; N < D_.size(); ++N) {
@@ -527,7 +535,8 @@ void JK::AO2USO()
     // If not C1, J/K/wK are already allocated
 
     // Transform
-    double* temp = new double[AO2USO_->max_ncol() * AO2USO_->max_nrow()];
+    SharedMatrix T = workspace_->acquire("USO2AO temp", AO2USO_->max_ncol(), AO2USO_->max_nrow());
+    double* temp = T->pointer()[0];
     for (int N = 0; N < D_.size(); ++N) {
         int symm = D_[N]->symmetry();
         for (int h = 0; h < AO2USO_->nirrep(); ++h) {
@@ -560,11 +569,13 @@ void JK::AO2USO()
             }
         }
     }
-    delete[] temp;
+    workspace_->release(T);
 }
 void JK::initialize()
 {
+    diagnostics::phase_on("JK: Preiterations");
     preiterations();
+    diagnostics::phase_off("JK: Preiterations");
 }
 void JK::compute()
 {
@@ -575,25 +586,25 @@ void JK::compute()
         lr_symmetric_ = false;
     }
 
-    //~ timer_on("JK: D");
+    diagnostics::phase_on("JK: D");
     compute_D();
-    //~ timer_off("JK: D");
+    diagnostics::phase_off("JK: D");
     if (C1()) {
-        //~ timer_on("JK: USO2AO");
+        diagnostics::phase_on("JK: USO2AO");
         USO2AO();
-        //~ timer_off("JK: USO2AO");
+        diagnostics::phase_off("JK: USO2AO");
     } else {
         allocate_JK();
     }
 
-    //~ timer_on("JK: JK");
+    diagnostics::phase_on("JK: JK");
     compute_JK();
-    //~ timer_off("JK: JK");
+    diagnostics::phase_off("JK: JK");
 
     if (C1()) {
-        //~ timer_on("JK: AO2USO");
+        diagnostics::phase_on("JK: AO2USO");
         AO2USO();
-        //~ timer_off("JK: AO2USO");
+        diagnostics::phase_off("JK: AO2USO");
     }
 
     if (debug_ > 6) {
@@ -1225,9 +1236,10 @@ void PKJK::preiterations()
         mints->integrals_erf(omega_);
     mints.reset();
 
-    int nso   = process_environment_.wavefunction()->nso();
-    int *sopi = process_environment_.wavefunction()->nsopi();
-    int nirreps = process_environment_.wavefunction()->nirrep();
+    // The SO basis of this object, whatever wavefunction the environment holds
+    int nso   = primary_->nbf();
+    const int *sopi = AO2USO_->colspi();
+    int nirreps = AO2USO_->nirrep();
 
     so2symblk_ = new int[nso];
     so2index_  = new int[nso];
@@ -1520,18 +1532,25 @@ void PKJK::preiterations()
 
 void PKJK::compute_JK()
 {
-    int nirreps = process_environment_.wavefunction()->nirrep();
-    int *sopi   = process_environment_.wavefunction()->nsopi();
+    int nirreps = AO2USO_->nirrep();
+    const int *sopi = AO2USO_->colspi();
 
-    bool file_was_open = psio_->open_check(pk_file_);
-//    if(!file_was_open);
+    // The PK file stays open between calls and is closed in postiterations()
+    if(!psio_->open_check(pk_file_))
         psio_->open(pk_file_, PSIO_OPEN_OLD);
 
-
     int nbatches = batch_pq_min_.size();
-    std::vector<double*> J_vectors;
-    std::vector<double*> K_vectors;
-    std::vector<double*> D_vectors;
+
+    // One result vector and one density vector per matrix, reused across calls
+    size_t nvec = std::max(J_.size(), std::max(K_.size(), wK_.size()));
+    if(pk_vectors_.size() < 2 * nvec * pk_pairs_)
+        pk_vectors_.resize(2 * nvec * pk_pairs_);
+    size_t max_batch = 0;
+    for(int batch = 0; batch < nbatches; ++batch)
+        max_batch = std::max(max_batch, batch_index_max_[batch] - batch_index_min_[batch]);
+    if(pk_block_.size() < max_batch)
+        pk_block_.resize(max_batch);
+    char label[100];
 
 if(do_J_) {
     /*
@@ -1540,12 +1559,9 @@ if(do_J_) {
     for(int N = 0; N < J_.size(); ++N){
         if(D_[N]->symmetry())
             throw PSIEXCEPTION("PK integrals cannot be used for this type of calculation.");
-        double *J_vector = new double[pk_pairs_];
+        double *J_vector = &pk_vectors_[2 * N * pk_pairs_];
+        double *D_vector = J_vector + pk_pairs_;
         ::memset(J_vector,  0, pk_pairs_ * sizeof(double));
-        J_vectors.push_back(J_vector);
-        double *D_vector = new double[pk_pairs_];
-        ::memset(D_vector,  0, pk_pairs_ * sizeof(double));
-        D_vectors.push_back(D_vector);
         // The off-diagonal terms need to be doubled here
         size_t pqval = 0;
         for (int h = 0; h < nirreps; ++h) {
@@ -1569,16 +1585,15 @@ if(do_J_) {
             size_t min_index   = batch_index_min_[batch];
             size_t max_index   = batch_index_max_[batch];
             size_t batch_size = max_index - min_index;
-            double *j_block = new double[batch_size];
+            double *j_block = &pk_block_[0];
 
-            char *label = new char[100];
             sprintf(label, "J Block (Batch %d)", batch);
             psio_->read_entry(pk_file_, label, (char*) j_block, batch_size * sizeof(double));
 
             int nvectors = J_.size();
             for(int N = 0; N < nvectors; ++N){
-                double *D_vector = D_vectors[N];
-                double *J_vector = J_vectors[N];
+                double *J_vector = &pk_vectors_[2 * N * pk_pairs_];
+                double *D_vector = J_vector + pk_pairs_;
                 double *j_ptr = j_block;
                 for (size_t pq = min_pq; pq < max_pq; ++pq) {
                     double D_pq = D_vector[pq];
@@ -1595,14 +1610,12 @@ if(do_J_) {
                     J_vector[pq] += J_pq;
                 }
             }
-            delete[] label;
-            delete[] j_block;
         }
     }
 
     for(int N = 0; N < J_.size(); ++N){
         // Copy the results from the vector to the buffer
-        double *J = J_vectors[N];
+        double *J = &pk_vectors_[2 * N * pk_pairs_];
         for (int h = 0; h < nirreps; ++h) {
             for (int p = 0; p < sopi[h]; ++p) {
                 for (int q = 0; q <= p; ++q) {
@@ -1611,8 +1624,6 @@ if(do_J_) {
             }
         }
         J_[N]->copy_lower_to_upper();
-        delete [] D_vectors[N];
-        delete [] J_vectors[N];
     }
 }
 
@@ -1621,14 +1632,10 @@ if(do_K_) {
     /*
      * The K terms
      */
-    D_vectors.clear();
     for(int N = 0; N < K_.size(); ++N){
-        double *K_vector = new double[pk_pairs_];
+        double *K_vector = &pk_vectors_[2 * N * pk_pairs_];
+        double *D_vector = K_vector + pk_pairs_;
         ::memset(K_vector,  0, pk_pairs_ * sizeof(double));
-        K_vectors.push_back(K_vector);
-        double *D_vector = new double[pk_pairs_];
-        ::memset(D_vector,  0, pk_pairs_ * sizeof(double));
-        D_vectors.push_back(D_vector);
         // The off-diagonal terms need to be doubled here
         size_t pqval = 0;
         for (int h = 0; h < nirreps; ++h) {
@@ -1652,16 +1659,15 @@ if(do_K_) {
             size_t min_index   = batch_index_min_[batch];
             size_t max_index   = batch_index_max_[batch];
             size_t batch_size = max_index - min_index;
-            double *k_block = new double[batch_size];
+            double *k_block = &pk_block_[0];
 
-            char *label = new char[100];
             sprintf(label, "K Block (Batch %d)", batch);
             psio_->read_entry(pk_file_, label, (char*) k_block, batch_size * sizeof(double));
 
             int nvectors = K_.size();
             for(int N = 0; N < nvectors; ++N){
-                double *D_vector = D_vectors[N];
-                double *K_vector = K_vectors[N];
+                double *K_vector = &pk_vectors_[2 * N * pk_pairs_];
+                double *D_vector = K_vector + pk_pairs_;
                 double *k_ptr = k_block;
                 for (size_t pq = min_pq; pq < max_pq; ++pq) {
                     double D_pq = D_vector[pq];
@@ -1678,14 +1684,12 @@ if(do_K_) {
                     K_vector[pq] += K_pq;
                 }
             }
-            delete[] label;
-            delete[] k_block;
         }
     }
 
     for(int N = 0; N < K_.size(); ++N){
         // Copy the results from the vector to the buffer
-        double *K = K_vectors[N];
+        double *K = &pk_vectors_[2 * N * pk_pairs_];
         for (int h = 0; h < nirreps; ++h) {
             for (int p = 0; p < sopi[h]; ++p) {
                 for (int q = 0; q <= p; ++q) {
@@ -1694,8 +1698,6 @@ if(do_K_) {
             }
         }
         K_[N]->copy_lower_to_upper();
-        delete [] D_vectors[N];
-        delete [] K_vectors[N];
     }
 }
 
@@ -1703,15 +1705,10 @@ if(do_wK_) {
     /*
      * The wK terms
      */
-    std::vector<double*> wK_vectors;
-    D_vectors.clear();
     for(int N = 0; N < wK_.size(); ++N){
-        double *K_vector = new double[pk_pairs_];
+        double *K_vector = &pk_vectors_[2 * N * pk_pairs_];
+        double *D_vector = K_vector + pk_pairs_;
         ::memset(K_vector,  0, pk_pairs_ * sizeof(double));
-        wK_vectors.push_back(K_vector);
-        double *D_vector = new double[pk_pairs_];
-        ::memset(D_vector,  0, pk_pairs_ * sizeof(double));
-        D_vectors.push_back(D_vector);
         // The off-diagonal terms need to be doubled here
         size_t pqval = 0;
         for (int h = 0; h < nirreps; ++h) {
@@ -1735,16 +1732,15 @@ if(do_wK_) {
             size_t min_index   = batch_index_min_[batch];
             size_t max_index   = batch_index_max_[batch];
             size_t batch_size = max_index - min_index;
-            double *k_block = new double[batch_size];
+            double *k_block = &pk_block_[0];
 
-            char *label = new char[100];
             sprintf(label, "wK Block (Batch %d)", batch);
             psio_->read_entry(pk_file_, label, (char*) k_block, batch_size * sizeof(double));
 
             int nvectors = wK_.size();
             for(int N = 0; N < nvectors; ++N){
-                double *D_vector = D_vectors[N];
-                double *K_vector = wK_vectors[N];
+                double *K_vector = &pk_vectors_[2 * N * pk_pairs_];
+                double *D_vector = K_vector + pk_pairs_;
                 double *k_ptr = k_block;
                 for (size_t pq = min_pq; pq < max_pq; ++pq) {
                     double D_pq = D_vector[pq];
@@ -1761,14 +1757,12 @@ if(do_wK_) {
                     K_vector[pq] += K_pq;
                 }
             }
-            delete[] label;
-            delete[] k_block;
         }
     }
 
     for(int N = 0; N < wK_.size(); ++N){
         // Copy the results from the vector to the buffer
-        double *K = wK_vectors[N];
+        double *K = &pk_vectors_[2 * N * pk_pairs_];
         for (int h = 0; h < nirreps; ++h) {
             for (int p = 0; p < sopi[h]; ++p) {
                 for (int q = 0; q <= p; ++q) {
@@ -1777,19 +1771,17 @@ if(do_wK_) {
             }
         }
         wK_[N]->copy_lower_to_upper();
-
-        delete [] D_vectors[N];
-        delete [] wK_vectors[N];
     }
 }
-
-//    if(!file_was_open);
-        psio_->close(pk_file_, 1);
 }
 
 
 void PKJK::postiterations()
 {
+    if(psio_->open_check(pk_file_))
+        psio_->close(pk_file_, 1);
+    std::vector<double>().swap(pk_vectors_);
+    std::vector<double>().swap(pk_block_);
     delete[] so2symblk_;
     delete[] so2index_;
 }
@@ -1806,6 +1798,8 @@ DirectJK::~DirectJK()
 }
 void DirectJK::common_init()
 {
+    erf_omega_ = 0.0;
+    qqr_ = false;
     df_ints_num_threads_ = 1;
     #ifdef _OPENMP
         df_ints_num_threads_ = omp_get_max_threads();
@@ -1823,53 +1817,62 @@ void DirectJK::print_header() const
             fprintf(outfile, "    Omega:             %11.3E\n", omega_);
         fprintf(outfile, "    Integrals threads: %11d\n", df_ints_num_threads_);
         //fprintf(outfile, "    Memory (MB):       %11ld\n", (memory_ *8L) / (1024L * 1024L));
-        fprintf(outfile, "    Schwarz Cutoff:    %11.0E\n\n", cutoff_);
+        fprintf(outfile, "    Schwarz Cutoff:    %11.0E\n", cutoff_);
+        fprintf(outfile, "    Screening:         %11s\n\n", (qqr_ ? "QQR" : "Schwarz"));
     }
 }
 void DirectJK::preiterations()
 {
     sieve_ = boost::shared_ptr<ERISieve>(new ERISieve(primary_, cutoff_));
+    sieve_->set_qqr(qqr_);
+    factory_ = boost::shared_ptr<IntegralFactory>(new IntegralFactory(primary_,primary_,primary_,primary_));
+    eri_.clear();
+    erf_eri_.clear();
 }
 void DirectJK::compute_JK()
 {
-    boost::shared_ptr<IntegralFactory> factory(new IntegralFactory(primary_,primary_,primary_,primary_));
+    if (!factory_) {
+        factory_ = boost::shared_ptr<IntegralFactory>(new IntegralFactory(primary_,primary_,primary_,primary_));
+    }
+
+    // Scratch J/K for the tasks not asked for, shared by all D
+    std::vector<boost::shared_ptr<Matrix> > temp;
+    if (do_wK_ || !(do_J_ && do_K_)) {
+        for (int i = 0; i < D_ao_.size(); i++) {
+            temp.push_back(workspace_->acquire("temp", primary_->nbf(), primary_->nbf()));
+        }
+    }
 
     if (do_wK_) {
-        std::vector<boost::shared_ptr<TwoBodyAOInt> > ints;
-        for (int thread = 0; thread < df_ints_num_threads_; thread++) {
-            ints.push_back(boost::shared_ptr<TwoBodyAOInt>(factory->erf_eri(omega_)));
+        // omega may change between calls
+        if (erf_eri_.size() != df_ints_num_threads_ || erf_omega_ != omega_) {
+            erf_eri_.clear();
+            for (int thread = 0; thread < df_ints_num_threads_; thread++) {
+                erf_eri_.push_back(boost::shared_ptr<TwoBodyAOInt>(factory_->erf_eri(omega_)));
+            }
+            erf_omega_ = omega_;
         }
         // TODO: Fast K algorithm
         if (do_J_) {
-            build_JK(ints,D_ao_,J_ao_,wK_ao_);
+            build_JK(erf_eri_,D_ao_,J_ao_,wK_ao_);
         } else {
-            std::vector<boost::shared_ptr<Matrix> > temp;
-            for (int i = 0; i < D_ao_.size(); i++) {
-                temp.push_back(boost::shared_ptr<Matrix>(new Matrix("temp", primary_->nbf(), primary_->nbf())));
-            }
-            build_JK(ints,D_ao_,temp,wK_ao_);
+            build_JK(erf_eri_,D_ao_,temp,wK_ao_);
         }
     }
 
     if (do_J_ || do_K_) {
-        std::vector<boost::shared_ptr<TwoBodyAOInt> > ints;
-        for (int thread = 0; thread < df_ints_num_threads_; thread++) {
-            ints.push_back(boost::shared_ptr<TwoBodyAOInt>(factory->eri()));
+        if (eri_.size() != df_ints_num_threads_) {
+            eri_.clear();
+            for (int thread = 0; thread < df_ints_num_threads_; thread++) {
+                eri_.push_back(boost::shared_ptr<TwoBodyAOInt>(factory_->eri()));
+            }
         }
         if (do_J_ && do_K_) {
-            build_JK(ints,D_ao_,J_ao_,K_ao_);
+            build_JK(eri_,D_ao_,J_ao_,K_ao_);
         } else if (do_J_) {
-            std::vector<boost::shared_ptr<Matrix> > temp;
-            for (int i = 0; i < D_ao_.size(); i++) {
-                temp.push_back(boost::shared_ptr<Matrix>(new Matrix("temp", primary_->nbf(), primary_->nbf())));
-            }
-            build_JK(ints,D_ao_,J_ao_,temp);
+            build_JK(eri_,D_ao_,J_ao_,temp);
         } else {
-            std::vector<boost::shared_ptr<Matrix> > temp;
-            for (int i = 0; i < D_ao_.size(); i++) {
-                temp.push_back(boost::shared_ptr<Matrix>(new Matrix("temp", primary_->nbf(), primary_->nbf())));
-            }
-            build_JK(ints,D_ao_,temp,K_ao_);
+            build_JK(eri_,D_ao_,temp,K_ao_);
         }
     }
 
@@ -1877,6 +1880,9 @@ void DirectJK::compute_JK()
 void DirectJK::postiterations()
 {
     sieve_.reset();
+    eri_.clear();
+    erf_eri_.clear();
+    factory_.reset();
 }
 void DirectJK::build_JK(std::vector<boost::shared_ptr<TwoBodyAOInt> >& ints,
                         std::vector<boost::shared_ptr<Matrix> >& D,
@@ -1898,10 +1904,16 @@ void DirectJK::build_JK(std::vector<boost::shared_ptr<TwoBodyAOInt> >& ints,
     int nshell  = primary_->nshell();
     int nthread = df_ints_num_threads_;
 
+    // => Density Screening <= //
+
+    sieve_->set_density(D);
+
     // => Task Blocking <= //
 
-    std::vector<int> task_shells;
-    std::vector<int> task_starts;
+    std::vector<int>& task_shells = task_shells_;
+    std::vector<int>& task_starts = task_starts_;
+    task_shells.clear();
+    task_starts.clear();
 
     // > Atomic Blocking < //
 
@@ -1921,7 +1933,8 @@ void DirectJK::build_JK(std::vector<boost::shared_ptr<TwoBodyAOInt> >& ints,
     size_t ntask2 = ntask * ntask;
     size_t ntask4 = ntask * ntask * ntask * ntask;
 
-    std::vector<int> task_offsets;
+    std::vector<int>& task_offsets = task_offsets_;
+    task_offsets.clear();
     task_offsets.push_back(0);
     for (int P2 = 0; P2 < primary_->nshell(); P2++) {
         task_offsets.push_back(task_offsets[P2] + primary_->shell(task_shells[P2]).nfunction());
@@ -1953,7 +1966,8 @@ void DirectJK::build_JK(std::vector<boost::shared_ptr<TwoBodyAOInt> >& ints,
 
     // => Significant Task Pairs (PQ|-style <= //
 
-    std::vector<std::pair<int, int> > task_pairs;
+    std::vector<std::pair<int, int> >& task_pairs = task_pairs_;
+    task_pairs.clear();
     for (int Ptask = 0; Ptask < ntask; Ptask++) {
         for (int Qtask = 0; Qtask < ntask; Qtask++) {
             if (Qtask > Ptask) continue;
@@ -1977,22 +1991,35 @@ void DirectJK::build_JK(std::vector<boost::shared_ptr<TwoBodyAOInt> >& ints,
 
     // => Intermediate Buffers <= //
 
-    std::vector<std::vector<boost::shared_ptr<Matrix> > > JKT;
+    std::vector<std::vector<boost::shared_ptr<Matrix> > >& JKT = task_JKT_;
+    JKT.resize(nthread);
     for (int thread = 0; thread < nthread; thread++) {
-        std::vector<boost::shared_ptr<Matrix> > JK2;
+        JKT[thread].resize(D.size());
         for (int ind = 0; ind < D.size(); ind++) {
-            JK2.push_back(boost::shared_ptr<Matrix>(new Matrix("JKT", (lr_symmetric_ ? 6 : 10) * max_task, max_task)));
+            JKT[thread][ind] = workspace_->acquire("JKT", (lr_symmetric_ ? 6 : 10) * max_task, max_task);
         }
-        JKT.push_back(JK2);
     }
 
+    // => Shell quartet lists, per thread <= //
+
+    std::vector<std::vector<int> >& task_quartets = task_quartets_;
+    std::vector<std::vector<std::pair<int, int> > >& task_classes = task_classes_;
+    std::vector<std::vector<int> >& task_batch = task_batch_;
+    task_quartets.resize(nthread);
+    task_classes.resize(nthread);
+    task_batch.resize(nthread);
+
+    // Bound on the integrals of one batch
+    const size_t max_batch_size = 131072L;
+
     // => Benchmarks <= //
 
     size_t computed_shells = 0L;
+    size_t screened_shells = 0L;
 
     // ==> Master Task Loop <== //
 
-    #pragma omp parallel for num_threads(nthread) schedule(dynamic) reduction(+: computed_shells)
+    #pragma omp parallel for num_threads(nthread) schedule(dynamic) reduction(+: computed_shells, screened_shells)
     for (size_t task = 0L; task < ntask_pair2; task++) {
 
         size_t task1 = task / ntask_pair;
@@ -2032,9 +2059,12 @@ void DirectJK::build_JK(std::vector<boost::shared_ptr<TwoBodyAOInt> >& ints,
             thread = omp_get_thread_num();
         #endif
 
-        // => Master shell quartet loops <= //
+        // => Significant shell quartets, by angular momentum class <= //
 
-        bool touched = false;
+        std::vector<int>& quartets = task_quartets[thread];
+        std::vector<std::pair<int, int> >& classes = task_classes[thread];
+        quartets.clear();
+        classes.clear();
         for (int P2 = P2start; P2 < P2start + nPtask; P2++) {
         for (int Q2 = Q2start; Q2 < Q2start + nQtask; Q2++) {
             if (Q2 > P2) continue;
@@ -2048,16 +2078,60 @@ void DirectJK::build_JK(std::vector<boost::shared_ptr<TwoBodyAOInt> >& ints,
             int S = task_shells[S2];
             if (R2 * nshell + S2 > P2 * nshell + Q2) continue;
             if (!sieve_->shell_pair_significant(R,S)) continue;
-            if (!sieve_->shell_significant(P,Q,R,S)) continue;
-
-            //printf("Quartet: %2d %2d %2d %2d\n", P, Q, R, S);
+            if (!sieve_->shell_significant_density(P,Q,R,S)) {
+                screened_shells++;
+                continue;
+            }
+            int am = ((primary_->shell(P).am() * 16 + primary_->shell(Q).am()) * 16 + primary_->shell(R).am()) * 16 + primary_->shell(S).am();
+            classes.push_back(std::pair<int, int>(am, quartets.size() / 4));
+            quartets.push_back(P2);
+            quartets.push_back(Q2);
+            quartets.push_back(R2);
+            quartets.push_back(S2);
+        }}}}
+        std::sort(classes.begin(), classes.end());
+
+        // => Master shell quartet loop, the integrals computed in batches <= //
+
+        std::vector<int>& batch = task_batch[thread];
+        bool touched = false;
+        for (size_t first = 0L, last = 0L; first < classes.size(); first = last) {
+
+            batch.clear();
+            size_t batch_size = 0L;
+            for (; last < classes.size(); last++) {
+                const int* quartet = &quartets[4 * classes[last].second];
+                size_t size = 1L;
+                for (int k = 0; k < 4; k++) {
+                    batch.push_back(task_shells[quartet[k]]);
+                    size *= primary_->shell(task_shells[quartet[k]]).nfunction();
+                }
+                batch_size += size;
+                if (batch_size > max_batch_size && last > first) {
+                    batch.resize(batch.size() - 4);
+                    break;
+                }
+            }
 
             //if (thread == 0) timer_on("JK: Ints");
-            ints[thread]->compute_shell(P,Q,R,S);
-            computed_shells++;
+            ints[thread]->compute_shells(last - first, &batch[0]);
+            computed_shells += last - first;
             //if (thread == 0) timer_off("JK: Ints");
 
-            const double* buffer = ints[thread]->buffer();
+        for (size_t ind2 = first; ind2 < last; ind2++) {
+            const int* quartet = &quartets[4 * classes[ind2].second];
+            int P2 = quartet[0];
+            int Q2 = quartet[1];
+            int R2 = quartet[2];
+            int S2 = quartet[3];
+            int P = task_shells[P2];
+            int Q = task_shells[Q2];
+            int R = task_shells[R2];
+            int S = task_shells[S2];
+
+            //printf("Quartet: %2d %2d %2d %2d\n", P, Q, R, S);
+
+            const double* buffer = ints[thread]->batch_buffer() + ints[thread]->batch_offsets()[ind2 - first];
 
             int Psize = primary_->shell(P).nfunction();
             int Qsize = primary_->shell(Q).nfunction();
@@ -2140,7 +2214,7 @@ void DirectJK::build_JK(std::vector<boost::shared_ptr<TwoBodyAOInt> >& ints,
             touched = true;
             //if (thread == 0) timer_off("JK: GEMV");
 
-        }}}} // End Shell Quartets
+        }} // End Shell Quartets
 
         if (!touched) continue;
 
@@ -2304,6 +2378,15 @@ void DirectJK::build_JK(std::vector<boost::shared_ptr<TwoBodyAOInt> >& ints,
 
     } // End master task list
 
+    diagnostics::count(diagnostics::QuartetsComputed, computed_shells);
+    diagnostics::count(diagnostics::QuartetsScreened, screened_shells);
+
+    for (int thread = 0; thread < nthread; thread++) {
+        for (int ind = 0; ind < D.size(); ind++) {
+            workspace_->release(JKT[thread][ind]);
+        }
+    }
+
     for (int ind = 0; ind < D.size(); ind++) {
         J[ind]->scale(2.0);
         J[ind]->hermitivitize();
@@ -2608,34 +2691,27 @@ int DFJK::max_nocc() const
 }
 void DFJK::initialize_temps()
 {
-    J_temp_ = boost::shared_ptr<Vector>(new Vector("Jtemp", sieve_->function_pairs().size()));
-    D_temp_ = boost::shared_ptr<Vector>(new Vector("Dtemp", sieve_->function_pairs().size()));
-    d_temp_ = boost::shared_ptr<Vector>(new Vector("dtemp", max_rows_));
-
+    // The vectors live until postiterations, the matrices come from the workspace
+    size_t num_nm = sieve_->function_pairs().size();
+    if (!J_temp_ || J_temp_->dim() != (int) num_nm) {
+        J_temp_ = boost::shared_ptr<Vector>(new Vector("Jtemp", num_nm));
+        D_temp_ = boost::shared_ptr<Vector>(new Vector("Dtemp", num_nm));
+    }
+    if (!d_temp_ || d_temp_->dim() != max_rows_)
+        d_temp_ = boost::shared_ptr<Vector>(new Vector("dtemp", max_rows_));
 
-    #ifdef _OPENMP
-    int temp_nthread = omp_get_max_threads();
-    omp_set_num_threads(omp_nthread_);
     C_temp_.resize(omp_nthread_);
     Q_temp_.resize(omp_nthread_);
-    #pragma omp parallel
-    {
-        C_temp_[omp_get_thread_num()] = SharedMatrix(new Matrix("Ctemp", max_nocc_, primary_->nbf()));
-        Q_temp_[omp_get_thread_num()] = SharedMatrix(new Matrix("Qtemp", max_rows_, primary_->nbf()));
+    for (int thread = 0; thread < omp_nthread_; thread++) {
+        C_temp_[thread] = workspace_->acquire("Ctemp", max_nocc_, primary_->nbf());
+        Q_temp_[thread] = workspace_->acquire("Qtemp", max_rows_, primary_->nbf());
     }
-    omp_set_num_threads(temp_nthread);
-    #else
-        for (int thread = 0; thread < omp_nthread_; thread++) {
-            C_temp_.push_back(SharedMatrix(new Matrix("Ctemp", max_nocc_, primary_->nbf())));
-            Q_temp_.push_back(SharedMatrix(new Matrix("Qtemp", max_rows_, primary_->nbf())));
-        }
-    #endif
 
-    E_left_ = SharedMatrix(new Matrix("E_left", primary_->nbf(), max_rows_ * max_nocc_));
+    E_left_ = workspace_->acquire("E_left", primary_->nbf(), max_rows_ * max_nocc_);
     if (lr_symmetric_)
         E_right_ = E_left_;
     else
-        E_right_ = boost::shared_ptr<Matrix>(new Matrix("E_right", primary_->nbf(), max_rows_ * max_nocc_));
+        E_right_ = workspace_->acquire("E_right", primary_->nbf(), max_rows_ * max_nocc_);
 
 }
 void DFJK::initialize_w_temps()
@@ -2643,33 +2719,20 @@ void DFJK::initialize_w_temps()
     int max_rows_w = max_rows_ / 2;
     max_rows_w = (max_rows_w < 1 ? 1 : max_rows_w);
 
-    #ifdef _OPENMP
-    int temp_nthread = omp_get_max_threads();
-    omp_set_num_threads(omp_nthread_);
-        C_temp_.resize(omp_nthread_);
-        Q_temp_.resize(omp_nthread_);
-        #pragma omp parallel
-        {
-            C_temp_[omp_get_thread_num()] = SharedMatrix(new Matrix("Ctemp", max_nocc_, primary_->nbf()));
-            Q_temp_[omp_get_thread_num()] = SharedMatrix(new Matrix("Qtemp", max_rows_w, primary_->nbf()));
-        }
-    omp_set_num_threads(temp_nthread);
-    #else
-        for (int thread = 0; thread < omp_nthread_; thread++) {
-            C_temp_.push_back(SharedMatrix(new Matrix("Ctemp", max_nocc_, primary_->nbf())));
-            Q_temp_.push_back(SharedMatrix(new Matrix("Qtemp", max_rows_w, primary_->nbf())));
-        }
-    #endif
+    C_temp_.resize(omp_nthread_);
+    Q_temp_.resize(omp_nthread_);
+    for (int thread = 0; thread < omp_nthread_; thread++) {
+        C_temp_[thread] = workspace_->acquire("Ctemp", max_nocc_, primary_->nbf());
+        Q_temp_[thread] = workspace_->acquire("Qtemp", max_rows_w, primary_->nbf());
+    }
 
-    E_left_  = SharedMatrix(new Matrix("E_left", primary_->nbf(), max_rows_w * max_nocc_));
-    E_right_ = SharedMatrix(new Matrix("E_right", primary_->nbf(), max_rows_w * max_nocc_));
+    E_left_  = workspace_->acquire("E_left", primary_->nbf(), max_rows_w * max_nocc_);
+    E_right_ = workspace_->acquire("E_right", primary_->nbf(), max_rows_w * max_nocc_);
 
 }
 void DFJK::free_temps()
 {
-    J_temp_.reset();
-    D_temp_.reset();
-    d_temp_.reset();
+    // Hand the matrices back to the workspace; clear() keeps the capacity of the lists
     E_left_.reset();
     E_right_.reset();
     C_temp_.clear();
@@ -2741,7 +2804,26 @@ void DFJK::postiterations()
     Qmn_.reset();
     Qlmn_.reset();
     Qrmn_.reset();
+    J_temp_.reset();
+    D_temp_.reset();
+    d_temp_.reset();
 }
+// Auxiliary shells ordered by angular momentum, so that the (A 0|mn) of one mn pair come in one
+// run per class through TwoBodyAOInt::compute_shells
+static std::vector<int> aux_shells_by_am(boost::shared_ptr<BasisSet> auxiliary)
+{
+    std::vector<std::pair<int, int> > order;
+    for (int P = 0; P < auxiliary->nshell(); P++) {
+        order.push_back(std::pair<int, int>(auxiliary->shell(P).am(), P));
+    }
+    std::sort(order.begin(), order.end());
+    std::vector<int> shells;
+    for (size_t ind = 0; ind < order.size(); ind++) {
+        shells.push_back(order[ind].second);
+    }
+    return shells;
+}
+
 void DFJK::initialize_JK_core()
 {
     int ntri = sieve_->function_pairs().size();
@@ -2769,16 +2851,18 @@ void DFJK::initialize_JK_core()
     //Get a TEI for each thread
     boost::shared_ptr<BasisSet> zero = BasisSet::zero_ao_basis_set();
     boost::shared_ptr<IntegralFactory> rifactory(new IntegralFactory(auxiliary_, zero, primary_, primary_));
-    const double **buffer = new const double*[nthread];
     boost::shared_ptr<TwoBodyAOInt> *eri = new boost::shared_ptr<TwoBodyAOInt>[nthread];
     for (int Q = 0; Q<nthread; Q++) {
         eri[Q] = boost::shared_ptr<TwoBodyAOInt>(rifactory->eri());
-        buffer[Q] = eri[Q]->buffer();
     }
 
     const std::vector<long int>& schwarz_shell_pairs = sieve_->shell_pairs_reverse();
     const std::vector<long int>& schwarz_fun_pairs = sieve_->function_pairs_reverse();
 
+    // The (A|mn) of one mn shell pair in one batch, A by angular momentum
+    std::vector<int> aux_shells = aux_shells_by_am(auxiliary_);
+    std::vector<std::vector<int> > quartets(nthread, std::vector<int>(4 * aux_shells.size()));
+
     int numP,Pshell,MU,NU,P,PHI,mu,nu,nummu,numnu,omu,onu;
 
     //~ timer_on("JK: (A|mn)");
@@ -2793,9 +2877,17 @@ void DFJK::initialize_JK_core()
         for (NU=0; NU <= MU; ++NU) {
             numnu = primary_->shell(NU).nfunction();
             if (schwarz_shell_pairs[MU*(MU+1)/2+NU] > -1) {
-                for (Pshell=0; Pshell < auxiliary_->nshell(); ++Pshell) {
+                for (size_t ind = 0; ind < aux_shells.size(); ++ind) {
+                    quartets[rank][4*ind] = aux_shells[ind];
+                    quartets[rank][4*ind+1] = 0;
+                    quartets[rank][4*ind+2] = MU;
+                    quartets[rank][4*ind+3] = NU;
+                }
+                eri[rank]->compute_shells(aux_shells.size(), &quartets[rank][0]);
+                for (size_t ind = 0; ind < aux_shells.size(); ++ind) {
+                    Pshell = aux_shells[ind];
                     numP = auxiliary_->shell(Pshell).nfunction();
-                    eri[rank]->compute_shell(Pshell, 0, MU, NU);
+                    const double* buffer = eri[rank]->batch_buffer() + eri[rank]->batch_offsets()[ind];
                     for (mu=0 ; mu < nummu; ++mu) {
                         omu = primary_->shell(MU).function_index() + mu;
                         for (nu=0; nu < numnu; ++nu) {
@@ -2803,7 +2895,7 @@ void DFJK::initialize_JK_core()
                             if(omu>=onu && schwarz_fun_pairs[omu*(omu+1)/2+onu] > -1) {
                                 for (P=0; P < numP; ++P) {
                                     PHI = auxiliary_->shell(Pshell).function_index() + P;
-                                    Qmnp[PHI][schwarz_fun_pairs[omu*(omu+1)/2+onu]] = buffer[rank][P*nummu*numnu + mu*numnu + nu];
+                                    Qmnp[PHI][schwarz_fun_pairs[omu*(omu+1)/2+onu]] = buffer[P*nummu*numnu + mu*numnu + nu];
                                 }
                             }
                         }
@@ -2820,7 +2912,6 @@ void DFJK::initialize_JK_core()
 
     //~ timer_off("JK: (A|mn)");
 
-    delete []buffer;
     delete []eri;
 
     //~ timer_on("JK: (A|Q)^-1/2");
@@ -3109,13 +3200,15 @@ void DFJK::initialize_JK_disk()
     // ==> ERI initialization <== //
     boost::shared_ptr<BasisSet> zero = BasisSet::zero_ao_basis_set();
     boost::shared_ptr<IntegralFactory> rifactory(new IntegralFactory(auxiliary_, zero, primary_, primary_));
-    const double **buffer = new const double*[nthread];
     boost::shared_ptr<TwoBodyAOInt> *eri = new boost::shared_ptr<TwoBodyAOInt>[nthread];
     for (int Q = 0; Q<nthread; Q++) {
         eri[Q] = boost::shared_ptr<TwoBodyAOInt>(rifactory->eri());
-        buffer[Q] = eri[Q]->buffer();
     }
 
+    // The (A|mn) of one mn shell pair in one batch, A by angular momentum
+    std::vector<int> aux_shells = aux_shells_by_am(auxiliary_);
+    std::vector<std::vector<int> > quartets(nthread, std::vector<int>(4 * aux_shells.size()));
+
     // ==> Main loop <== //
     for (int block = 0; block < nblock; block++) {
         int MN_start_val = MN_start_b[block];
@@ -3141,10 +3234,18 @@ void DFJK::initialize_JK_disk()
             int numnu = primary_->shell(NU).nfunction();
             int mu = primary_->shell(MU).function_index();
             int nu = primary_->shell(NU).function_index();
-            for (int P = 0; P < auxiliary_->nshell(); P++) {
+            for (size_t ind = 0; ind < aux_shells.size(); ind++) {
+                quartets[rank][4*ind] = aux_shells[ind];
+                quartets[rank][4*ind+1] = 0;
+                quartets[rank][4*ind+2] = MU;
+                quartets[rank][4*ind+3] = NU;
+            }
+            eri[rank]->compute_shells(aux_shells.size(), &quartets[rank][0]);
+            for (size_t ind = 0; ind < aux_shells.size(); ind++) {
+                int P = aux_shells[ind];
                 int nump = auxiliary_->shell(P).nfunction();
                 int p = auxiliary_->shell(P).function_index();
-                eri[rank]->compute_shell(P,0,MU,NU);
+                const double* buffer = eri[rank]->batch_buffer() + eri[rank]->batch_offsets()[ind];
                 for (int dm = 0; dm < nummu; dm++) {
                     int omu = mu + dm;
                     for (int dn = 0; dn < numnu;  dn++) {
@@ -3153,7 +3254,7 @@ void DFJK::initialize_JK_disk()
                             int delta = schwarz_fun_pairs_r[omu*(omu+1)/2 + onu] - mn_start_val;
                             for (int dp = 0; dp < nump; dp ++) {
                                 int op = p + dp;
-                                Qmnp[op][delta] = buffer[rank][dp*nummu*numnu + dm*numnu + dn];
+                                Qmnp[op][delta] = buffer[dp*nummu*numnu + dm*numnu + dn];
                             }
                         }
                     }
@@ -4038,6 +4139,7 @@ void DFJK::block_J(double** Qmnp, int naux)
         //~ timer_on("JK: J2");
         C_DGEMV('T',naux,num_nm,1.0,Qmnp[0],num_nm,dp,1,0.0,J2p,1);
         //~ timer_off("JK: J2");
+        diagnostics::count(diagnostics::GemmFlops, 4.0 * naux * num_nm);
         for (unsigned long int mn = 0; mn < num_nm; ++mn) {
             int m = function_pairs[mn].first;
             int n = function_pairs[mn].second;
@@ -4146,6 +4248,7 @@ void DFJK::block_K(double** Qmnp, int naux)
         //~ timer_on("JK: K2");
         C_DGEMM('N','T',nbf,nbf,naux*nocc,1.0,Elp[0],naux*nocc,Erp[0],naux*nocc,1.0,Kp[0],nbf);
         //~ timer_off("JK: K2");
+        diagnostics::count(diagnostics::GemmFlops, 2.0 * nbf * nbf * (double) naux * nocc);
     }
 
 }
@@ -5104,9 +5207,11 @@ void ICJK::preiterations() {
     double* kptr = reshaped_eri_k_->get_pointer();
     AOShellCombinationsIterator shellIter = intfac_->shells_iterator();
     const double *buffer = eri_->buffer();
+    size_t computed_shells = 0L;
     for (shellIter.first(); shellIter.is_done() == false; shellIter.next()) {
         // Compute quartet
         eri_->compute_shell(shellIter);
+        computed_shells++;
         // From the quartet get all the integrals
         AOIntegralsIterator intIter = shellIter.integrals_iterator();
         for (intIter.first(); intIter.is_done() == false; intIter.next()) {
@@ -5117,6 +5222,7 @@ void ICJK::preiterations() {
             jptr[ij2I(k, l) * bigN_ + ij2I(i, j)] = jptr[ij2I(i, j) * bigN_ + ij2I(k, l)] = buffer[intIter.index()];
         }
     }
+    diagnostics::count(diagnostics::QuartetsComputed, computed_shells);
     for (shellIter.first(); shellIter.is_done() == false; shellIter.next()) {
         // Compute quartet
         // From the quartet get all the integrals
@@ -37,6 +37,7 @@ class BasisSet;
 class Matrix;
 class IntegralFactory;
 class ERISieve;
+class MatrixWorkspace;
 class TwoBodyAOInt;
 class Options;
 class FittingMetric;
@@ -173,6 +174,8 @@ protected:
     double cutoff_;
     /// Whether to all desymmetrization, for cases when it's already been performed elsewhere
     bool allow_desymmetrization_;
+    /// Pool the per-call temporaries (AO C matrices, scratch J/K) are drawn from
+    boost::shared_ptr<MatrixWorkspace> workspace_;
 
     // => Tasks <= //
 
@@ -337,6 +340,11 @@ public:
     * @param omega range-separation parameter
     */
     void set_omega(double omega) { omega_ = omega; }
+    /**
+    * Draw per-call temporaries from this workspace (e.g. the
+    * calling wavefunction's), instead of the JK's own
+    */
+    void set_workspace(boost::shared_ptr<MatrixWorkspace> workspace) { workspace_ = workspace; }
 
     // => Computers <= //
 
@@ -524,6 +532,11 @@ class PKJK : public JK {
     /// The index of the last integral in each batch
     std::vector<size_t> batch_index_max_;
 
+    /// Packed result and density vectors, kept between compute_JK calls
+    std::vector<double> pk_vectors_;
+    /// Buffer for one batch of PK integrals, kept between compute_JK calls
+    std::vector<double> pk_block_;
+
     /// Do we need to backtransform to C1 under the hood?
     virtual bool C1() const { return false; }
     /// Setup integrals, files, etc
@@ -579,6 +592,24 @@ protected:
     int df_ints_num_threads_;
     /// ERI Sieve
     boost::shared_ptr<ERISieve> sieve_;
+    /// Integral factory and per-thread integral objects, kept between compute() calls
+    boost::shared_ptr<IntegralFactory> factory_;
+    std::vector<boost::shared_ptr<TwoBodyAOInt> > eri_;
+    std::vector<boost::shared_ptr<TwoBodyAOInt> > erf_eri_;
+    /// The omega erf_eri_ was built for
+    double erf_omega_;
+    /// Tighten the Schwarz bounds of far-apart shell pairs with their distance (QQR)?
+    bool qqr_;
+
+    /// Task blocking, buffers and per-thread quartet lists of build_JK, kept between calls
+    std::vector<int> task_shells_;
+    std::vector<int> task_starts_;
+    std::vector<int> task_offsets_;
+    std::vector<std::pair<int, int> > task_pairs_;
+    std::vector<std::vector<boost::shared_ptr<Matrix> > > task_JKT_;
+    std::vector<std::vector<int> > task_quartets_;
+    std::vector<std::vector<std::pair<int, int> > > task_classes_;
+    std::vector<std::vector<int> > task_batch_;
 
     // => Required Algorithm-Specific Methods <= //
 
@@ -591,7 +622,8 @@ protected:
     /// Delete integrals, files, etc
     virtual void postiterations();
 
-    /// Build the J and K matrices for this integral class
+    /// Build the J and K matrices for this integral class, skipping the quartets whose
+    /// bound times the density blocks they meet is below the cutoff
     void build_JK(std::vector<boost::shared_ptr<TwoBodyAOInt> >& ints,
         std::vector<boost::shared_ptr<Matrix> >& D,
         std::vector<boost::shared_ptr<Matrix> >& J,
@@ -621,6 +653,12 @@ public:
      * @param val a positive integer
      */
     void set_df_ints_num_threads(int val) { df_ints_num_threads_ = val; }
+    /**
+     * Use distance-dependent (QQR) quartet bounds?
+     * See ERISieve. Defaults to false, plain Schwarz
+     * @param qqr true to use QQR
+     */
+    void set_qqr(bool qqr) { qqr_ = qqr; }
 
     // => Accessors <= //
 
@@ -0,0 +1,272 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * PSI4: an ab initio quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *@END LICENSE
+ */
+
+#include <libmints/mints.h>
+#include <libqt/qt.h>
+#include <cmath>
+#include "pointprop.h"
+#include "points.h"
+#include "cubature.h"
+#include "psiconfig.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace psi {
+
+PointProp::PointProp(boost::shared_ptr<BasisSet> primary, double basis_tolerance, int block_size) :
+    primary_(primary), block_size_(block_size), nthreads_(1)
+{
+    extents_ = boost::shared_ptr<BasisExtents>(new BasisExtents(primary_, basis_tolerance));
+    #ifdef _OPENMP
+    nthreads_ = omp_get_max_threads();
+    #endif
+}
+PointProp::~PointProp()
+{
+}
+SharedMatrix PointProp::compute_density(SharedMatrix points, SharedMatrix D)
+{
+    if (points->colspi()[0] != 3)
+        throw PSIEXCEPTION("PointProp: points must be npoints x 3");
+
+    int npoints = points->rowspi()[0];
+    int nbf = primary_->nbf();
+    double** Pp = points->pointer();
+    double** Dp = D->pointer();
+
+    SharedMatrix rho(new Matrix("Density", npoints, 4));
+    double** Rp = rho->pointer();
+
+    std::vector<boost::shared_ptr<BasisFunctions> > functions;
+    std::vector<SharedMatrix> XYZ;
+    std::vector<SharedMatrix> T;
+    std::vector<SharedMatrix> Dl;
+    std::vector<std::vector<int> > index;
+    for (int thread = 0; thread < nthreads_; thread++) {
+        functions.push_back(boost::shared_ptr<BasisFunctions>(new BasisFunctions(primary_, block_size_, nbf)));
+        functions[thread]->set_deriv(1);
+        XYZ.push_back(SharedMatrix(new Matrix("XYZW", 4, block_size_)));
+        T.push_back(SharedMatrix(new Matrix("T", block_size_, nbf)));
+        Dl.push_back(SharedMatrix(new Matrix("Dlocal", nbf, nbf)));
+        index.push_back(std::vector<int>(block_size_, 0));
+    }
+
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads_)
+    for (int B = 0; B < nblocks(npoints); B++) {
+
+        int thread = 0;
+        #ifdef _OPENMP
+        thread = omp_get_thread_num();
+        #endif
+
+        int start = B * block_size_;
+        int n = (start + block_size_ > npoints ? npoints - start : block_size_);
+        double** XYZp = XYZ[thread]->pointer();
+        for (int P = 0; P < n; P++) {
+            XYZp[0][P] = Pp[start + P][0];
+            XYZp[1][P] = Pp[start + P][1];
+            XYZp[2][P] = Pp[start + P][2];
+        }
+        boost::shared_ptr<BlockOPoints> block(new BlockOPoints(n, XYZp[0], XYZp[1], XYZp[2], XYZp[3], &index[thread][0], extents_));
+        const std::vector<int>& function_map = block->functions_local_to_global();
+        int nlocal = function_map.size();
+        if (!nlocal) continue;
+
+        functions[thread]->compute_functions(block);
+        double** phip = functions[thread]->basis_value("PHI")->pointer();
+        double** phixp = functions[thread]->basis_value("PHI_X")->pointer();
+        double** phiyp = functions[thread]->basis_value("PHI_Y")->pointer();
+        double** phizp = functions[thread]->basis_value("PHI_Z")->pointer();
+        double** Tp = T[thread]->pointer();
+        double** D2p = Dl[thread]->pointer();
+
+        for (int ml = 0; ml < nlocal; ml++) {
+            for (int nl = 0; nl < nlocal; nl++) {
+                D2p[ml][nl] = Dp[function_map[ml]][function_map[nl]];
+            }
+        }
+
+        C_DGEMM('N','N',n,nlocal,nlocal,1.0,phip[0],nbf,D2p[0],nbf,0.0,Tp[0],nbf);
+
+        for (int P = 0; P < n; P++) {
+            Rp[start + P][0] = C_DDOT(nlocal,Tp[P],1,phip[P],1);
+            Rp[start + P][1] = 2.0 * C_DDOT(nlocal,Tp[P],1,phixp[P],1);
+            Rp[start + P][2] = 2.0 * C_DDOT(nlocal,Tp[P],1,phiyp[P],1);
+            Rp[start + P][3] = 2.0 * C_DDOT(nlocal,Tp[P],1,phizp[P],1);
+        }
+    }
+
+    return rho;
+}
+SharedMatrix PointProp::compute_orbitals(SharedMatrix points, SharedMatrix C)
+{
+    if (points->colspi()[0] != 3)
+        throw PSIEXCEPTION("PointProp: points must be npoints x 3");
+
+    int npoints = points->rowspi()[0];
+    int nbf = primary_->nbf();
+    int norb = C->colspi()[0];
+    double** Pp = points->pointer();
+    double** Cp = C->pointer();
+
+    SharedMatrix psi(new Matrix("Orbitals", npoints, norb));
+    double** Rp = psi->pointer();
+    if (!norb) return psi;
+
+    std::vector<boost::shared_ptr<BasisFunctions> > functions;
+    std::vector<SharedMatrix> XYZ;
+    std::vector<SharedMatrix> Cl;
+    std::vector<std::vector<int> > index;
+    for (int thread = 0; thread < nthreads_; thread++) {
+        functions.push_back(boost::shared_ptr<BasisFunctions>(new BasisFunctions(primary_, block_size_, nbf)));
+        XYZ.push_back(SharedMatrix(new Matrix("XYZW", 4, block_size_)));
+        Cl.push_back(SharedMatrix(new Matrix("Clocal", nbf, norb)));
+        index.push_back(std::vector<int>(block_size_, 0));
+    }
+
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads_)
+    for (int B = 0; B < nblocks(npoints); B++) {
+
+        int thread = 0;
+        #ifdef _OPENMP
+        thread = omp_get_thread_num();
+        #endif
+
+        int start = B * block_size_;
+        int n = (start + block_size_ > npoints ? npoints - start : block_size_);
+        double** XYZp = XYZ[thread]->pointer();
+        for (int P = 0; P < n; P++) {
+            XYZp[0][P] = Pp[start + P][0];
+            XYZp[1][P] = Pp[start + P][1];
+            XYZp[2][P] = Pp[start + P][2];
+        }
+        boost::shared_ptr<BlockOPoints> block(new BlockOPoints(n, XYZp[0], XYZp[1], XYZp[2], XYZp[3], &index[thread][0], extents_));
+        const std::vector<int>& function_map = block->functions_local_to_global();
+        int nlocal = function_map.size();
+        if (!nlocal) continue;
+
+        functions[thread]->compute_functions(block);
+        double** phip = functions[thread]->basis_value("PHI")->pointer();
+        double** C2p = Cl[thread]->pointer();
+
+        for (int ml = 0; ml < nlocal; ml++) {
+            ::memcpy((void*) C2p[ml], (void*) Cp[function_map[ml]], sizeof(double) * norb);
+        }
+
+        // Rows of the result are contiguous, so write the block in place
+        C_DGEMM('N','N',n,norb,nlocal,1.0,phip[0],nbf,C2p[0],norb,0.0,Rp[start],norb);
+    }
+
+    return psi;
+}
+SharedVector PointProp::compute_esp(SharedMatrix points, SharedMatrix D)
+{
+    if (points->colspi()[0] != 3)
+        throw PSIEXCEPTION("PointProp: points must be npoints x 3");
+
+    int npoints = points->rowspi()[0];
+    int nshell = primary_->nshell();
+    double** Pp = points->pointer();
+    double** Dp = D->pointer();
+    boost::shared_ptr<Molecule> mol = primary_->molecule();
+    int natom = mol->natom();
+
+    SharedVector esp(new Vector("ESP", npoints));
+    double* Vp = esp->pointer();
+
+    // Shell pairs with a significant density block, lower triangle
+    std::vector<std::pair<int,int> > pairs;
+    for (int M = 0; M < nshell; M++) {
+        int m0 = primary_->shell(M).function_index();
+        int nm = primary_->shell(M).nfunction();
+        for (int N = 0; N <= M; N++) {
+            int n0 = primary_->shell(N).function_index();
+            int nn = primary_->shell(N).nfunction();
+            double Dmax = 0.0;
+            for (int m = 0; m < nm; m++) {
+                for (int n = 0; n < nn; n++) {
+                    Dmax = std::max(Dmax, std::fabs(Dp[m + m0][n + n0]) + std::fabs(Dp[n + n0][m + m0]));
+                }
+            }
+            if (Dmax > 1.0E-14)
+                pairs.push_back(std::make_pair(M,N));
+        }
+    }
+
+    boost::shared_ptr<IntegralFactory> factory(new IntegralFactory(primary_,primary_,primary_,primary_));
+    std::vector<boost::shared_ptr<ElectrostaticInt> > ints;
+    for (int thread = 0; thread < nthreads_; thread++) {
+        ints.push_back(boost::shared_ptr<ElectrostaticInt>(static_cast<ElectrostaticInt*>(factory->electrostatic())));
+    }
+
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads_)
+    for (int B = 0; B < nblocks(npoints); B++) {
+
+        int thread = 0;
+        #ifdef _OPENMP
+        thread = omp_get_thread_num();
+        #endif
+
+        int start = B * block_size_;
+        int n = (start + block_size_ > npoints ? npoints - start : block_size_);
+        const double* buffer = ints[thread]->buffer();
+
+        for (int P = start; P < start + n; P++) {
+            Vector3 r(Pp[P][0], Pp[P][1], Pp[P][2]);
+
+            double nuc = 0.0;
+            for (int A = 0; A < natom; A++) {
+                double R = r.distance(mol->xyz(A));
+                if (R > 1.0E-10)
+                    nuc += mol->Z(A) / R;
+            }
+
+            double elec = 0.0;
+            for (int MN = 0; MN < pairs.size(); MN++) {
+                int M = pairs[MN].first;
+                int N = pairs[MN].second;
+                int m0 = primary_->shell(M).function_index();
+                int nm = primary_->shell(M).nfunction();
+                int n0 = primary_->shell(N).function_index();
+                int nn = primary_->shell(N).nfunction();
+                ints[thread]->compute_shell(M, N, r);
+                double val = 0.0;
+                for (int m = 0; m < nm; m++) {
+                    val += C_DDOT(nn, const_cast<double*>(&buffer[m * nn]), 1, &Dp[m + m0][n0], 1);
+                }
+                if (M != N) {
+                    for (int m = 0; m < nm; m++) {
+                        val += C_DDOT(nn, const_cast<double*>(&buffer[m * nn]), 1, &Dp[n0][m + m0], D->colspi()[0]);
+                    }
+                }
+                elec += val;
+            }
+
+            Vp[P] = nuc + elec;
+        }
+    }
+
+    return esp;
+}
+
+}
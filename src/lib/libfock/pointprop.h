@@ -0,0 +1,76 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * PSI4: an ab initio quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *@END LICENSE
+ */
+
+#ifndef libfock_pointprop_H
+#define libfock_pointprop_H
+
+#include <cstdio>
+
+#include <libmints/typedefs.h>
+
+namespace psi {
+
+class BasisSet;
+class BasisExtents;
+class Matrix;
+class Vector;
+
+extern FILE* outfile;
+
+/**
+ * Evaluates densities, orbitals and the electrostatic potential on an
+ * arbitrary list of points (npoints x 3, bohr). The points are processed
+ * in blocks of block_size over threads, so the scratch memory is bounded
+ * by nthreads x block_size x nbf no matter how many points there are.
+ */
+class PointProp {
+
+protected:
+    /// Basis set the densities/orbitals are expanded in
+    boost::shared_ptr<BasisSet> primary_;
+    /// Significant-function extents used to sieve each block
+    boost::shared_ptr<BasisExtents> extents_;
+    /// Number of points evaluated at once by a thread
+    int block_size_;
+    /// Number of threads
+    int nthreads_;
+
+    /// Number of blocks for npoints points
+    int nblocks(int npoints) const { return (npoints + block_size_ - 1) / block_size_; }
+
+public:
+    PointProp(boost::shared_ptr<BasisSet> primary, double basis_tolerance = 1.0E-12, int block_size = 5000);
+    virtual ~PointProp();
+
+    /// rho, d rho/dx, d rho/dy, d rho/dz (npoints x 4) of the total AO density D
+    SharedMatrix compute_density(SharedMatrix points, SharedMatrix D);
+    /// Values of the AO orbital columns of C (npoints x ncol)
+    SharedMatrix compute_orbitals(SharedMatrix points, SharedMatrix C);
+    /// Electrostatic potential of the nuclei and the total AO density D (npoints)
+    SharedVector compute_esp(SharedMatrix points, SharedMatrix D);
+
+    void set_nthreads(int nthreads) { nthreads_ = nthreads; }
+    void set_block_size(int block_size) { block_size_ = block_size; }
+};
+
+}
+#endif
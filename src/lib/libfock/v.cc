@@ -23,13 +23,19 @@
 #include <libmints/mints.h>
 #include <libfunctional/superfunctional.h>
 #include <libqt/qt.h>
+#include <libqt/diagnostics.h>
 #include <psi4-dec.h>
 
 #include "cubature.h"
+#include "gridblocker.h"
 #include "points.h"
 #include "v.h"
 
 #include <sstream>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace psi;
 
@@ -49,11 +55,19 @@ void VBase::common_init()
 {
     print_ = options_.get_int("PRINT");
     debug_ = options_.get_int("DEBUG");
+    density_tolerance_ = options_.get_double("DFT_DENSITY_TOLERANCE");
+    nblocks_skipped_ = 0;
 }
-boost::shared_ptr<VBase> VBase::build_V(Process::Environment& process_environment_in, Options& options, const std::string& type)
+boost::shared_ptr<VBase> VBase::build_V(Process::Environment& process_environment_in, Options& options, const std::string& type,
+    boost::shared_ptr<DFTGridContext> context)
 {
-    boost::shared_ptr<BasisSetParser> parser(new Gaussian94BasisSetParser());
-    boost::shared_ptr<BasisSet> primary = BasisSet::construct(process_environment_in, parser, process_environment_in.molecule(), "BASIS");
+    boost::shared_ptr<BasisSet> primary;
+    if (context) {
+        primary = context->basis();
+    } else {
+        boost::shared_ptr<BasisSetParser> parser(new Gaussian94BasisSetParser());
+        primary = BasisSet::construct(process_environment_in, parser, process_environment_in.molecule(), "BASIS");
+    }
 
     int depth = 1; // By default, do first partials of the kernel
     if (type == "RK" || type == "UK")
@@ -74,6 +88,7 @@ boost::shared_ptr<VBase> VBase::build_V(Process::Environment& process_environmen
     } else {
         throw PSIEXCEPTION("V: V type is not recognized");    
     }
+    v->set_grid_context(context);
 
     return v;
 }
@@ -357,26 +372,72 @@ void VBase::AO2USO()
 void VBase::initialize()
 {
     //~ timer_on("V: Grid");
-    grid_ = boost::shared_ptr<DFTGrid>(new DFTGrid(process_environment_, primary_->molecule(),primary_,options_));
+    if (grid_context_) {
+        grid_ = grid_context_->grid(grid_int_options_,grid_str_options_);
+    } else {
+        grid_ = boost::shared_ptr<DFTGrid>(new DFTGrid(process_environment_, primary_->molecule(),primary_,grid_int_options_,grid_str_options_,options_));
+    }
     //~ timer_off("V: Grid");
+    block_phi_max_.clear();
+    block_phi_max_.resize(grid_->blocks().size());
+}
+bool VBase::block_is_negligible(int Q)
+{
+    if (density_tolerance_ <= 0.0) return false;
+    const std::vector<double>& phimax = block_phi_max_[Q];
+    if (!phimax.size()) return false;
+
+    // rho(P) <= sum_mn |phi_m(P)| |D_mn| |phi_n(P)| for every density in the block
+    const std::vector<int>& function_map = grid_->blocks()[Q]->functions_local_to_global();
+    int nlocal = function_map.size();
+    double bound = 0.0;
+    for (int i = 0; i < D_AO_.size(); i++) {
+        double** Dp = D_AO_[i]->pointer();
+        for (int ml = 0; ml < nlocal; ml++) {
+            double* Dmp = Dp[function_map[ml]];
+            double row = 0.0;
+            for (int nl = 0; nl < nlocal; nl++) {
+                row += fabs(Dmp[function_map[nl]]) * phimax[nl];
+            }
+            bound += phimax[ml] * row;
+        }
+    }
+    return bound < density_tolerance_;
+}
+void VBase::store_block_phi_max(int Q)
+{
+    if (density_tolerance_ <= 0.0 || block_phi_max_[Q].size()) return;
+
+    boost::shared_ptr<BlockOPoints> block = grid_->blocks()[Q];
+    int npoints = block->npoints();
+    int nlocal = block->functions_local_to_global().size();
+    double** phi = properties_->basis_value("PHI")->pointer();
+
+    std::vector<double>& phimax = block_phi_max_[Q];
+    phimax.resize(nlocal, 0.0);
+    for (int P = 0; P < npoints; P++) {
+        for (int ml = 0; ml < nlocal; ml++) {
+            phimax[ml] = std::max(phimax[ml], fabs(phi[P][ml]));
+        }
+    }
 }
 void VBase::compute()
 {
-    //~ timer_on("V: D");
+    diagnostics::phase_on("V: D");
     compute_D();
-    //~ timer_off("V: D");
+    diagnostics::phase_off("V: D");
 
-    //~ timer_on("V: USO2AO");
+    diagnostics::phase_on("V: USO2AO");
     USO2AO();
-    //~ timer_off("V: USO2AO");
+    diagnostics::phase_off("V: USO2AO");
 
-    //~ timer_on("V: V");
+    diagnostics::phase_on("V: V");
     compute_V();
-    //~ timer_off("V: V");
+    diagnostics::phase_off("V: V");
 
-    //~ timer_on("V: AO2USO");
+    diagnostics::phase_on("V: AO2USO");
     AO2USO();
-    //~ timer_off("V: AO2USO");
+    diagnostics::phase_off("V: AO2USO");
 }
 SharedMatrix VBase::compute_gradient()
 {
@@ -385,6 +446,7 @@ SharedMatrix VBase::compute_gradient()
 void VBase::finalize()
 {
     grid_.reset();
+    block_phi_max_.clear();
 }
 void VBase::print_header() const
 {
@@ -456,6 +518,9 @@ void RV::compute_V()
     double *restrict QTp = QT->pointer();
     const std::vector<boost::shared_ptr<BlockOPoints> >& blocks = grid_->blocks();
 
+    double points_computed = 0.0;
+    double flops = 0.0;
+    nblocks_skipped_ = 0;
     for (int Q = 0; Q < blocks.size(); Q++) {
 
         boost::shared_ptr<BlockOPoints> block = blocks[Q];
@@ -467,8 +532,16 @@ void RV::compute_V()
         const std::vector<int>& function_map = block->functions_local_to_global();
         int nlocal = function_map.size();
 
+        if (block_is_negligible(Q)) {
+            nblocks_skipped_++;
+            continue;
+        }
+        points_computed += npoints;
+        flops += GridBlocker::gemm_flops(npoints, nlocal);
+
         //~ timer_on("Properties");
         properties_->compute_points(block);
+        store_block_phi_max(Q);
         //~ timer_off("Properties");
         //~ timer_on("Functional");
         std::map<std::string, SharedVector>& vals = functional_->compute_functional(properties_->point_values(), npoints); 
@@ -572,6 +645,9 @@ void RV::compute_V()
         //~ timer_off("V_XC");
     } 
    
+    diagnostics::count(diagnostics::GridPoints, points_computed);
+    diagnostics::count(diagnostics::GemmFlops, flops);
+
     quad_values_["FUNCTIONAL"] = functionalq;
     quad_values_["RHO_A"]      = rhoaq; 
     quad_values_["RHO_AX"]     = rhoaxq; 
@@ -591,6 +667,15 @@ void RV::compute_V()
         fprintf(outfile, "    <\\vec r\\rho_b>  : <%24.16E,%24.16E,%24.16E>\n\n",quad_values_["RHO_BX"],quad_values_["RHO_BY"],quad_values_["RHO_BZ"]);
     }
 }
+/// Accumulate the per-point sums S[P] += (U[P] . phi_x[P], U[P] . phi_y[P], U[P] . phi_z[P])
+static void point_sums(int npoints, int nlocal, double** Up, double** phi_x, double** phi_y, double** phi_z, double** Sp)
+{
+    for (int P = 0; P < npoints; P++) {
+        Sp[P][0] += C_DDOT(nlocal,Up[P],1,phi_x[P],1);
+        Sp[P][1] += C_DDOT(nlocal,Up[P],1,phi_y[P],1);
+        Sp[P][2] += C_DDOT(nlocal,Up[P],1,phi_z[P],1);
+    }
+}
 SharedMatrix RV::compute_gradient()
 {
     compute_D();
@@ -602,32 +687,56 @@ SharedMatrix RV::compute_gradient()
     // Build the target gradient Matrix
     int natom = primary_->molecule()->natom();
     SharedMatrix G(new Matrix("XC Gradient", natom,3));
-    double** Gp = G->pointer();
 
     // Set Hessian derivative level in properties
     int old_deriv = properties_->deriv(); 
-    properties_->set_deriv((functional_->is_gga() || functional_->is_meta() ? 2 : 1));
+    int deriv = (functional_->is_gga() || functional_->is_meta() ? 2 : 1);
 
     // Setup the pointers
     SharedMatrix D_AO = D_AO_[0];
-    properties_->set_pointers(D_AO);
 
     // What local XC ansatz are we in?
     int ansatz = functional_->ansatz();
 
+    // Move the points with their atoms?
+    bool weight_gradient = options_.get_bool("DFT_WEIGHT_GRADIENT");
+    boost::shared_ptr<NuclearWeights> nuclear_weights;
+    if (weight_gradient) nuclear_weights = grid_->nuclear_weights();
+
     // How many functions are there (for lda in Vtemp, T)
     int max_functions = grid_->max_functions(); 
     int max_points = grid_->max_points();
 
-    // Scratch
-    std::vector<SharedMatrix> scratch = properties_->scratch();
-    SharedMatrix T_local = scratch[0];
-    SharedMatrix U_local(T_local->clone());
-    double** Tp = T_local->pointer();
-    double** Up = U_local->pointer();
-    std::vector<SharedMatrix> Dscratch = properties_->D_scratch();
-    SharedMatrix D_local = Dscratch[0];
-    double** Dp = D_local->pointer();
+    // => Per-thread workers <= //
+    int nthreads = 1;
+    #ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+    #endif
+
+    std::vector<boost::shared_ptr<PointFunctions> > point_workers;
+    std::vector<boost::shared_ptr<SuperFunctional> > functional_workers;
+    std::vector<SharedMatrix> U_workers;
+    std::vector<SharedMatrix> S_workers;
+    std::vector<SharedMatrix> G_workers;
+    std::vector<SharedMatrix> GW_workers;
+    std::vector<SharedVector> QT_workers;
+    for (int i = 0; i < nthreads; i++) {
+        // The first worker is the SCF properties object, the rest are built alongside it
+        boost::shared_ptr<PointFunctions> worker = properties_;
+        if (i) {
+            worker = boost::shared_ptr<PointFunctions>(new RKSFunctions(primary_,max_points,max_functions));
+            worker->set_ansatz(ansatz);
+        }
+        worker->set_deriv(deriv);
+        worker->set_pointers(D_AO);
+        point_workers.push_back(worker);
+        functional_workers.push_back(functional_->build_worker());
+        U_workers.push_back(SharedMatrix(worker->scratch()[0]->clone()));
+        S_workers.push_back(SharedMatrix(new Matrix("Point Gradient", max_points, 3)));
+        G_workers.push_back(SharedMatrix(new Matrix("XC Gradient", natom, 3)));
+        GW_workers.push_back(SharedMatrix(new Matrix("XC Weight Gradient", natom, 3)));
+        QT_workers.push_back(SharedVector(new Vector("Quadrature Temp", max_points)));
+    }
 
     // Traverse the blocks of points
     double functionalq = 0.0;
@@ -636,12 +745,24 @@ SharedMatrix RV::compute_gradient()
     double rhoayq      = 0.0;
     double rhoazq      = 0.0;
 
-    boost::shared_ptr<Vector> QT(new Vector("Quadrature Temp", max_points));
-    double* QTp = QT->pointer();
     const std::vector<boost::shared_ptr<BlockOPoints> >& blocks = grid_->blocks();
 
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads) reduction(+: functionalq, rhoaq, rhoaxq, rhoayq, rhoazq)
     for (int Q = 0; Q < blocks.size(); Q++) {
 
+        int rank = 0;
+        #ifdef _OPENMP
+        rank = omp_get_thread_num();
+        #endif
+
+        boost::shared_ptr<PointFunctions> properties = point_workers[rank];
+        double** Tp = properties->scratch()[0]->pointer();
+        double** Up = U_workers[rank]->pointer();
+        double** Dp = properties->D_scratch()[0]->pointer();
+        double** Sp = S_workers[rank]->pointer();
+        double** Gp = G_workers[rank]->pointer();
+        double* QTp = QT_workers[rank]->pointer();
+
         boost::shared_ptr<BlockOPoints> block = blocks[Q];
         int npoints = block->npoints();
         double* x = block->x();
@@ -652,17 +773,17 @@ SharedMatrix RV::compute_gradient()
         int nlocal = function_map.size();
 
         //~ timer_on("Properties");
-        properties_->compute_points(block);
+        properties->compute_points(block);
         //~ timer_off("Properties");
         //~ timer_on("Functional");
-        std::map<std::string, SharedVector>& vals = functional_->compute_functional(properties_->point_values(), npoints); 
+        std::map<std::string, SharedVector>& vals = functional_workers[rank]->compute_functional(properties->point_values(), npoints); 
         //~ timer_off("Functional");
 
-        double** phi = properties_->basis_value("PHI")->pointer();
-        double** phi_x = properties_->basis_value("PHI_X")->pointer();
-        double** phi_y = properties_->basis_value("PHI_Y")->pointer();
-        double** phi_z = properties_->basis_value("PHI_Z")->pointer();
-        double* rho_a = properties_->point_value("RHO_A")->pointer();
+        double** phi = properties->basis_value("PHI")->pointer();
+        double** phi_x = properties->basis_value("PHI_X")->pointer();
+        double** phi_y = properties->basis_value("PHI_Y")->pointer();
+        double** phi_z = properties->basis_value("PHI_Z")->pointer();
+        double* rho_a = properties->point_value("RHO_A")->pointer();
         double* zk = vals["V"]->pointer(); 
         double* v_rho_a = vals["V_RHO_A"]->pointer();
 
@@ -676,6 +797,10 @@ SharedMatrix RV::compute_gradient()
         rhoayq      += C_DDOT(npoints,QTp,1,y,1);
         rhoazq      += C_DDOT(npoints,QTp,1,z,1);
 
+        if (weight_gradient) {
+            ::memset((void*) Sp[0], '\0', sizeof(double) * 3 * npoints);
+        }
+
         // => LSDA Contribution <= //
         for (int P = 0; P < npoints; P++) {
             ::memset((void*) Tp[P], '\0', sizeof(double) * nlocal);
@@ -684,9 +809,9 @@ SharedMatrix RV::compute_gradient()
     
         // => GGA Contribution (Term 1) <= //
         if (functional_->is_gga()) {
-            double* rho_ax = properties_->point_value("RHO_AX")->pointer();
-            double* rho_ay = properties_->point_value("RHO_AY")->pointer();
-            double* rho_az = properties_->point_value("RHO_AZ")->pointer();
+            double* rho_ax = properties->point_value("RHO_AX")->pointer();
+            double* rho_ay = properties->point_value("RHO_AY")->pointer();
+            double* rho_az = properties->point_value("RHO_AZ")->pointer();
             double* v_gamma_aa = vals["V_GAMMA_AA"]->pointer();
             double* v_gamma_ab = vals["V_GAMMA_AB"]->pointer();
 
@@ -707,18 +832,19 @@ SharedMatrix RV::compute_gradient()
             Gp[A][1] += C_DDOT(npoints,&Up[0][ml],max_functions,&phi_y[0][ml],max_functions);
             Gp[A][2] += C_DDOT(npoints,&Up[0][ml],max_functions,&phi_z[0][ml],max_functions);
         }          
+        if (weight_gradient) point_sums(npoints,nlocal,Up,phi_x,phi_y,phi_z,Sp);
         
         // => GGA Contribution (Term 2) <= //
         if (functional_->is_gga()) {
-            double** phi_xx = properties_->basis_value("PHI_XX")->pointer();
-            double** phi_xy = properties_->basis_value("PHI_XY")->pointer();
-            double** phi_xz = properties_->basis_value("PHI_XZ")->pointer();
-            double** phi_yy = properties_->basis_value("PHI_YY")->pointer();
-            double** phi_yz = properties_->basis_value("PHI_YZ")->pointer();
-            double** phi_zz = properties_->basis_value("PHI_ZZ")->pointer();
-            double* rho_ax = properties_->point_value("RHO_AX")->pointer();
-            double* rho_ay = properties_->point_value("RHO_AY")->pointer();
-            double* rho_az = properties_->point_value("RHO_AZ")->pointer();
+            double** phi_xx = properties->basis_value("PHI_XX")->pointer();
+            double** phi_xy = properties->basis_value("PHI_XY")->pointer();
+            double** phi_xz = properties->basis_value("PHI_XZ")->pointer();
+            double** phi_yy = properties->basis_value("PHI_YY")->pointer();
+            double** phi_yz = properties->basis_value("PHI_YZ")->pointer();
+            double** phi_zz = properties->basis_value("PHI_ZZ")->pointer();
+            double* rho_ax = properties->point_value("RHO_AX")->pointer();
+            double* rho_ay = properties->point_value("RHO_AY")->pointer();
+            double* rho_az = properties->point_value("RHO_AZ")->pointer();
             double* v_gamma_aa = vals["V_GAMMA_AA"]->pointer();
             double* v_gamma_ab = vals["V_GAMMA_AB"]->pointer();
 
@@ -735,6 +861,7 @@ SharedMatrix RV::compute_gradient()
                 Gp[A][1] += C_DDOT(npoints,&Tp[0][ml],max_functions,&phi_xy[0][ml],max_functions);
                 Gp[A][2] += C_DDOT(npoints,&Tp[0][ml],max_functions,&phi_xz[0][ml],max_functions);
             }          
+            if (weight_gradient) point_sums(npoints,nlocal,Tp,phi_xx,phi_xy,phi_xz,Sp);
             
             // y
             for (int P = 0; P < npoints; P++) {
@@ -747,6 +874,7 @@ SharedMatrix RV::compute_gradient()
                 Gp[A][1] += C_DDOT(npoints,&Tp[0][ml],max_functions,&phi_yy[0][ml],max_functions);
                 Gp[A][2] += C_DDOT(npoints,&Tp[0][ml],max_functions,&phi_yz[0][ml],max_functions);
             }          
+            if (weight_gradient) point_sums(npoints,nlocal,Tp,phi_xy,phi_yy,phi_yz,Sp);
             
             // z
             for (int P = 0; P < npoints; P++) {
@@ -759,17 +887,18 @@ SharedMatrix RV::compute_gradient()
                 Gp[A][1] += C_DDOT(npoints,&Tp[0][ml],max_functions,&phi_yz[0][ml],max_functions);
                 Gp[A][2] += C_DDOT(npoints,&Tp[0][ml],max_functions,&phi_zz[0][ml],max_functions);
             }          
+            if (weight_gradient) point_sums(npoints,nlocal,Tp,phi_xz,phi_yz,phi_zz,Sp);
     
         }
         
         // => Meta Contribution <= //
         if (functional_->is_meta()) {
-            double** phi_xx = properties_->basis_value("PHI_XX")->pointer();
-            double** phi_xy = properties_->basis_value("PHI_XY")->pointer();
-            double** phi_xz = properties_->basis_value("PHI_XZ")->pointer();
-            double** phi_yy = properties_->basis_value("PHI_YY")->pointer();
-            double** phi_yz = properties_->basis_value("PHI_YZ")->pointer();
-            double** phi_zz = properties_->basis_value("PHI_ZZ")->pointer();
+            double** phi_xx = properties->basis_value("PHI_XX")->pointer();
+            double** phi_xy = properties->basis_value("PHI_XY")->pointer();
+            double** phi_xz = properties->basis_value("PHI_XZ")->pointer();
+            double** phi_yy = properties->basis_value("PHI_YY")->pointer();
+            double** phi_yz = properties->basis_value("PHI_YZ")->pointer();
+            double** phi_zz = properties->basis_value("PHI_ZZ")->pointer();
             double* v_tau_a = vals["V_TAU_A"]->pointer();
 
             double** phi_i[3];
@@ -786,7 +915,7 @@ SharedMatrix RV::compute_gradient()
             phi_ij[1][2] = phi_yz;
             phi_ij[2][0] = phi_xz;
             phi_ij[2][1] = phi_yz;
-            phi_ij[2][2] = phi_xz;
+            phi_ij[2][2] = phi_zz;
 
             for (int i = 0; i < 3; i++) {
                 double*** phi_j = phi_ij[i];
@@ -801,9 +930,26 @@ SharedMatrix RV::compute_gradient()
                     Gp[A][1] += C_DDOT(npoints,&Tp[0][ml],max_functions,&phi_j[1][0][ml],max_functions);
                     Gp[A][2] += C_DDOT(npoints,&Tp[0][ml],max_functions,&phi_j[2][0][ml],max_functions);
                 }          
+                if (weight_gradient) point_sums(npoints,nlocal,Tp,phi_j[0],phi_j[1],phi_j[2],Sp);
+            }
+        }
+
+        // => Moving grid <= //
+        if (weight_gradient) {
+            // Each point's basis function terms sum to its translation, which its parent atom absorbs
+            int* index = block->index();
+            for (int P = 0; P < npoints; P++) {
+                Gp[index[P]][0] -= Sp[P][0];
+                Gp[index[P]][1] -= Sp[P][1];
+                Gp[index[P]][2] -= Sp[P][2];
             }
+            grid_->weight_gradient(block, zk, GW_workers[rank]->pointer(), *nuclear_weights);
         }
     } 
+
+    for (int i = 0; i < nthreads; i++) {
+        G->add(G_workers[i]);
+    }
    
     quad_values_["FUNCTIONAL"] = functionalq;
     quad_values_["RHO_A"]      = rhoaq; 
@@ -829,6 +975,11 @@ SharedMatrix RV::compute_gradient()
     // RKS
     G->scale(2.0);
 
+    // The weights multiply the total (not the alpha) functional
+    for (int i = 0; i < nthreads; i++) {
+        G->add(GW_workers[i]);
+    }
+
     return G;
 }
 
@@ -906,6 +1057,9 @@ void UV::compute_V()
     boost::shared_ptr<Vector> QTb(new Vector("Quadrature Temp", max_points));
     double* QTbp = QTb->pointer();
     const std::vector<boost::shared_ptr<BlockOPoints> >& blocks = grid_->blocks();
+    double points_computed = 0.0;
+    double flops = 0.0;
+    nblocks_skipped_ = 0;
     for (int Q = 0; Q < blocks.size(); Q++) {
 
         boost::shared_ptr<BlockOPoints> block = blocks[Q];
@@ -917,8 +1071,16 @@ void UV::compute_V()
         const std::vector<int>& function_map = block->functions_local_to_global();
         int nlocal = function_map.size();
 
+        if (block_is_negligible(Q)) {
+            nblocks_skipped_++;
+            continue;
+        }
+        points_computed += npoints;
+        flops += 2.0 * GridBlocker::gemm_flops(npoints, nlocal);
+
         //~ timer_on("Properties");
         properties_->compute_points(block);
+        store_block_phi_max(Q);
         //~ timer_off("Properties");
         //~ timer_on("Functional");
         std::map<std::string, SharedVector>& vals = functional_->compute_functional(properties_->point_values(), npoints); 
@@ -1057,6 +1219,9 @@ void UV::compute_V()
         //~ timer_off("V_XC");
     } 
    
+    diagnostics::count(diagnostics::GridPoints, points_computed);
+    diagnostics::count(diagnostics::GemmFlops, flops);
+
     quad_values_["FUNCTIONAL"] = functionalq;
     quad_values_["RHO_A"]      = rhoaq; 
     quad_values_["RHO_AX"]     = rhoaxq; 
@@ -1087,51 +1252,92 @@ SharedMatrix UV::compute_gradient()
     // Build the target gradient Matrix
     int natom = primary_->molecule()->natom();
     SharedMatrix G(new Matrix("XC Gradient", natom,3));
-    double** Gp = G->pointer();
 
     // Set Hessian derivative level in properties
     int old_deriv = properties_->deriv(); 
-    properties_->set_deriv((functional_->is_gga() || functional_->is_meta() ? 2 : 1));
+    int deriv = (functional_->is_gga() || functional_->is_meta() ? 2 : 1);
 
     // Setup the pointers
     SharedMatrix Da_AO = D_AO_[0];
     SharedMatrix Db_AO = D_AO_[1];
-    properties_->set_pointers(Da_AO, Db_AO);
 
     // What local XC ansatz are we in?
     int ansatz = functional_->ansatz();
 
+    // Move the points with their atoms?
+    bool weight_gradient = options_.get_bool("DFT_WEIGHT_GRADIENT");
+    boost::shared_ptr<NuclearWeights> nuclear_weights;
+    if (weight_gradient) nuclear_weights = grid_->nuclear_weights();
+
     // How many functions are there (for lda in Vtemp, T)
     int max_functions = grid_->max_functions(); 
     int max_points = grid_->max_points();
 
-    // Scratch
-    std::vector<SharedMatrix> scratch = properties_->scratch();
-    SharedMatrix Ta_local = scratch[0];
-    SharedMatrix Ua_local(Ta_local->clone());
-    SharedMatrix Tb_local = scratch[1];
-    SharedMatrix Ub_local(Tb_local->clone());
-    double** Tap = Ta_local->pointer();
-    double** Uap = Ua_local->pointer();
-    double** Tbp = Tb_local->pointer();
-    double** Ubp = Ub_local->pointer();
-    std::vector<SharedMatrix> Dscratch = properties_->D_scratch();
-    SharedMatrix Da_local = Dscratch[0];
-    SharedMatrix Db_local = Dscratch[1];
-    double** Dap = Da_local->pointer();
-    double** Dbp = Db_local->pointer();
+    // => Per-thread workers <= //
+    int nthreads = 1;
+    #ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+    #endif
+
+    std::vector<boost::shared_ptr<PointFunctions> > point_workers;
+    std::vector<boost::shared_ptr<SuperFunctional> > functional_workers;
+    std::vector<SharedMatrix> Ua_workers;
+    std::vector<SharedMatrix> Ub_workers;
+    std::vector<SharedMatrix> S_workers;
+    std::vector<SharedMatrix> G_workers;
+    std::vector<SharedMatrix> GW_workers;
+    std::vector<SharedVector> QT_workers;
+    for (int i = 0; i < nthreads; i++) {
+        // The first worker is the SCF properties object, the rest are built alongside it
+        boost::shared_ptr<PointFunctions> worker = properties_;
+        if (i) {
+            worker = boost::shared_ptr<PointFunctions>(new UKSFunctions(primary_,max_points,max_functions));
+            worker->set_ansatz(ansatz);
+        }
+        worker->set_deriv(deriv);
+        worker->set_pointers(Da_AO, Db_AO);
+        point_workers.push_back(worker);
+        functional_workers.push_back(functional_->build_worker());
+        Ua_workers.push_back(SharedMatrix(worker->scratch()[0]->clone()));
+        Ub_workers.push_back(SharedMatrix(worker->scratch()[1]->clone()));
+        S_workers.push_back(SharedMatrix(new Matrix("Point Gradient", max_points, 3)));
+        G_workers.push_back(SharedMatrix(new Matrix("XC Gradient", natom, 3)));
+        GW_workers.push_back(SharedMatrix(new Matrix("XC Weight Gradient", natom, 3)));
+        QT_workers.push_back(SharedVector(new Vector("Quadrature Temp", max_points)));
+    }
 
     // Traverse the blocks of points
-    boost::shared_ptr<Vector> QT(new Vector("Quadrature Temp", max_points));
-    double* QTp = QT->pointer();
-    const std::vector<boost::shared_ptr<BlockOPoints> >& blocks = grid_->blocks();
+    double functionalq = 0.0;
+    double rhoaq       = 0.0;
+    double rhoaxq      = 0.0;
+    double rhoayq      = 0.0;
+    double rhoazq      = 0.0;
+    double rhobq       = 0.0;
+    double rhobxq      = 0.0;
+    double rhobyq      = 0.0;
+    double rhobzq      = 0.0;
 
-    for (std::map<std::string, double>::const_iterator it = quad_values_.begin(); it != quad_values_.end(); ++it) {
-        quad_values_[(*it).first] = 0.0;
-    }
+    const std::vector<boost::shared_ptr<BlockOPoints> >& blocks = grid_->blocks();
 
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads) reduction(+: functionalq, rhoaq, rhoaxq, rhoayq, rhoazq, rhobq, rhobxq, rhobyq, rhobzq)
     for (int Q = 0; Q < blocks.size(); Q++) {
 
+        int rank = 0;
+        #ifdef _OPENMP
+        rank = omp_get_thread_num();
+        #endif
+
+        boost::shared_ptr<PointFunctions> properties = point_workers[rank];
+        double** Tap = properties->scratch()[0]->pointer();
+        double** Tbp = properties->scratch()[1]->pointer();
+        double** Uap = Ua_workers[rank]->pointer();
+        double** Ubp = Ub_workers[rank]->pointer();
+        double** Dap = properties->D_scratch()[0]->pointer();
+        double** Dbp = properties->D_scratch()[1]->pointer();
+        double** Sp = S_workers[rank]->pointer();
+        double** Gp = G_workers[rank]->pointer();
+        double* QTp = QT_workers[rank]->pointer();
+
         boost::shared_ptr<BlockOPoints> block = blocks[Q];
         int npoints = block->npoints();
         double* x = block->x();
@@ -1142,38 +1348,42 @@ SharedMatrix UV::compute_gradient()
         int nlocal = function_map.size();
 
         //~ timer_on("Properties");
-        properties_->compute_points(block);
+        properties->compute_points(block);
         //~ timer_off("Properties");
         //~ timer_on("Functional");
-        std::map<std::string, SharedVector>& vals = functional_->compute_functional(properties_->point_values(), npoints); 
+        std::map<std::string, SharedVector>& vals = functional_workers[rank]->compute_functional(properties->point_values(), npoints); 
         //~ timer_off("Functional");
 
-        double** phi = properties_->basis_value("PHI")->pointer();
-        double** phi_x = properties_->basis_value("PHI_X")->pointer();
-        double** phi_y = properties_->basis_value("PHI_Y")->pointer();
-        double** phi_z = properties_->basis_value("PHI_Z")->pointer();
-        double* rho_a = properties_->point_value("RHO_A")->pointer();
-        double* rho_b = properties_->point_value("RHO_B")->pointer();
+        double** phi = properties->basis_value("PHI")->pointer();
+        double** phi_x = properties->basis_value("PHI_X")->pointer();
+        double** phi_y = properties->basis_value("PHI_Y")->pointer();
+        double** phi_z = properties->basis_value("PHI_Z")->pointer();
+        double* rho_a = properties->point_value("RHO_A")->pointer();
+        double* rho_b = properties->point_value("RHO_B")->pointer();
         double* zk = vals["V"]->pointer(); 
         double* v_rho_a = vals["V_RHO_A"]->pointer();
         double* v_rho_b = vals["V_RHO_B"]->pointer();
 
         // => Quadrature values <= //
-        quad_values_["FUNCTIONAL"] += C_DDOT(npoints,w,1,zk,1); 
+        functionalq += C_DDOT(npoints,w,1,zk,1); 
         for (int P = 0; P < npoints; P++) {
             QTp[P] = w[P] * rho_a[P];
         }
-        quad_values_["RHO_A"] += C_DDOT(npoints,w,1,rho_a,1);
-        quad_values_["RHO_AX"] += C_DDOT(npoints,QTp,1,x,1);
-        quad_values_["RHO_AY"] += C_DDOT(npoints,QTp,1,y,1);
-        quad_values_["RHO_AZ"] += C_DDOT(npoints,QTp,1,z,1);
+        rhoaq += C_DDOT(npoints,w,1,rho_a,1);
+        rhoaxq += C_DDOT(npoints,QTp,1,x,1);
+        rhoayq += C_DDOT(npoints,QTp,1,y,1);
+        rhoazq += C_DDOT(npoints,QTp,1,z,1);
         for (int P = 0; P < npoints; P++) {
             QTp[P] = w[P] * rho_b[P];
         }
-        quad_values_["RHO_B"] += C_DDOT(npoints,w,1,rho_b,1);
-        quad_values_["RHO_BX"] += C_DDOT(npoints,QTp,1,x,1);
-        quad_values_["RHO_BY"] += C_DDOT(npoints,QTp,1,y,1);
-        quad_values_["RHO_BZ"] += C_DDOT(npoints,QTp,1,z,1);
+        rhobq += C_DDOT(npoints,w,1,rho_b,1);
+        rhobxq += C_DDOT(npoints,QTp,1,x,1);
+        rhobyq += C_DDOT(npoints,QTp,1,y,1);
+        rhobzq += C_DDOT(npoints,QTp,1,z,1);
+
+        if (weight_gradient) {
+            ::memset((void*) Sp[0], '\0', sizeof(double) * 3 * npoints);
+        }
     
         // => LSDA Contribution <= //
         for (int P = 0; P < npoints; P++) {
@@ -1185,12 +1395,12 @@ SharedMatrix UV::compute_gradient()
     
         // => GGA Contribution (Term 1) <= //
         if (functional_->is_gga()) {
-            double* rho_ax = properties_->point_value("RHO_AX")->pointer();
-            double* rho_ay = properties_->point_value("RHO_AY")->pointer();
-            double* rho_az = properties_->point_value("RHO_AZ")->pointer();
-            double* rho_bx = properties_->point_value("RHO_BX")->pointer();
-            double* rho_by = properties_->point_value("RHO_BY")->pointer();
-            double* rho_bz = properties_->point_value("RHO_BZ")->pointer();
+            double* rho_ax = properties->point_value("RHO_AX")->pointer();
+            double* rho_ay = properties->point_value("RHO_AY")->pointer();
+            double* rho_az = properties->point_value("RHO_AZ")->pointer();
+            double* rho_bx = properties->point_value("RHO_BX")->pointer();
+            double* rho_by = properties->point_value("RHO_BY")->pointer();
+            double* rho_bz = properties->point_value("RHO_BZ")->pointer();
             double* v_gamma_aa = vals["V_GAMMA_AA"]->pointer();
             double* v_gamma_ab = vals["V_GAMMA_AB"]->pointer();
             double* v_gamma_bb = vals["V_GAMMA_BB"]->pointer();
@@ -1219,21 +1429,25 @@ SharedMatrix UV::compute_gradient()
             Gp[A][1] += C_DDOT(npoints,&Ubp[0][ml],max_functions,&phi_y[0][ml],max_functions);
             Gp[A][2] += C_DDOT(npoints,&Ubp[0][ml],max_functions,&phi_z[0][ml],max_functions);
         }          
+        if (weight_gradient) {
+            point_sums(npoints,nlocal,Uap,phi_x,phi_y,phi_z,Sp);
+            point_sums(npoints,nlocal,Ubp,phi_x,phi_y,phi_z,Sp);
+        }
         
         // => GGA Contribution (Term 2) <= //
         if (functional_->is_gga()) {
-            double** phi_xx = properties_->basis_value("PHI_XX")->pointer();
-            double** phi_xy = properties_->basis_value("PHI_XY")->pointer();
-            double** phi_xz = properties_->basis_value("PHI_XZ")->pointer();
-            double** phi_yy = properties_->basis_value("PHI_YY")->pointer();
-            double** phi_yz = properties_->basis_value("PHI_YZ")->pointer();
-            double** phi_zz = properties_->basis_value("PHI_ZZ")->pointer();
-            double* rho_ax = properties_->point_value("RHO_AX")->pointer();
-            double* rho_ay = properties_->point_value("RHO_AY")->pointer();
-            double* rho_az = properties_->point_value("RHO_AZ")->pointer();
-            double* rho_bx = properties_->point_value("RHO_BX")->pointer();
-            double* rho_by = properties_->point_value("RHO_BY")->pointer();
-            double* rho_bz = properties_->point_value("RHO_BZ")->pointer();
+            double** phi_xx = properties->basis_value("PHI_XX")->pointer();
+            double** phi_xy = properties->basis_value("PHI_XY")->pointer();
+            double** phi_xz = properties->basis_value("PHI_XZ")->pointer();
+            double** phi_yy = properties->basis_value("PHI_YY")->pointer();
+            double** phi_yz = properties->basis_value("PHI_YZ")->pointer();
+            double** phi_zz = properties->basis_value("PHI_ZZ")->pointer();
+            double* rho_ax = properties->point_value("RHO_AX")->pointer();
+            double* rho_ay = properties->point_value("RHO_AY")->pointer();
+            double* rho_az = properties->point_value("RHO_AZ")->pointer();
+            double* rho_bx = properties->point_value("RHO_BX")->pointer();
+            double* rho_by = properties->point_value("RHO_BY")->pointer();
+            double* rho_bz = properties->point_value("RHO_BZ")->pointer();
             double* v_gamma_aa = vals["V_GAMMA_AA"]->pointer();
             double* v_gamma_ab = vals["V_GAMMA_AB"]->pointer();
             double* v_gamma_bb = vals["V_GAMMA_BB"]->pointer();
@@ -1257,6 +1471,10 @@ SharedMatrix UV::compute_gradient()
                 Gp[A][1] += C_DDOT(npoints,&Tbp[0][ml],max_functions,&phi_xy[0][ml],max_functions);
                 Gp[A][2] += C_DDOT(npoints,&Tbp[0][ml],max_functions,&phi_xz[0][ml],max_functions);
             }          
+            if (weight_gradient) {
+                point_sums(npoints,nlocal,Tap,phi_xx,phi_xy,phi_xz,Sp);
+                point_sums(npoints,nlocal,Tbp,phi_xx,phi_xy,phi_xz,Sp);
+            }
             
             // y
             for (int P = 0; P < npoints; P++) {
@@ -1274,6 +1492,10 @@ SharedMatrix UV::compute_gradient()
                 Gp[A][1] += C_DDOT(npoints,&Tbp[0][ml],max_functions,&phi_yy[0][ml],max_functions);
                 Gp[A][2] += C_DDOT(npoints,&Tbp[0][ml],max_functions,&phi_yz[0][ml],max_functions);
             }          
+            if (weight_gradient) {
+                point_sums(npoints,nlocal,Tap,phi_xy,phi_yy,phi_yz,Sp);
+                point_sums(npoints,nlocal,Tbp,phi_xy,phi_yy,phi_yz,Sp);
+            }
             
             // z
             for (int P = 0; P < npoints; P++) {
@@ -1291,17 +1513,21 @@ SharedMatrix UV::compute_gradient()
                 Gp[A][1] += C_DDOT(npoints,&Tbp[0][ml],max_functions,&phi_yz[0][ml],max_functions);
                 Gp[A][2] += C_DDOT(npoints,&Tbp[0][ml],max_functions,&phi_zz[0][ml],max_functions);
             }          
+            if (weight_gradient) {
+                point_sums(npoints,nlocal,Tap,phi_xz,phi_yz,phi_zz,Sp);
+                point_sums(npoints,nlocal,Tbp,phi_xz,phi_yz,phi_zz,Sp);
+            }
     
         }
         
         // => Meta Contribution <= //
         if (functional_->is_meta()) {
-            double** phi_xx = properties_->basis_value("PHI_XX")->pointer();
-            double** phi_xy = properties_->basis_value("PHI_XY")->pointer();
-            double** phi_xz = properties_->basis_value("PHI_XZ")->pointer();
-            double** phi_yy = properties_->basis_value("PHI_YY")->pointer();
-            double** phi_yz = properties_->basis_value("PHI_YZ")->pointer();
-            double** phi_zz = properties_->basis_value("PHI_ZZ")->pointer();
+            double** phi_xx = properties->basis_value("PHI_XX")->pointer();
+            double** phi_xy = properties->basis_value("PHI_XY")->pointer();
+            double** phi_xz = properties->basis_value("PHI_XZ")->pointer();
+            double** phi_yy = properties->basis_value("PHI_YY")->pointer();
+            double** phi_yz = properties->basis_value("PHI_YZ")->pointer();
+            double** phi_zz = properties->basis_value("PHI_ZZ")->pointer();
             double* v_tau_a = vals["V_TAU_A"]->pointer();
             double* v_tau_b = vals["V_TAU_B"]->pointer();
 
@@ -1319,7 +1545,7 @@ SharedMatrix UV::compute_gradient()
             phi_ij[1][2] = phi_yz;
             phi_ij[2][0] = phi_xz;
             phi_ij[2][1] = phi_yz;
-            phi_ij[2][2] = phi_xz;
+            phi_ij[2][2] = phi_zz;
 
             double** Ds[2];
             Ds[0] = Dap;
@@ -1345,11 +1571,38 @@ SharedMatrix UV::compute_gradient()
                         Gp[A][1] += C_DDOT(npoints,&Tap[0][ml],max_functions,&phi_j[1][0][ml],max_functions);
                         Gp[A][2] += C_DDOT(npoints,&Tap[0][ml],max_functions,&phi_j[2][0][ml],max_functions);
                     }          
+                    if (weight_gradient) point_sums(npoints,nlocal,Tap,phi_j[0],phi_j[1],phi_j[2],Sp);
                 }
             }
         }
 
+        // => Moving grid <= //
+        if (weight_gradient) {
+            // Each point's basis function terms sum to its translation, which its parent atom absorbs
+            int* index = block->index();
+            for (int P = 0; P < npoints; P++) {
+                Gp[index[P]][0] -= Sp[P][0];
+                Gp[index[P]][1] -= Sp[P][1];
+                Gp[index[P]][2] -= Sp[P][2];
+            }
+            grid_->weight_gradient(block, zk, GW_workers[rank]->pointer(), *nuclear_weights);
+        }
     } 
+
+    for (int i = 0; i < nthreads; i++) {
+        G->add(G_workers[i]);
+        G->add(GW_workers[i]);
+    }
+
+    quad_values_["FUNCTIONAL"] = functionalq;
+    quad_values_["RHO_A"]      = rhoaq; 
+    quad_values_["RHO_AX"]     = rhoaxq; 
+    quad_values_["RHO_AY"]     = rhoayq; 
+    quad_values_["RHO_AZ"]     = rhoazq; 
+    quad_values_["RHO_B"]      = rhobq; 
+    quad_values_["RHO_BX"]     = rhobxq; 
+    quad_values_["RHO_BY"]     = rhobyq; 
+    quad_values_["RHO_BZ"]     = rhobzq; 
  
     if (debug_) {
         fprintf(outfile, "   => XC Gradient: Numerical Integrals <=\n\n");
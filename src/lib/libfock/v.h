@@ -31,6 +31,7 @@ namespace psi {
 
 class Options;
 class DFTGrid;
+class DFTGridContext;
 class PointFunctions;
 class SuperFunctional;
 
@@ -62,8 +63,24 @@ protected:
     boost::shared_ptr<PointFunctions> properties_;
     /// Integration grid, built by KSPotential
     boost::shared_ptr<DFTGrid> grid_;
+    /// Shared grid owner; if set, initialize() borrows its grid instead of building one
+    boost::shared_ptr<DFTGridContext> grid_context_;
     /// Quadrature values obtained during integration 
     std::map<std::string, double> quad_values_;
+    /// Grid option overrides (e.g. a coarse grid), applied in initialize()
+    std::map<std::string, int> grid_int_options_;
+    std::map<std::string, std::string> grid_str_options_;
+
+    /// Blocks whose density bound falls below this are skipped (DFT_DENSITY_TOLERANCE, <= 0 disables)
+    double density_tolerance_;
+    /// Max |phi| of each local function over each block, recorded the first time the block is visited
+    std::vector<std::vector<double> > block_phi_max_;
+    /// Can block Q be skipped for the current D_AO_ (false until block Q has been visited once)?
+    bool block_is_negligible(int Q);
+    /// Record the basis function maxima for block Q from the current properties_ values
+    void store_block_phi_max(int Q);
+    /// Number of blocks skipped in the last compute_V
+    int nblocks_skipped_;
 
     /// AO2USO matrix (if not C1)
     SharedMatrix AO2USO_;
@@ -107,7 +124,9 @@ public:
         Options& options);
     virtual ~VBase();
     
-    static boost::shared_ptr<VBase> build_V(Process::Environment& process_environment_in, Options& options, const std::string& type = "RV");
+    /// Build a potential; with a context, its basis and grid are borrowed rather than rebuilt
+    static boost::shared_ptr<VBase> build_V(Process::Environment& process_environment_in, Options& options, const std::string& type = "RV",
+        boost::shared_ptr<DFTGridContext> context = boost::shared_ptr<DFTGridContext>());
 
     boost::shared_ptr<BasisSet> basis() const { return primary_; }
     boost::shared_ptr<SuperFunctional> functional() const { return functional_; }
@@ -129,6 +148,15 @@ public:
     void set_print(int print) { print_ = print; }
     void set_debug(int debug) { debug_ = debug; }
 
+    /// Override DFT_* grid options for the next initialize() (empty maps restore the defaults)
+    void set_grid_options(const std::map<std::string, int>& int_opts_map,
+                          const std::map<std::string, std::string>& str_opts_map)
+        { grid_int_options_ = int_opts_map; grid_str_options_ = str_opts_map; }
+    /// Borrow the grid of context in the next initialize()
+    void set_grid_context(boost::shared_ptr<DFTGridContext> context) { grid_context_ = context; }
+    /// Number of blocks skipped by density screening in the last compute()
+    int nblocks_skipped() const { return nblocks_skipped_; }
+
     virtual void initialize();
     virtual void compute();
     virtual void finalize();
@@ -54,6 +54,28 @@ boost::shared_ptr<SuperFunctional> SuperFunctional::blank()
 {
     return boost::shared_ptr<SuperFunctional>(new SuperFunctional());
 }
+boost::shared_ptr<SuperFunctional> SuperFunctional::build_worker()
+{
+    boost::shared_ptr<SuperFunctional> sup(new SuperFunctional());
+
+    sup->name_ = name_;
+    sup->description_ = description_;
+    sup->citation_ = citation_;
+    sup->x_functionals_ = x_functionals_;
+    sup->x_alpha_ = x_alpha_;
+    sup->x_omega_ = x_omega_;
+    sup->c_functionals_ = c_functionals_;
+    sup->c_alpha_ = c_alpha_;
+    sup->c_ss_alpha_ = c_ss_alpha_;
+    sup->c_os_alpha_ = c_os_alpha_;
+    sup->c_omega_ = c_omega_;
+    sup->dispersion_ = dispersion_;
+    sup->max_points_ = max_points_;
+    sup->deriv_ = deriv_;
+    sup->allocate();
+
+    return sup;
+}
 void SuperFunctional::print(FILE* out, int level) const 
 {
     if (level < 1) return;
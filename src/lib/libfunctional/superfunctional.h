@@ -111,6 +111,8 @@ public:
     static boost::shared_ptr<SuperFunctional> current(Options& options, int max_points = -1, int deriv = 1);
     static boost::shared_ptr<SuperFunctional> build(const std::string& alias, int max_points = 5000, int deriv = 1); 
     static boost::shared_ptr<SuperFunctional> blank();
+    // Copy sharing this superfunctional's DFA functionals, but with its own values (one per thread)
+    boost::shared_ptr<SuperFunctional> build_worker();
 
     // Allocate values (MUST be called after adding new functionals to the superfunctional)
     void allocate();
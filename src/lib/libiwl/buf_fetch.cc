@@ -44,6 +44,29 @@ void IWL::fetch()
     idx_ = 0;
 }
 
+/*!
+** Positions the file at IWL buffer number buffer, counting from zero,
+** so that the next fetch() reads it. Buffers are records of bufszc_ bytes,
+** so readers may split the buffers of a file between them.
+*/
+void IWL::seek(size_t buffer)
+{
+    bufpos_ = psio_get_address(PSIO_ZERO, (ULI) buffer * bufszc_);
+}
+
+/*!
+** Number of IWL buffers in the file, the last one included
+*/
+size_t IWL::nbuffer()
+{
+    psio_tocentry *entry = psio_->tocscan(itap_, IWL_KEY_BUF);
+    if (entry == NULL) return 0;
+    /* the entry spans its TOC header, which is shorter than one buffer */
+    ULI length = (entry->eadd.page - entry->sadd.page) * PSIO_PAGELEN
+        + entry->eadd.offset - entry->sadd.offset;
+    return length / bufszc_;
+}
+
 //~ /*!
 //~ ** iwl_buf_fetch()
 //~ **
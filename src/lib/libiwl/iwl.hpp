@@ -49,6 +49,9 @@ namespace psi {
         
         void fetch();
         void put();
+        /// Random access to the fixed-size buffers: fetch() next reads buffer number buffer
+        void seek(size_t buffer);
+        size_t nbuffer();
         
         static void read_one(PSIO *psio, int itap, const char *label, double *ints,
             int ntri, int erase, int printflg, FILE *outfile);
@@ -65,6 +65,26 @@ bool BasisSet::initialized_shared_ = false;
 std::vector<Vector3> BasisSet::exp_ao[LIBINT_MAX_AM];
 
 namespace {
+
+// Shells parsed by earlier constructions, so that displaced geometries and the
+// many objects that build their own copy of a basis do not reread the library
+std::map<std::string, std::vector<GaussianShell> > parsed_shells;
+
+// Everything the parse of one element depends on: where it is looked up and the puream setting
+std::string parsed_shells_key(Process::Environment& process_environment_in, const boost::shared_ptr<BasisSetParser>& parser,
+                              const std::string& basisname, const std::string& symbol)
+{
+    std::string key;
+    BOOST_FOREACH(const std::string& file, process_environment_in.user_basis_files)
+        key += file + ";";
+    key += process_environment_in("PSIDATADIR") + "|" + basisname + "|" + symbol + "|";
+    if (parser->force_puream_or_cartesian_)
+        key += parser->forced_is_puream_ ? "pure" : "cartesian";
+    else if (process_environment_in.options.get_global("PUREAM").has_changed())
+        key += process_environment_in.options.get_global("PUREAM").to_integer() ? "pure" : "cartesian";
+    return key;
+}
+
 bool has_ending (std::string const &fullString, std::string const &ending)
 {
     if (fullString.length() >= ending.length()) {
@@ -340,8 +360,13 @@ boost::shared_ptr<BasisSet> BasisSet::construct(Process::Environment& process_en
 
         names[basisname] = 1;
 
-        // Add basisname, symbol to the list by clearing the vector.
-        basis_atom_shell[basisname][symbol].clear();
+        // Add basisname, symbol to the list, taking the shells parsed before if there are any.
+        std::map<std::string, std::vector<GaussianShell> >::const_iterator parsed =
+            parsed_shells.find(parsed_shells_key(process_environment_in, parser, basisname, symbol));
+        if (parsed != parsed_shells.end())
+            basis_atom_shell[basisname][symbol] = parsed->second;
+        else
+            basis_atom_shell[basisname][symbol].clear();
     }
 
     BOOST_FOREACH(map_ssv::value_type& basis, basis_atom_shell)
@@ -349,6 +374,12 @@ boost::shared_ptr<BasisSet> BasisSet::construct(Process::Environment& process_en
 //fprintf(outfile, "Working on basis %s\n", basis.first.c_str());
          bool not_found = true;
 
+        bool all_parsed = true;
+        BOOST_FOREACH(map_sv::value_type& atom, basis.second)
+            all_parsed = all_parsed && !atom.second.empty();
+        if (all_parsed)
+            continue;
+
         BOOST_FOREACH(string user_file, user_list)
         {
             //~ boost::filesystem::path bf_path;
@@ -409,6 +440,10 @@ boost::shared_ptr<BasisSet> BasisSet::construct(Process::Environment& process_en
         }
     }
 
+    BOOST_FOREACH(map_ssv::value_type& basis, basis_atom_shell)
+        BOOST_FOREACH(map_sv::value_type& atom, basis.second)
+            parsed_shells[parsed_shells_key(process_environment_in, parser, basis.first, atom.first)] = atom.second;
+
     // Go through the atoms and copy the shells to the basis set.
     for (int atom=0; atom<mol->natom(); ++atom) {
         string basis = mol->atom_entry(atom)->basisset(type);
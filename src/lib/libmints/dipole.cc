@@ -59,6 +59,14 @@ DipoleInt::~DipoleInt()
     delete[] buffer_;
 }
 
+OneBodyAOInt* DipoleInt::clone()
+{
+    DipoleInt* engine = new DipoleInt(spherical_transforms_, bs1_, bs2_, deriv_);
+    engine->set_force_cartesian(force_cartesian_);
+    engine->set_origin(origin_);
+    return engine;
+}
+
 SharedVector DipoleInt::nuclear_contribution(boost::shared_ptr<Molecule> mol, const Vector3& origin)
 {
     boost::shared_ptr<Vector> sret(new Vector(3));
@@ -52,6 +52,12 @@ public:
     //! Does the method provide first derivatives?
     bool has_deriv1() { return true; }
 
+    /// Engines are independent, so compute() can run one clone per thread
+    bool cloneable() { return true; }
+    OneBodyAOInt* clone();
+    /// The dipole operator is symmetric
+    bool hermitian() const { return true; }
+
     /// Returns the nuclear contribution to the dipole moment
     static SharedVector nuclear_contribution(boost::shared_ptr<Molecule> mol, const Vector3 &origin);
 };
@@ -38,6 +38,7 @@ ERI::ERI(const IntegralFactory *integral, int deriv, bool use_shell_pairs)
                           basis3()->max_am() +
                           basis4()->max_am() +
                           deriv_+1, 1e-15);
+    lowam_kernels_ = true;
 }
 
 ERI::~ERI()
@@ -23,8 +23,11 @@
 #ifndef _psi_src_lib_libmints_eri_h
 #define _psi_src_lib_libmints_eri_h
 
+#include <vector>
 #include <libint/libint.h>
 #include <libderiv/libderiv.h>
+#include "eri_lowam.h"
+#include "shellpaircache.h"
 
 namespace boost {
 template<class T> class shared_ptr;
@@ -41,31 +44,6 @@ class Fjt;
 class AOShellCombinationsIterator;
 class CorrelationFactor;
 
-/**
-  * \ingroup MINTS
-  * Structure to hold precomputed shell pair information
-  */
-typedef struct ShellPair_typ {
-    //! Shells for this information.
-    int i, j;
-    //! Matrix over primitives with x, y, z coordinate of average Gaussian
-    double *** restrict P;
-    //! Distance between shell i and shell j centers
-    double AB[3];
-    //! Distance between P and shell i center
-    double *** restrict PA;
-    //! Distance between P and shell j center
-    double *** restrict PB;
-    //! Array of alphas for both centers
-    double * restrict ai, * restrict aj;
-    //! Array of the gammas (ai + aj)
-    double ** restrict gamma;
-    //! Contraction coefficients
-    double * restrict ci, * restrict cj;
-    //! Overlap between primitives on i and j
-    double ** restrict overlap;
-} ShellPair;
-
 /*! \ingroup MINTS
  *  \class ERI
  *  \brief Capable of computing two-electron repulsion integrals.
@@ -93,25 +71,14 @@ protected:
     //! Computes the ERI second derivative between four shells.
     void compute_quartet_deriv2(int, int, int, int);
 
-    //! Form shell pair information. Must be smart enough to handle arbitrary basis sets
-    void init_shell_pairs12();
-    void init_shell_pairs34();
-
-    //! Free shell pair information
-    void free_shell_pairs12();
-    void free_shell_pairs34();
-
     //! Should we use shell pair information?
     bool use_shell_pairs_;
 
-    //! Stack memory pointer, used in init_shell_pairs, freed in destructor
-    double *stack12_, *stack34_;
+    //! Shell pair data of (12| and |34), borrowed read-only from ShellPairCache
+    boost::shared_ptr<const ShellPairCache> pairs12_, pairs34_;
 
-    //! Shell pair information
-    ShellPair **pairs12_, **pairs34_;
-
-    //! Evaluates how much memory (in doubles) is needed to store shell pair data
-    size_t memory_to_store_shell_pairs(const boost::shared_ptr<BasisSet>&, const boost::shared_ptr<BasisSet>&);
+    //! Are all four basis sets the same, so libint and libderiv may take any permuted quartet from pairs12_?
+    bool libint_shell_pairs_;
 
     //! Original shell index requested
     int osh1_, osh2_, osh3_, osh4_;
@@ -119,6 +86,25 @@ protected:
     //! Were the indices permuted?
     bool p13p24_, p12_, p34_;
 
+    //! Use the kernels of eri_lowam.h where they exist? Only valid for the plain Coulomb operator.
+    bool lowam_kernels_;
+
+    //! Primitive pair scratch for the low angular momentum kernels
+    std::vector<ERIPrimitivePair> lowam_bra_, lowam_ket_;
+
+    //! Primitive pairs, quartets and their kernels of a compute_shells batch
+    std::vector<ERIPrimitivePair> lowam_pairs_;
+    std::vector<ERIQuartet> lowam_quartets_;
+    std::vector<ERILowAMKernel> lowam_quartet_kernels_;
+
+    //! Cartesian-to-pure transforms of l = 0..LOWAM_ERI_MAX_AM, for the low angular momentum kernels
+    ERIPureTransform lowam_pure_[LOWAM_ERI_MAX_AM+1];
+
+    //! The low angular momentum kernel of the quartet, or 0 if it is left to libint
+    ERILowAMKernel lowam_kernel(int, int, int, int) const;
+
+    //! Computes the quartet with a low angular momentum kernel, if there is one, into target_
+    bool compute_shell_lowam(int, int, int, int);
 
 public:
     //! Constructor. Use an IntegralFactory to create this object.
@@ -132,6 +118,10 @@ public:
     /// Compute ERIs between 4 shells. Result is stored in buffer.
     virtual void compute_shell(int, int, int, int);
 
+    /// Compute ERIs of a batch of quartets, see TwoBodyAOInt::compute_shells. Runs of quartets of
+    /// one class with a low angular momentum kernel are computed together.
+    virtual void compute_shells(int n, const int* shells);
+
     /// Compute ERI derivatives between 4 shells. Result is stored in buffer.
     virtual void compute_shell_deriv1(int, int, int, int);
 
@@ -144,6 +134,9 @@ class ERI : public TwoElectronInt
 public:
     ERI(const IntegralFactory* integral, int deriv=0, bool use_shell_pairs=false);
     virtual ~ERI();
+
+    /// Switch the low angular momentum kernels (on by default) on or off, e.g. to compare against libint
+    void set_lowam_kernels(bool flag) { lowam_kernels_ = flag; }
 };
 
 class F12 : public TwoElectronInt
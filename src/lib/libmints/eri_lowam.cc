@@ -0,0 +1,574 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * PSI4: an ab initio quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *@END LICENSE
+ */
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <boost/shared_ptr.hpp>
+
+#include "gshell.h"
+#include "vector3.h"
+#include "fjt.h"
+#include "eri_lowam.h"
+
+// Head-Gordon-Pople ERIs (JCP 89, 5777 (1988)): the Obara-Saika vertical recursion builds
+// [e0|f0] on the first center of each pair, contracted over primitives, and the horizontal
+// recursion moves angular momentum onto the second center. Every Cartesian function index,
+// recursion direction and loop bound is a compile time constant of the class, so each kernel
+// unrolls into straight-line code.
+
+namespace psi {
+
+namespace {
+
+template<int l> struct NCart { enum { value = (l+1)*(l+2)/2 }; };
+// Cartesian functions of all angular momenta 0..l, zero for l < 0
+template<int l> struct NCartUpTo { enum { value = l < 0 ? 0 : (l+1)*(l+2)*(l+3)/6 }; };
+
+/*
+ * Cartesian functions of angular momentum 0, 1, 2, ..., in libint order within each angular
+ * momentum, numbered consecutively.
+ */
+
+// Number of x^x y^y z^z, or -1 if an exponent is negative
+template<int x, int y, int z> struct CartesianIndex {
+    enum { value = (x < 0 || y < 0 || z < 0) ? -1 : NCartUpTo<x+y+z-1>::value + (y+z)*(y+z+1)/2 + z };
+};
+
+// Smallest l with g < NCartUpTo<l>
+template<int g, int l = 0, bool found = (g < NCartUpTo<l>::value)> struct CartesianL {
+    enum { value = CartesianL<g, l+1>::value };
+};
+template<int g, int l> struct CartesianL<g, l, true> { enum { value = l }; };
+
+// Smallest i with r < (i+1)(i+2)/2
+template<int r, int i = 0, bool found = (r < (i+1)*(i+2)/2)> struct Triangle {
+    enum { value = Triangle<r, i+1>::value };
+};
+template<int r, int i> struct Triangle<r, i, true> { enum { value = i }; };
+
+template<int g> struct Cartesian {
+    enum {
+        l = CartesianL<g>::value,
+        yz = Triangle<g - NCartUpTo<l-1>::value>::value,
+        z = g - NCartUpTo<l-1>::value - yz*(yz+1)/2,
+        y = yz - z,
+        x = l - yz,
+        // direction the recursions build the function along: its largest exponent
+        dir = (x >= y && x >= z) ? 0 : (y >= z ? 1 : 2)
+    };
+};
+
+// Exponent of g along d
+template<int g, int d> struct CartesianN {
+    enum { value = d == 0 ? Cartesian<g>::x : (d == 1 ? Cartesian<g>::y : Cartesian<g>::z) };
+};
+
+// g - 1_d, or -1
+template<int g, int d> struct CartesianDown {
+    enum { value = CartesianIndex<Cartesian<g>::x - (d == 0), Cartesian<g>::y - (d == 1), Cartesian<g>::z - (d == 2)>::value };
+};
+
+// g + 1_d
+template<int g, int d> struct CartesianUp {
+    enum { value = CartesianIndex<Cartesian<g>::x + (d == 0), Cartesian<g>::y + (d == 1), Cartesian<g>::z + (d == 2)>::value };
+};
+
+/*
+ * The vertical recursion runs on NL primitive quartets at once, taken from any shell quartets of
+ * the batch: every recursion step is a loop over the lanes, whose data are stored lane innermost.
+ */
+template<int NL> struct ERILanes {
+    //! Lanes in use
+    int n;
+    double PA[3][NL];
+    double WP[3][NL];
+    double QC[3][NL];
+    double WQ[3][NL];
+    double oo2z[NL];
+    double oo2n[NL];
+    double oo2zn[NL];
+    double roz[NL];
+    double ron[NL];
+    //! [00|00]^(m), m = 0..L
+    double ssss[4*LOWAM_ERI_MAX_AM+1][NL];
+    //! Offset of the contracted [e0|f0] the lane adds to
+    int acc[NL];
+};
+
+/*
+ * Vertical recursion on the bra, [e0|00]^(m) for e = E..NE-1 and m <= L - |e|, from lower e.
+ * v holds L+1 rows of NE, each of NL lanes.
+ */
+template<int E, int NE, int L, int NL> struct BraVRR {
+    static void build(double* v, const ERILanes<NL>& x)
+    {
+        enum {
+            i = Cartesian<E>::dir,
+            e1 = CartesianDown<E, i>::value,
+            n1 = CartesianN<e1, i>::value,
+            e2 = n1 > 0 ? CartesianDown<e1, i>::value : 0,
+            mmax = L - Cartesian<E>::l
+        };
+        for (int m=0; m<=mmax; ++m) {
+            double* y = v + (m*NE + E)*NL;
+            const double* a0 = v + (m*NE + e1)*NL;
+            const double* a1 = a0 + NE*NL;
+            for (int l=0; l<NL; ++l)
+                y[l] = x.PA[i][l] * a0[l] + x.WP[i][l] * a1[l];
+            if (n1 > 0) {
+                const double* c0 = v + (m*NE + e2)*NL;
+                const double* c1 = c0 + NE*NL;
+                for (int l=0; l<NL; ++l)
+                    y[l] += n1 * x.oo2z[l] * (c0[l] - x.roz[l] * c1[l]);
+            }
+        }
+        BraVRR<E+1, NE, L, NL>::build(v, x);
+    }
+};
+template<int NE, int L, int NL> struct BraVRR<NE, NE, L, NL> {
+    static void build(double*, const ERILanes<NL>&) {}
+};
+
+// The coupling term of the ket vertical recursion, y[e] += n_i(e) / 2(zeta+eta) x[e - 1_i], e = E..NE-1
+template<int E, int NE, int I, int NL> struct KetCoupling {
+    static void add(double* y, const double* x, const ERILanes<NL>& lanes)
+    {
+        enum { ne = CartesianN<E, I>::value, e1 = ne > 0 ? CartesianDown<E, I>::value : 0 };
+        if (ne > 0) {
+            for (int l=0; l<NL; ++l)
+                y[E*NL+l] += ne * lanes.oo2zn[l] * x[e1*NL+l];
+        }
+        KetCoupling<E+1, NE, I, NL>::add(y, x, lanes);
+    }
+};
+template<int NE, int I, int NL> struct KetCoupling<NE, NE, I, NL> {
+    static void add(double*, const double*, const ERILanes<NL>&) {}
+};
+
+/*
+ * Vertical recursion on the ket, [e0|f0]^(m) for f = F..NF-1 and m <= FK - |f|, from lower f.
+ * Only |e| >= LA - (FK - |f|) feeds the final |e| >= LA. v2 holds NF blocks of FK+1 rows of NE
+ * (of NL lanes); its f = 0 block is v1, which holds L+1 rows.
+ */
+template<int F, int NF, int FK, int NE, int LA, int NL> struct KetVRR {
+    static void build(double* v2, const double* v1, const ERILanes<NL>& x)
+    {
+        enum {
+            i = Cartesian<F>::dir,
+            f1 = CartesianDown<F, i>::value,
+            n1 = CartesianN<f1, i>::value,
+            f2 = n1 > 0 ? CartesianDown<f1, i>::value : 0,
+            mmax = FK - Cartesian<F>::l,
+            elo = NCartUpTo<LA - 1 - mmax>::value,
+            row = NE*NL
+        };
+        const double* xf = f1 > 0 ? v2 + f1*(FK+1)*row : v1;
+        const double* zf = f2 > 0 ? v2 + f2*(FK+1)*row : v1;
+        for (int m=0; m<=mmax; ++m) {
+            double* y = v2 + (F*(FK+1) + m)*row;
+            const double* x0 = xf + m*row;
+            const double* x1 = x0 + row;
+            for (int e=elo; e<NE; ++e)
+                for (int l=0; l<NL; ++l)
+                    y[e*NL+l] = x.QC[i][l] * x0[e*NL+l] + x.WQ[i][l] * x1[e*NL+l];
+            if (n1 > 0) {
+                const double* z0 = zf + m*row;
+                const double* z1 = z0 + row;
+                for (int e=elo; e<NE; ++e)
+                    for (int l=0; l<NL; ++l)
+                        y[e*NL+l] += n1 * x.oo2n[l] * (z0[e*NL+l] - x.ron[l] * z1[e*NL+l]);
+            }
+            KetCoupling<(elo > 0 ? elo : 1), NE, i, NL>::add(y, x1, x);
+        }
+        KetVRR<F+1, NF, FK, NE, LA, NL>::build(v2, v1, x);
+    }
+};
+template<int NF, int FK, int NE, int LA, int NL> struct KetVRR<NF, NF, FK, NE, LA, NL> {
+    static void build(double*, const double*, const ERILanes<NL>&) {}
+};
+
+/*
+ * Horizontal recursion (a,b+1_i| = (a+1_i,b| + AB_i (a,b|, the pairs T..end of step K, which
+ * builds |b| = K for |a| in [L1, L1+L2-K]. Spectators, NS of them, are innermost.
+ */
+template<int L1, int L2, int K, int NS, int T,
+         bool done = (T == (NCartUpTo<L1+L2-K>::value - NCartUpTo<L1-1>::value) * NCart<K>::value)>
+struct HRRStep {
+    static void build(const double* in, double* out, const double AB[3])
+    {
+        enum {
+            A0 = NCartUpTo<L1-1>::value,
+            B0 = NCartUpTo<K-1>::value,
+            Bm0 = NCartUpTo<K-2>::value,
+            NB = NCart<K>::value,
+            NBM = NCart<K-1>::value,
+            a = T / NB,
+            b = T % NB,
+            i = Cartesian<B0+b>::dir,
+            bm = CartesianDown<B0+b, i>::value - Bm0,
+            ap = CartesianUp<A0+a, i>::value - A0
+        };
+        const double* x1 = in + (ap*NBM + bm)*NS;
+        const double* x0 = in + (a*NBM + bm)*NS;
+        double* y = out + T*NS;
+        for (int s=0; s<NS; ++s)
+            y[s] = x1[s] + AB[i] * x0[s];
+        HRRStep<L1, L2, K, NS, T+1>::build(in, out, AB);
+    }
+};
+template<int L1, int L2, int K, int NS, int T> struct HRRStep<L1, L2, K, NS, T, true> {
+    static void build(const double*, double*, const double*) {}
+};
+
+/*
+ * Steps K..L2 of the horizontal recursion: in holds (a,b| for |a| in [L1, L1+L2-K+1] and
+ * |b| = K-1, numbered from the first function of L1; out receives |a| = L1, |b| = L2.
+ */
+template<int L1, int L2, int K, int NS, bool done = (K > L2)> struct HRR {
+    static void build(const double* in, double* out, const double AB[3])
+    {
+        if (K == L2) {
+            HRRStep<L1, L2, K, NS, 0>::build(in, out, AB);
+            return;
+        }
+        double buf[(NCartUpTo<L1+L2-K>::value - NCartUpTo<L1-1>::value) * NCart<K>::value * NS];
+        HRRStep<L1, L2, K, NS, 0>::build(in, buf, AB);
+        HRR<L1, L2, K+1, NS>::build(buf, out, AB);
+    }
+};
+template<int L1, int L2, int K, int NS> struct HRR<L1, L2, K, NS, true> {
+    static void build(const double*, double*, const double*) {}
+};
+
+// out[o][p][i] = sum_c C[p][c] in[o][c][i], from the NC Cartesian to the NP pure functions of the middle index
+template<int NC, int NP, int NINNER>
+void transform_index(const double* in, double* out, const ERIPureTransform& C, int nouter)
+{
+    for (int o=0; o<nouter; ++o, in+=NC*NINNER, out+=NP*NINNER) {
+        for (int i=0; i<NP*NINNER; ++i)
+            out[i] = 0.0;
+        for (int k=0; k<C.n; ++k) {
+            const double coef = C.coef[k];
+            const double* x = in + C.cart[k]*NINNER;
+            double* y = out + C.pure[k]*NINNER;
+            for (int i=0; i<NINNER; ++i)
+                y[i] += coef * x[i];
+        }
+    }
+}
+
+// Runs the vertical recursion on all NL lanes and adds [e0|f0], |e| >= LA and |f| >= LC, of the
+// lanes in use to fe
+template<int LA, int LB, int LC, int LD, int NL>
+inline void vrr_lanes(ERILanes<NL>& x, double* fe)
+{
+    enum {
+        L = LA + LB + LC + LD,
+        FK = LC + LD,
+        NE = NCartUpTo<LA+LB>::value,
+        E0 = NCartUpTo<LA-1>::value,
+        NEE = NE - E0,
+        NF = NCartUpTo<FK>::value,
+        F0 = NCartUpTo<LC-1>::value
+    };
+    double v1[(L+1) * NE * NL];
+    double v2[NF * (FK+1) * NE * NL];
+
+    for (int m=0; m<=L; ++m)
+        for (int l=0; l<NL; ++l)
+            v1[m*NE*NL + l] = x.ssss[m][l];
+    BraVRR<1, NE, L, NL>::build(v1, x);
+    KetVRR<1, NF, FK, NE, LA, NL>::build(v2, v1, x);
+
+    for (int l=0; l<x.n; ++l) {
+        double* y = fe + x.acc[l];
+        for (int f=F0; f<NF; ++f) {
+            const double* xf = (f ? v2 + f*(FK+1)*NE*NL : v1) + E0*NL + l;
+            for (int e=0; e<NEE; ++e)
+                y[(f-F0)*NEE + e] += xf[e*NL];
+        }
+    }
+    x.n = 0;
+}
+
+// Runs the lanes in use one at a time, for a batch that ends with few of them
+template<int LA, int LB, int LC, int LD, int NL>
+void vrr_lanes_scalar(ERILanes<NL>& x, double* fe)
+{
+    enum { L = LA + LB + LC + LD };
+    ERILanes<1> x1;
+    x1.n = 1;
+    for (int l=0; l<x.n; ++l) {
+        for (int i=0; i<3; ++i) {
+            x1.PA[i][0] = x.PA[i][l];
+            x1.WP[i][0] = x.WP[i][l];
+            x1.QC[i][0] = x.QC[i][l];
+            x1.WQ[i][0] = x.WQ[i][l];
+        }
+        x1.oo2z[0] = x.oo2z[l];
+        x1.oo2n[0] = x.oo2n[l];
+        x1.oo2zn[0] = x.oo2zn[l];
+        x1.roz[0] = x.roz[l];
+        x1.ron[0] = x.ron[l];
+        for (int m=0; m<=L; ++m)
+            x1.ssss[m][0] = x.ssss[m][l];
+        x1.acc[0] = x.acc[l];
+        vrr_lanes<LA, LB, LC, LD, 1>(x1, fe);
+        x1.n = 1;
+    }
+    x.n = 0;
+}
+
+// From the contracted [e0|f0] of one quartet to its (ab|cd) in target
+template<int LA, int LB, int LC, int LD, bool PURE>
+void hrr_quartet(const double* fe, const double AB[3], const double CD[3], const ERIPureTransform* pure,
+                 double* target)
+{
+    enum {
+        NE = NCartUpTo<LA+LB>::value,
+        NEE = NE - NCartUpTo<LA-1>::value,
+        NA = NCart<LA>::value,
+        NB = NCart<LB>::value,
+        NC = NCart<LC>::value,
+        ND = NCart<LD>::value,
+        NCD = NC * ND,
+        // functions of the result
+        NAP = PURE ? 2*LA + 1 : NA,
+        NBP = PURE ? 2*LB + 1 : NB,
+        NCP = PURE ? 2*LC + 1 : NC,
+        NDP = PURE ? 2*LD + 1 : ND,
+        NCDP = NCP * NDP
+    };
+
+    // Ket horizontal recursion and transform to pure functions, with the bra functions as
+    // spectators; the transforms see long inner loops, and the bra recursion fewer functions
+    double cde[NCD * NEE];
+    double work[NCD * NEE];
+    HRR<LC, LD, 1, NEE>::build(fe, cde, CD);
+    const double* ket_done = LD ? cde : fe;
+    if (PURE && LC > 0) {
+        transform_index<NC, NCP, ND * NEE>(ket_done, work, pure[LC], 1);
+        ket_done = work;
+    }
+    if (PURE && LD > 0) {
+        double* out = ket_done == work ? cde : work;
+        transform_index<ND, NDP, NEE>(ket_done, out, pure[LD], NCP);
+        ket_done = out;
+    }
+    double ecd[NEE * NCDP];
+    for (int e=0; e<NEE; ++e)
+        for (int c=0; c<NCDP; ++c)
+            ecd[e*NCDP + c] = ket_done[c*NEE + e];
+
+    // Bra horizontal recursion and transform, the last step writing target
+    const bool ta = PURE && LA > 0;
+    const bool tb = PURE && LB > 0;
+    double abcd[NA * NB * NCDP];
+    double tmp[NA * NB * NCDP];
+    const double* bra_done = ecd;
+    if (LB > 0) {
+        double* out = ta || tb ? abcd : target;
+        HRR<LA, LB, 1, NCDP>::build(ecd, out, AB);
+        bra_done = out;
+    }
+    if (ta) {
+        double* out = tb ? tmp : target;
+        transform_index<NA, NAP, NB * NCDP>(bra_done, out, pure[LA], 1);
+        bra_done = out;
+    }
+    if (tb)
+        transform_index<NB, NBP, NCDP>(bra_done, target, pure[LB], NAP);
+    else if (!ta && LB == 0)
+        ::memcpy(target, ecd, sizeof(double) * NA * NCDP);
+}
+
+// Fills lane x.n with the primitive quartet of ab and cd
+template<int L, int NL>
+inline void fill_lane(ERILanes<NL>& x, const ERIPrimitivePair& ab, const ERIPrimitivePair& cd, const BoysFunction& boys)
+{
+    const double zeta = ab.zeta;
+    const double eta = cd.zeta;
+    const double oozn = 1.0 / (zeta + eta);
+    const double rho = zeta * eta * oozn;
+    const int l = x.n;
+    x.oo2z[l] = 0.5 / zeta;
+    x.oo2n[l] = 0.5 / eta;
+    x.oo2zn[l] = 0.5 * oozn;
+    x.roz[l] = rho / zeta;
+    x.ron[l] = rho / eta;
+
+    double PQ2 = 0.0;
+    for (int i=0; i<3; ++i) {
+        const double PQ = ab.P[i] - cd.P[i];
+        PQ2 += PQ * PQ;
+        x.PA[i][l] = ab.PA[i];
+        x.QC[i][l] = cd.PA[i];
+        x.WP[i][l] = -eta * oozn * PQ;
+        x.WQ[i][l] = zeta * oozn * PQ;
+    }
+
+    // eqs 14, 15, 16 of the libint manual
+    const double pfac = 2.0 * std::sqrt(rho * M_1_PI) * ab.K * cd.K;
+    double F[L+1];
+    boys.values(L, rho * PQ2, F);
+    for (int m=0; m<=L; ++m)
+        x.ssss[m][l] = pfac * F[m];
+}
+
+// Bound on the doubles of contracted [e0|f0] the kernels keep for one group of quartets
+const int eri_group_doubles = 2048;
+
+/*
+ * Lanes of the vertical recursion of a class. Eight lanes pay off once [e0|f0] has 24 or more
+ * elements, i.e. from (pp|ps); below that the lane bookkeeping costs more than the recursion
+ * saves, so those classes run one primitive quartet at a time.
+ */
+template<int LA, int LB, int LC, int LD> struct ERILaneCount {
+    enum {
+        NFE = (NCartUpTo<LA+LB>::value - NCartUpTo<LA-1>::value) * (NCartUpTo<LC+LD>::value - NCartUpTo<LC-1>::value),
+        value = NFE >= 24 ? 8 : 1
+    };
+};
+
+template<int LA, int LB, int LC, int LD, bool PURE>
+void eri_kernel(const ERIQuartet* quartets, int nquartet, const ERIPureTransform* pure)
+{
+    enum {
+        L = LA + LB + LC + LD,
+        NEE = NCartUpTo<LA+LB>::value - NCartUpTo<LA-1>::value,
+        NFF = NCartUpTo<LC+LD>::value - NCartUpTo<LC-1>::value,
+        NFE = NFF * NEE,
+        NL = ERILaneCount<LA, LB, LC, LD>::value,
+        // quartets contracted together; their primitive quartets share lanes
+        NGROUP = NFE < eri_group_doubles ? eri_group_doubles / NFE : 1
+    };
+
+    const BoysFunction& boys = BoysFunction::instance();
+
+    // [e0|f0] contracted over primitives per quartet, |e| in [LA, LA+LB] innermost and |f| in [LC, LC+LD]
+    double fe[NGROUP * NFE];
+    // Lanes past those in use still go through the recursion, so they hold finite values
+    ERILanes<NL> x;
+    ::memset(&x, 0, sizeof(x));
+
+    for (int g0=0; g0<nquartet; g0+=NGROUP) {
+        const int ng = std::min(nquartet - g0, (int)NGROUP);
+        for (int i=0; i<ng*NFE; ++i)
+            fe[i] = 0.0;
+
+        for (int g=0; g<ng; ++g) {
+            const ERIQuartet& quartet = quartets[g0 + g];
+            for (int p=0; p<quartet.nbra; ++p) {
+                for (int q=0; q<quartet.nket; ++q) {
+                    if (NL == 1) {
+                        // A lane of its own keeps everything in registers
+                        ERILanes<1> x1;
+                        x1.n = 0;
+                        fill_lane<L>(x1, quartet.bra[p], quartet.ket[q], boys);
+                        x1.acc[0] = g * NFE;
+                        x1.n = 1;
+                        vrr_lanes<LA, LB, LC, LD, 1>(x1, fe);
+                        continue;
+                    }
+                    fill_lane<L>(x, quartet.bra[p], quartet.ket[q], boys);
+                    x.acc[x.n] = g * NFE;
+                    if (++x.n == NL)
+                        vrr_lanes<LA, LB, LC, LD, NL>(x, fe);
+                }
+            }
+        }
+        if (2*x.n >= NL)
+            vrr_lanes<LA, LB, LC, LD, NL>(x, fe);
+        else if (x.n)
+            vrr_lanes_scalar<LA, LB, LC, LD, NL>(x, fe);
+
+        for (int g=0; g<ng; ++g) {
+            const ERIQuartet& quartet = quartets[g0 + g];
+            hrr_quartet<LA, LB, LC, LD, PURE>(fe + g*NFE, quartet.AB, quartet.CD, pure, quartet.target);
+        }
+    }
+}
+
+/*
+ * The classes dispatched to the kernels: against libint, they win on all s and p classes and on
+ * d classes up to total angular momentum 3, and lose on the rest (MatPsi2's Integrals_ERIThroughput,
+ * cc-pVDZ). Only these are instantiated.
+ */
+template<int LA, int LB, int LC, int LD> struct Dispatched {
+    enum { value = LA + LB + LC + LD <= 3 || (LA <= 1 && LB <= 1 && LC <= 1 && LD <= 1) };
+};
+
+template<int LA, int LB, int LC, int LD, bool PURE, bool use = Dispatched<LA, LB, LC, LD>::value>
+struct Kernel {
+    static ERILowAMKernel get() { return eri_kernel<LA, LB, LC, LD, PURE>; }
+};
+template<int LA, int LB, int LC, int LD, bool PURE> struct Kernel<LA, LB, LC, LD, PURE, false> {
+    static ERILowAMKernel get() { return 0; }
+};
+
+#define ERI_KERNELS_D(p, a, b, c) Kernel<a, b, c, 0, p>::get(), Kernel<a, b, c, 1, p>::get(), Kernel<a, b, c, 2, p>::get()
+#define ERI_KERNELS_C(p, a, b) { ERI_KERNELS_D(p, a, b, 0) }, { ERI_KERNELS_D(p, a, b, 1) }, { ERI_KERNELS_D(p, a, b, 2) }
+#define ERI_KERNELS_B(p, a) { ERI_KERNELS_C(p, a, 0) }, { ERI_KERNELS_C(p, a, 1) }, { ERI_KERNELS_C(p, a, 2) }
+#define ERI_KERNELS_A(p) { ERI_KERNELS_B(p, 0) }, { ERI_KERNELS_B(p, 1) }, { ERI_KERNELS_B(p, 2) }
+
+// Cartesian, then pure kernels
+const ERILowAMKernel kernels[2][LOWAM_ERI_MAX_AM+1][LOWAM_ERI_MAX_AM+1][LOWAM_ERI_MAX_AM+1][LOWAM_ERI_MAX_AM+1] = {
+    { ERI_KERNELS_A(false) }, { ERI_KERNELS_A(true) }
+};
+
+}
+
+int eri_primitive_pairs(const GaussianShell& s1, const GaussianShell& s2, ERIPrimitivePair* pairs)
+{
+    const Vector3& A = s1.center();
+    const Vector3& B = s2.center();
+    const double AB2 = A.distance(B) * A.distance(B);
+
+    int n = 0;
+    for (int p1=0; p1<s1.nprimitive(); ++p1) {
+        const double a1 = s1.exp(p1);
+        const double c1 = s1.coef(p1);
+        for (int p2=0; p2<s2.nprimitive(); ++p2, ++n) {
+            const double a2 = s2.exp(p2);
+            const double c2 = s2.coef(p2);
+            ERIPrimitivePair& pair = pairs[n];
+            pair.zeta = a1 + a2;
+            const double ooz = 1.0 / pair.zeta;
+            pair.K = std::pow(M_PI*ooz, 1.5) * std::exp(-a1*a2*ooz*AB2) * c1 * c2;
+            for (int i=0; i<3; ++i) {
+                pair.P[i] = (a1*A[i] + a2*B[i]) * ooz;
+                pair.PA[i] = pair.P[i] - A[i];
+            }
+        }
+    }
+    return n;
+}
+
+ERILowAMKernel eri_lowam_kernel(int am1, int am2, int am3, int am4, bool pure)
+{
+    if (am1 > LOWAM_ERI_MAX_AM || am2 > LOWAM_ERI_MAX_AM || am3 > LOWAM_ERI_MAX_AM || am4 > LOWAM_ERI_MAX_AM)
+        return 0;
+    return kernels[pure][am1][am2][am3][am4];
+}
+
+}
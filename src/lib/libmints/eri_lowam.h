@@ -0,0 +1,92 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * PSI4: an ab initio quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *@END LICENSE
+ */
+
+#ifndef _psi_src_lib_libmints_eri_lowam_h
+#define _psi_src_lib_libmints_eri_lowam_h
+
+namespace psi {
+
+class GaussianShell;
+
+/// Highest shell angular momentum with a specialized ERI kernel
+#define LOWAM_ERI_MAX_AM 2
+/// Bound on the nonzero Cartesian-to-pure coefficients of one angular momentum up to LOWAM_ERI_MAX_AM
+#define LOWAM_ERI_MAX_PURE_TERMS ((LOWAM_ERI_MAX_AM+1)*(LOWAM_ERI_MAX_AM+2)/2 * (2*LOWAM_ERI_MAX_AM+1))
+
+/*! \ingroup MINTS
+ *  Primitive pair data of two shells, shared by all primitive quartets of a low angular momentum ERI kernel
+ */
+typedef struct ERIPrimitivePair_typ {
+    //! Sum of the exponents
+    double zeta;
+    //! c1 c2 (pi/zeta)^(3/2) exp(-a1 a2 |AB|^2 / zeta)
+    double K;
+    //! Gaussian product center
+    double P[3];
+    //! P minus the center of the first shell
+    double PA[3];
+} ERIPrimitivePair;
+
+/*! \ingroup MINTS
+ *  Nonzero Cartesian-to-pure coefficients of one angular momentum, pure[k] += coef[k] * cart[k]
+ */
+typedef struct ERIPureTransform_typ {
+    //! Number of terms
+    int n;
+    int cart[LOWAM_ERI_MAX_PURE_TERMS];
+    int pure[LOWAM_ERI_MAX_PURE_TERMS];
+    double coef[LOWAM_ERI_MAX_PURE_TERMS];
+} ERIPureTransform;
+
+/// Fills pairs, which holds nprimitive(s1)*nprimitive(s2) entries; returns the number filled
+int eri_primitive_pairs(const GaussianShell& s1, const GaussianShell& s2, ERIPrimitivePair* pairs);
+
+/*! \ingroup MINTS
+ *  One shell quartet (12|34) of a low angular momentum kernel batch
+ */
+typedef struct ERIQuartet_typ {
+    //! Primitive pairs of shells 1 and 2
+    const ERIPrimitivePair* bra;
+    int nbra;
+    //! Primitive pairs of shells 3 and 4
+    const ERIPrimitivePair* ket;
+    int nket;
+    //! A - B and C - D
+    double AB[3];
+    double CD[3];
+    //! Receives the integrals of the quartet
+    double* target;
+} ERIQuartet;
+
+/*! Computes nquartet quartets of one class over contracted shells in the order given, without libint
+ *  or any index permutation. The primitive quartets of the whole batch go through the recursions
+ *  several at a time. Pure kernels transform every index to pure functions with pure[l], the
+ *  transform of angular momentum l, before writing each target; Cartesian kernels ignore pure.
+ */
+typedef void (*ERILowAMKernel)(const ERIQuartet* quartets, int nquartet, const ERIPureTransform* pure);
+
+/// The pure or Cartesian kernel for the class (am1 am2|am3 am4), or 0 if the class is left to libint
+ERILowAMKernel eri_lowam_kernel(int am1, int am2, int am3, int am4, bool pure);
+
+}
+
+#endif
@@ -917,6 +917,86 @@ namespace {
         }
     }
 
+    /**
+     * @brief Fills one primitive quartet of the libint/libderiv primitive data from the ShellPairs
+     * @param prim The primitive quartet to fill.
+     * @param fjt Object used to compute the fundamental integrals.
+     * @param p12 ShellPair data structure for the left
+     * @param p1 Primitive on center 1
+     * @param p2 Primitive on center 2
+     * @param p34 ShellPair data structure for the right
+     * @param p3 Primitive on center 3
+     * @param p4 Primitive on center 4
+     * @param am Total angular momentum of this quartet
+     * @param deriv_lvl Derivitive level of the integral
+     * @param scale Factor on the fundamental integrals, the permutational multiplicity
+     */
+    static void fill_primitive_quartet(prim_data& prim, Fjt* fjt,
+                                       const ShellPair* p12, int p1, int p2,
+                                       const ShellPair* p34, int p3, int p4,
+                                       int am, int deriv_lvl, double scale) {
+        double zeta, eta, ooze, rho, poz, coef1, PQ[3], PQ2, W[3], T, *F;
+        int i;
+
+        zeta = p12->gamma[p1][p2];
+        eta  = p34->gamma[p3][p4];
+        ooze = 1.0 / (zeta + eta);
+        poz  = eta * ooze;
+        rho  = zeta * poz;
+        coef1= 2.0 * sqrt(rho*M_1_PI) * p12->overlap[p1][p2] * p34->overlap[p3][p4] * scale;
+
+        prim.poz   = poz;
+        prim.oo2zn = 0.5 * ooze;
+        prim.pon   = zeta * ooze;
+        prim.oo2z  = 0.5 / zeta;
+        prim.oo2n  = 0.5 / eta;
+        prim.twozeta_a = 2.0 * p12->ai[p1];
+        prim.twozeta_b = 2.0 * p12->aj[p2];
+        prim.twozeta_c = 2.0 * p34->ai[p3];
+        prim.twozeta_d = 2.0 * p34->aj[p4];
+
+        PQ[0] = p12->P[p1][p2][0] - p34->P[p3][p4][0];
+        PQ[1] = p12->P[p1][p2][1] - p34->P[p3][p4][1];
+        PQ[2] = p12->P[p1][p2][2] - p34->P[p3][p4][2];
+        PQ2   = PQ[0]*PQ[0] + PQ[1]*PQ[1] + PQ[2]*PQ[2];
+
+        W[0]  = (p12->P[p1][p2][0] * zeta + p34->P[p3][p4][0] * eta) * ooze;
+        W[1]  = (p12->P[p1][p2][1] * zeta + p34->P[p3][p4][1] * eta) * ooze;
+        W[2]  = (p12->P[p1][p2][2] * zeta + p34->P[p3][p4][2] * eta) * ooze;
+
+        // PA
+        prim.U[0][0] = p12->PA[p1][p2][0];
+        prim.U[0][1] = p12->PA[p1][p2][1];
+        prim.U[0][2] = p12->PA[p1][p2][2];
+        // PB
+        prim.U[1][0] = p12->PB[p1][p2][0];
+        prim.U[1][1] = p12->PB[p1][p2][1];
+        prim.U[1][2] = p12->PB[p1][p2][2];
+        // QC
+        prim.U[2][0] = p34->PA[p3][p4][0];
+        prim.U[2][1] = p34->PA[p3][p4][1];
+        prim.U[2][2] = p34->PA[p3][p4][2];
+        // QD
+        prim.U[3][0] = p34->PB[p3][p4][0];
+        prim.U[3][1] = p34->PB[p3][p4][1];
+        prim.U[3][2] = p34->PB[p3][p4][2];
+        // WP
+        prim.U[4][0] = W[0] - p12->P[p1][p2][0];
+        prim.U[4][1] = W[1] - p12->P[p1][p2][1];
+        prim.U[4][2] = W[2] - p12->P[p1][p2][2];
+        // WQ
+        prim.U[5][0] = W[0] - p34->P[p3][p4][0];
+        prim.U[5][1] = W[1] - p34->P[p3][p4][1];
+        prim.U[5][2] = W[2] - p34->P[p3][p4][2];
+
+        T = rho * PQ2;
+        fjt->set_rho(rho);
+        F = fjt->values(am+deriv_lvl, T);
+
+        for (i=0; i<=am+deriv_lvl; ++i)
+            prim.F[i] = F[i] * coef1;
+    }
+
     /**
      * @brief Fills the primitive data structure used by libint/libderiv with information from the ShellPairs
      * @param PrimQuartet The structure to hold the data.
@@ -932,99 +1012,44 @@ namespace {
      * @param sh3eqsh4 Is the shell on center 3 identical to that on center 4?
      * @param deriv_lvl Derivitive level of the integral
      * @return The total number of primitive combinations found. This is passed to libint/libderiv.
+     *
+     * Primitive pairs screened out by the ShellPairCache (zero overlap) are skipped. If all of them
+     * are, one primitive quartet with zero fundamentals is passed, so the result is zero.
      */
     static size_t fill_primitive_data(prim_data* PrimQuartet, Fjt* fjt,
                                       const ShellPair* p12, const ShellPair* p34,
                                       int am,
                                       int nprim1, int nprim2, int nprim3, int nprim4,
                                       bool sh1eqsh2, bool sh3eqsh4, int deriv_lvl) {
-        double zeta, eta, ooze, rho, poz, coef1, PQ[3], PQ2, W[3], o12, o34, T, *F;
-        double a1, a2, a3, a4;
-        int max_p2, max_p4, p1, p2, p3, p4, m, n, i;
+        int max_p2, max_p4, p1, p2, p3, p4, m, n;
         size_t nprim = 0L;
 
         for (p1 = 0; p1 < nprim1; ++p1) {
             max_p2 = sh1eqsh2 ? p1+1 : nprim2;
-            a1 = p12->ai[p1];
 
             for (p2 = 0; p2 < max_p2; ++p2) {
+                if (p12->overlap[p1][p2] == 0.0)
+                    continue;
                 m = (1 + (sh1eqsh2 && p1 != p2));
 
-                a2   = p12->aj[p2];
-                zeta = p12->gamma[p1][p2];
-                o12  = p12->overlap[p1][p2];
-
                 for (p3 = 0; p3 < nprim3; ++p3) {
                     max_p4 = sh3eqsh4 ? p3+1 : nprim4;
-                    a3 = p34->ai[p3];
 
                     for (p4 = 0; p4 < max_p4; ++p4) {
+                        if (p34->overlap[p3][p4] == 0.0)
+                            continue;
                         n = m * (1 + (sh3eqsh4 && p3 != p4));
-                        a4 = p34->aj[p4];
-
-                        eta  = p34->gamma[p3][p4];
-                        o34  = p34->overlap[p3][p4];
-                        ooze = 1.0 / (zeta + eta);
-                        poz  = eta * ooze;
-                        rho  = zeta * poz;
-                        coef1= 2.0 * sqrt(rho*M_1_PI) * o12 * o34 * n;
-
-                        PrimQuartet[nprim].poz   = poz;
-                        PrimQuartet[nprim].oo2zn = 0.5 * ooze;
-                        PrimQuartet[nprim].pon   = zeta * ooze;
-                        PrimQuartet[nprim].oo2z  = 0.5 / zeta;
-                        PrimQuartet[nprim].oo2n  = 0.5 / eta;
-                        PrimQuartet[nprim].twozeta_a = 2.0 * a1;
-                        PrimQuartet[nprim].twozeta_b = 2.0 * a2;
-                        PrimQuartet[nprim].twozeta_c = 2.0 * a3;
-                        PrimQuartet[nprim].twozeta_d = 2.0 * a4;
-
-                        PQ[0] = p12->P[p1][p2][0] - p34->P[p3][p4][0];
-                        PQ[1] = p12->P[p1][p2][1] - p34->P[p3][p4][1];
-                        PQ[2] = p12->P[p1][p2][2] - p34->P[p3][p4][2];
-                        PQ2   = PQ[0]*PQ[0] + PQ[1]*PQ[1] + PQ[2]*PQ[2];
-
-                        W[0]  = (p12->P[p1][p2][0] * zeta + p34->P[p3][p4][0] * eta) * ooze;
-                        W[1]  = (p12->P[p1][p2][1] * zeta + p34->P[p3][p4][1] * eta) * ooze;
-                        W[2]  = (p12->P[p1][p2][2] * zeta + p34->P[p3][p4][2] * eta) * ooze;
-
-                        // PA
-                        PrimQuartet[nprim].U[0][0] = p12->PA[p1][p2][0];
-                        PrimQuartet[nprim].U[0][1] = p12->PA[p1][p2][1];
-                        PrimQuartet[nprim].U[0][2] = p12->PA[p1][p2][2];
-                        // PB
-                        PrimQuartet[nprim].U[1][0] = p12->PB[p1][p2][0];
-                        PrimQuartet[nprim].U[1][1] = p12->PB[p1][p2][1];
-                        PrimQuartet[nprim].U[1][2] = p12->PB[p1][p2][2];
-                        // QC
-                        PrimQuartet[nprim].U[2][0] = p34->PA[p3][p4][0];
-                        PrimQuartet[nprim].U[2][1] = p34->PA[p3][p4][1];
-                        PrimQuartet[nprim].U[2][2] = p34->PA[p3][p4][2];
-                        // QD
-                        PrimQuartet[nprim].U[3][0] = p34->PB[p3][p4][0];
-                        PrimQuartet[nprim].U[3][1] = p34->PB[p3][p4][1];
-                        PrimQuartet[nprim].U[3][2] = p34->PB[p3][p4][2];
-                        // WP
-                        PrimQuartet[nprim].U[4][0] = W[0] - p12->P[p1][p2][0];
-                        PrimQuartet[nprim].U[4][1] = W[1] - p12->P[p1][p2][1];
-                        PrimQuartet[nprim].U[4][2] = W[2] - p12->P[p1][p2][2];
-                        // WQ
-                        PrimQuartet[nprim].U[5][0] = W[0] - p34->P[p3][p4][0];
-                        PrimQuartet[nprim].U[5][1] = W[1] - p34->P[p3][p4][1];
-                        PrimQuartet[nprim].U[5][2] = W[2] - p34->P[p3][p4][2];
-
-                        T = rho * PQ2;
-                        fjt->set_rho(rho);
-                        F = fjt->values(am+deriv_lvl, T);
-
-                        for (i=0; i<=am+deriv_lvl; ++i)
-                            PrimQuartet[nprim].F[i] = F[i] * coef1;
 
+                        fill_primitive_quartet(PrimQuartet[nprim], fjt, p12, p1, p2, p34, p3, p4, am, deriv_lvl, n);
                         nprim++;
                     }
                 }
             }
         }
+
+        if (nprim == 0L)
+            fill_primitive_quartet(PrimQuartet[nprim++], fjt, p12, 0, 0, p34, 0, 0, am, deriv_lvl, 0.0);
+
         return nprim;
     }
 
@@ -1119,16 +1144,29 @@ TwoElectronInt::TwoElectronInt(const IntegralFactory* integral, int deriv, bool
     }
     memset(source_, 0, sizeof(double)*size);
 
-    if (basis1() != basis2() || basis1() != basis3() || basis2() != basis4()) {
-        use_shell_pairs_ = false;
+    // Primitive pair data is shared with every other engine on the same basis sets and geometry.
+    // libint and libderiv see quartets permuted across the basis sets, so they only use it when
+    // all four are the same; the low angular momentum kernels work in the requested order.
+    libint_shell_pairs_ = false;
+    if (use_shell_pairs_) {
+        pairs12_ = ShellPairCache::get(original_bs1_, original_bs2_);
+        pairs34_ = ShellPairCache::get(original_bs3_, original_bs4_);
+        libint_shell_pairs_ = basis1() == basis2() && basis1() == basis3() && basis1() == basis4();
     }
 
-    if (use_shell_pairs_) {
-        // Precompute a bunch of information
-        init_shell_pairs12();
-        // If basis3 and basis4 equals basis1 and basis2, then the following function will do nothing,
-        // except assign pairs34_ to pairs12_
-        init_shell_pairs34();
+    // Scratch and pure transforms for the low angular momentum kernels, which ERI switches on
+    lowam_kernels_ = false;
+    lowam_bra_.resize(basis1()->max_nprimitive() * basis2()->max_nprimitive());
+    lowam_ket_.resize(basis3()->max_nprimitive() * basis4()->max_nprimitive());
+    for (int l=0; l<=max_am && l<=LOWAM_ERI_MAX_AM; ++l) {
+        ERIPureTransform& pure = lowam_pure_[l];
+        pure.n = 0;
+        SphericalTransformIter sti(*integral->spherical_transform(l));
+        for (sti.first(); !sti.is_done(); sti.next(), ++pure.n) {
+            pure.cart[pure.n] = sti.cartindex();
+            pure.pure[pure.n] = sti.pureindex();
+            pure.coef[pure.n] = sti.coef();
+        }
     }
 }
 
@@ -1140,308 +1178,167 @@ TwoElectronInt::~TwoElectronInt()
     free_libint(&libint_);
     if (deriv_)
         free_libderiv(&libderiv_);
-    free_shell_pairs12();
-    free_shell_pairs34();       // This shouldn't do anything, but this might change in the future
 }
 
-void TwoElectronInt::init_shell_pairs12()
+void TwoElectronInt::compute_shell(const AOShellCombinationsIterator& shellIter)
 {
-    ShellPair *sp;
-    Vector3 P, PA, PB, AB, A, B;
-    int i, j, si, sj, np_i, np_j;
-    size_t memd;
-    double a1, a2, ab2, gam, c1, c2;
-    double *curr_stack_ptr;
-
-    // Estimate memory needed by allocated space for the dynamically allocated parts of ShellPair structure
-    memd = TwoElectronInt::memory_to_store_shell_pairs(basis1(), basis2());
-
-    // Allocate a stack of memory
-    stack12_ = new double[memd];
-    curr_stack_ptr = stack12_;
-
-    // Allocate shell pair memory
-    pairs12_ = new ShellPair*[basis1()->nshell()];
-    for (i=0; i<basis1()->nshell(); ++i)
-        pairs12_[i] = new ShellPair[basis2()->nshell()];
-
-    // Loop over all shell pairs (si, sj) and create primitive pairs pairs
-    for (si=0; si<basis1()->nshell(); ++si) {
-        A = basis1()->shell(si).center();
-
-        for (sj=0; sj<basis2()->nshell(); ++sj) {
-            B = basis2()->shell(sj).center();
-
-            AB = A - B;
-            ab2 = AB.dot(AB);
-
-            // Get the pointer for convenience
-            sp = &(pairs12_[si][sj]);
-
-            // Save some information
-            sp->i = si;
-            sp->j = sj;
-            sp->AB[0] = AB[0]; sp->AB[1] = AB[1]; sp->AB[2] = AB[2];
-
-            np_i = basis1()->shell(si).nprimitive();
-            np_j = basis2()->shell(sj).nprimitive();
-
-            // Reserve some memory for the primitives
-            sp->ai = curr_stack_ptr; curr_stack_ptr += np_i;
-            sp->aj = curr_stack_ptr; curr_stack_ptr += np_j;
-
-            // Allocate and reserve memory for gammas
-            sp->gamma = new double*[np_i];
-            for (i=0; i<np_i; ++i) {
-                sp->gamma[i] = curr_stack_ptr; curr_stack_ptr += np_j;
-            }
-
-            // Reserve space for contraction coefficients
-            sp->ci = curr_stack_ptr; curr_stack_ptr += np_i;
-            sp->cj = curr_stack_ptr; curr_stack_ptr += np_j;
-
-            // Allocate and reserve space for overlaps
-            sp->overlap = new double*[np_i];
-            for (i=0; i<np_i; ++i) {
-                sp->overlap[i] = curr_stack_ptr; curr_stack_ptr += np_j;
-            }
-
-            // Allocate and reserve space for P, PA, and PB.
-            sp->P  = new double**[np_i];
-            sp->PA = new double**[np_i];
-            sp->PB = new double**[np_i];
-            for (i=0; i<np_i; ++i) {
-                sp->P[i]  = new double*[np_j];
-                sp->PA[i] = new double*[np_j];
-                sp->PB[i] = new double*[np_j];
-
-                for (j=0; j<np_j; ++j) {
-                    sp->P[i][j]  = curr_stack_ptr; curr_stack_ptr += 3;
-                    sp->PA[i][j] = curr_stack_ptr; curr_stack_ptr += 3;
-                    sp->PB[i][j] = curr_stack_ptr; curr_stack_ptr += 3;
-                }
-            }
-
-            // All memory has been reserved/allocated for this shell primitive pair pair.
-            // Pre-compute all data that we can:
-            for (i=0; i<np_i; ++i) {
-                a1 = basis1()->shell(si).exp(i);
-                c1 = basis1()->shell(si).coef(i);
-
-                // Save some information
-                sp->ai[i] = a1;
-                sp->ci[i] = c1;
-
-                for (j=0; j<np_j; ++j) {
-                    a2 = basis2()->shell(sj).exp(j);
-                    c2 = basis2()->shell(sj).coef(j);
-
-                    gam = a1 + a2;
-
-                    // Compute Gaussian product and component distances
-                    P = ( A * a1 + B * a2 ) / gam;
-                    PA = P - A;
-                    PB = P - B;
-
-                    // Copy data into pairs array
-                    sp->aj[j] = a2;
-                    sp->cj[j] = c2;
-                    sp->gamma[i][j] = gam;
-                    sp->P[i][j][0]  = P[0];  sp->P[i][j][1]  = P[1];  sp->P[i][j][2]  = P[2];
-                    sp->PA[i][j][0] = PA[0]; sp->PA[i][j][1] = PA[1]; sp->PA[i][j][2] = PA[2];
-                    sp->PB[i][j][0] = PB[0]; sp->PB[i][j][1] = PB[1]; sp->PB[i][j][2] = PB[2];
-                    sp->overlap[i][j] = pow(M_PI/gam, 3.0/2.0) * exp(-a1*a2*ab2/gam) * c1 * c2;
-                }
-            }
-        }
-    }
+    compute_shell(shellIter.p(), shellIter.q(), shellIter.r(), shellIter.s());
 }
 
-void TwoElectronInt::init_shell_pairs34()
+ERILowAMKernel TwoElectronInt::lowam_kernel(int sh1, int sh2, int sh3, int sh4) const
 {
-    // If basis1 == basis3 && basis2 == basis4, then we don't need to do anything except use the pointer
-    // of pairs12_.
-    if (use_shell_pairs_ == true) {
-        // This assumes init_shell_pairs12 was called and precomputed the values.
-        pairs34_ = pairs12_;
-        stack34_ = NULL;
-        return;
+    const GaussianShell* s[4] = { &original_bs1_->shell(sh1), &original_bs2_->shell(sh2),
+                                  &original_bs3_->shell(sh3), &original_bs4_->shell(sh4) };
+
+    // The kernels make every index pure or every index Cartesian; a mix is left to libint
+    bool pure = false, cartesian = false;
+    for (int k=0; k<4; ++k) {
+        if (s[k]->am() == 0)
+            continue;
+        if (!force_cartesian_ && s[k]->is_pure())
+            pure = true;
+        else
+            cartesian = true;
     }
-#if 0
-    fprintf(outfile, "  Pre-computing additional values for two-electron integrals. [ |34) does not equal (12| ]\n");
-
-    // Estimate memory needed by allocated space for the dynamically allocated parts of ShellPair structure
-    memd = ERIBase::memory_to_store_shell_pairs(basis3(), basis4());
+    if (pure && cartesian)
+        return 0;
 
-    // Allocate a stack of memory
-    stack34_ = new double[memd];
-    curr_stack_ptr = stack34_;
-
-    // Allocate shell pair memory
-    pairs34_ = new ShellPair*[basis3()->nprimitive()];
-    for (i=0; i<basis3()->nprimitive(); ++i)
-        pairs34_[i] = new ShellPair[basis4()->nprimitive()];
-
-    // Loop over all shell pairs (si, sj) and create primitive pairs pairs
-    for (si=0; si<basis3()->nprimitive(); ++si) {
-        A = basis3()->shell(si).center();
-
-        for (sj=0; sj<basis4()->nprimitive(); ++sj) {
-            B = basis4()->shell(sj).center();
-
-            AB = A - B;
-            ab2 = AB.dot(AB);
-
-            // Get the pointer for convenience
-            sp = &(pairs34_[si][sj]);
-
-            // Save some information
-            sp->i = si;
-            sp->j = sj;
-            sp->AB[0] = AB[0]; sp->AB[1] = AB[1]; sp->AB[2] = AB[2];
-
-            np_i = basis3()->shell(si).nprimitive();
-            np_j = basis4()->shell(sj).nprimitive();
+    return eri_lowam_kernel(s[0]->am(), s[1]->am(), s[2]->am(), s[3]->am(), pure);
+}
 
-            // Reserve some memory for the primitives
-            sp->ai = curr_stack_ptr; curr_stack_ptr += np_i;
-            sp->aj = curr_stack_ptr; curr_stack_ptr += np_j;
+// Center differences of the quartet, A - B and C - D
+static void lowam_centers(const GaussianShell& s1, const GaussianShell& s2, const GaussianShell& s3,
+                          const GaussianShell& s4, ERIQuartet& quartet)
+{
+    for (int i=0; i<3; ++i) {
+        quartet.AB[i] = s1.center()[i] - s2.center()[i];
+        quartet.CD[i] = s3.center()[i] - s4.center()[i];
+    }
+}
 
-            // Allocate and reserve memory for gammas
-            sp->gamma = new double*[np_i];
-            for (i=0; i<np_i; ++i) {
-                sp->gamma[i] = curr_stack_ptr; curr_stack_ptr += np_j;
-            }
+bool TwoElectronInt::compute_shell_lowam(int sh1, int sh2, int sh3, int sh4)
+{
+    ERILowAMKernel kernel = lowam_kernel(sh1, sh2, sh3, sh4);
+    if (!kernel)
+        return false;
 
-            // Reserve space for contraction coefficients
-            sp->ci = curr_stack_ptr; curr_stack_ptr += np_i;
-            sp->cj = curr_stack_ptr; curr_stack_ptr += np_j;
+    const GaussianShell& s1 = original_bs1_->shell(sh1);
+    const GaussianShell& s2 = original_bs2_->shell(sh2);
+    const GaussianShell& s3 = original_bs3_->shell(sh3);
+    const GaussianShell& s4 = original_bs4_->shell(sh4);
 
-            // Allocate and reserve space for overlaps
-            sp->overlap = new double*[np_i];
-            for (i=0; i<np_i; ++i) {
-                sp->overlap[i] = curr_stack_ptr; curr_stack_ptr += np_j;
-            }
+    ERIQuartet quartet;
+    if (use_shell_pairs_) {
+        quartet.bra = pairs12_->primitive_pairs(sh1, sh2);
+        quartet.nbra = pairs12_->nprimitive_pair(sh1, sh2);
+        quartet.ket = pairs34_->primitive_pairs(sh3, sh4);
+        quartet.nket = pairs34_->nprimitive_pair(sh3, sh4);
+    }
+    else {
+        quartet.bra = &lowam_bra_[0];
+        quartet.nbra = eri_primitive_pairs(s1, s2, &lowam_bra_[0]);
+        quartet.ket = &lowam_ket_[0];
+        quartet.nket = eri_primitive_pairs(s3, s4, &lowam_ket_[0]);
+    }
+    lowam_centers(s1, s2, s3, s4, quartet);
+    quartet.target = target_;
 
-            // Allocate and reserve space for P, PA, and PB.
-            sp->P  = new double**[np_i];
-            sp->PA = new double**[np_i];
-            sp->PB = new double**[np_i];
-            for (i=0; i<np_i; ++i) {
-                sp->P[i]  = new double*[np_j];
-                sp->PA[i] = new double*[np_j];
-                sp->PB[i] = new double*[np_j];
-
-                for (j=0; j<np_j; ++j) {
-                    sp->P[i][j]  = curr_stack_ptr; curr_stack_ptr += 3;
-                    sp->PA[i][j] = curr_stack_ptr; curr_stack_ptr += 3;
-                    sp->PB[i][j] = curr_stack_ptr; curr_stack_ptr += 3;
-                }
-            }
+    // The kernels work in the requested order and transform to pure functions themselves; a
+    // kernel is only chosen when that gives the size of the usual buffer
+    curr_buff_size_ = s1.nfunction() * s2.nfunction() * s3.nfunction() * s4.nfunction();
+    if (force_cartesian_)
+        curr_buff_size_ = s1.ncartesian() * s2.ncartesian() * s3.ncartesian() * s4.ncartesian();
 
-            // All memory has been reserved/allocated for this shell primitive pair pair.
-            // Pre-compute all data that we can:
-            for (i=0; i<np_i; ++i) {
-                a1 = basis3()->shell(si)->exp(i);
-                c1 = basis3()->shell(si)->coef(i);
-
-                // Save some information
-                sp->ai[i] = a1;
-                sp->ci[i] = c1;
-
-                for (j=0; j<np_j; ++j) {
-                    a2 = basis4()->shell(sj)->exp(j);
-                    c2 = basis4()->shell(sj)->coef(j);
-
-                    gam = a1 + a2;
-
-                    // Compute some distances
-                    P = ( A * a1 + B * a2 ) / gam;
-                    PA = P - A;
-                    PB = P - B;
-
-                    // Copy data into pairs array
-                    sp->aj[j] = a2;
-                    sp->cj[j] = c2;
-                    sp->gamma[i][j] = gam;
-                    sp->P[i][j][0]  = P[0];  sp->P[i][j][1]  = P[1];  sp->P[i][j][2]  = P[2];
-                    sp->PA[i][j][0] = PA[0]; sp->PA[i][j][1] = PA[1]; sp->PA[i][j][2] = PA[2];
-                    sp->PB[i][j][0] = PB[0]; sp->PB[i][j][1] = PB[1]; sp->PB[i][j][2] = PB[2];
-                    sp->overlap[i][j] = pow(M_PI/gam, 3.0/2.0) * exp(-a1*a2*ab2/gam) * c1 * c2;
-                }
-            }
-        }
-    }
-#endif
+    kernel(&quartet, 1, lowam_pure_);
+    return true;
 }
 
-void TwoElectronInt::free_shell_pairs12()
+void TwoElectronInt::compute_shells(int n, const int* shells)
 {
-    int i, si, sj;
-    ShellPair *sp;
-    int np_i;
-
-    if (!use_shell_pairs_)
+    if (!lowam_kernels_) {
+        TwoBodyAOInt::compute_shells(n, shells);
         return;
+    }
+    init_batch(n, shells);
+
+    // Quartets with a kernel are gathered, the others go through libint right away. The pair data
+    // comes from the shell pair caches or, without them, is built once for consecutive quartets on
+    // the same bra or ket pair.
+    size_t npair = 0;
+    for (int i=0; i<n && !use_shell_pairs_; ++i) {
+        const int* q = shells + 4*i;
+        npair += original_bs1_->shell(q[0]).nprimitive() * original_bs2_->shell(q[1]).nprimitive()
+               + original_bs3_->shell(q[2]).nprimitive() * original_bs4_->shell(q[3]).nprimitive();
+    }
+    if (lowam_pairs_.size() < npair)
+        lowam_pairs_.resize(npair);
+    lowam_quartets_.clear();
+    lowam_quartet_kernels_.clear();
+
+    ERIPrimitivePair* pairs = lowam_pairs_.empty() ? 0 : &lowam_pairs_[0];
+    int bra[2] = { -1, -1 }, ket[2] = { -1, -1 };
+    const ERIPrimitivePair *bra_pairs = 0, *ket_pairs = 0;
+    int nbra = 0, nket = 0;
+    for (int i=0; i<n; ++i) {
+        const int* q = shells + 4*i;
+        ERILowAMKernel kernel = lowam_kernel(q[0], q[1], q[2], q[3]);
+        if (!kernel) {
+            compute_shell(q[0], q[1], q[2], q[3]);
+            ::memcpy(&batch_buffer_[batch_offsets_[i]], target_, sizeof(double) * (batch_offsets_[i+1] - batch_offsets_[i]));
+            continue;
+        }
 
-    delete[] stack12_;
-    for (si=0; si<basis1()->nshell(); ++si) {
-        for (sj=0; sj<basis2()->nshell(); ++sj) {
-            np_i = basis1()->shell(si).nprimitive();
-            sp = &(pairs12_[si][sj]);
-
-            delete[] sp->gamma;
-            delete[] sp->overlap;
-
-            if (sp->P != NULL) {
-                for (i=0; i<np_i; ++i)
-                    delete[] sp->P[i];
-                delete[] sp->P;
-            }
-            if (sp->PA != NULL) {
-                for (i=0; i<np_i; ++i)
-                    delete[] sp->PA[i];
-                delete[] sp->PA;
+        const GaussianShell& s1 = original_bs1_->shell(q[0]);
+        const GaussianShell& s2 = original_bs2_->shell(q[1]);
+        const GaussianShell& s3 = original_bs3_->shell(q[2]);
+        const GaussianShell& s4 = original_bs4_->shell(q[3]);
+        if (use_shell_pairs_) {
+            bra_pairs = pairs12_->primitive_pairs(q[0], q[1]);
+            nbra = pairs12_->nprimitive_pair(q[0], q[1]);
+            ket_pairs = pairs34_->primitive_pairs(q[2], q[3]);
+            nket = pairs34_->nprimitive_pair(q[2], q[3]);
+        }
+        else {
+            if (q[0] != bra[0] || q[1] != bra[1]) {
+                bra[0] = q[0]; bra[1] = q[1];
+                bra_pairs = pairs;
+                nbra = eri_primitive_pairs(s1, s2, pairs);
+                pairs += nbra;
             }
-            if (sp->PB != NULL) {
-                for (i=0; i<np_i; ++i)
-                    delete[] sp->PB[i];
-                delete[] sp->PB;
+            if (q[2] != ket[0] || q[3] != ket[1]) {
+                ket[0] = q[2]; ket[1] = q[3];
+                ket_pairs = pairs;
+                nket = eri_primitive_pairs(s3, s4, pairs);
+                pairs += nket;
             }
         }
-    }
-
-    for (si=0; si<basis1()->nshell(); ++si)
-        delete[] pairs12_[si];
-    delete[] pairs12_;
-}
 
-void TwoElectronInt::free_shell_pairs34()
-{
-}
-
-size_t TwoElectronInt::memory_to_store_shell_pairs(const shared_ptr<BasisSet> &bs1, const shared_ptr<BasisSet> &bs2)
-{
-    int i, j, np_i, np_j;
-    size_t mem = 0;
-
-    for (i=0; i<bs1->nshell(); ++i) {
-        np_i = bs1->shell(i).nprimitive();
-        for (j=0; j<bs2->nshell(); ++j) {
-            np_j = bs2->shell(j).nprimitive();
-            mem += (2*(np_i + np_j) + 11*np_i*np_j);
-        }
+        ERIQuartet quartet;
+        quartet.bra = bra_pairs;
+        quartet.nbra = nbra;
+        quartet.ket = ket_pairs;
+        quartet.nket = nket;
+        lowam_centers(s1, s2, s3, s4, quartet);
+        quartet.target = &batch_buffer_[batch_offsets_[i]];
+        lowam_quartets_.push_back(quartet);
+        lowam_quartet_kernels_.push_back(kernel);
     }
-    return mem;
-}
 
-void TwoElectronInt::compute_shell(const AOShellCombinationsIterator& shellIter)
-{
-    compute_shell(shellIter.p(), shellIter.q(), shellIter.r(), shellIter.s());
+    // Each run of one kernel in a single call
+    const int nquartet = lowam_quartets_.size();
+    for (int first=0, last=0; first<nquartet; first=last) {
+        ERILowAMKernel kernel = lowam_quartet_kernels_[first];
+        while (last < nquartet && lowam_quartet_kernels_[last] == kernel)
+            ++last;
+        kernel(&lowam_quartets_[first], last - first, lowam_pure_);
+    }
 }
 
 void TwoElectronInt::compute_shell(int sh1, int sh2, int sh3, int sh4)
 {
+    if (lowam_kernels_ && compute_shell_lowam(sh1, sh2, sh3, sh4))
+        return;
+
 #ifdef MINTS_TIMER
     //~ timer_on("ERI::compute_shell");
 #endif
@@ -1646,11 +1543,11 @@ void TwoElectronInt::compute_quartet(int sh1, int sh2, int sh3, int sh4)
     nprim4 = s4.nprimitive();
 
     // If we can, use the precomputed values found in ShellPair.
-    if (use_shell_pairs_) {
-        ShellPair * restrict p12, * restrict p34;
+    if (libint_shell_pairs_) {
+        const ShellPair * restrict p12, * restrict p34;
         // 1234 -> 1234 no change
-        p12 = &(pairs12_[sh1][sh2]);
-        p34 = &(pairs34_[sh3][sh4]);
+        p12 = pairs12_->pair(sh1, sh2);
+        p34 = pairs34_->pair(sh3, sh4);
 
         nprim = fill_primitive_data(libint_.PrimQuartet, fjt_, p12, p34, am, nprim1, nprim2, nprim3, nprim4, sh1 == sh2, sh3 == sh4, 0);
     }
@@ -2026,12 +1923,13 @@ void TwoElectronInt::compute_quartet_deriv1(int sh1, int sh2, int sh3, int sh4)
     // Prepare all the data needed by libderiv
     nprim = 0;
 
-    if (use_shell_pairs_) {
-        ShellPair *p12, *p34;
-        p12 = &(pairs12_[sh1][sh2]);
-        p34 = &(pairs34_[sh3][sh4]);
+    if (libint_shell_pairs_) {
+        const ShellPair *p12, *p34;
+        p12 = pairs12_->pair(sh1, sh2);
+        p34 = pairs34_->pair(sh3, sh4);
 
-        nprim = fill_primitive_data(libderiv_.PrimQuartet, fjt_, p12, p34, am, nprim1, nprim2, nprim3, nprim4, sh1 == sh2, sh3 == sh4, 1);
+        // Swapping the primitives of identical shells swaps their center derivatives, so no pairs are folded
+        nprim = fill_primitive_data(libderiv_.PrimQuartet, fjt_, p12, p34, am, nprim1, nprim2, nprim3, nprim4, false, false, 1);
     }
     else {
         for (int p1=0; p1<nprim1; ++p1) {
@@ -2382,12 +2280,13 @@ void TwoElectronInt::compute_quartet_deriv2(int sh1, int sh2, int sh3, int sh4)
     libderiv_.CD[2] = C[2] - D[2];
 
     // prepare all the data needed for libderiv
-    if (use_shell_pairs_) {
-        ShellPair *p12, *p34;
-        p12 = &(pairs12_[sh1][sh2]);
-        p34 = &(pairs34_[sh3][sh4]);
+    if (libint_shell_pairs_) {
+        const ShellPair *p12, *p34;
+        p12 = pairs12_->pair(sh1, sh2);
+        p34 = pairs34_->pair(sh3, sh4);
 
-        nprim = fill_primitive_data(libderiv_.PrimQuartet, fjt_, p12, p34, am, nprim1, nprim2, nprim3, nprim4, sh1 == sh2, sh3 == sh4, 2);
+        // Swapping the primitives of identical shells swaps their center derivatives, so no pairs are folded
+        nprim = fill_primitive_data(libderiv_.PrimQuartet, fjt_, p12, p34, am, nprim1, nprim2, nprim3, nprim4, false, false, 2);
     }
     else {
         for (int p1=0; p1<nprim1; ++p1) {
@@ -73,40 +73,50 @@ const double oon[] = {0.0, 1.0, 1.0/2.0, 1.0/3.0, 1.0/4.0, 1.0/5.0, 1.0/6.0, 1.0
 Fjt::Fjt() {}
 Fjt::~Fjt() {}
 
-double Taylor_Fjt::relative_zero_(1e-6);
+#if TAYLOR_INTERPOLATION_ORDER != 6
+#error "BoysFunction::values() is written out for 6th-order Taylor interpolation"
+#endif
+
+namespace {
+// Series terms below relative_zero * sum stop the tabulation; tight, since the
+// high orders are tiny and enter the recursions multiplied by powers of |PC|
+const double relative_zero = 1e-16;
+}
 
 /*------------------------------------------------------
-  Initialize Taylor_Fm_Eval object (computes incomplete
-  gamma function via Taylor interpolation)
+  Shared Boys function table: Taylor interpolation
+  below T_crit, asymptotic formula above
  ------------------------------------------------------*/
-Taylor_Fjt::Taylor_Fjt(unsigned int mmax, double accuracy) :
-    cutoff_(accuracy), interp_order_(TAYLOR_INTERPOLATION_ORDER),
-    F_(new double[mmax+1])
+BoysFunction::BoysFunction(int max_m, double accuracy) :
+    max_m_(max_m)
 {
-    const double sqrt_pi = M_SQRT_PI;
+    const int ncol = max_m_ + TAYLOR_INTERPOLATION_ORDER + 1;
 
     /*---------------------------------------
     We are doing Taylor interpolation with
     n=TAYLOR_ORDER terms here:
     error <= delT^n/(n+1)!
    ---------------------------------------*/
-    delT_ = 2.0*std::pow(cutoff_*fac[interp_order_+1],
-                         1.0/interp_order_);
+    double fac_np1 = 1.0;
+    for (int k = 2; k <= TAYLOR_INTERPOLATION_ORDER + 1; ++k)
+        fac_np1 *= k;
+    delT_ = 2.0*std::pow(accuracy*fac_np1, 1.0/TAYLOR_INTERPOLATION_ORDER);
     oodelT_ = 1.0/delT_;
-    max_m_ = mmax + interp_order_ - 1;
 
-    T_crit_ = new double[max_m_ + 1];   /*--- m=0 is included! ---*/
+    T_crit_ = new double[ncol];
     max_T_ = 0;
-    /*--- Figure out T_crit for each m and put into the T_crit ---*/
-    for(int m=max_m_; m>=0; --m) {
+    /*--- Figure out T_crit for each m; egamma = epsilon*Gamma(m+0.5) ---*/
+    double egamma = accuracy * M_SQRT_PI;
+    for (int m = 0; m < ncol; ++m) {
+        if (m > 0)
+            egamma *= m - 0.5;
         /*------------------------------------------
       Damped Newton-Raphson method to solve
       T^{m-0.5}*exp(-T) = epsilon*Gamma(m+0.5)
       The solution is the max T for which to do
       the interpolation
      ------------------------------------------*/
-        double T = -log(cutoff_);
-        const double egamma = cutoff_ * sqrt_pi * df[2*m]/std::pow(2.0,m);
+        double T = -log(accuracy);
         double T_new = T;
         double func;
         do {
@@ -133,365 +143,152 @@ Taylor_Fjt::Taylor_Fjt(unsigned int mmax, double accuracy) :
             }
         } while (std::fabs(func/egamma) >= SOFT_ZERO);
         T_crit_[m] = T_new;
-        const int T_idx = (int)std::floor(T_new/delT_);
-        max_T_ = std::max(max_T_,T_idx);
+        max_T_ = std::max(max_T_, (int)std::floor(T_new*oodelT_));
     }
+    // one spare row, T rounds to the nearest grid point
+    max_T_ += 1;
 
-    // allocate the grid (see the comments below)
-    {
-        const int nrow = max_T_+1;
-        const int ncol = max_m_+1;
-        grid_ = block_matrix(nrow, ncol);
-        //grid_ = new double*[nrow];
-        //grid_[0] = new double[nrow*ncol];
-        //for(int r=1; r<nrow; ++r)
-        //    grid_[r] = grid_[r-1] + ncol;
-    }
+    grid_ = block_matrix(max_T_+1, ncol);
 
     /*-------------------------------------------------------
-    Tabulate the gamma function from t=delT to T_crit[m]:
-    1) include T=0 though the table is empty for T=0 since
-       Fm(0) is simple to compute
-    2) modified MacLaurin series converges fastest for
-       the largest m -> use it to compute Fmmax(T)
-       see JPC 94, 5564 (1990).
-    3) then either use the series to compute the rest
-       of the row or maybe use downward recursion
+    Tabulate the gamma function from t=0 to T_crit[m]
+    with the modified MacLaurin series, see JPC 94, 5564 (1990).
    -------------------------------------------------------*/
-    /*--- do the mmax first ---*/
-    const double cutoff_o_10 = 0.1 * cutoff_;
-    for(int m=0; m<=max_m_; ++m) {
-        for(int T_idx = max_T_;
-            T_idx >= 0;
-            --T_idx) {
+    const double cutoff_o_10 = 0.1 * accuracy;
+    for (int m = 0; m < ncol; ++m) {
+        for (int T_idx = max_T_; T_idx >= 0; --T_idx) {
             const double T = T_idx * delT_;
             double denom = (m+0.5);
             double term = 0.5*std::exp(-T)/denom;
             double sum = term;
-            //            double rel_error;
             double epsilon;
             do {
                 denom += 1.0;
                 term *= T/denom;
                 sum += term;
-                //                rel_error = term/sum;
-                // stop if adding a term smaller or equal to cutoff_/10 and smaller than relative_zero * sum
+                // stop if adding a term smaller or equal to cutoff/10 and smaller than relative_zero * sum
                 // When sum is small in absolute value, the second threshold is more important
-                epsilon = std::min(cutoff_o_10, sum*relative_zero_);
+                epsilon = std::min(cutoff_o_10, sum*relative_zero);
             } while (term > epsilon);
-            //            } while (term > epsilon || term > sum*relative_zero_);
 
             grid_[T_idx][m] = sum;
         }
     }
 }
 
-Taylor_Fjt::~Taylor_Fjt()
+BoysFunction::~BoysFunction()
 {
-    delete[] F_;
     delete[] T_crit_;
-    T_crit_ = 0;
     free_block(grid_);
-    grid_ = NULL;
 }
 
-/* Using the tabulated incomplete gamma function in gtable, compute
- * the incomplete gamma function for a particular wval for all 0<=j<=J.
- * The result is placed in the global intermediate int_fjttable.
- */
-double *
-Taylor_Fjt::values(int l, double T)
+const BoysFunction& BoysFunction::instance()
 {
-    const double two_T = 2.0*T;
-
-    // since Tcrit grows with l, this condition only needs to be determined once
-    const bool T_gt_Tcrit = T > T_crit_[l];
-    // start recursion at j=jrecur
-    const int jrecur = TAYLOR_INTERPOLATION_AND_RECURSION ? l : 0;
-    /*-------------------------------------
-     Compute Fj(T) from l down to jrecur
-   -------------------------------------*/
-    if (T_gt_Tcrit) {
-        double pow_two_T_to_minusjp05 = std::pow(two_T,-l-0.5);
-        for(int j=l; j>=jrecur; --j) {
-            /*--- Asymptotic formula ---*/
-            F_[j] = df[2*j] * M_SQRT_PI_2 * pow_two_T_to_minusjp05;
-            pow_two_T_to_minusjp05 *= two_T;
-        }
+    static BoysFunction boys(BOYS_MAX_M, 1e-15);
+    return boys;
+}
+
+void BoysFunction::values(int J, double T, double *F) const
+{
+    if (J > max_m_) {
+        series(J, T, F);
+        return;
+    }
+    // since T_crit grows with m, this test covers F_0..F_J
+    if (T > T_crit_[J]) {
+        /*--- Asymptotic formula, F_j = (2j-1)!! sqrt(pi/2) / (2T)^(j+1/2) ---*/
+        const double oo2T = 0.5/T;
+        F[0] = M_SQRT_PI_2 * std::sqrt(oo2T);
+        for (int j = 1; j <= J; ++j)
+            F[j] = F[j-1] * (2*j-1) * oo2T;
     }
     else {
-        const int T_ind = (int)std::floor(0.5+T*oodelT_);
+        /*--- Taylor interpolation, F_j(T) = sum_k F_{j+k}(T0) (T0-T)^k / k! ---*/
+        const int T_ind = (int)(0.5+T*oodelT_);
         const double h = T_ind * delT_ - T;
-        const double* F_row = grid_[T_ind] + l;
-
-        for(int j=l; j>=jrecur; --j, --F_row) {
-
-            /*--- Taylor interpolation ---*/
-            F_[j] =          F_row[0]
-        #if TAYLOR_INTERPOLATION_ORDER > 0
-                    +       h*(F_row[1]
-                   #endif
-                   #if TAYLOR_INTERPOLATION_ORDER > 1
-                               +oon[2]*h*(F_row[2]
-                              #endif
-                              #if TAYLOR_INTERPOLATION_ORDER > 2
-                                          +oon[3]*h*(F_row[3]
-                                         #endif
-                                         #if TAYLOR_INTERPOLATION_ORDER > 3
-                                                     +oon[4]*h*(F_row[4]
-                                                    #endif
-                                                    #if TAYLOR_INTERPOLATION_ORDER > 4
-                                                                +oon[5]*h*(F_row[5]
-                                                               #endif
-                                                               #if TAYLOR_INTERPOLATION_ORDER > 5
-                                                                           +oon[6]*h*(F_row[6]
-                                                                          #endif
-                                                                          #if TAYLOR_INTERPOLATION_ORDER > 6
-                                                                                      +oon[7]*h*(F_row[7]
-                                                                                     #endif
-                                                                                     #if TAYLOR_INTERPOLATION_ORDER > 7
-                                                                                                 +oon[8]*h*(F_row[8])
-                                                                                     #endif
-                                                                                     #if TAYLOR_INTERPOLATION_ORDER > 6
-                                                                                                 )
-                                                                          #endif
-                                                                          #if TAYLOR_INTERPOLATION_ORDER > 5
-                                                                                      )
-                                                               #endif
-                                                               #if TAYLOR_INTERPOLATION_ORDER > 4
-                                                                           )
-                                                    #endif
-                                                    #if TAYLOR_INTERPOLATION_ORDER > 3
-                                                                )
-                                         #endif
-                                         #if TAYLOR_INTERPOLATION_ORDER > 2
-                                                     )
-                              #endif
-                              #if TAYLOR_INTERPOLATION_ORDER > 1
-                                          )
-                   #endif
-                   #if TAYLOR_INTERPOLATION_ORDER > 0
-                               )
-        #endif
-                    ;
-        } // interpolation for F_j(T), jrecur<=j<=l
-    } // if T < T_crit
-
-    /*------------------------------------
-    And then do downward recursion in j
-   ------------------------------------*/
-#if TAYLOR_INTERPOLATION_AND_RECURSION
-    if (l > 0 && jrecur > 0) {
-        double F_jp1 = F_[jrecur];
-        const double exp_jT = std::exp(-T);
-        for(int j=jrecur-1; j>=0; --j) {
-            const double F_j = (exp_jT + two_T*F_jp1)*oo2np1[j];
-            F_[j] = F_j;
-            F_jp1 = F_j;
-        }
+        const double w2 = h * h * oon[2];
+        const double w3 = w2 * h * oon[3];
+        const double w4 = w3 * h * oon[4];
+        const double w5 = w4 * h * oon[5];
+        const double w6 = w5 * h * oon[6];
+        const double* row = grid_[T_ind];
+        // contiguous in j, so the compiler vectorizes across orders
+        for (int j = 0; j <= J; ++j)
+            F[j] = row[j] + h*row[j+1] + w2*row[j+2] + w3*row[j+3] + w4*row[j+4] + w5*row[j+5] + w6*row[j+6];
     }
-#endif
-
-    return F_;
 }
 
-/////////////////////////////////////////////////////////////////////////////
-
-/* Tablesize should always be at least 121. */
-#define TABLESIZE 121
-
-/* Tabulate the incomplete gamma function and put in gtable. */
-/*
- *     For J = JMAX a power series expansion is used, see for
- *     example Eq.(39) given by V. Saunders in "Computational
- *     Techniques in Quantum Chemistry and Molecular Physics",
- *     Reidel 1975.  For J < JMAX the values are calculated
- *     using downward recursion in J.
- */
-FJT::FJT(int max)
+void BoysFunction::values(int J, int n, const double *T, double *F) const
 {
-    int i,j;
-    double denom,d2jmax1,r2jmax1,wval,d2wval,sum,term,rexpw;
-
-    maxj = max;
-
-    /* Allocate storage for gtable and int_fjttable. */
-    int_fjttable = new double[maxj+1];
-    gtable = new double*[ngtable()];
-    for (i=0; i<ngtable(); i++) {
-        gtable[i] = new double[TABLESIZE];
-    }
+    for (int i = 0; i < n; ++i, F += J+1)
+        values(J, T[i], F);
+}
 
-    /* Tabulate the gamma function for t(=wval)=0.0. */
-    denom = 1.0;
-    for (i=0; i<ngtable(); i++) {
-        gtable[i][0] = 1.0/denom;
-        denom += 2.0;
+void BoysFunction::series(int J, double T, double *F)
+{
+    const double EPS = 1.0e-17;
+    const double et = std::exp(-T);
+    const double t2 = 2.0*T;
+
+    if (T > 20.0) {
+        // F_0 from erf, then upward recursion, which is stable this far out
+        const double sqrtT = std::sqrt(T);
+        F[0] = 0.5 * M_SQRT_PI * erf(sqrtT) / sqrtT;
+        for (int m = 0; m < J; ++m)
+            F[m+1] = ((2*m + 1)*F[m] - et)/t2;
     }
-
-    /* Tabulate the gamma function from t(=wval)=0.1, to 12.0. */
-    d2jmax1 = 2.0*(ngtable()-1) + 1.0;
-    r2jmax1 = 1.0/d2jmax1;
-    for (i=1; i<TABLESIZE; i++) {
-        wval = 0.1 * i;
-        d2wval = 2.0 * wval;
-        term = r2jmax1;
-        sum = term;
-        denom = d2jmax1;
-        for (j=2; j<=200; j++) {
-            denom = denom + 2.0;
-            term = term * d2wval / denom;
-            sum = sum + term;
-            if (term <= 1.0e-15) break;
+    else {
+        // F_J = exp(-T) sum_i (2T)^i / ((2J+1)(2J+3)...(2J+2i+1)), then downward recursion
+        double term = 1.0/(2*J+1);
+        double sum = term;
+        for (int i = 1; fabs(term) > EPS && i < 1000; ++i) {
+            term *= t2/(2*J+2*i+1);
+            sum += term;
         }
-        rexpw = exp(-wval);
+        F[J] = sum*et;
+        for (int m = J-1; m >= 0; --m)
+            F[m] = (t2*F[m+1] + et)/(2*m+1);
+    }
+}
 
-        /* Fill in the values for the highest j gtable entries (top row). */
-        gtable[ngtable()-1][i] = rexpw * sum;
+Taylor_Fjt::Taylor_Fjt(unsigned int mmax, double accuracy) :
+    F_(new double[mmax+1])
+{
+}
 
-        /* Work down the table filling in the rest of the column. */
-        denom = d2jmax1;
-        for (j=ngtable() - 2; j>=0; j--) {
-            denom = denom - 2.0;
-            gtable[j][i] = (gtable[j+1][i]*d2wval + rexpw)/denom;
-        }
-    }
+Taylor_Fjt::~Taylor_Fjt()
+{
+    delete[] F_;
+}
 
-    /* Form some denominators, so divisions can be eliminated below. */
-    denomarray = new double[max+1];
-    denomarray[0] = 0.0;
-    for (i=1; i<=max; i++) {
-        denomarray[i] = 1.0/(2*i - 1);
-    }
+double *
+Taylor_Fjt::values(int l, double T)
+{
+    BoysFunction::instance().values(l, T, F_);
+    return F_;
+}
 
-    wval_infinity = 2*max + 37.0;
-    itable_infinity = (int) (10 * wval_infinity);
+/////////////////////////////////////////////////////////////////////////////
 
+FJT::FJT(int max) :
+    maxj(max), int_fjttable(new double[max+1])
+{
 }
 
 FJT::~FJT()
 {
     delete[] int_fjttable;
-    for (int i=0; i<maxj+7; i++) {
-        delete[] gtable[i];
-    }
-    delete[] gtable;
-    delete[] denomarray;
 }
 
-/* Using the tabulated incomplete gamma function in gtable, compute
- * the incomplete gamma function for a particular wval for all 0<=j<=J.
- * The result is placed in the global intermediate int_fjttable.
- */
 double *
-FJT::values(int J,double wval)
-{
-    const double sqrpih =  0.886226925452758;
-    const double coef2 =  0.5000000000000000;
-    const double coef3 = -0.1666666666666667;
-    const double coef4 =  0.0416666666666667;
-    const double coef5 = -0.0083333333333333;
-    const double coef6 =  0.0013888888888889;
-    const double gfac30 =  0.4999489092;
-    const double gfac31 = -0.2473631686;
-    const double gfac32 =  0.321180909;
-    const double gfac33 = -0.3811559346;
-    const double gfac20 =  0.4998436875;
-    const double gfac21 = -0.24249438;
-    const double gfac22 =  0.24642845;
-    const double gfac10 =  0.499093162;
-    const double gfac11 = -0.2152832;
-    const double gfac00 = -0.490;
-
-    double wdif, d2wal, rexpw, /* denom, */ gval, factor, rwval, term;
-    int i, itable, irange;
-
+FJT::values(int J, double wval)
+{
     if (J>maxj) {
         fprintf(stderr, "the int_fjt routine has been incorrectly used\n");
         fprintf(stderr, "J = %d but maxj = %d\n", J, maxj);
         abort();
     }
-
-    /* Compute an index into the table. */
-    /* The test is needed to avoid floating point exceptions for
-   * large values of wval. */
-    if (wval > wval_infinity) {
-        itable = itable_infinity;
-    }
-    else {
-        itable = (int) (10.0 * wval);
-    }
-
-    /* If itable is small enough use the table to compute int_fjttable. */
-    if (itable < TABLESIZE) {
-
-        wdif = wval - 0.1 * itable;
-
-        /* Compute fjt for J. */
-        int_fjttable[J] = (((((coef6 * gtable[J+6][itable]*wdif
-                               + coef5 * gtable[J+5][itable])*wdif
-                              + coef4 * gtable[J+4][itable])*wdif
-                             + coef3 * gtable[J+3][itable])*wdif
-                            + coef2 * gtable[J+2][itable])*wdif
-                           -  gtable[J+1][itable])*wdif
-                +  gtable[J][itable];
-
-        /* Compute the rest of the fjt. */
-        d2wal = 2.0 * wval;
-        rexpw = exp(-wval);
-        /* denom = 2*J + 1; */
-        for (i=J; i>0; i--) {
-            /* denom = denom - 2.0; */
-            int_fjttable[i-1] = (d2wal*int_fjttable[i] + rexpw)*denomarray[i];
-        }
-    }
-    /* If wval <= 2*J + 36.0, use the following formula. */
-    else if (itable <= 20*J + 360) {
-        rwval = 1.0/wval;
-        rexpw = exp(-wval);
-
-        /* Subdivide wval into 6 ranges. */
-        irange = itable/30 - 3;
-        if (irange == 1) {
-            gval = gfac30 + rwval*(gfac31 + rwval*(gfac32 + rwval*gfac33));
-            int_fjttable[0] = sqrpih*sqrt(rwval) - rexpw*gval*rwval;
-        }
-        else if (irange == 2) {
-            gval = gfac20 + rwval*(gfac21 + rwval*gfac22);
-            int_fjttable[0] = sqrpih*sqrt(rwval) - rexpw*gval*rwval;
-        }
-        else if (irange == 3 || irange == 4) {
-            gval = gfac10 + rwval*gfac11;
-            int_fjttable[0] = sqrpih*sqrt(rwval) - rexpw*gval*rwval;
-        }
-        else if (irange == 5 || irange == 6) {
-            gval = gfac00;
-            int_fjttable[0] = sqrpih*sqrt(rwval) - rexpw*gval*rwval;
-        }
-        else {
-            int_fjttable[0] = sqrpih*sqrt(rwval);
-        }
-
-        /* Compute the rest of the int_fjttable from int_fjttable[0]. */
-        factor = 0.5 * rwval;
-        term = factor * rexpw;
-        for (i=1; i<=J; i++) {
-            int_fjttable[i] = factor * int_fjttable[i-1] - term;
-            factor = rwval + factor;
-        }
-    }
-    /* For large values of wval use this algorithm: */
-    else {
-        rwval = 1.0/wval;
-        int_fjttable[0] = sqrpih*sqrt(rwval);
-        factor = 0.5 * rwval;
-        for (i=1; i<=J; i++) {
-            int_fjttable[i] = factor * int_fjttable[i-1];
-            factor = rwval + factor;
-        }
-    }
-    /* printf(" %2d %12.8f %4d %12.8f\n",J,wval,itable,int_fjttable[0]); */
-
+    BoysFunction::instance().values(J, wval, int_fjttable);
     return int_fjttable;
 }
 
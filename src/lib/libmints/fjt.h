@@ -72,49 +72,63 @@ public:
 };
 
 #define TAYLOR_INTERPOLATION_ORDER 6
-#define TAYLOR_INTERPOLATION_AND_RECURSION 0  // compute F_lmax(T) and then iterate down to F_0(T)? Else use interpolation only
-/// Uses Taylor interpolation of up to 8-th order to compute the Boys function
+#define BOYS_MAX_M 32  // highest order served from the shared table; ERIs need up to 4 * LIBINT_MAX_AM + 2
+
+/*! Boys function engine shared by every integral class (ERIs, potential, electric field, EFP).
+ *  One table of F_m(T) on a uniform grid is built on first use; below T_crit(m) values come from
+ *  Taylor interpolation of order TAYLOR_INTERPOLATION_ORDER, above it from the asymptotic formula,
+ *  with an absolute error below 1e-14. Orders past max_m() fall back to the series.
+ *  The engine is read-only after construction, so all threads share it.
+ */
+class BoysFunction {
+    double **grid_;            /* F_m(T_idx * delT_), row T_idx, column m */
+    double delT_;
+    double oodelT_;
+    int max_m_;                /* highest order served, the table has TAYLOR_INTERPOLATION_ORDER more columns */
+    int max_T_;                /* highest row of the table */
+    double *T_crit_;           /* above T_crit_[m] the asymptotic formula is used for F_0..F_m */
+
+    BoysFunction(int max_m, double accuracy);
+    // No copy constructor or assignment
+    BoysFunction(const BoysFunction&);
+    BoysFunction& operator=(const BoysFunction&);
+
+public:
+    ~BoysFunction();
+
+    /// The process-wide engine
+    static const BoysFunction& instance();
+
+    int max_m() const { return max_m_; }
+
+    /// F_0(T) .. F_J(T) into F
+    void values(int J, double T, double *F) const;
+    /// F_0 .. F_J for each of n arguments, F_j(T[i]) into F[i * (J+1) + j]
+    void values(int J, int n, const double *T, double *F) const;
+    /// F_0(T) .. F_J(T) by the power series and downward recursion, for any J; the reference for the table
+    static void series(int J, double T, double *F);
+};
+
+/// Boys function from the shared BoysFunction table, for the ERI code
 class Taylor_Fjt : public Fjt {
-    static double relative_zero_;
 public:
     static const int max_interp_order = 8;
 
+    /// The table is built to 1e-15 whatever accuracy is asked for
     Taylor_Fjt(unsigned int jmax, double accuracy);
     virtual ~Taylor_Fjt();
     /// Implements Fjt::values()
     double *values(int J, double T);
 private:
-    double **grid_;            /* Table of "exact" Fm(T) values. Row index corresponds to
-                                  values of T (max_T+1 rows), column index to values
-                                  of m (max_m+1 columns) */
-    double delT_;              /* The step size for T, depends on cutoff */
-    double oodelT_;            /* 1.0 / delT_, see above */
-    double cutoff_;            /* Tolerance cutoff used in all computations of Fm(T) */
-    int interp_order_;         /* Order of (Taylor) interpolation */
-    int max_m_;                /* Maximum value of m in the table, depends on cutoff
-                                  and the number of terms in Taylor interpolation */
-    int max_T_;                /* Maximum index of T in the table, depends on cutoff
-                                  and m */
-    double *T_crit_;           /* Maximum T for each row, depends on cutoff;
-                                  for a given m and T_idx <= max_T_idx[m] use Taylor interpolation,
-                                  for a given m and T_idx > max_T_idx[m] use the asymptotic formula */
     double *F_;                /* Here computed values of Fj(T) are stored */
 };
 
-/// "Old" intv3 code from Curt
-/// Computes F_j(T) using 6-th order Taylor interpolation
+/// Boys function from the shared BoysFunction table, for the attenuated and F12 fundamentals
 class FJT: public Fjt {
 private:
-    double **gtable;
-
     int maxj;
-    double *denomarray;
-    double wval_infinity;
-    int itable_infinity;
-
     double *int_fjttable;
 
-    int ngtable() const { return maxj + 7; }
 public:
     FJT(int n);
     virtual ~FJT();
@@ -64,6 +64,14 @@ KineticInt::~KineticInt()
     delete[] buffer_;
 }
 
+OneBodyAOInt* KineticInt::clone()
+{
+    KineticInt* engine = new KineticInt(spherical_transforms_, bs1_, bs2_, deriv_);
+    engine->set_force_cartesian(force_cartesian_);
+    engine->set_origin(origin_);
+    return engine;
+}
+
 // The engine only supports segmented basis sets
 void KineticInt::compute_pair(const GaussianShell& s1, const GaussianShell& s2)
 {
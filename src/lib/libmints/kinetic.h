@@ -64,6 +64,12 @@ public:
 
     /// Does the method provide first derivatives?
     bool has_deriv2() { return true; }
+
+    /// Engines are independent, so compute() can run one clone per thread
+    bool cloneable() { return true; }
+    OneBodyAOInt* clone();
+    /// The kinetic energy operator is symmetric
+    bool hermitian() const { return true; }
 };
 
 }
@@ -52,7 +52,9 @@
 
 #include <cmath>
 #include <cstdio>
+#include <cstdlib>
 #include <fstream>
+#include <limits>
 #include <algorithm>
 #include <ctype.h>
 #include <sstream>
@@ -79,11 +81,158 @@ string to_string(const int val)
     strm <<  val;
     return strm.str();
 }
+
+/// n doubles (at least one) on a MATRIX_ALIGNMENT boundary, release with ::free
+double* aligned_doubles(size_t n)
+{
+    void* p = NULL;
+    if (posix_memalign(&p, MATRIX_ALIGNMENT, (n ? n : 1) * sizeof(double)))
+        throw PSIEXCEPTION("Matrix: out of memory.");
+    return static_cast<double*>(p);
+}
+
+/// n rounded up to whole MATRIX_ALIGNMENT units of doubles
+size_t aligned_size(size_t n)
+{
+    const size_t unit = MATRIX_ALIGNMENT / sizeof(double);
+    return (n + unit - 1) / unit * unit;
+}
+
+// Full spectra of blocks below this order go to dsyev, as fast there as the others
+#define EIGENSOLVER_DSYEV_MAX 64
+// Above this order dsyevd's 2n^2 doubles of workspace are too much; dsyevr is used instead
+#define EIGENSOLVER_DSYEVD_MAX 4096
+// Cached workspace beyond this many doubles (or ints) is freed after each call
+#define EIGENSOLVER_CACHE_MAX (1 << 24)
+
+eigensolver_backend eigensolver_choice = eigensolver_automatic;
+
+// LAPACK workspace of the eigensolver, kept per thread between calls
+double* eigensolver_work = NULL;
+size_t eigensolver_nwork = 0;
+int* eigensolver_iwork = NULL;
+size_t eigensolver_niwork = 0;
+#pragma omp threadprivate(eigensolver_work, eigensolver_nwork, eigensolver_iwork, eigensolver_niwork)
+
+// Eigenvectors and eigenvalues of Matrix::power, kept per thread between calls
+double* power_work = NULL;
+size_t power_nwork = 0;
+#pragma omp threadprivate(power_work, power_nwork)
+
+double* eigensolver_doubles(size_t n)
+{
+    if (n > eigensolver_nwork) {
+        ::free(eigensolver_work);
+        eigensolver_work = (double*)malloc(n * sizeof(double));
+        eigensolver_nwork = eigensolver_work ? n : 0;
+        if (!eigensolver_work)
+            throw PSIEXCEPTION("Matrix::diagonalize: out of memory for the eigensolver workspace.");
+    }
+    return eigensolver_work;
+}
+
+int* eigensolver_ints(size_t n)
+{
+    if (n > eigensolver_niwork) {
+        ::free(eigensolver_iwork);
+        eigensolver_iwork = (int*)malloc(n * sizeof(int));
+        eigensolver_niwork = eigensolver_iwork ? n : 0;
+        if (!eigensolver_iwork)
+            throw PSIEXCEPTION("Matrix::diagonalize: out of memory for the eigensolver workspace.");
+    }
+    return eigensolver_iwork;
+}
+
+double* power_doubles(size_t n)
+{
+    if (n > power_nwork) {
+        ::free(power_work);
+        power_work = (double*)malloc(n * sizeof(double));
+        power_nwork = power_work ? n : 0;
+        if (!power_work)
+            throw PSIEXCEPTION("Matrix::power: out of memory for the eigenvectors.");
+    }
+    return power_work;
+}
+
+void eigensolver_trim()
+{
+    if (eigensolver_nwork > EIGENSOLVER_CACHE_MAX) {
+        ::free(eigensolver_work);
+        eigensolver_work = NULL;
+        eigensolver_nwork = 0;
+    }
+    if (eigensolver_niwork > EIGENSOLVER_CACHE_MAX) {
+        ::free(eigensolver_iwork);
+        eigensolver_iwork = NULL;
+        eigensolver_niwork = 0;
+    }
+}
+
+/*
+ * Eigenpairs of the symmetric n x n row-major block A, which is left intact, ascending into w.
+ * range is 'A' for all of them, 'I' for the lowest count and 'V' for those above vl. With z,
+ * eigenvector k goes to row k of z (z[k * n + i]); z holds n x n doubles for range 'A' and
+ * may be A itself, else n x count ('I') or n x n ('V'). Returns the number of eigenpairs.
+ */
+int symmetric_eigensolve(int n, double* A, double* w, double* z, char range, int count, double vl, const char* caller)
+{
+    eigensolver_backend backend = eigensolver_choice;
+    if (range != 'A')
+        backend = eigensolver_dsyevr;
+    else if (backend == eigensolver_automatic)
+        backend = n < EIGENSOLVER_DSYEV_MAX ? eigensolver_dsyev :
+                  (n <= EIGENSOLVER_DSYEVD_MAX ? eigensolver_dsyevd : eigensolver_dsyevr);
+    const char jobz = z ? 'V' : 'N';
+    const size_t nn = (size_t) n * n;
+    int info = 0;
+    int found = n;
+
+    if (backend == eigensolver_dsyev || backend == eigensolver_dsyevd) {
+        // In place; A is symmetric, so the column-major eigenvectors are the rows of the result
+        double lwork;
+        int liwork = 0;
+        if (backend == eigensolver_dsyev)
+            info = C_DSYEV(jobz, 'U', n, A, n, w, &lwork, -1);
+        else
+            info = C_DSYEVD(jobz, 'U', n, A, n, w, &lwork, -1, &liwork, -1);
+        double* work = eigensolver_doubles((z ? 0 : nn) + (size_t) lwork);
+        double* a = z ? z : work;
+        work += z ? 0 : nn;
+        if (a != A)
+            ::memcpy((void*) a, (void*) A, nn * sizeof(double));
+        if (backend == eigensolver_dsyev)
+            info = C_DSYEV(jobz, 'U', n, a, n, w, work, (int) lwork);
+        else
+            info = C_DSYEVD(jobz, 'U', n, a, n, w, work, (int) lwork, eigensolver_ints(liwork), liwork);
+    }
+    else {
+        const char lrange = range == 'I' && count >= n ? 'A' : range;
+        const double vu = std::numeric_limits<double>::max();
+        double lwork;
+        int liwork;
+        info = C_DSYEVR(jobz, lrange, 'U', n, A, n, vl, vu, 1, count, 0.0, &found, w, z, n,
+                        NULL, &lwork, -1, &liwork, -1);
+        // dsyevr destroys its input, which may also be where the eigenvectors go
+        double* work = eigensolver_doubles(nn + (size_t) lwork);
+        int* iwork = eigensolver_ints(2 * (size_t) n + liwork);
+        ::memcpy((void*) work, (void*) A, nn * sizeof(double));
+        if (info == 0)
+            info = C_DSYEVR(jobz, lrange, 'U', n, work, n, vl, vu, 1, count, 0.0, &found, w, z, n,
+                            iwork, work + nn, (int) lwork, iwork + 2 * n, liwork);
+    }
+
+    eigensolver_trim();
+    if (info != 0)
+        throw PSIEXCEPTION(std::string(caller) + ": LAPACK eigensolver failed, info = " + to_string(info) + ".");
+    return found;
+}
 }
 
 Matrix::Matrix()
 {
     matrix_ = NULL;
+    data_ = NULL;
     rowspi_ = NULL;
     colspi_ = NULL;
     nirrep_ = 0;
@@ -91,7 +240,7 @@ Matrix::Matrix()
 }
 
 Matrix::Matrix(const string& name, int symmetry)
-    : matrix_(0), nirrep_(0),
+    : matrix_(0), data_(0), nirrep_(0),
       name_(name), symmetry_(symmetry)
 {
 }
@@ -100,6 +249,7 @@ Matrix::Matrix(const Matrix& c)
     : rowspi_(c.rowspi_), colspi_(c.colspi_)
 {
     matrix_ = NULL;
+    data_ = NULL;
     nirrep_ = c.nirrep_;
     symmetry_ = c.symmetry_;
     alloc();
@@ -110,6 +260,7 @@ Matrix::Matrix(const SharedMatrix& c)
     : rowspi_(c->rowspi_), colspi_(c->colspi_)
 {
     matrix_ = NULL;
+    data_ = NULL;
     nirrep_ = c->nirrep_;
     symmetry_ = c->symmetry_;
     alloc();
@@ -120,6 +271,7 @@ Matrix::Matrix(const Matrix* c)
     : rowspi_(c->rowspi_), colspi_(c->colspi_)
 {
     matrix_ = NULL;
+    data_ = NULL;
     nirrep_ = c->nirrep_;
     symmetry_ = c->symmetry_;
     alloc();
@@ -130,6 +282,7 @@ Matrix::Matrix(int l_nirreps, const int *l_rowspi, const int *l_colspi, int symm
     : rowspi_(l_nirreps), colspi_(l_nirreps)
 {
     matrix_ = NULL;
+    data_ = NULL;
     nirrep_ = l_nirreps;
     symmetry_ = symmetry;
     rowspi_ = l_rowspi;
@@ -141,6 +294,7 @@ Matrix::Matrix(const string& name, int l_nirreps, const int *l_rowspi, const int
     : name_(name), rowspi_(l_nirreps), colspi_(l_nirreps)
 {
     matrix_ = NULL;
+    data_ = NULL;
     nirrep_ = l_nirreps;
     symmetry_ = symmetry;
     rowspi_ = l_rowspi;
@@ -152,6 +306,7 @@ Matrix::Matrix(const string& name, int rows, int cols)
     : name_(name), rowspi_(1), colspi_(1)
 {
     matrix_ = NULL;
+    data_ = NULL;
     nirrep_ = 1;
     symmetry_ = 0;
     rowspi_[0] = rows;
@@ -163,6 +318,7 @@ Matrix::Matrix(int rows, int cols)
     : rowspi_(1), colspi_(1)
 {
     matrix_ = NULL;
+    data_ = NULL;
     nirrep_ = 1;
     symmetry_ = 0;
     rowspi_[0] = rows;
@@ -174,6 +330,7 @@ Matrix::Matrix(int nirrep, int rows, const int *colspi)
     : rowspi_(nirrep), colspi_(nirrep)
 {
     matrix_ = NULL;
+    data_ = NULL;
     symmetry_ = 0;
     nirrep_ = nirrep;
     for (int i=0; i<nirrep_; ++i) {
@@ -187,6 +344,7 @@ Matrix::Matrix(int nirrep, const int *rowspi, int cols)
     : rowspi_(nirrep), colspi_(nirrep)
 {
     matrix_ = NULL;
+    data_ = NULL;
     symmetry_ = 0;
     nirrep_ = nirrep;
     for (int i=0; i<nirrep_; ++i) {
@@ -200,6 +358,7 @@ Matrix::Matrix(const string& name, const Dimension& rows, const Dimension& cols,
 {
     name_ = name;
     matrix_ = NULL;
+    data_ = NULL;
     symmetry_ = symmetry;
 
     // This will happen in PetiteList::aotoso()
@@ -228,6 +387,7 @@ Matrix::Matrix(const string& name, const Dimension& rows, const Dimension& cols,
 Matrix::Matrix(const Dimension& rows, const Dimension& cols, int symmetry)
 {
     matrix_ = NULL;
+    data_ = NULL;
     symmetry_ = symmetry;
 
     // This will happen in PetiteList::aotoso()
@@ -259,6 +419,7 @@ Matrix::Matrix(dpdfile2 *inFile)
     global_dpd_->file2_mat_init(inFile);
     global_dpd_->file2_mat_rd(inFile);
     matrix_ = NULL;
+    data_ = NULL;
     symmetry_ = inFile->my_irrep;
     nirrep_ = inFile->params->nirreps;
     for (int i=0; i<nirrep_; ++i) {
@@ -275,12 +436,46 @@ Matrix::~Matrix()
     release();
 }
 
+Matrix& Matrix::operator=(const Matrix& other)
+{
+    if (this != &other) {
+        copy(&other);
+        name_ = other.name_;
+    }
+    return *this;
+}
+
+#if __cplusplus >= 201103L
+Matrix::Matrix(Matrix&& other)
+    : matrix_(0), data_(0), nirrep_(0), symmetry_(0)
+{
+    swap(other);
+}
+
+Matrix& Matrix::operator=(Matrix&& other)
+{
+    swap(other);
+    return *this;
+}
+#endif
+
+void Matrix::swap(Matrix& other)
+{
+    std::swap(matrix_, other.matrix_);
+    std::swap(data_, other.data_);
+    std::swap(nirrep_, other.nirrep_);
+    std::swap(rowspi_, other.rowspi_);
+    std::swap(colspi_, other.colspi_);
+    name_.swap(other.name_);
+    std::swap(symmetry_, other.symmetry_);
+}
+
 /// allocate a block matrix -- analogous to libciomr's block_matrix
 double** Matrix::matrix(int nrow, int ncol)
 {
     double** mat = (double**) malloc(sizeof(double*)*nrow);
     const size_t size = sizeof(double)*nrow*ncol;
-    mat[0] = (double*) malloc(size);
+    mat[0] = aligned_doubles((size_t)nrow*ncol);
     ::memset((void *)mat[0], 0, size);
     for(int r=1; r<nrow; ++r) mat[r] = mat[r-1] + ncol;
     return mat;
@@ -528,10 +723,38 @@ void Matrix::alloc()
     if (matrix_)
         release();
 
-    matrix_ = (double***)malloc(sizeof(double***) * nirrep_);
+    size_t size = 0;
     for (int h=0; h<nirrep_; ++h) {
         if (rowspi_[h] != 0 && colspi_[h^symmetry_] != 0)
-            matrix_[h] = Matrix::matrix(rowspi_[h], colspi_[h^symmetry_]);
+            size += aligned_size(rowspi_[h] * (size_t) colspi_[h^symmetry_]);
+    }
+    data_ = aligned_doubles(size);
+    ::memset((void *)data_, 0, size * sizeof(double));
+    assign_row_pointers();
+}
+
+void Matrix::assign_row_pointers()
+{
+    // One allocation for the per-irrep row pointer arrays, after the block pointers
+    ::free(matrix_);
+    size_t nrow = 0;
+    for (int h=0; h<nirrep_; ++h) {
+        if (rowspi_[h] != 0 && colspi_[h^symmetry_] != 0)
+            nrow += rowspi_[h];
+    }
+    matrix_ = (double***)malloc(sizeof(double**) * nirrep_ + sizeof(double*) * nrow);
+
+    double** rows = (double**)(matrix_ + nirrep_);
+    double* block = data_;
+    for (int h=0; h<nirrep_; ++h) {
+        if (rowspi_[h] != 0 && colspi_[h^symmetry_] != 0) {
+            const int ncol = colspi_[h^symmetry_];
+            matrix_[h] = rows;
+            for (int r=0; r<rowspi_[h]; ++r)
+                rows[r] = block + r * (size_t) ncol;
+            rows += rowspi_[h];
+            block += aligned_size(rowspi_[h] * (size_t) ncol);
+        }
         else {
             // Force rowspi_[h] and colspi_[h^symmetry] to hard 0
             // This solves an issue where a row can have 0 dim but a col does not (or the other way).
@@ -550,11 +773,9 @@ void Matrix::release()
     if (!matrix_)
         return;
 
-    for (int h=0; h<nirrep_; ++h) {
-        if (matrix_[h])
-            Matrix::free(matrix_[h]);
-    }
+    ::free(data_);
     ::free(matrix_);
+    data_ = NULL;
     matrix_ = NULL;
 }
 
@@ -1054,7 +1275,31 @@ void Matrix::transpose_this()
             }
         }
         else {
-            throw NotImplementedException();
+            // Rectangular blocks are contiguous, so each is transposed in place by following
+            // the cycles of the permutation k -> k * nrow mod (nrow * ncol - 1)
+            for (h=0; h<nirrep_; ++h) {
+                const size_t nrow = rowspi_[h];
+                const size_t ncol = colspi_[h];
+                const size_t last = nrow * ncol - 1;
+                if (nrow < 2 || ncol < 2)
+                    continue;
+                double* block = matrix_[h][0];
+                std::vector<bool> moved(last + 1, false);
+                for (size_t start=1; start<last; ++start) {
+                    if (moved[start])
+                        continue;
+                    size_t k = start;
+                    double val = block[start];
+                    do {
+                        const size_t next = k * nrow % last;
+                        std::swap(val, block[next]);
+                        moved[k] = true;
+                        k = next;
+                    } while (k != start);
+                }
+            }
+            std::swap(rowspi_, colspi_);
+            assign_row_pointers();
         }
     }
 }
@@ -1106,6 +1351,96 @@ void Matrix::subtract(const SharedMatrix& sub)
     subtract(sub.get());
 }
 
+void Matrix::axpy(double a, const Matrix& X)
+{
+    for (int h=0; h<nirrep_; ++h) {
+        size_t size = rowspi_[h] * (size_t) colspi_[h^symmetry_];
+        if (size)
+            C_DAXPY(size, a, X.matrix_[h][0], 1, matrix_[h][0], 1);
+    }
+}
+
+void Matrix::axpy(double a, const SharedMatrix& X)
+{
+    axpy(a, *X);
+}
+
+void Matrix::linear_combination(double a, const Matrix& A, double b, const Matrix& B)
+{
+    for (int h=0; h<nirrep_; ++h) {
+        size_t size = rowspi_[h] * (size_t) colspi_[h^symmetry_];
+        if (size) {
+            double* lhs = matrix_[h][0];
+            const double* ap = A.matrix_[h][0];
+            const double* bp = B.matrix_[h][0];
+            for (size_t ij=0; ij<size; ++ij)
+                lhs[ij] = a * ap[ij] + b * bp[ij];
+        }
+    }
+}
+
+void Matrix::linear_combination(double a, const SharedMatrix& A, double b, const SharedMatrix& B)
+{
+    linear_combination(a, *A, b, *B);
+}
+
+MatrixSlice Matrix::slice(int h) const
+{
+    return MatrixSlice(matrix_[h] ? matrix_[h][0] : 0, rowspi_[h], colspi_[h^symmetry_], colspi_[h^symmetry_]);
+}
+
+MatrixSlice Matrix::slice(int h, int row, int col, int nrow, int ncol) const
+{
+    return slice(h).block(row, col, nrow, ncol);
+}
+
+MatrixSlice MatrixSlice::block(int row, int col, int nrow, int ncol) const
+{
+    if (row < 0 || col < 0 || nrow < 0 || ncol < 0 || row + nrow > rows_ || col + ncol > cols_)
+        throw PSIEXCEPTION("MatrixSlice::block: Block out of range.");
+    if (!nrow || !ncol)
+        return MatrixSlice(0, nrow, ncol, ld_);
+    return MatrixSlice(data_ + row * ld_ + col, nrow, ncol, ld_);
+}
+
+void MatrixSlice::zero() const
+{
+    for (int i=0; i<rows_; ++i)
+        ::memset((void*)(data_ + i * ld_), 0, cols_ * sizeof(double));
+}
+
+void MatrixSlice::copy(const MatrixSlice& src) const
+{
+    if (rows_ != src.rows_ || cols_ != src.cols_)
+        throw PSIEXCEPTION("MatrixSlice::copy: Shapes do not match.");
+    for (int i=0; i<rows_; ++i)
+        ::memcpy((void*)(data_ + i * ld_), (void*)(src.data_ + i * src.ld_), cols_ * sizeof(double));
+}
+
+void MatrixSlice::scale(double a) const
+{
+    for (int i=0; i<rows_; ++i)
+        C_DSCAL(cols_, a, data_ + i * ld_, 1);
+}
+
+void MatrixSlice::axpy(double a, const MatrixSlice& x) const
+{
+    if (rows_ != x.rows_ || cols_ != x.cols_)
+        throw PSIEXCEPTION("MatrixSlice::axpy: Shapes do not match.");
+    for (int i=0; i<rows_; ++i)
+        C_DAXPY(cols_, a, x.data_ + i * x.ld_, 1, data_ + i * ld_, 1);
+}
+
+double MatrixSlice::vector_dot(const MatrixSlice& x) const
+{
+    if (rows_ != x.rows_ || cols_ != x.cols_)
+        throw PSIEXCEPTION("MatrixSlice::vector_dot: Shapes do not match.");
+    double sum = 0.0;
+    for (int i=0; i<rows_; ++i)
+        sum += C_DDOT(cols_, data_ + i * ld_, 1, x.data_ + i * x.ld_, 1);
+    return sum;
+}
+
 void Matrix::apply_denominator(const Matrix * const plus)
 {
     double *lhs, *rhs;
@@ -1496,16 +1831,14 @@ bool Matrix::add_and_orthogonalize_row(const SharedVector v)
         throw PSIEXCEPTION("Matrix::schmidt_add_and_orthogonalize: Symmetry not allowed (yet).");
     if(v_copy.dimpi()[0] != colspi_[0])
         throw PSIEXCEPTION("Matrix::schmidt_add_and_orthogonalize: Incompatible dimensions.");
-    double **mat = Matrix::matrix(rowspi_[0]+1, colspi_[0]);
-    size_t n = colspi_[0]*rowspi_[0]*sizeof(double);
-    if(n){
-        ::memcpy(mat[0], matrix_[0][0], n);
-        Matrix::free(matrix_[0]);
-    }
-    matrix_[0] = mat;
-    bool ret = schmidt_add_row(0, rowspi_[0], v_copy);
-    rowspi_[0]++;
-    return ret;
+    const int nrow = rowspi_[0];
+    const int nrow_grown = nrow + 1;
+    Matrix grown(name_, 1, &nrow_grown, &colspi_[0]);
+    size_t n = colspi_[0]*nrow*sizeof(double);
+    if(n)
+        ::memcpy(grown.matrix_[0][0], matrix_[0][0], n);
+    swap(grown);
+    return schmidt_add_row(0, nrow, v_copy);
 }
 
 bool Matrix::schmidt_add_row(int h, int rows, Vector& v) throw()
@@ -1667,12 +2000,101 @@ void Matrix::diagonalize(Matrix* eigvectors, Vector* eigvalues, diagonalize_orde
     if (symmetry_) {
         throw PSIEXCEPTION("Matrix::diagonalize: Matrix is non-totally symmetric.");
     }
-    int h;
-    for (h=0; h<nirrep_; ++h) {
-        if (rowspi_[h]) {
-            sq_rsp(rowspi_[h], colspi_[h], matrix_[h], eigvalues->vector_[h], static_cast<int>(nMatz), eigvectors->matrix_[h], 1.0e-14);
+    const bool vectors = nMatz == ascending || nMatz == descending;
+    const bool reverse = nMatz == evals_only_descending || nMatz == descending;
+    for (int h=0; h<nirrep_; ++h) {
+        const int n = rowspi_[h];
+        if (!n)
+            continue;
+        double* e = eigvalues->vector_[h];
+        double** V = vectors ? eigvectors->matrix_[h] : NULL;
+        symmetric_eigensolve(n, matrix_[h][0], e, V ? V[0] : NULL, 'A', n, 0.0, "Matrix::diagonalize");
+
+        if (V) {
+            // Rows to columns, in the requested order
+            for (int i=0; i<n; ++i)
+                for (int j=0; j<i; ++j)
+                    std::swap(V[i][j], V[j][i]);
+        }
+        if (reverse) {
+            for (int k=0; k<n/2; ++k) {
+                std::swap(e[k], e[n-k-1]);
+                if (V) {
+                    for (int i=0; i<n; ++i)
+                        std::swap(V[i][k], V[i][n-k-1]);
+                }
+            }
+        }
+    }
+}
+
+void Matrix::diagonalize_lowest(Matrix* eigvectors, Vector* eigvalues, const Dimension& nlowest)
+{
+    if (symmetry_) {
+        throw PSIEXCEPTION("Matrix::diagonalize_lowest: Matrix is non-totally symmetric.");
+    }
+    for (int h=0; h<nirrep_; ++h) {
+        const int n = rowspi_[h];
+        const int m = std::min(n, (int) nlowest[h]);
+        if (!n || m <= 0)
+            continue;
+        if (eigvectors->colspi_[h] < m)
+            throw PSIEXCEPTION("Matrix::diagonalize_lowest: Not enough eigenvector columns.");
+        // Rows first, then into the leading columns
+        double* z = aligned_doubles((size_t) n * m);
+        symmetric_eigensolve(n, matrix_[h][0], eigvalues->vector_[h], z, 'I', m, 0.0, "Matrix::diagonalize_lowest");
+        double** V = eigvectors->matrix_[h];
+        for (int i=0; i<n; ++i)
+            for (int k=0; k<m; ++k)
+                V[i][k] = z[(size_t) k * n + i];
+        ::free(z);
+    }
+}
+
+void Matrix::diagonalize_lowest(SharedMatrix& eigvectors, boost::shared_ptr<Vector>& eigvalues, const Dimension& nlowest)
+{
+    diagonalize_lowest(eigvectors.get(), eigvalues.get(), nlowest);
+}
+
+Dimension Matrix::diagonalize_above(Matrix* eigvectors, Vector* eigvalues, double cutoff)
+{
+    if (symmetry_) {
+        throw PSIEXCEPTION("Matrix::diagonalize_above: Matrix is non-totally symmetric.");
+    }
+    Dimension found(nirrep_, "Eigenvalues above the cutoff");
+    for (int h=0; h<nirrep_; ++h) {
+        const int n = rowspi_[h];
+        if (!n)
+            continue;
+        double* z = aligned_doubles((size_t) n * n);
+        const int m = symmetric_eigensolve(n, matrix_[h][0], eigvalues->vector_[h], z, 'V', n, cutoff, "Matrix::diagonalize_above");
+        if (eigvectors->colspi_[h] < m) {
+            ::free(z);
+            throw PSIEXCEPTION("Matrix::diagonalize_above: Not enough eigenvector columns.");
         }
+        double** V = eigvectors->matrix_[h];
+        for (int i=0; i<n; ++i)
+            for (int k=0; k<m; ++k)
+                V[i][k] = z[(size_t) k * n + i];
+        ::free(z);
+        found[h] = m;
     }
+    return found;
+}
+
+Dimension Matrix::diagonalize_above(SharedMatrix& eigvectors, boost::shared_ptr<Vector>& eigvalues, double cutoff)
+{
+    return diagonalize_above(eigvectors.get(), eigvalues.get(), cutoff);
+}
+
+void Matrix::set_eigensolver(eigensolver_backend backend)
+{
+    eigensolver_choice = backend;
+}
+
+eigensolver_backend Matrix::eigensolver()
+{
+    return eigensolver_choice;
 }
 
 void Matrix::diagonalize(SharedMatrix& eigvectors, boost::shared_ptr<Vector>& eigvalues, diagonalize_order nMatz)
@@ -2234,7 +2656,8 @@ Dimension Matrix::power(double alpha, double cutoff)
         throw PSIEXCEPTION("Matrix::power: Matrix is non-totally symmetric.");
     }
 
-    Dimension remaining(nirrep_, "Number of remaining orbitals");
+    // Unnamed, so that the result is one allocation (DIIS calls this every iteration)
+    Dimension remaining(nirrep_);
 
     for (int h=0; h<nirrep_; ++h) {
         if (rowspi_[h] == 0) continue;
@@ -2242,23 +2665,16 @@ Dimension Matrix::power(double alpha, double cutoff)
         int n = rowspi_[h];
         double** A = matrix_[h];
 
-        double** A1 = Matrix::matrix(n,n);
-        double** A2 = Matrix::matrix(n,n);
-        double* a  = new double[n];
+        // Eigenvectors, scaled eigenvectors and eigenvalues share one per-thread buffer
+        const size_t nn = (size_t) n * n;
+        double* A1 = power_doubles(2 * nn + n);
+        double* A2 = A1 + nn;
+        double* a  = A2 + nn;
 
-        memcpy(static_cast<void*>(A1[0]), static_cast<void*>(A[0]), sizeof(double)*n*n);
+        // Eigendecomposition, eigenvectors in the rows of A1
+        symmetric_eigensolve(n, A[0], a, A1, 'A', n, 0.0, "Matrix::power");
 
-        // Eigendecomposition
-        double lwork;
-        int stat = C_DSYEV('V','U',n,A1[0],n,a,&lwork,-1);
-        double* work = new double[(int)lwork];
-        stat = C_DSYEV('V','U',n,A1[0],n,a,work,(int)lwork);
-        delete[] work;
-
-        if (stat)
-            throw PSIEXCEPTION("Matrix::power: C_DSYEV failed");
-
-        memcpy(static_cast<void*>(A2[0]), static_cast<void*>(A1[0]), sizeof(double)*n*n);
+        memcpy(static_cast<void*>(A2), static_cast<void*>(A1), sizeof(double)*nn);
 
         double max_a = (fabs(a[n-1]) > fabs(a[0]) ? fabs(a[n-1]) : fabs(a[0]));
         int remain = 0;
@@ -2275,15 +2691,17 @@ Dimension Matrix::power(double alpha, double cutoff)
                 }
             }
 
-            C_DSCAL(n, a[i], A2[i], 1);
+            C_DSCAL(n, a[i], A2 + i * n, 1);
         }
         remaining[h] = remain;
 
-        C_DGEMM('T','N',n,n,n,1.0,A2[0],n,A1[0],n,0.0,A[0],n);
+        C_DGEMM('T','N',n,n,n,1.0,A2,n,A1,n,0.0,A[0],n);
+    }
 
-        delete[] a;
-        Matrix::free(A1);
-        Matrix::free(A2);
+    if (power_nwork > EIGENSOLVER_CACHE_MAX) {
+        ::free(power_work);
+        power_work = NULL;
+        power_nwork = 0;
     }
 
     return remaining;
@@ -2737,12 +3155,8 @@ double Matrix::vector_dot(const Matrix& rhs)
 
 void Matrix::diagonalize(Matrix& eigvectors, Vector& eigvalues, int nMatz)
 {
-    int h;
-    for (h=0; h<nirrep_; ++h) {
-        if (rowspi_[h]) {
-            sq_rsp(rowspi_[h], colspi_[h], matrix_[h], eigvalues.vector_[h], nMatz, eigvectors.matrix_[h], 1.0e-14);
-        }
-    }
+    if (nMatz > 3 || nMatz < 0) nMatz = 0;
+    diagonalize(&eigvectors, &eigvalues, static_cast<diagonalize_order>(nMatz));
 }
 
 void Matrix::write_to_dpdfile2(dpdfile2 *outFile)
@@ -3125,42 +3539,39 @@ void Matrix::load_mpqc(const std::string &filename)
     rowspi_ = Dimension(nirrep_);
     colspi_ = Dimension(nirrep_);
 
-    // We'll handle memory allocation here
-    matrix_ = (double***)malloc(sizeof(double***) * nirrep_);
-
-    // This will hold the index in lines we should be working on
-    size_t nline = 3;
-
-    // Handle each block separately
     regex dim_line("^\\s*(\\d+)\\s*(\\d+)\\s*", regbase::icase);
     regex data_line("^\\s*\\d+\\s*" NUMBER "\\s*" NUMBER "?\\s*" NUMBER "?\\s*");
 
+    // First pass over the dimension lines, so the blocks are allocated like in every other constructor;
+    // each block is its dimension line, a column number line and a line per row for every 3 columns, and a last line
+    size_t nline = 3;
     for (int h=0; h < nirrep_; ++h) {
-
-        // Read dimension line
-        if (regex_match(lines[nline], match, dim_line)) {
+        if (nline < lines.size() && regex_match(lines[nline], match, dim_line)) {
             rowspi_[h] = str_to_int(match[1]);
             colspi_[h ^ symmetry_] = str_to_int(match[2]);
         }
         else
             throw PSIEXCEPTION("Matrix::load_mpqc: Expected to find dimensions.");
+        nline += 2 + ((colspi_[h ^ symmetry_] + 2) / 3) * (size_t)(1 + rowspi_[h]);
+    }
+    alloc();
+
+    // This will hold the index in lines we should be working on
+    nline = 3;
+
+    // Handle each block separately
+    for (int h=0; h < nirrep_; ++h) {
 
         // Done with dimension line
         nline++;
 
-        // Allocate memory
-        if (rowspi_[h] != 0 && colspi_[h^symmetry_] != 0)
-            matrix_[h] = Matrix::matrix(rowspi_[h], colspi_[h^symmetry_]);
-        else
-            matrix_[h] = NULL;
-
         // We read no more than 3 columns at a time
         for (int col=0; col < colspi_[h ^ symmetry_]; col += 3) {
             // skip the next line (contains column numbers, which we ignore)
             nline++;
 
             for (int row=0; row < rowspi_[h]; ++row) {
-                if (regex_match(lines[nline], match, data_line)) {
+                if (nline < lines.size() && regex_match(lines[nline], match, data_line)) {
                     string s1 = match[1];
                     string s2 = match[2];
                     string s3 = match[3];
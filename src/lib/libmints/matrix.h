@@ -64,16 +64,80 @@ enum diagonalize_order {
     descending = 3
 };
 
+/// LAPACK driver behind Matrix::diagonalize and Matrix::power
+enum eigensolver_backend {
+    eigensolver_automatic = 0,  ///< by block size, see Matrix::diagonalize
+    eigensolver_dsyev = 1,      ///< implicit QL/QR
+    eigensolver_dsyevd = 2,     ///< divide and conquer
+    eigensolver_dsyevr = 3      ///< MRRR
+};
+
+/// Byte boundary every irrep block of a Matrix starts on
+#define MATRIX_ALIGNMENT 64
+
+/*! \ingroup MINTS
+ *  \class MatrixSlice
+ *  \brief Non-owning, strided window onto a rectangle of doubles.
+ *
+ *  A slice is a pointer, a shape and a leading dimension (the distance between rows). It never
+ *  allocates, copies or frees, and is only valid while the storage it looks at is alive and not
+ *  reallocated. Matrix::slice hands out slices of an irrep block or a rectangle of one, which can
+ *  be copied into, scaled or accumulated without building a temporary Matrix:
+ *
+ *  \code
+ *  // Occupied columns of C into Cocc, irrep h
+ *  Cocc->slice(h).copy(C->slice(h, 0, 0, nsopi[h], noccpi[h]));
+ *  \endcode
+ */
+class MatrixSlice {
+    double* data_;
+    int rows_;
+    int cols_;
+    size_t ld_;
+
+public:
+    MatrixSlice() : data_(0), rows_(0), cols_(0), ld_(0) {}
+    MatrixSlice(double* data, int rows, int cols, size_t ld) : data_(data), rows_(rows), cols_(cols), ld_(ld) {}
+
+    double* data() const { return data_; }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    /// Distance between the starts of two rows
+    size_t ld() const { return ld_; }
+    /// Whether the rows follow each other without gaps
+    bool contiguous() const { return rows_ <= 1 || ld_ == (size_t)cols_; }
+
+    double* operator[](int i) const { return data_ + i * ld_; }
+    double& operator()(int i, int j) const { return data_[i * ld_ + j]; }
+
+    /// The nrow x ncol rectangle starting at (row, col)
+    MatrixSlice block(int row, int col, int nrow, int ncol) const;
+
+    /// Element-wise operations; the other slice must have the same shape
+    void zero() const;
+    void copy(const MatrixSlice& src) const;
+    void scale(double a) const;
+    /// this += a * x
+    void axpy(double a, const MatrixSlice& x) const;
+    double vector_dot(const MatrixSlice& x) const;
+};
+
 /*! \ingroup MINTS
  *  \class Matrix
  *  \brief Makes using matrices just a little easier.
  *
  * Using a matrix factory makes creating these a breeze.
+ *
+ * All irrep blocks live in one buffer, each block contiguous (row-major) and starting on a
+ * MATRIX_ALIGNMENT boundary; matrix_[h] are the row pointers into block h. swap() and, with
+ * C++11, move construction and assignment hand the buffer over without copying.
  */
 class Matrix : public Serializable {
 protected:
-    /// Matrix data
+    /// Matrix data, row pointers into data_
     double ***matrix_;
+    /// The one aligned buffer holding every irrep block
+    double *data_;
     /// Number of irreps
     int nirrep_;
     /// Rows per irrep array
@@ -89,6 +153,8 @@ protected:
     void alloc();
     /// Release matrix_
     void release();
+    /// Points matrix_ at the blocks of data_ for the current dimensions
+    void assign_row_pointers();
 
     /// Copies data from the passed matrix to this matrix_
     void copy_from(double ***);
@@ -197,6 +263,16 @@ public:
     /// Destructor, frees memory
     ~Matrix();
 
+    /// Deep copy of data, dimensions and name, reusing this storage if the size matches
+    Matrix& operator=(const Matrix& other);
+#if __cplusplus >= 201103L
+    /// Takes over the storage of other, which is left empty
+    Matrix(Matrix&& other);
+    Matrix& operator=(Matrix&& other);
+#endif
+    /// Exchanges storage, dimensions, name and symmetry with other; no data is copied
+    void swap(Matrix& other);
+
     /**
      * Initializes a matrix
      *
@@ -482,6 +558,13 @@ public:
      * @param h Subblock
      * @returns pointer to h-th subblock in block-matrix form
      */
+    /**
+     * Non-owning view of the h-th irrep block, or of its nrow x ncol rectangle starting at
+     * (row, col). Same caveats as pointer(): the slice dies with the storage.
+     */
+    MatrixSlice slice(int h = 0) const;
+    MatrixSlice slice(int h, int row, int col, int nrow, int ncol) const;
+
     double* get_pointer(const int& h = 0) const {
         if(rowspi_[h]*colspi_[h] > 0)
            return &(matrix_[h][0][0]);
@@ -647,7 +730,7 @@ public:
     /// Creates a new matrix which is the transpose of this
     SharedMatrix transpose();
 
-    /// In place transposition
+    /// In place transposition, rectangular blocks included for totally symmetric matrices
     void transpose_this();
 
     /// Adds a matrix to this
@@ -661,6 +744,12 @@ public:
     void subtract(const Matrix* const);
     /// Subtracts a matrix from this
     void subtract(const SharedMatrix&);
+    /// Adds a * X to this
+    void axpy(double a, const Matrix& X);
+    void axpy(double a, const SharedMatrix& X);
+    /// Sets this to a * A + b * B in one pass, without temporaries; this may be A or B
+    void linear_combination(double a, const Matrix& A, double b, const Matrix& B);
+    void linear_combination(double a, const SharedMatrix& A, double b, const SharedMatrix& B);
     /// Multiplies the two arguments and adds their result to this
     void accumulate_product(const Matrix* const, const Matrix* const);
     void accumulate_product(const SharedMatrix&, const SharedMatrix&);
@@ -812,12 +901,35 @@ public:
     /// @}
 
     /// @{
-    /// Diagonalizes this, eigvectors and eigvalues must be created by caller.  Only for symmetric matrices.
+    /**
+     * Diagonalizes this, eigvectors and eigvalues must be created by caller.  Only for symmetric matrices.
+     * Unless set_eigensolver says otherwise, blocks below order 64 use dsyev, larger ones dsyevd
+     * (divide and conquer, several times faster with eigenvectors) and those above order 4096,
+     * where dsyevd needs 2n^2 doubles of workspace, dsyevr (MRRR). LAPACK workspace is cached
+     * per thread between calls.
+     */
     void diagonalize(Matrix* eigvectors, Vector* eigvalues, diagonalize_order nMatz = ascending);
     void diagonalize(SharedMatrix& eigvectors, boost::shared_ptr<Vector>& eigvalues, diagonalize_order nMatz = ascending);
     void diagonalize(SharedMatrix& eigvectors, Vector& eigvalues, diagonalize_order nMatz = ascending);
     /// @}
 
+    /// @{
+    /// The lowest nlowest[h] eigenpairs of each irrep (dsyevr), ascending, in the first columns of
+    /// eigvectors and entries of eigvalues; the other columns and entries are left alone.
+    void diagonalize_lowest(Matrix* eigvectors, Vector* eigvalues, const Dimension& nlowest);
+    void diagonalize_lowest(SharedMatrix& eigvectors, boost::shared_ptr<Vector>& eigvalues, const Dimension& nlowest);
+    /// @}
+
+    /// @{
+    /// As diagonalize_lowest, for the eigenpairs with eigenvalues above cutoff; returns their number per irrep
+    Dimension diagonalize_above(Matrix* eigvectors, Vector* eigvalues, double cutoff);
+    Dimension diagonalize_above(SharedMatrix& eigvectors, boost::shared_ptr<Vector>& eigvalues, double cutoff);
+    /// @}
+
+    /// Forces the LAPACK driver of full diagonalizations (benchmarking); eigensolver_automatic restores the default
+    static void set_eigensolver(eigensolver_backend backend);
+    static eigensolver_backend eigensolver();
+
     /// @{
     /// Diagonalizes this, applying supplied metric, eigvectors and eigvalues must be created by caller.  Only for symmetric matrices.
     void diagonalize(SharedMatrix& metric, SharedMatrix& eigvectors, boost::shared_ptr<Vector>& eigvalues, diagonalize_order nMatz = ascending);
@@ -26,6 +26,8 @@
 #include <cmath>
 #include <sstream>
 #include <vector>
+#include <cstring>
+#include <algorithm>
 
 #include <psifiles.h>
 #include <libpsio/psio.hpp>
@@ -41,27 +43,57 @@
 
 #include <boost/foreach.hpp>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace boost;
 
 namespace psi {
 
 /**
-* IWLWriter functor for use with SO TEIs
+* IWLWriter functor for use with SO TEIs, one per thread
+*
+* Integrals collect in a private buffer of the file's size; a full buffer is
+* appended to the file as one IWL buffer. Only the appends are serialized, so
+* every thread keeps computing while another one writes.
 **/
 class IWLWriter {
     IWL& writeto_;
     size_t count_;
-    int& current_buffer_count_;
+    int current_buffer_count_;
+    int ints_per_buffer_;
+
+    std::vector<Label> labels_;
+    std::vector<Value> values_;
+
+    /// Appends n integrals from labels and values to the file buffer, putting it when full
+    static void append(IWL& writeto, const Label* labels, const Value* values, int n)
+    {
+        int& index = writeto.index();
+        while (n > 0) {
+            int nput = std::min(n, writeto.ints_per_buffer() - index);
+            ::memcpy(writeto.labels() + 4*index, labels, 4*nput*sizeof(Label));
+            ::memcpy(writeto.values() + index, values, nput*sizeof(Value));
+            index += nput;
+            labels += 4*nput;
+            values += nput;
+            n -= nput;
+            if (index == writeto.ints_per_buffer()) {
+                writeto.last_buffer() = 0;
+                writeto.buffer_count() = index;
+                writeto.put();
+                index = 0;
+            }
+        }
+    }
 
-    Label *plabel_;
-    Value *pvalue_;
 public:
 
-    IWLWriter(IWL& writeto) : writeto_(writeto), count_(0),
-        current_buffer_count_(writeto_.index())
+    IWLWriter(IWL& writeto) : writeto_(writeto), count_(0), current_buffer_count_(0),
+        ints_per_buffer_(writeto.ints_per_buffer()),
+        labels_(4*ints_per_buffer_), values_(ints_per_buffer_)
     {
-        plabel_ = writeto_.labels();
-        pvalue_ = writeto_.values();
     }
 
     void operator()(int i, int j, int k, int l, int , int , int , int , int , int , int , int , double value)
@@ -69,29 +101,69 @@ public:
         int current_label_position = 4*current_buffer_count_;
 
         // Save the labels
-        plabel_[current_label_position++] = i;
-        plabel_[current_label_position++] = j;
-        plabel_[current_label_position++] = k;
-        plabel_[current_label_position]   = l;
+        labels_[current_label_position++] = i;
+        labels_[current_label_position++] = j;
+        labels_[current_label_position++] = k;
+        labels_[current_label_position]   = l;
 
         // Save the value
-        pvalue_[current_buffer_count_++] = value;
+        values_[current_buffer_count_++] = value;
 
         // Increment overall counter
         count_++;
 
-        // If our IWL buffer is full dump to disk.
-        if (current_buffer_count_ == writeto_.ints_per_buffer()) {
-            writeto_.last_buffer() = 0;
-            writeto_.buffer_count() = current_buffer_count_;
-            writeto_.put();
+        // If our buffer is full dump to disk.
+        if (current_buffer_count_ == ints_per_buffer_) {
+#pragma omp critical (IWLWriter)
+            append(writeto_, &labels_[0], &values_[0], current_buffer_count_);
             current_buffer_count_ = 0;
         }
     }
 
+    /// Hands what is left in the private buffer to the file buffer; call with no other thread writing
+    void drain()
+    {
+        append(writeto_, &labels_[0], &values_[0], current_buffer_count_);
+        current_buffer_count_ = 0;
+    }
+
     size_t count() const { return count_; }
 };
 
+/**
+* Computes all unique SO integrals of eri into out, over the threads of eri.
+* Shell pairs PQ are dealt out dynamically; with one thread the integrals come
+* in the order of SOShellCombinationsIterator. Returns the number written.
+**/
+static size_t compute_to_iwl(TwoBodySOInt& eri, const boost::shared_ptr<SOBasisSet>& sobasis, IWL& out)
+{
+    std::vector<std::pair<int, int> > PQ;
+    for (int P=0; P<sobasis->nshell(); ++P)
+        for (int Q=0; Q<=P; ++Q)
+            PQ.push_back(std::make_pair(P, Q));
+
+    const int nthread = eri.nthread();
+    std::vector<IWLWriter> writers(nthread, IWLWriter(out));
+
+#pragma omp parallel for schedule(dynamic) num_threads(nthread)
+    for (long int pq=0; pq<(long int)PQ.size(); ++pq) {
+        int thread = 0;
+#ifdef _OPENMP
+        thread = omp_get_thread_num();
+#endif
+        SO_RS_Iterator shellIter(PQ[pq].first, PQ[pq].second, sobasis, sobasis, sobasis, sobasis);
+        for (shellIter.first(); shellIter.is_done() == false; shellIter.next())
+            eri.compute_shell(shellIter.p(), shellIter.q(), shellIter.r(), shellIter.s(), writers[thread], thread);
+    }
+
+    size_t count = 0;
+    for (int thread=0; thread<nthread; ++thread) {
+        writers[thread].drain();
+        count += writers[thread].count();
+    }
+    return count;
+}
+
 
 MintsHelper::MintsHelper(Process::Environment& process_environment_in, boost::shared_ptr<PSIO> psio_in, Options & options, int print)
     : process_environment_(process_environment_in), options_(options), print_(print)
@@ -286,15 +358,11 @@ void MintsHelper::integrals()
 
     // Open the IWL buffer where we will store the integrals.
     IWL ERIOUT(psio_.get(), PSIF_SO_TEI, cutoff_, 0, 0);
-    IWLWriter writer(ERIOUT);
 
     // Let the user know what we're doing.
     fprintf(outfile, "      Computing two-electron integrals..."); fflush(outfile);
 
-    SOShellCombinationsIterator shellIter(sobasis_, sobasis_, sobasis_, sobasis_);
-    for (shellIter.first(); shellIter.is_done() == false; shellIter.next()) {
-        eri->compute_shell(shellIter, writer);
-    }
+    size_t count = compute_to_iwl(*eri, sobasis_, ERIOUT);
 
     // Flush out buffers.
     ERIOUT.flush(1);
@@ -305,7 +373,7 @@ void MintsHelper::integrals()
 
     fprintf(outfile, "done\n");
     fprintf(outfile, "      Computed %lu non-zero two-electron integrals.\n"
-                     "        Stored in file %d.\n\n", writer.count(), PSIF_SO_TEI);
+                     "        Stored in file %d.\n\n", count, PSIF_SO_TEI);
 }
 
 void MintsHelper::integrals_erf(double w)
@@ -313,7 +381,6 @@ void MintsHelper::integrals_erf(double w)
     double omega = (w == -1.0 ? options_.get_double("OMEGA_ERF") : w);
 
     IWL ERIOUT(psio_.get(), PSIF_SO_ERF_TEI, cutoff_, 0, 0);
-    IWLWriter writer(ERIOUT);
 
     // Get ERI object
     std::vector<boost::shared_ptr<TwoBodyAOInt> > tb;
@@ -325,9 +392,7 @@ void MintsHelper::integrals_erf(double w)
     // Let the user know what we're doing.
     fprintf(outfile, "      Computing non-zero ERF integrals (omega = %.3f)...", omega); fflush(outfile);
 
-    SOShellCombinationsIterator shellIter(sobasis_, sobasis_, sobasis_, sobasis_);
-    for (shellIter.first(); shellIter.is_done() == false; shellIter.next())
-        erf->compute_shell(shellIter, writer);
+    size_t count = compute_to_iwl(*erf, sobasis_, ERIOUT);
 
     // Flush the buffers
     ERIOUT.flush(1);
@@ -338,7 +403,7 @@ void MintsHelper::integrals_erf(double w)
 
     fprintf(outfile, "done\n");
     fprintf(outfile, "      Computed %lu non-zero ERF integrals.\n"
-                     "        Stored in file %d.\n\n", writer.count(), PSIF_SO_ERF_TEI);
+                     "        Stored in file %d.\n\n", count, PSIF_SO_ERF_TEI);
 }
 
 void MintsHelper::integrals_erfc(double w)
@@ -346,7 +411,6 @@ void MintsHelper::integrals_erfc(double w)
     double omega = (w == -1.0 ? options_.get_double("OMEGA_ERF") : w);
 
     IWL ERIOUT(psio_.get(), PSIF_SO_ERFC_TEI, cutoff_, 0, 0);
-    IWLWriter writer(ERIOUT);
 
     // Get ERI object
     std::vector<boost::shared_ptr<TwoBodyAOInt> > tb;
@@ -358,9 +422,7 @@ void MintsHelper::integrals_erfc(double w)
     // Let the user know what we're doing.
     fprintf(outfile, "      Computing non-zero ERFComplement integrals..."); fflush(outfile);
 
-    SOShellCombinationsIterator shellIter(sobasis_, sobasis_, sobasis_, sobasis_);
-    for (shellIter.first(); shellIter.is_done() == false; shellIter.next())
-        erf->compute_shell(shellIter, writer);
+    size_t count = compute_to_iwl(*erf, sobasis_, ERIOUT);
 
     // Flush the buffers
     ERIOUT.flush(1);
@@ -371,7 +433,7 @@ void MintsHelper::integrals_erfc(double w)
 
     fprintf(outfile, "done\n");
     fprintf(outfile, "      Computed %lu non-zero ERFComplement integrals.\n"
-                     "        Stored in file %d.\n\n", writer.count(), PSIF_SO_ERFC_TEI);
+                     "        Stored in file %d.\n\n", count, PSIF_SO_ERFC_TEI);
 }
 
 
@@ -23,6 +23,11 @@
 #include <boost/foreach.hpp>
 #include <stdexcept>
 #include <exception.h>
+#include <utility>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "mints.h"
 #include <compiler.h>
@@ -254,48 +259,121 @@ void OneBodyAOInt::compute_shell_deriv1(int sh1, int sh2)
         pure_transform(s1, s2, nchunk_);
 }
 
-void OneBodyAOInt::compute(SharedMatrix& result)
+void OneBodyAOInt::compute_pairs(std::vector<SharedMatrix>& result, int deriv, bool by_center)
 {
     // Do not worry about zeroing out result
     int ns1 = bs1_->nshell();
     int ns2 = bs2_->nshell();
+    bool symmetric = bs1_ == bs2_ && hermitian();
 
-    int i_offset=0;
-    double *location;
+    std::vector<int> offset1(ns1), offset2(ns2);
+    for (int i=0, offset=0; i<ns1; ++i) {
+        offset1[i] = offset;
+        offset += force_cartesian_ ? bs1_->shell(i).ncartesian() : bs1_->shell(i).nfunction();
+    }
+    for (int j=0, offset=0; j<ns2; ++j) {
+        offset2[j] = offset;
+        offset += force_cartesian_ ? bs2_->shell(j).ncartesian() : bs2_->shell(j).nfunction();
+    }
 
-    // Leave as this full double for loop. We could be computing nonsymmetric integrals
+    std::vector<std::pair<int, int> > pairs;
     for (int i=0; i<ns1; ++i) {
-        int ni = force_cartesian_ ? bs1_->shell(i).ncartesian() : bs1_->shell(i).nfunction();
-        int j_offset=0;
-        for (int j=0; j<ns2; ++j) {
-            int nj = force_cartesian_ ? bs2_->shell(j).ncartesian() : bs2_->shell(j).nfunction();
+        for (int j=0; j<(symmetric ? i+1 : ns2); ++j) {
+            if (by_center && bs1_->shell(i).ncenter() == bs2_->shell(j).ncenter())
+                continue;
+            pairs.push_back(std::make_pair(i, j));
+        }
+    }
 
-            // Compute the shell (automatically transforms to pure am in needed)
-            compute_shell(i, j);
+    int nresult = by_center ? 6 : result.size();
+    std::vector<double**> targets(result.size());
+    for (size_t r=0; r<result.size(); ++r)
+        targets[r] = result[r]->pointer(0);
+
+    // This object serves thread 0, clones the others
+    int nthread = 1;
+#ifdef _OPENMP
+    if (cloneable())
+        nthread = std::max(1, std::min(omp_get_max_threads(), (int)pairs.size()));
+#endif
+    std::vector<OneBodyAOInt*> engines(1, this);
+    for (int t=1; t<nthread; ++t)
+        engines.push_back(clone());
+
+    std::string error;
+    #pragma omp parallel for schedule(dynamic) num_threads(nthread)
+    for (long int ij=0; ij<(long int)pairs.size(); ++ij) {
+        int thread = 0;
+#ifdef _OPENMP
+        thread = omp_get_thread_num();
+#endif
+        OneBodyAOInt* engine = engines[thread];
+        int i = pairs[ij].first;
+        int j = pairs[ij].second;
+        int ni = force_cartesian_ ? bs1_->shell(i).ncartesian() : bs1_->shell(i).nfunction();
+        int nj = force_cartesian_ ? bs2_->shell(j).ncartesian() : bs2_->shell(j).nfunction();
+        try {
+            if (deriv == 0)
+                engine->compute_shell(i, j);
+            else if (deriv == 1)
+                engine->compute_shell_deriv1(i, j);
+            else
+                engine->compute_shell_deriv2(i, j);
+        }
+        catch (std::exception& e) {
+            #pragma omp critical
+            error = e.what();
+            continue;
+        }
 
-            // For each integral that we got put in its contribution
-            location = buffer_;
+        // Blocks of different pairs never overlap, mirrors included
+        const double* location = engine->buffer_;
+        for (int r=0; r<nresult; ++r, location += ni*nj) {
+            double** T;
+            if (by_center)
+                T = targets[r < 3 ? 3*bs1_->shell(i).ncenter() + r : 3*bs2_->shell(j).ncenter() + r - 3];
+            else
+                T = targets[r];
             for (int p=0; p<ni; ++p) {
-                for (int q=0; q<nj; ++q) {
-                    result->add(0, i_offset+p, j_offset+q, *location);
-                    location++;
+                double* Tp = T[offset1[i] + p] + offset2[j];
+                const double* row = location + p*nj;
+                if (!symmetric) {
+                    for (int q=0; q<nj; ++q)
+                        Tp[q] += row[q];
+                }
+                else if (i != j) {
+                    for (int q=0; q<nj; ++q) {
+                        Tp[q] += row[q];
+                        T[offset2[j] + q][offset1[i] + p] += row[q];
+                    }
+                }
+                else {
+                    // diagonal block: lower triangle, mirrored, so the result is exactly symmetric
+                    for (int q=0; q<=p; ++q) {
+                        Tp[q] += row[q];
+                        if (q != p)
+                            T[offset2[j] + q][offset1[i] + p] += row[q];
+                    }
                 }
             }
-
-            j_offset += nj;
         }
-        i_offset += ni;
     }
+
+    for (int t=1; t<nthread; ++t)
+        delete engines[t];
+    if (!error.empty())
+        throw PSIEXCEPTION(error);
 }
 
-void OneBodyAOInt::compute(std::vector<SharedMatrix > &result)
+void OneBodyAOInt::compute(SharedMatrix& result)
 {
-    // Do not worry about zeroing out result
-    int ns1 = bs1_->nshell();
-    int ns2 = bs2_->nshell();
-    int i_offset = 0;
-    double *location = 0;
+    // Only the first chunk goes into result
+    std::vector<SharedMatrix> results(1, result);
+    compute_pairs(results, 0);
+}
 
+void OneBodyAOInt::compute(std::vector<SharedMatrix > &result)
+{
     // Check the length of result, must be chunk
     // There not an easy way of checking the size now.
     if (result.size() != nchunk_) {
@@ -310,29 +388,7 @@ void OneBodyAOInt::compute(std::vector<SharedMatrix > &result)
         }
     }
 
-    for (int i=0; i<ns1; ++i) {
-        int ni = force_cartesian_ ? bs1_->shell(i).ncartesian() : bs1_->shell(i).nfunction();
-        int j_offset=0;
-        for (int j=0; j<ns2; ++j) {
-            int nj = force_cartesian_ ? bs2_->shell(j).ncartesian() : bs2_->shell(j).nfunction();
-
-            // Compute the shell
-            compute_shell(i, j);
-
-            // For each integral that we got put in its contribution
-            location = buffer_;
-            for (int r=0; r<nchunk_; ++r) {
-                for (int p=0; p<ni; ++p) {
-                    for (int q=0; q<nj; ++q) {
-                        result[r]->add(0, i_offset+p, j_offset+q, *location);
-                        location++;
-                    }
-                }
-            }
-            j_offset += nj;
-        }
-        i_offset += ni;
-    }
+    compute_pairs(result, 0);
 }
 
 void OneBodyAOInt::compute_deriv1(std::vector<SharedMatrix > &result)
@@ -340,12 +396,6 @@ void OneBodyAOInt::compute_deriv1(std::vector<SharedMatrix > &result)
     if (deriv_ < 1)
         throw SanityCheckError("OneBodyInt::compute_deriv1(result): integral object not created to handle derivatives.", __FILE__, __LINE__);
 
-    // Do not worry about zeroing out result
-    int ns1 = bs1_->nshell();
-    int ns2 = bs2_->nshell();
-    int i_offset = 0;
-    double *location = 0;
-
     // Check the length of result, must be 3*natom_
     if (result.size() != 3*natom_)
         throw SanityCheckError("OneBodyInt::compute_deriv1(result): result must be 3 * natom in length.", __FILE__, __LINE__);
@@ -353,46 +403,8 @@ void OneBodyAOInt::compute_deriv1(std::vector<SharedMatrix > &result)
     if (result[0]->nirrep() != 1)
         throw SanityCheckError("OneBodyInt::compute_deriv1(result): results must be C1 symmetry.", __FILE__, __LINE__);
 
-    for (int i=0; i<ns1; ++i) {
-        int ni = force_cartesian_ ? bs1_->shell(i).ncartesian() : bs1_->shell(i).nfunction();
-        int center_i3 = 3*bs1_->shell(i).ncenter();
-        int j_offset=0;
-        for (int j=0; j<ns2; ++j) {
-            int nj = force_cartesian_ ? bs2_->shell(i).ncartesian() : bs2_->shell(j).nfunction();
-            int center_j3 = 3*bs2_->shell(j).ncenter();
-
-            if (center_i3 != center_j3) {
-
-                // Compute the shell
-                compute_shell_deriv1(i, j);
-
-                // Center i
-                location = buffer_;
-                for (int r=0; r<3; ++r) {
-                    for (int p=0; p<ni; ++p) {
-                        for (int q=0; q<nj; ++q) {
-                            result[center_i3+r]->add(0, i_offset+p, j_offset+q, *location);
-                            location++;
-                        }
-                    }
-                }
-
-                // Center j -- only if center i != center j
-                for (int r=0; r<3; ++r) {
-                    for (int p=0; p<ni; ++p) {
-                        for (int q=0; q<nj; ++q) {
-                            result[center_j3+r]->add(0, i_offset+p, j_offset+q, *location);
-                            location++;
-                        }
-                    }
-                }
-
-            }
-
-            j_offset += nj;
-        }
-        i_offset += ni;
-    }
+    // Center i, then center j -- only if center i != center j
+    compute_pairs(result, 1, true);
 }
 
 void OneBodyAOInt::compute_deriv2(std::vector<SharedMatrix > &result)
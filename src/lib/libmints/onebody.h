@@ -77,6 +77,14 @@ protected:
     /// Normalize Cartesian functions based on angular momentum
     void normalize_am(const GaussianShell&, const GaussianShell&, int nchunk=1);
 
+    /*! Adds the integrals (deriv 0, 1 or 2) of every shell pair into result.
+     *  Chunk r goes to result[r], or with by_center the first three chunks go to the center of
+     *  shell one and the next three to the center of shell two, skipping one-center pairs.
+     *  For a hermitian() operator on one basis set only pairs j <= i are computed and mirrored.
+     *  Pairs are shared among threads, each with its own clone() when cloneable().
+     */
+    void compute_pairs(std::vector<SharedMatrix>& result, int deriv, bool by_center = false);
+
 public:
     virtual ~OneBodyAOInt();
 
@@ -144,6 +152,9 @@ public:
     /// Returns a clone of this object. By default throws an exception.
     virtual OneBodyAOInt* clone();
 
+    /// Whether (i|O|j) = (j|O|i), so that only unique shell pairs are computed on one basis set. By default returns false.
+    virtual bool hermitian() const { return false; }
+
     /// Returns the origin (useful for properties)
     Vector3 origin() const { return origin_; }
 
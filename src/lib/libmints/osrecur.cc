@@ -26,6 +26,7 @@
 #include <libmints/integral.h>
 #include <libmints/wavefunction.h>   // for df
 #include <libmints/osrecur.h>
+#include <libmints/fjt.h>
 #include <exception.h>
 
 using namespace psi;
@@ -194,6 +195,7 @@ ObaraSaikaTwoCenterEFPRecursion::ObaraSaikaTwoCenterEFPRecursion(int max_am1, in
     xzz_ = init_box(size_, size_, max_am1_ + max_am2_ + 3);
     yzz_ = init_box(size_, size_, max_am1_ + max_am2_ + 3);
     xyz_ = init_box(size_, size_, max_am1_ + max_am2_ + 3);
+    F_ = new double[max_am1_ + max_am2_ + 4];
 }
 
 ObaraSaikaTwoCenterEFPRecursion::~ObaraSaikaTwoCenterEFPRecursion()
@@ -218,49 +220,7 @@ ObaraSaikaTwoCenterEFPRecursion::~ObaraSaikaTwoCenterEFPRecursion()
     free_box(xzz_, size_, size_);
     free_box(yzz_, size_, size_);
     free_box(xyz_, size_, size_);
-}
-
-#define EPS 1.0e-17
-
-void ObaraSaikaTwoCenterEFPRecursion::calculate_f(double *F, int n, double t)
-{
-    int i, m, k;
-    int m2;
-    double t2;
-    double num;
-    double sum;
-    double term1, term2;
-    static double K = 1.0/M_2_SQRTPI;
-    double et;
-
-
-    if (t>20.0){
-        t2 = 2*t;
-        et = exp(-t);
-        t = sqrt(t);
-        F[0] = K*erf(t)/t;
-        for(m=0; m<=n-1; m++){
-            F[m+1] = ((2*m + 1)*F[m] - et)/(t2);
-        }
-    }
-    else {
-        et = exp(-t);
-        t2 = 2*t;
-        m2 = 2*n;
-        num = df[m2];
-        i=0;
-        sum = 1.0/(m2+1);
-        do{
-            i++;
-            num = num*t2;
-            term1 = num/df[m2+2*i+2];
-            sum += term1;
-        } while (fabs(term1) > EPS && i < MAX_FAC);
-        F[n] = sum*et;
-        for(m=n-1;m>=0;m--){
-            F[m] = (t2*F[m+1] + et)/(2*m+1);
-        }
-    }
+    delete[] F_;
 }
 
 void ObaraSaikaTwoCenterEFPRecursion::compute(double PA[3], double PB[3], double PC[3], double zeta, int am1, int am2)
@@ -281,13 +241,13 @@ void ObaraSaikaTwoCenterEFPRecursion::compute(double PA[3], double PB[3], double
     double tmp = sqrt(zeta) * M_2_SQRTPI;
     // U from A21
     double u = zeta * (PC[0] * PC[0] + PC[1] * PC[1] + PC[2] * PC[2]);
-    double *F = new double[mmax+1]; // TODO: Move this allocation into constructor
+    double *F = F_;
 
     // Zero out F
     memset(F, 0, sizeof(double) * (mmax+1));
 
     // Form Fm(U) from A20
-    calculate_f(F, mmax, u);
+    BoysFunction::instance().values(mmax, u, F);
 
     // Perform recursion in m for (a|A(0)|s) using A20
     for (m=0; m<=mmax; ++m) {
@@ -810,7 +770,6 @@ void ObaraSaikaTwoCenterEFPRecursion::compute(double PA[3], double PB[3], double
             }
         }
     }
-    delete[] F;
 }
 
 
@@ -922,57 +881,27 @@ ObaraSaikaTwoCenterVIRecursion::ObaraSaikaTwoCenterVIRecursion(int max_am1, int
     size_ += 1;
     size_ = (size_-1)*size_*(size_+1)+1;
     vi_ = init_box(size_, size_, max_am1_ + max_am2_ + 1);
+    F_ = new double[max_am1_ + max_am2_ + 1];
 }
 
 ObaraSaikaTwoCenterVIRecursion::~ObaraSaikaTwoCenterVIRecursion()
 {
     free_box(vi_, size_, size_);
+    delete[] F_;
 }
 
-#define EPS 1.0e-17
-
-void ObaraSaikaTwoCenterVIRecursion::calculate_f(double *F, int n, double t)
+void ObaraSaikaTwoCenterVIRecursion::compute(double PA[3], double PB[3], double PC[3], double zeta, int am1, int am2)
 {
-    int i, m, k;
-    int m2;
-    double t2;
-    double num;
-    double sum;
-    double term1, term2;
-    static double K = 1.0/M_2_SQRTPI;
-    double et;
-
-
-    if (t>20.0){
-        t2 = 2*t;
-        et = exp(-t);
-        t = sqrt(t);
-        F[0] = K*erf(t)/t;
-        for(m=0; m<=n-1; m++){
-            F[m+1] = ((2*m + 1)*F[m] - et)/(t2);
-        }
-    }
-    else {
-        et = exp(-t);
-        t2 = 2*t;
-        m2 = 2*n;
-        num = df[m2];
-        i=0;
-        sum = 1.0/(m2+1);
-        do{
-            i++;
-            num = num*t2;
-            term1 = num/df[m2+2*i+2];
-            sum += term1;
-        } while (fabs(term1) > EPS && i < MAX_FAC);
-        F[n] = sum*et;
-        for(m=n-1;m>=0;m--){
-            F[m] = (t2*F[m+1] + et)/(2*m+1);
-        }
-    }
+    // U from A21
+    double u = zeta * (PC[0] * PC[0] + PC[1] * PC[1] + PC[2] * PC[2]);
+
+    // Form Fm(U) from A20
+    BoysFunction::instance().values(max_am1_ + max_am2_, u, F_);
+
+    compute(PA, PB, PC, zeta, am1, am2, F_);
 }
 
-void ObaraSaikaTwoCenterVIRecursion::compute(double PA[3], double PB[3], double PC[3], double zeta, int am1, int am2)
+void ObaraSaikaTwoCenterVIRecursion::compute(double PA[3], double PB[3], double PC[3], double zeta, int am1, int am2, const double *F)
 {
     int a, b, m;
     int azm = 1;
@@ -988,12 +917,6 @@ void ObaraSaikaTwoCenterVIRecursion::compute(double PA[3], double PB[3], double
 
     // Prefactor from A20
     double tmp = sqrt(zeta) * M_2_SQRTPI;
-    // U from A21
-    double u = zeta * (PC[0] * PC[0] + PC[1] * PC[1] + PC[2] * PC[2]);
-    double *F = new double[mmax+1];
-
-    // Form Fm(U) from A20
-    calculate_f(F, mmax, u);
 
     // Think we're having problems with values being left over.
     //zero_box(vi_, size_, size_, mmax + 1);
@@ -1118,7 +1041,6 @@ void ObaraSaikaTwoCenterVIRecursion::compute(double PA[3], double PB[3], double
         }
     }
 
-    delete[] F;
 
 }
 
@@ -1140,10 +1062,10 @@ void ObaraSaikaTwoCenterVIRecursion::compute_erf(double PA[3], double PB[3], dou
     double tmp = sqrt(zetam) * M_2_SQRTPI;
     // U from A21
     double u = zetam * (PC[0] * PC[0] + PC[1] * PC[1] + PC[2] * PC[2]);
-    double *F = new double[mmax+1];
+    double *F = F_;
 
     // Form Fm(U) from A20
-    calculate_f(F, mmax, u);
+    BoysFunction::instance().values(mmax, u, F);
 
     // Think we're having problems with values being left over.
     //zero_box(vi_, size_, size_, mmax + 1);
@@ -1273,7 +1195,6 @@ void ObaraSaikaTwoCenterVIRecursion::compute_erf(double PA[3], double PB[3], dou
         }
     }
 
-    delete[] F;
 
 }
 
@@ -1310,13 +1231,13 @@ void ObaraSaikaTwoCenterVIDerivRecursion::compute(double PA[3], double PB[3], do
     double tmp = sqrt(zeta) * M_2_SQRTPI;
     // U from A21
     double u = zeta * (PC[0] * PC[0] + PC[1] * PC[1] + PC[2] * PC[2]);
-    double *F = new double[mmax+1];
+    double *F = F_;
 
     // Zero out F
     memset(F, 0, sizeof(double) * (mmax+1));
 
     // Form Fm(U) from A20
-    calculate_f(F, mmax, u);
+    BoysFunction::instance().values(mmax, u, F);
 
     // Perform recursion in m for (a|A(0)|s) using A20
     for (m=0; m<=mmax; ++m) {
@@ -1517,7 +1438,6 @@ void ObaraSaikaTwoCenterVIDerivRecursion::compute(double PA[3], double PB[3], do
             }
         }
     }
-    delete[] F;
 }
 
 ObaraSaikaTwoCenterVIDeriv2Recursion::ObaraSaikaTwoCenterVIDeriv2Recursion(int max_am1, int max_am2)
@@ -1561,13 +1481,13 @@ void ObaraSaikaTwoCenterVIDeriv2Recursion::compute(double PA[3], double PB[3], d
     double tmp = sqrt(zeta) * M_2_SQRTPI;
     // U from A21
     double u = zeta * (PC[0] * PC[0] + PC[1] * PC[1] + PC[2] * PC[2]);
-    double *F = new double[mmax+1]; // TODO: Move this allocation into constructor
+    double *F = F_;
 
     // Zero out F
     memset(F, 0, sizeof(double) * (mmax+1));
 
     // Form Fm(U) from A20
-    calculate_f(F, mmax, u);
+    BoysFunction::instance().values(mmax, u, F);
 
     // Perform recursion in m for (a|A(0)|s) using A20
     for (m=0; m<=mmax; ++m) {
@@ -1899,7 +1819,6 @@ void ObaraSaikaTwoCenterVIDeriv2Recursion::compute(double PA[3], double PB[3], d
             }
         }
     }
-    delete[] F;
 }
 
 ObaraSaikaTwoCenterElectricField::ObaraSaikaTwoCenterElectricField(int max_am1, int max_am2)
@@ -103,8 +103,8 @@ protected:
 
     double ***vi_;
 
-    // Forms Fm(U) from A20 (OS 1986)
-    void calculate_f(double *F, int n, double t);
+    // Fm(U) from A20 (OS 1986), filled by the shared BoysFunction
+    double *F_;
 
 private:
     // No default constructor
@@ -132,8 +132,13 @@ public:
     virtual double ***vyz() const { return 0; }
     virtual double ***vzz() const { return 0; }
 
+    /// Highest order of Fm(U) that compute() needs
+    int max_m() const { return max_am1_ + max_am2_; }
+
     /// Computes the potential integral 3D matrix using the data provided.
     virtual void compute(double PA[3], double PB[3], double PC[3], double zeta, int am1, int am2);
+    /// As compute(), with Fm(U) for 0 <= m <= max_m() already evaluated, e.g. for a batch of charges
+    void compute(double PA[3], double PB[3], double PC[3], double zeta, int am1, int am2, const double *F);
     /// Computes the Ewald potential integral with modified zeta -> zetam 3D matrix using the data provided.
     virtual void compute_erf(double PA[3], double PB[3], double PC[3], double zeta, int am1, int am2, double zetam);
 };
@@ -292,8 +297,8 @@ protected:
     double*** yzz_;
     double*** zzz_;
 
-    // Forms Fm(U) from A20 (OS 1986)
-    void calculate_f(double *F, int n, double t);
+    // Fm(U) from A20 (OS 1986), filled by the shared BoysFunction
+    double *F_;
 
 private:
     // No default constructor
@@ -65,6 +65,14 @@ OverlapInt::~OverlapInt()
     delete[] buffer_;
 }
 
+OneBodyAOInt* OverlapInt::clone()
+{
+    OverlapInt* engine = new OverlapInt(spherical_transforms_, bs1_, bs2_, deriv_);
+    engine->set_force_cartesian(force_cartesian_);
+    engine->set_origin(origin_);
+    return engine;
+}
+
 // The engine only supports segmented basis sets
 void OverlapInt::compute_pair(const GaussianShell& s1, const GaussianShell& s2)
 {
@@ -60,6 +60,12 @@ public:
     bool has_deriv1() { return true; }
     /// Does the method provide second derivatives?
     bool has_deriv2() { return true; }
+
+    /// Engines are independent, so compute() can run one clone per thread
+    bool cloneable() { return true; }
+    OneBodyAOInt* clone();
+    /// The overlap operator is symmetric
+    bool hermitian() const { return true; }
 };
 
 }
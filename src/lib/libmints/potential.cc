@@ -20,6 +20,7 @@
  *@END LICENSE
  */
 
+#include <algorithm>
 #include <libciomr/libciomr.h>
 
 #include "mints.h"
@@ -86,6 +87,15 @@ PotentialInt::~PotentialInt()
     delete potential_recur_;
 }
 
+OneBodyAOInt* PotentialInt::clone()
+{
+    PotentialInt* engine = new PotentialInt(spherical_transforms_, bs1_, bs2_, deriv_);
+    engine->set_force_cartesian(force_cartesian_);
+    engine->set_origin(origin_);
+    engine->set_charge_field(Zxyz_);
+    return engine;
+}
+
 // The engine only supports segmented basis sets
 void PotentialInt::compute_pair(const GaussianShell& s1,
                                 const GaussianShell& s2)
@@ -123,6 +133,11 @@ void PotentialInt::compute_pair(const GaussianShell& s1,
     double** Zxyzp = Zxyz_->pointer();
     int ncharge = Zxyz_->rowspi()[0];
 
+    const int boys_block = 128;
+    int mmax = potential_recur_->max_m();
+    boys_T_.resize(boys_block);
+    boys_F_.resize(boys_block * (mmax + 1));
+
     for (int p1=0; p1<nprim1; ++p1) {
         double a1 = s1.exp(p1);
         double c1 = s1.coef(p1);
@@ -148,8 +163,20 @@ void PotentialInt::compute_pair(const GaussianShell& s1,
             double over_pf = exp(-a1*a2*AB2*oog) * sqrt(M_PI*oog) * M_PI * oog * c1 * c2;
 
             // Loop over atoms of basis set 1 (only works if bs1_ and bs2_ are on the same
-            // molecule)
+            // molecule), evaluating the Boys function for a block of charges at a time
             for (int atom=0; atom<ncharge; ++atom) {
+                int block = atom % boys_block;
+                if (block == 0) {
+                    int nblock = std::min(boys_block, ncharge - atom);
+                    for (int c=0; c<nblock; ++c) {
+                        double PCx = P[0] - Zxyzp[atom+c][1];
+                        double PCy = P[1] - Zxyzp[atom+c][2];
+                        double PCz = P[2] - Zxyzp[atom+c][3];
+                        boys_T_[c] = gamma * (PCx * PCx + PCy * PCy + PCz * PCz);
+                    }
+                    BoysFunction::instance().values(mmax, nblock, &boys_T_[0], &boys_F_[0]);
+                }
+
                 double PC[3];
 
                 double Z = Zxyzp[atom][0];
@@ -159,7 +186,7 @@ void PotentialInt::compute_pair(const GaussianShell& s1,
                 PC[2] = P[2] - Zxyzp[atom][3];
 
                 // Do recursion
-                potential_recur_->compute(PA, PB, PC, gamma, am1, am2);
+                potential_recur_->compute(PA, PB, PC, gamma, am1, am2, &boys_F_[block * (mmax + 1)]);
 
                 ao12 = 0;
                 for(int ii = 0; ii <= am1; ii++) {
@@ -1115,40 +1142,11 @@ void PotentialInt::compute_deriv1(std::vector<SharedMatrix > &result)
     if (deriv_ < 1)
         throw SanityCheckError("PotentialInt::compute_deriv1(result): integral object not created to handle derivatives.", __FILE__, __LINE__);
 
-    // Do not worry about zeroing out result
-    int ns1 = bs1_->nshell();
-    int ns2 = bs2_->nshell();
-    int result_size = result.size();
-    int i_offset = 0;
-    double *location = 0;
-
     // Check the length of result, must be 3*natom_
     if (result.size() != 3*natom_)
         throw SanityCheckError("PotentialInt::compute_deriv1(result): result must be 3 * natom in length.", __FILE__, __LINE__);
 
-    for (int i=0; i<ns1; ++i) {
-        int ni = force_cartesian_ ? bs1_->shell(i).ncartesian() : bs1_->shell(i).nfunction();
-        int j_offset=0;
-        for (int j=0; j<ns2; ++j) {
-            int nj = force_cartesian_ ? bs2_->shell(j).ncartesian() : bs2_->shell(j).nfunction();
-
-            // Compute the shell
-            compute_shell_deriv1(i, j);
-
-            // For each integral that we got put in its contribution
-            location = buffer_;
-            for (int r=0; r<result_size; ++r) {
-                for (int p=0; p<ni; ++p) {
-                    for (int q=0; q<nj; ++q) {
-                        result[r]->add(0, i_offset+p, j_offset+q, *location);
-                        location++;
-                    }
-                }
-            }
-            j_offset += nj;
-        }
-        i_offset += ni;
-    }
+    compute_pairs(result, 1);
 }
 
 void PotentialInt::compute_deriv2(std::vector<SharedMatrix > &result)
@@ -1156,40 +1154,11 @@ void PotentialInt::compute_deriv2(std::vector<SharedMatrix > &result)
     if (deriv_ < 1)
         throw SanityCheckError("PotentialInt::compute_deriv2(result): integral object not created to handle derivatives.", __FILE__, __LINE__);
 
-    // Do not worry about zeroing out result
-    int ns1 = bs1_->nshell();
-    int ns2 = bs2_->nshell();
-    int result_size = result.size();
-    int i_offset = 0;
-    double *location = 0;
-
     // Check the length of result, must be 3*natom_
     if (result.size() != 3*3*natom_*natom_)
         throw SanityCheckError("PotentialInt::compute_deriv2(result): result must be 9 * natom^2 in length.", __FILE__, __LINE__);
 
-    for (int i=0; i<ns1; ++i) {
-        int ni = force_cartesian_ ? bs1_->shell(i).ncartesian() : bs1_->shell(i).nfunction();
-        int j_offset=0;
-        for (int j=0; j<ns2; ++j) {
-            int nj = force_cartesian_ ? bs2_->shell(j).ncartesian() : bs2_->shell(j).nfunction();
-
-            // Compute the shell
-            compute_shell_deriv2(i, j);
-
-            // For each integral that we got put in its contribution
-            location = buffer_;
-            for (int r=0; r<result_size; ++r) {
-                for (int p=0; p<ni; ++p) {
-                    for (int q=0; q<nj; ++q) {
-                        result[r]->add(0, i_offset+p, j_offset+q, *location);
-                        location++;
-                    }
-                }
-            }
-            j_offset += nj;
-        }
-        i_offset += ni;
-    }
+    compute_pairs(result, 2);
 }
 
 PotentialSOInt::PotentialSOInt(const boost::shared_ptr<OneBodyAOInt> &aoint, const boost::shared_ptr<IntegralFactory> &fact)
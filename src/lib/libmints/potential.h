@@ -60,6 +60,10 @@ protected:
     /// Matrix of coordinates/charges of partial charges
     SharedMatrix Zxyz_;
 
+    /// Boys function arguments and values for a block of charges
+    std::vector<double> boys_T_;
+    std::vector<double> boys_F_;
+
 public:
     /// Constructor. Assumes nuclear centers/charges as the potential
     PotentialInt(std::vector<SphericalTransform>&, boost::shared_ptr<BasisSet>, boost::shared_ptr<BasisSet>, int deriv=0);
@@ -79,6 +83,12 @@ public:
 
     /// Does the method provide first derivatives?
     bool has_deriv1() { return true; }
+
+    /// Engines are independent, so compute() can run one clone per thread
+    bool cloneable() { return true; }
+    OneBodyAOInt* clone();
+    /// The potential operator is symmetric
+    bool hermitian() const { return true; }
 };
 
 class PotentialSOInt : public OneBodySOInt
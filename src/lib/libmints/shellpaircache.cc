@@ -0,0 +1,213 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * PSI4: an ab initio quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *@END LICENSE
+ */
+
+#include <cmath>
+#include <boost/weak_ptr.hpp>
+
+#include "mints.h"
+#include "shellpaircache.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace boost;
+using namespace psi;
+
+namespace {
+
+// Caches alive in the process; the engines own them, this only finds them again
+std::vector<weak_ptr<const ShellPairCache> > live_caches;
+
+}
+
+std::vector<Vector3> ShellPairCache::shell_centers(const shared_ptr<BasisSet>& basis1, const shared_ptr<BasisSet>& basis2)
+{
+    std::vector<Vector3> centers;
+    centers.reserve(basis1->nshell() + basis2->nshell());
+    for (int i=0; i<basis1->nshell(); ++i)
+        centers.push_back(basis1->shell(i).center());
+    for (int j=0; j<basis2->nshell(); ++j)
+        centers.push_back(basis2->shell(j).center());
+    return centers;
+}
+
+shared_ptr<const ShellPairCache> ShellPairCache::get(const shared_ptr<BasisSet>& basis1,
+                                                     const shared_ptr<BasisSet>& basis2,
+                                                     double cutoff)
+{
+    shared_ptr<const ShellPairCache> cache;
+
+    // Engines are created from several threads at once
+#pragma omp critical (ShellPairCache)
+    {
+        std::vector<Vector3> centers = shell_centers(basis1, basis2);
+
+        std::vector<weak_ptr<const ShellPairCache> > alive;
+        for (size_t k=0; k<live_caches.size(); ++k) {
+            shared_ptr<const ShellPairCache> c = live_caches[k].lock();
+            if (!c)
+                continue;
+            alive.push_back(c);
+            if (!cache && c->basis1_ == basis1 && c->basis2_ == basis2 && c->cutoff_ == cutoff
+                    && c->centers_.size() == centers.size()) {
+                bool same = true;
+                for (size_t s=0; s<centers.size() && same; ++s)
+                    same = c->centers_[s][0] == centers[s][0] && c->centers_[s][1] == centers[s][1]
+                        && c->centers_[s][2] == centers[s][2];
+                if (same)
+                    cache = c;
+            }
+        }
+
+        if (!cache) {
+            cache = shared_ptr<const ShellPairCache>(new ShellPairCache(basis1, basis2, cutoff));
+            alive.push_back(cache);
+        }
+        live_caches.swap(alive);
+    }
+
+    return cache;
+}
+
+ShellPairCache::ShellPairCache(const shared_ptr<BasisSet>& basis1, const shared_ptr<BasisSet>& basis2, double cutoff)
+    : basis1_(basis1), basis2_(basis2), centers_(shell_centers(basis1, basis2)), cutoff_(cutoff),
+      nshell2_(basis2->nshell()), nscreened_(0)
+{
+    const int nshell1 = basis1_->nshell();
+    const size_t npair = (size_t)nshell1 * nshell2_;
+
+    // Where each pair's data goes, so the pairs can be filled independently
+    std::vector<size_t> stack_offsets(npair + 1), row_offsets(npair + 1), row3_offsets(npair + 1);
+    primitive_offsets_.resize(npair + 1);
+    stack_offsets[0] = row_offsets[0] = row3_offsets[0] = primitive_offsets_[0] = 0;
+    for (int si=0; si<nshell1; ++si) {
+        const size_t np_i = basis1_->shell(si).nprimitive();
+        for (int sj=0; sj<nshell2_; ++sj) {
+            const size_t np_j = basis2_->shell(sj).nprimitive();
+            const size_t ij = (size_t)si * nshell2_ + sj;
+            stack_offsets[ij+1] = stack_offsets[ij] + 2*(np_i + np_j) + 11*np_i*np_j;
+            row_offsets[ij+1] = row_offsets[ij] + 2*np_i + 3*np_i*np_j;
+            row3_offsets[ij+1] = row3_offsets[ij] + 3*np_i;
+            primitive_offsets_[ij+1] = primitive_offsets_[ij] + np_i*np_j;
+        }
+    }
+    pairs_.resize(npair);
+    stack_.resize(stack_offsets[npair]);
+    rows_.resize(row_offsets[npair]);
+    rows3_.resize(row3_offsets[npair]);
+    primitive_pairs_.resize(primitive_offsets_[npair]);
+    nprimitive_pairs_.resize(npair);
+
+    size_t nscreened = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+:nscreened)
+    for (long int ij=0; ij<(long int)npair; ++ij) {
+        const int si = ij / nshell2_;
+        const int sj = ij % nshell2_;
+        const GaussianShell& s1 = basis1_->shell(si);
+        const GaussianShell& s2 = basis2_->shell(sj);
+        const int np_i = s1.nprimitive();
+        const int np_j = s2.nprimitive();
+        const Vector3 A = s1.center();
+        const Vector3 B = s2.center();
+        const Vector3 AB = A - B;
+        const double ab2 = AB.dot(AB);
+
+        ShellPair* sp = &pairs_[ij];
+        double* stack = &stack_[stack_offsets[ij]];
+        double** rows = &rows_[row_offsets[ij]];
+        double*** rows3 = &rows3_[row3_offsets[ij]];
+
+        sp->i = si;
+        sp->j = sj;
+        sp->AB[0] = AB[0]; sp->AB[1] = AB[1]; sp->AB[2] = AB[2];
+
+        sp->ai = stack; stack += np_i;
+        sp->aj = stack; stack += np_j;
+        sp->ci = stack; stack += np_i;
+        sp->cj = stack; stack += np_j;
+        sp->gamma = rows; rows += np_i;
+        sp->overlap = rows; rows += np_i;
+        sp->P = rows3; rows3 += np_i;
+        sp->PA = rows3; rows3 += np_i;
+        sp->PB = rows3; rows3 += np_i;
+        for (int i=0; i<np_i; ++i) {
+            sp->gamma[i] = stack; stack += np_j;
+            sp->overlap[i] = stack; stack += np_j;
+            sp->P[i] = rows; rows += np_j;
+            sp->PA[i] = rows; rows += np_j;
+            sp->PB[i] = rows; rows += np_j;
+            for (int j=0; j<np_j; ++j) {
+                sp->P[i][j] = stack; stack += 3;
+                sp->PA[i][j] = stack; stack += 3;
+                sp->PB[i][j] = stack; stack += 3;
+            }
+        }
+
+        ERIPrimitivePair* prim = &primitive_pairs_[primitive_offsets_[ij]];
+        int nprim = 0;
+        for (int i=0; i<np_i; ++i) {
+            const double a1 = s1.exp(i);
+            const double c1 = s1.coef(i);
+            sp->ai[i] = a1;
+            sp->ci[i] = c1;
+
+            for (int j=0; j<np_j; ++j) {
+                const double a2 = s2.exp(j);
+                const double c2 = s2.coef(j);
+                const double gam = a1 + a2;
+
+                // Gaussian product and component distances
+                const Vector3 P = (A * a1 + B * a2) / gam;
+                const Vector3 PA = P - A;
+                const Vector3 PB = P - B;
+                double overlap = std::pow(M_PI/gam, 3.0/2.0) * std::exp(-a1*a2*ab2/gam) * c1 * c2;
+
+                sp->aj[j] = a2;
+                sp->cj[j] = c2;
+                sp->gamma[i][j] = gam;
+                for (int k=0; k<3; ++k) {
+                    sp->P[i][j][k] = P[k];
+                    sp->PA[i][j][k] = PA[k];
+                    sp->PB[i][j][k] = PB[k];
+                }
+
+                if (std::fabs(overlap) < cutoff_) {
+                    overlap = 0.0;
+                    ++nscreened;
+                }
+                else {
+                    prim[nprim].zeta = gam;
+                    prim[nprim].K = overlap;
+                    for (int k=0; k<3; ++k) {
+                        prim[nprim].P[k] = P[k];
+                        prim[nprim].PA[k] = PA[k];
+                    }
+                    ++nprim;
+                }
+                sp->overlap[i][j] = overlap;
+            }
+        }
+        nprimitive_pairs_[ij] = nprim;
+    }
+    nscreened_ = nscreened;
+}
@@ -0,0 +1,126 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * PSI4: an ab initio quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *@END LICENSE
+ */
+
+#ifndef _psi_src_lib_libmints_shellpaircache_h
+#define _psi_src_lib_libmints_shellpaircache_h
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "eri_lowam.h"
+#include "vector3.h"
+
+namespace psi {
+
+class BasisSet;
+
+/// Primitive pairs whose Gaussian product prefactor |c1 c2 (pi/zeta)^(3/2) exp(-a1 a2 |AB|^2 / zeta)| is below this are dropped
+#define SHELL_PAIR_PRIMITIVE_CUTOFF 1.0E-15
+
+/**
+  * \ingroup MINTS
+  * Structure to hold precomputed shell pair information
+  */
+typedef struct ShellPair_typ {
+    //! Shells for this information.
+    int i, j;
+    //! Matrix over primitives with x, y, z coordinate of average Gaussian
+    double *** restrict P;
+    //! Distance between shell i and shell j centers
+    double AB[3];
+    //! Distance between P and shell i center
+    double *** restrict PA;
+    //! Distance between P and shell j center
+    double *** restrict PB;
+    //! Array of alphas for both centers
+    double * restrict ai, * restrict aj;
+    //! Array of the gammas (ai + aj)
+    double ** restrict gamma;
+    //! Contraction coefficients
+    double * restrict ci, * restrict cj;
+    //! Overlap between primitives on i and j, zero for screened primitive pairs
+    double ** restrict overlap;
+} ShellPair;
+
+/*! \ingroup MINTS
+ *  \class ShellPairCache
+ *  \brief Immutable primitive pair data of all shell pairs of two basis sets.
+ *
+ *  The data is built once, in parallel over shell pairs, and shared read-only by every two-electron
+ *  engine (and every thread) on the same basis sets and geometry: get() returns the cache already
+ *  alive for the pair, building it only when there is none. A cache lives as long as an engine
+ *  holds it.
+ *
+ *  Each shell pair has both the ShellPair layout used with libint and libderiv and a compact list
+ *  of ERIPrimitivePair for the low angular momentum kernels. Primitive pairs whose Gaussian product
+ *  prefactor is below the cutoff are screened: their overlap is zero in the ShellPair and they are
+ *  left out of the list.
+ */
+class ShellPairCache {
+    boost::shared_ptr<BasisSet> basis1_, basis2_;
+    //! Shell centers the data was built for, the geometry part of the key
+    std::vector<Vector3> centers_;
+    double cutoff_;
+    int nshell2_;
+
+    //! ShellPair of shells (i, j) at i * nshell2 + j, their doubles and row pointers
+    std::vector<ShellPair> pairs_;
+    std::vector<double> stack_;
+    std::vector<double*> rows_;
+    std::vector<double**> rows3_;
+
+    //! Primitive pairs of (i, j) that pass the cutoff, from primitive_pairs_[primitive_offsets_[i * nshell2 + j]]
+    std::vector<ERIPrimitivePair> primitive_pairs_;
+    std::vector<size_t> primitive_offsets_;
+    std::vector<int> nprimitive_pairs_;
+    size_t nscreened_;
+
+    ShellPairCache(const boost::shared_ptr<BasisSet>& basis1, const boost::shared_ptr<BasisSet>& basis2, double cutoff);
+    // No copy constructor or assignment
+    ShellPairCache(const ShellPairCache&);
+    ShellPairCache& operator=(const ShellPairCache&);
+
+    static std::vector<Vector3> shell_centers(const boost::shared_ptr<BasisSet>& basis1, const boost::shared_ptr<BasisSet>& basis2);
+
+public:
+    /// The cache of basis1 x basis2 at their current geometry and the cutoff, built if none is alive
+    static boost::shared_ptr<const ShellPairCache> get(const boost::shared_ptr<BasisSet>& basis1,
+                                                       const boost::shared_ptr<BasisSet>& basis2,
+                                                       double cutoff = SHELL_PAIR_PRIMITIVE_CUTOFF);
+
+    const boost::shared_ptr<BasisSet>& basis1() const { return basis1_; }
+    const boost::shared_ptr<BasisSet>& basis2() const { return basis2_; }
+    double cutoff() const { return cutoff_; }
+
+    /// ShellPair of shell i of basis1 and shell j of basis2
+    const ShellPair* pair(int i, int j) const { return &pairs_[(size_t)i * nshell2_ + j]; }
+
+    /// Primitive pairs of shells i and j that pass the cutoff, in the order of eri_primitive_pairs
+    const ERIPrimitivePair* primitive_pairs(int i, int j) const { return &primitive_pairs_[primitive_offsets_[(size_t)i * nshell2_ + j]]; }
+    int nprimitive_pair(int i, int j) const { return nprimitive_pairs_[(size_t)i * nshell2_ + j]; }
+
+    /// Number of primitive pairs screened out
+    size_t nscreened() const { return nscreened_; }
+};
+
+}
+
+#endif
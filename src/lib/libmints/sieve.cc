@@ -25,6 +25,10 @@
 #include <psi4-dec.h>
 #include "sieve.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 using namespace psi;
 
@@ -43,6 +47,7 @@ ERISieve::~ERISieve()
 void ERISieve::common_init()
 {
     debug_ = 0;
+    qqr_ = false;
 
     integrals();
     set_sieve(sieve_);
@@ -195,35 +200,116 @@ void ERISieve::integrals()
     ::memset((void*) shell_pair_values_, '\0', sizeof(double) * nshell * nshell);
     max_ = 0.0;
 
+    pair_centers_.resize(3L * nshell * nshell);
+    pair_extents_.resize(nshell * (unsigned long int) nshell);
+    pair_radii_.resize(nshell * (unsigned long int) nshell);
+    shell_density_.assign(nshell * (unsigned long int) nshell, 0.0);
+
+    int nthread = 1;
+    #ifdef _OPENMP
+        nthread = omp_get_max_threads();
+    #endif
+
     IntegralFactory schwarzfactory(primary_,primary_,primary_,primary_);
-    boost::shared_ptr<TwoBodyAOInt> eri = boost::shared_ptr<TwoBodyAOInt>(schwarzfactory.eri());
-    const double *buffer = eri->buffer();
-
-    int MU, NU, mu, nu,omu,onu, nummu, numnu, index;
-    for (MU=0; MU < nshell; ++MU) {
-        nummu = primary_->shell(MU).nfunction();
-        for (NU=0; NU <= MU; ++NU) {
-            numnu = primary_->shell(NU).nfunction();
-            eri->compute_shell(MU,NU,MU,NU);
-            for (mu=0; mu < nummu; ++mu) {
-                omu = primary_->shell(MU).function_index() + mu;
-                for (nu=0; nu < numnu; ++nu) {
-                    onu = primary_->shell(NU).function_index() + nu;
-
-                    if (omu>=onu) {
-                        index = mu*(numnu*nummu*numnu+numnu)+nu*(nummu*numnu+1);
-                        if (max_ < fabs(buffer[index]))
-                            max_ = fabs(buffer[index]);
-                        if (shell_pair_values_[MU * (unsigned long int) nshell + NU] < fabs(buffer[index])) {
-                            shell_pair_values_[MU * (unsigned long int) nshell + NU] = fabs(buffer[index]);
-                            shell_pair_values_[NU * (unsigned long int) nshell + MU] = fabs(buffer[index]);
-                        }
-                        if (function_pair_values_[omu * (unsigned long int) nbf + onu] < fabs(buffer[index])) {
-                            function_pair_values_[omu * (unsigned long int) nbf + onu] = fabs(buffer[index]);
-                            function_pair_values_[onu * (unsigned long int) nbf + omu] = fabs(buffer[index]);
-                        }
+    std::vector<boost::shared_ptr<TwoBodyAOInt> > eri;
+    for (int thread = 0; thread < nthread; thread++) {
+        eri.push_back(boost::shared_ptr<TwoBodyAOInt>(schwarzfactory.eri()));
+    }
+
+    // Each (MN|MN) writes only the MN and NM entries, so the shell pairs are spread over threads
+    unsigned long int npair = nshell * (nshell + 1L) / 2L;
+    #pragma omp parallel for num_threads(nthread) schedule(dynamic)
+    for (long int MUNU = 0L; MUNU < (long int) npair; MUNU++) {
+        int MU = (int)((std::sqrt(8.0 * MUNU + 1.0) - 1.0) / 2.0);
+        while (MU * (MU + 1L) / 2L > MUNU) MU--;
+        while ((MU + 1L) * (MU + 2L) / 2L <= MUNU) MU++;
+        int NU = MUNU - MU * (MU + 1L) / 2L;
+
+        int thread = 0;
+        #ifdef _OPENMP
+            thread = omp_get_thread_num();
+        #endif
+
+        const GaussianShell& M = primary_->shell(MU);
+        const GaussianShell& N = primary_->shell(NU);
+        int nummu = M.nfunction();
+        int numnu = N.nfunction();
+        const double *buffer = eri[thread]->buffer();
+        eri[thread]->compute_shell(MU,NU,MU,NU);
+
+        double pair_max = 0.0;
+        for (int mu=0; mu < nummu; ++mu) {
+            int omu = M.function_index() + mu;
+            for (int nu=0; nu < numnu; ++nu) {
+                int onu = N.function_index() + nu;
+
+                if (omu>=onu) {
+                    int index = mu*(numnu*nummu*numnu+numnu)+nu*(nummu*numnu+1);
+                    double value = fabs(buffer[index]);
+                    if (pair_max < value)
+                        pair_max = value;
+                    if (function_pair_values_[omu * (unsigned long int) nbf + onu] < value) {
+                        function_pair_values_[omu * (unsigned long int) nbf + onu] = value;
+                        function_pair_values_[onu * (unsigned long int) nbf + omu] = value;
+                    }
+                }
+            }
+        }
+        shell_pair_values_[MU * (unsigned long int) nshell + NU] = pair_max;
+        shell_pair_values_[NU * (unsigned long int) nshell + MU] = pair_max;
+
+        // QQR geometry: the most diffuse primitive product and the sphere holding all of them
+        int amin = 0, bmin = 0;
+        for (int a = 1; a < M.nprimitive(); a++)
+            if (M.exp(a) < M.exp(amin)) amin = a;
+        for (int b = 1; b < N.nprimitive(); b++)
+            if (N.exp(b) < N.exp(bmin)) bmin = b;
+        double pmin = M.exp(amin) + N.exp(bmin);
+        Vector3 P = (M.center() * M.exp(amin) + N.center() * N.exp(bmin)) / pmin;
+        double extent = 0.0;
+        for (int a = 0; a < M.nprimitive(); a++) {
+            for (int b = 0; b < N.nprimitive(); b++) {
+                double p = M.exp(a) + N.exp(b);
+                Vector3 Pab = (M.center() * M.exp(a) + N.center() * N.exp(b)) / p;
+                double ext = P.distance(Pab) + SIEVE_QQR_EXTENT / std::sqrt(p);
+                if (extent < ext) extent = ext;
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            pair_centers_[3L * (MU * (unsigned long int) nshell + NU) + k] = P[k];
+            pair_centers_[3L * (NU * (unsigned long int) nshell + MU) + k] = P[k];
+        }
+        pair_extents_[MU * (unsigned long int) nshell + NU] = extent;
+        pair_extents_[NU * (unsigned long int) nshell + MU] = extent;
+        double radius = std::sqrt(M_PI / (2.0 * pmin) * (1.0 + 0.4 * (M.am() + N.am())));
+        pair_radii_[MU * (unsigned long int) nshell + NU] = radius;
+        pair_radii_[NU * (unsigned long int) nshell + MU] = radius;
+    }
+
+    for (unsigned long int MN = 0L; MN < nshell * (unsigned long int) nshell; MN++) {
+        if (max_ < shell_pair_values_[MN])
+            max_ = shell_pair_values_[MN];
+    }
+}
+void ERISieve::set_density(const std::vector<boost::shared_ptr<Matrix> >& D)
+{
+    shell_density_.assign(nshell_ * (unsigned long int) nshell_, 0.0);
+    for (size_t ind = 0; ind < D.size(); ind++) {
+        double** Dp = D[ind]->pointer();
+        for (int M = 0; M < nshell_; M++) {
+            int mstart = primary_->shell(M).function_index();
+            int nm = primary_->shell(M).nfunction();
+            for (int N = 0; N < nshell_; N++) {
+                int nstart = primary_->shell(N).function_index();
+                int nn = primary_->shell(N).nfunction();
+                double value = shell_density_[M * (unsigned long int) nshell_ + N];
+                for (int m = mstart; m < mstart + nm; m++) {
+                    for (int n = nstart; n < nstart + nn; n++) {
+                        if (value < fabs(Dp[m][n])) value = fabs(Dp[m][n]);
+                        if (value < fabs(Dp[n][m])) value = fabs(Dp[n][m]);
                     }
                 }
+                shell_density_[M * (unsigned long int) nshell_ + N] = value;
             }
         }
     }
@@ -23,6 +23,9 @@
 #ifndef SIEVE_H 
 #define SIEVE_H
 
+#include <vector>
+#include <cmath>
+
 namespace boost {
 template<class T> class shared_ptr;
 }
@@ -31,6 +34,10 @@ namespace psi {
 
 class BasisSet;
 class TwoBodyAOInt;
+class Matrix;
+
+/// erfc^-1(1e-10): a shell pair's charge distribution is taken to end this many 1/sqrt(p) past its centers
+#define SIEVE_QQR_EXTENT 4.572824967389485
 
 /**
  * ERISieve
@@ -80,8 +87,24 @@ class TwoBodyAOInt;
  *     } else {
  *         // The shell pair is the MNreduced significant shell pair
  *     }  
+ *
+ *     // Tighten the quartet bounds of far-apart pairs with their distance (QQR)
+ *     sieve->set_qqr(true);
+ *
+ *     // Weight the quartet bounds with the density blocks a J/K build contracts them with
+ *     sieve->set_density(D);
+ *     if (sieve->shell_significant_density(M,N,R,S)) eri->compute(M,N,R,S);
  *       
  *
+ *  With QQR, a shell pair MN is also described by the product center P of its most diffuse
+ *  primitives, exponent p, its extent ext (every primitive product fits in a sphere of
+ *  radius ext around P, out to erfc(x) = 1e-10) and the monopole radius r, for which
+ *  (MN|MN) >= q^2 / r with q the charge of the distribution. For an s distribution
+ *  r = sqrt(pi / 2p); a distribution r^L exp(-p r^2) spreads further, which
+ *  r = sqrt(pi (1 + 0.4 L) / 2p), L = l_M + l_N, bounds. Past the extents, at
+ *  R' = |P_MN - P_RS| - ext_MN - ext_RS > 0, the Schwarz bound is scaled by
+ *  min(1, sqrt(r_MN r_RS) / R'), the ratio of the monopole interaction q q' / R' to it.
+ *
  */
 class ERISieve {
 
@@ -114,6 +137,17 @@ protected:
     /// max |(MN|MN)| values (nshell * nshell)
     double* shell_pair_values_;
 
+    /// Use the distance-dependent (QQR) quartet bounds?
+    bool qqr_;
+    /// Center of the most diffuse primitive product of each shell pair (3 * nshell * nshell)
+    std::vector<double> pair_centers_;
+    /// Extent of each shell pair's charge distribution around its center (nshell * nshell)
+    std::vector<double> pair_extents_;
+    /// Monopole radius of each shell pair (nshell * nshell)
+    std::vector<double> pair_radii_;
+    /// max |D_mn| over each shell block and its transpose, of all densities set (nshell * nshell)
+    std::vector<double> shell_density_;
+
     /// Significant unique bra- function pairs, in reduced triangular indexing
     std::vector<std::pair<int,int> > function_pairs_;
     /// Significant unique bra- shell pairs, in reduced triangular indexing
@@ -129,9 +163,19 @@ protected:
      
     /// Set initial indexing
     void common_init();
-    /// Compute sieve integrals (only done once)
+    /// Compute sieve integrals (only done once), threaded over shell pairs
     void integrals();
 
+    /// Square of the QQR factor of the shell pairs MN and RS, at most 1
+    inline double qqr_factor2(unsigned long int MN, unsigned long int RS) {
+        const double* P = &pair_centers_[3L * MN];
+        const double* Q = &pair_centers_[3L * RS];
+        double R = std::sqrt((P[0] - Q[0]) * (P[0] - Q[0]) + (P[1] - Q[1]) * (P[1] - Q[1]) + (P[2] - Q[2]) * (P[2] - Q[2]));
+        R -= pair_extents_[MN] + pair_extents_[RS];
+        if (R <= 0.0) return 1.0;
+        double f2 = pair_radii_[MN] * pair_radii_[RS] / (R * R);
+        return (f2 < 1.0 ? f2 : 1.0); }
+
 public:
 
     /// Constructor, basis set and first sieve cutoff
@@ -145,13 +189,20 @@ public:
     double sieve() const { return sieve_; }
     /// Global maximum |(mn|rs)|
     double max() const { return max_; }
+    /// Use the distance-dependent (QQR) bounds in the shell quartet checks? (defaults to false)
+    void set_qqr(bool qqr) { qqr_ = qqr; }
+    bool qqr() const { return qqr_; }
+    /// Take the shell block maxima of the densities for shell_significant_density
+    void set_density(const std::vector<boost::shared_ptr<Matrix> >& D);
     
     // => Significance Checks <= //
 
-    /// Square of ceiling of shell quartet (MN|RS)
+    /// Square of ceiling of shell quartet (MN|RS), tightened by QQR if set
     inline double shell_ceiling2(int M, int N, int R, int S) { 
-        return shell_pair_values_[N * (unsigned long int) nshell_ + M] * 
-               shell_pair_values_[R * (unsigned long int) nshell_ + S]; } 
+        unsigned long int MN = N * (unsigned long int) nshell_ + M;
+        unsigned long int RS = R * (unsigned long int) nshell_ + S;
+        double ceiling2 = shell_pair_values_[MN] * shell_pair_values_[RS];
+        return (qqr_ ? ceiling2 * qqr_factor2(MN, RS) : ceiling2); }
 
     /// Square of ceiling of integral (mn|rs)
     inline double function_ceiling2(int m, int n, int r, int s) { 
@@ -160,8 +211,19 @@ public:
 
     /// Is the shell quartet (MN|RS) significant according to sieve? (no restriction on MNRS order)
     inline bool shell_significant(int M, int N, int R, int S) { 
-        return shell_pair_values_[N * (unsigned long int) nshell_ + M] * 
-               shell_pair_values_[R * (unsigned long int) nshell_ + S] >= sieve2_; } 
+        return shell_ceiling2(M, N, R, S) >= sieve2_; } 
+
+    /// Is the shell quartet (MN|RS) significant according to sieve once weighted by the largest
+    /// density block a J or K build contracts it with: D_MN, D_RS, D_MR, D_MS, D_NR, D_NS (needs set_density)
+    inline bool shell_significant_density(int M, int N, int R, int S) {
+        unsigned long int n = nshell_;
+        double D = shell_density_[M * n + N];
+        if (D < shell_density_[R * n + S]) D = shell_density_[R * n + S];
+        if (D < shell_density_[M * n + R]) D = shell_density_[M * n + R];
+        if (D < shell_density_[M * n + S]) D = shell_density_[M * n + S];
+        if (D < shell_density_[N * n + R]) D = shell_density_[N * n + R];
+        if (D < shell_density_[N * n + S]) D = shell_density_[N * n + S];
+        return shell_ceiling2(M, N, R, S) * D * D >= sieve2_; }
 
     /// Is the integral (mn|rs) significant according to sieve? (no restriction on mnrs order)
     inline bool function_significant(int m, int n, int r, int s) { 
@@ -185,9 +247,9 @@ public:
     /// Significant unique bra- shell pairs, in reduced triangular indexing
     const std::vector<std::pair<int,int> >& shell_pairs() const { return shell_pairs_; }
     /// Unique bra- function pair indexing, accessed in triangular order, or -1 for non-significant pair 
-    const std::vector<long int> function_pairs_reverse() const { return function_pairs_reverse_; }
+    const std::vector<long int>& function_pairs_reverse() const { return function_pairs_reverse_; }
     /// Unique bra- shell pair indexing, accessed in triangular order, or -1 for non-significant pair 
-    const std::vector<long int> shell_pairs_reverse() const { return shell_pairs_reverse_; }
+    const std::vector<long int>& shell_pairs_reverse() const { return shell_pairs_reverse_; }
     /// Significant function pairs, indexes by function
     const std::vector<std::vector<int> >& function_to_function() const { return function_to_function_; }
     /// Significant shell pairs, indexes by shell
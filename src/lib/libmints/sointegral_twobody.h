@@ -110,7 +110,7 @@ protected:
     const CdSalcList* cdsalcs_;
 
     template<typename TwoBodySOIntFunctor>
-    void provide_IJKL(int, int, int, int, TwoBodySOIntFunctor& body);
+    void provide_IJKL(int, int, int, int, TwoBodySOIntFunctor& body, int thread = 0);
 
     template<typename TwoBodySOIntFunctor>
     void provide_IJKL_deriv1(int ish, int jsh, int ksh, int lsh, TwoBodySOIntFunctor& body);
@@ -142,6 +142,8 @@ public:
     boost::shared_ptr<SOBasisSet> basis4() const;
 
     const double *buffer(int thread=0) const { return buffer_[thread]; }
+    /// Number of AO engines, hence of threads that may compute shells at once
+    int nthread() const { return nthread_; }
 
     void set_cutoff(double ints_tolerance) { cutoff_ = ints_tolerance; }
 
@@ -152,8 +154,9 @@ public:
                       body);
     }
 
+    /// Thread selects the AO engine and buffer used; one thread per index at a time
     template<typename TwoBodySOIntFunctor>
-    void compute_shell(int, int, int, int, TwoBodySOIntFunctor& body);
+    void compute_shell(int, int, int, int, TwoBodySOIntFunctor& body, int thread = 0);
 
     // User provides an iterator object and this function will walk through it.
     // Assumes serial run (nthread = 1)
@@ -219,12 +222,11 @@ public:
 };
 
 template<typename TwoBodySOIntFunctor>
-void TwoBodySOInt::compute_shell(int uish, int ujsh, int uksh, int ulsh, TwoBodySOIntFunctor& body)
+void TwoBodySOInt::compute_shell(int uish, int ujsh, int uksh, int ulsh, TwoBodySOIntFunctor& body, int thread)
 {
     dprintf("uish %d, ujsh %d, uksh %d, ulsh %d\n", uish, ujsh, uksh, ulsh);
 
     //~ int thread = WorldComm->thread_id(pthread_self());
-    int thread = 0;
 
     //~ mints_timer_on("TwoBodySOInt::compute_shell overall");
     //~ mints_timer_on("TwoBodySOInt::compute_shell setup");
@@ -432,16 +434,15 @@ void TwoBodySOInt::compute_shell(int uish, int ujsh, int uksh, int ulsh, TwoBody
 
     //~ mints_timer_off("TwoBodySOInt::compute_shell full shell transform");
 
-    provide_IJKL(uish, ujsh, uksh, ulsh, body);
+    provide_IJKL(uish, ujsh, uksh, ulsh, body, thread);
 
     //~ mints_timer_off("TwoBodySOInt::compute_shell overall");
 }
 
 template<typename TwoBodySOIntFunctor>
-void TwoBodySOInt::provide_IJKL(int ish, int jsh, int ksh, int lsh, TwoBodySOIntFunctor& body)
+void TwoBodySOInt::provide_IJKL(int ish, int jsh, int ksh, int lsh, TwoBodySOIntFunctor& body, int thread)
 {
     //~ int thread = WorldComm->thread_id(pthread_self());
-    int thread = 0;
 
     //~ mints_timer_on("TwoBodySOInt::provide_IJKL overall");
 
@@ -21,6 +21,7 @@
  */
 
 #include <stdexcept>
+#include <cstring>
 
 #include <compiler.h>
 #include <libqt/qt.h>
@@ -83,6 +84,32 @@ boost::shared_ptr<BasisSet> TwoBodyAOInt::basis4()
     return original_bs4_;
 }
 
+void TwoBodyAOInt::init_batch(int n, const int* shells)
+{
+    batch_offsets_.resize(n + 1);
+    batch_offsets_[0] = 0;
+    for (int i=0; i<n; ++i) {
+        const int* q = shells + 4*i;
+        const GaussianShell* s[4] = { &original_bs1_->shell(q[0]), &original_bs2_->shell(q[1]),
+                                      &original_bs3_->shell(q[2]), &original_bs4_->shell(q[3]) };
+        size_t size = 1;
+        for (int k=0; k<4; ++k)
+            size *= force_cartesian_ ? s[k]->ncartesian() : s[k]->nfunction();
+        batch_offsets_[i+1] = batch_offsets_[i] + size;
+    }
+    batch_buffer_.resize(batch_offsets_[n]);
+}
+
+void TwoBodyAOInt::compute_shells(int n, const int* shells)
+{
+    init_batch(n, shells);
+    for (int i=0; i<n; ++i) {
+        const int* q = shells + 4*i;
+        compute_shell(q[0], q[1], q[2], q[3]);
+        ::memcpy(&batch_buffer_[batch_offsets_[i]], target_, sizeof(double) * (batch_offsets_[i+1] - batch_offsets_[i]));
+    }
+}
+
 bool TwoBodyAOInt::cloneable()
 {
     return false;
@@ -23,6 +23,7 @@
 #ifndef _psi_src_lib_libmints_twobody_h
 #define _psi_src_lib_libmints_twobody_h
 
+#include <vector>
 #include <boost/shared_ptr.hpp>
 //~ #include <boost/python/list.hpp>
 #include <exception.h>
@@ -73,6 +74,10 @@ protected:
     bool force_cartesian_;
     //! The order of the derivative integral buffers, after permuting shells
     unsigned char buffer_offsets_[4];
+    /// Integrals of the last compute_shells batch, one quartet after the other
+    std::vector<double> batch_buffer_;
+    /// Where each quartet of the last batch starts in batch_buffer_, then the total size
+    std::vector<size_t> batch_offsets_;
     //~ /// The PyBuffer object used for sharing the target_ buffer without copying data
     //~ PyBuffer<double> target_pybuffer_;
     //~ /// Whether or not to use the PyBuffer
@@ -87,6 +92,9 @@ protected:
     void permute_1234_to_3421(double *s, double *t, int nbf1, int nbf2, int nbf3, int nbf4);
     void permute_1234_to_4321(double *s, double *t, int nbf1, int nbf2, int nbf3, int nbf4);
 
+    /// Sizes batch_buffer_ and batch_offsets_ for the n quartets of shells
+    void init_batch(int n, const int* shells);
+
 //    TwoBodyInt(boost::shared_ptr<BasisSet> bs1,
 //               boost::shared_ptr<BasisSet> bs2,
 //               boost::shared_ptr<BasisSet> bs3,
@@ -146,6 +154,16 @@ public:
     /// Compute the integrals
     virtual void compute_shell(int, int, int, int) = 0;
 
+    /// Compute the integrals of n quartets, shells[4i..4i+3] for quartet i, into batch_buffer.
+    /// Batches of quartets of one angular momentum class evaluate fastest.
+    virtual void compute_shells(int n, const int* shells);
+
+    /// Buffer of the last compute_shells, quartet i at batch_offsets()[i]
+    const double *batch_buffer() const { return batch_buffer_.empty() ? 0 : &batch_buffer_[0]; }
+
+    /// Offsets of the quartets of the last compute_shells in batch_buffer, n+1 of them
+    const size_t *batch_offsets() const { return &batch_offsets_[0]; }
+
     /// Is the shell zero?
     virtual int shell_is_zero(int,int,int,int) { return 0; }
 
@@ -0,0 +1,140 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * PSI4: an ab initio quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *@END LICENSE
+ */
+
+#include <libmints/matrix.h>
+#include <libmints/dimension.h>
+#include "workspace.h"
+
+using namespace std;
+
+namespace psi {
+
+MatrixWorkspace::MatrixWorkspace(const std::string& name) :
+    name_(name), allocations_(0L), reuses_(0L), bytes_(0L)
+{
+}
+MatrixWorkspace::~MatrixWorkspace()
+{
+}
+SharedMatrix MatrixWorkspace::acquire(const char* name, int nirrep, const int* rowspi, const int* colspi, int symmetry)
+{
+    // Size class: symmetry, then rows and columns per irrep
+    key_.resize(2 * nirrep + 1);
+    key_[0] = symmetry;
+    for (int h = 0; h < nirrep; h++) {
+        key_[2 * h + 1] = rowspi[h];
+        key_[2 * h + 2] = colspi[h];
+    }
+
+    std::map<std::vector<int>, std::vector<SharedMatrix> >::iterator it = pool_.find(key_);
+    if (it == pool_.end())
+        it = pool_.insert(std::make_pair(key_, std::vector<SharedMatrix>())).first;
+    std::vector<SharedMatrix>& matrices = it->second;
+
+    // A free matrix that already has this name is preferred, so that renaming does not allocate
+    int free = -1;
+    for (size_t ind = 0; ind < matrices.size(); ind++) {
+        if (matrices[ind].use_count() != 1) continue;
+        if (matrices[ind]->name() == name) {
+            free = ind;
+            break;
+        }
+        if (free < 0) free = ind;
+    }
+    if (free >= 0) {
+        reuses_++;
+        if (matrices[free]->name() != name)
+            matrices[free]->set_name(name);
+        return matrices[free];
+    }
+
+    SharedMatrix matrix(new Matrix(name, nirrep, rowspi, colspi, symmetry));
+    matrices.push_back(matrix);
+    allocations_++;
+    for (int h = 0; h < nirrep; h++) {
+        bytes_ += sizeof(double) * rowspi[h] * colspi[h ^ symmetry];
+    }
+    return matrix;
+}
+SharedMatrix MatrixWorkspace::acquire(const char* name, const Dimension& rowspi, const Dimension& colspi, int symmetry)
+{
+    if (rowspi.n() != colspi.n())
+        throw PSIEXCEPTION("MatrixWorkspace::acquire: Row and column dimensions have different numbers of irreps");
+    return acquire(name, rowspi.n(), (const int*) rowspi, (const int*) colspi, symmetry);
+}
+SharedMatrix MatrixWorkspace::acquire(const char* name, int rows, int cols)
+{
+    return acquire(name, 1, &rows, &cols, 0);
+}
+void MatrixWorkspace::release(SharedMatrix& matrix)
+{
+    matrix.reset();
+}
+void MatrixWorkspace::clear()
+{
+    std::map<std::vector<int>, std::vector<SharedMatrix> >::iterator it;
+    for (it = pool_.begin(); it != pool_.end(); ++it) {
+        std::vector<SharedMatrix> kept;
+        for (size_t ind = 0; ind < it->second.size(); ind++) {
+            SharedMatrix matrix = it->second[ind];
+            if (matrix.use_count() > 2) {
+                kept.push_back(matrix);
+                continue;
+            }
+            for (int h = 0; h < matrix->nirrep(); h++) {
+                bytes_ -= sizeof(double) * matrix->rowspi()[h] * matrix->colspi()[h ^ matrix->symmetry()];
+            }
+        }
+        it->second = kept;
+    }
+}
+void MatrixWorkspace::print(FILE* out) const
+{
+    fprintf(out, "  ==> Workspace: %s <==\n\n", name_.c_str());
+    fprintf(out, "    %-30s %8s %8s %12s\n", "Size Class (sym: rows x cols)", "Total", "In Use", "Memory [MB]");
+    std::map<std::vector<int>, std::vector<SharedMatrix> >::const_iterator it;
+    for (it = pool_.begin(); it != pool_.end(); ++it) {
+        if (!it->second.size()) continue;
+        const std::vector<int>& key = it->first;
+        int nirrep = (key.size() - 1) / 2;
+        std::string label;
+        char buffer[32];
+        sprintf(buffer, "%d:", key[0]);
+        label += buffer;
+        for (int h = 0; h < nirrep; h++) {
+            sprintf(buffer, " %dx%d", key[2 * h + 1], key[2 * h + 2]);
+            label += buffer;
+        }
+        size_t busy = 0L;
+        size_t bytes = 0L;
+        for (size_t ind = 0; ind < it->second.size(); ind++) {
+            if (it->second[ind].use_count() > 1) busy++;
+            for (int h = 0; h < nirrep; h++) {
+                bytes += sizeof(double) * key[2 * h + 1] * key[2 * ((h ^ key[0]) + 1)];
+            }
+        }
+        fprintf(out, "    %-30s %8zu %8zu %12.3f\n", label.c_str(), it->second.size(), busy, bytes / 1048576.0);
+    }
+    fprintf(out, "\n    Allocations: %zu, Reuses: %zu, Memory: %.3f MB\n\n", allocations_, reuses_, bytes_ / 1048576.0);
+}
+
+}
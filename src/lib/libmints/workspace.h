@@ -0,0 +1,89 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * PSI4: an ab initio quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *@END LICENSE
+ */
+
+#ifndef _psi_src_lib_libmints_workspace_h_
+#define _psi_src_lib_libmints_workspace_h_
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+#include <psi4-dec.h>
+#include "typedefs.h"
+
+namespace psi {
+
+class Dimension;
+
+/**
+ * Pool of scratch matrices for code that needs the same temporaries over
+ * and over (SCF iterations, DIIS, JK builds).
+ *
+ * Matrices are pooled by size class: symmetry plus the row and column
+ * dimension of every irrep. A matrix handed out by acquire() stays busy
+ * until it is given back with release(), or until every handle besides the
+ * pool's own has been dropped. Acquired matrices are not zeroed; they hold
+ * whatever their previous user left in them.
+ */
+class MatrixWorkspace {
+
+protected:
+    /// Name used in the usage report
+    std::string name_;
+    /// Pooled matrices, keyed by size class
+    std::map<std::vector<int>, std::vector<SharedMatrix> > pool_;
+    /// Matrices allocated and requests served from the pool
+    size_t allocations_;
+    size_t reuses_;
+    /// Bytes held by all pooled matrices
+    size_t bytes_;
+    /// Size class of the current request, kept so that lookups do not allocate
+    std::vector<int> key_;
+
+    SharedMatrix acquire(const char* name, int nirrep, const int* rowspi, const int* colspi, int symmetry);
+
+public:
+    MatrixWorkspace(const std::string& name);
+    virtual ~MatrixWorkspace();
+
+    /// A free matrix of this shape, allocated only if none is pooled
+    SharedMatrix acquire(const char* name, const Dimension& rowspi, const Dimension& colspi, int symmetry = 0);
+    /// A free (rows x cols) C1 matrix
+    SharedMatrix acquire(const char* name, int rows, int cols);
+    /// Give a matrix back to the pool; resets the handle
+    void release(SharedMatrix& matrix);
+    /// Free every matrix that is not in use
+    void clear();
+
+    /// Matrices allocated so far
+    size_t allocations() const { return allocations_; }
+    /// Requests served without allocating
+    size_t reuses() const { return reuses_; }
+    /// Bytes held by the pool
+    size_t bytes() const { return bytes_; }
+    /// Print the memory usage per size class
+    void print(FILE* out = outfile) const;
+};
+
+}
+
+#endif
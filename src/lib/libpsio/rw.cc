@@ -30,6 +30,7 @@
 #include <libpsio/psio.h>
 #include <libpsio/psio.hpp>
 #include <libparallel/parallel.h>
+#include <libqt/diagnostics.h>
 
 namespace psi {
 
@@ -63,6 +64,8 @@ void PSIO::rw(unsigned int unit, char *buffer, psio_address address, ULI size,
       PSIOError(unit, PSIO_ERROR_LSEEK);
   }
   
+  diagnostics::count(wrt ? diagnostics::BytesWritten : diagnostics::BytesRead, (double) size);
+
   /* Number of bytes left on the first page */
   this_page_max = PSIO_PAGELEN - offset;
   
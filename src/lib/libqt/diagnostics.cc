@@ -0,0 +1,323 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * PSI4: an ab initio quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *@END LICENSE
+ */
+
+/*!
+** \file
+** \brief Thread-safe phase timers and work counters
+** \ingroup QT
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <sys/time.h>
+#include <psi4-dec.h>
+#include "diagnostics.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace psi {
+
+namespace diagnostics {
+
+namespace {
+
+/// Counter slots, one cache line each; threads share a slot only beyond MAX_SLOTS
+const int MAX_SLOTS = 64;
+const int SLOT_WIDTH = 8;
+double slots_[MAX_SLOTS][SLOT_WIDTH];
+
+struct OpenPhase {
+    const char* name;
+    double start;
+    double counters[NumCounters];
+};
+
+/// A closed phase or a row of totals; the name string is only built on the way out
+struct ClosedPhase {
+    const char* name;
+    int iteration;
+    int thread;
+    int calls;
+    double start;
+    double wall;
+    double counters[NumCounters];
+};
+
+/// (iteration, thread, name) of a row of totals
+typedef std::pair<std::pair<int, int>, const char*> TotalKey;
+typedef std::pair<TotalKey, size_t> TotalRow;
+
+/// Orders rows by (iteration, thread) and the text of the name, not its address
+struct TotalRowLess {
+    bool operator()(const TotalRow& a, const TotalRow& b) const
+    {
+        if (a.first.first != b.first.first) return a.first.first < b.first.first;
+        return ::strcmp(a.first.second, b.first.second) < 0;
+    }
+};
+
+/// Closed phases kept for the trace; older ones survive only in the totals
+const size_t MAX_TRACE = 4096;
+
+bool enabled_ = true;
+int iteration_ = -1;
+double origin_ = -1.0;
+std::map<int, std::vector<OpenPhase> > open_;
+/// Closed phases summed per (iteration, thread, name), in order of first appearance
+std::vector<ClosedPhase> totals_;
+/// Index of totals_, sorted by TotalRowLess; a flat vector, so new rows rarely allocate
+std::vector<TotalRow> total_rows_;
+/// Ring of the last MAX_TRACE closed phases; closed_count_ counts all of them
+std::vector<ClosedPhase> trace_;
+size_t closed_count_ = 0;
+
+const char* counter_names_[NumCounters] = {
+    "quartets_computed",
+    "quartets_screened",
+    "bytes_read",
+    "bytes_written",
+    "grid_points",
+    "gemm_flops"
+};
+
+double wall_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1.0E-6 * tv.tv_usec;
+}
+
+int thread_id()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+PhaseRecord to_record(const ClosedPhase& phase)
+{
+    PhaseRecord record;
+    record.name = phase.name;
+    record.iteration = phase.iteration;
+    record.thread = phase.thread;
+    record.calls = phase.calls;
+    record.start = phase.start;
+    record.wall = phase.wall;
+    ::memcpy((void*) record.counters, (const void*) phase.counters, sizeof(record.counters));
+    return record;
+}
+
+void snapshot(double* totals)
+{
+    for (int c = 0; c < NumCounters; c++) {
+        totals[c] = counter((Counter) c);
+    }
+}
+
+}
+
+void set_enabled(bool enabled)
+{
+    enabled_ = enabled;
+}
+bool enabled()
+{
+    return enabled_;
+}
+void reset()
+{
+    #pragma omp critical(psi_diagnostics)
+    {
+        ::memset((void*) slots_, '\0', sizeof(slots_));
+        open_.clear();
+        totals_.clear();
+        total_rows_.clear();
+        trace_.clear();
+        closed_count_ = 0;
+        origin_ = wall_time();
+    }
+}
+void set_iteration(int iteration)
+{
+    iteration_ = iteration;
+}
+int iteration()
+{
+    return iteration_;
+}
+void count(Counter counter, double value)
+{
+    if (!enabled_) return;
+    int slot = thread_id() % MAX_SLOTS;
+    #pragma omp atomic
+    slots_[slot][counter] += value;
+}
+double counter(Counter counter)
+{
+    double total = 0.0;
+    for (int slot = 0; slot < MAX_SLOTS; slot++) {
+        double value;
+        #pragma omp atomic read
+        value = slots_[slot][counter];
+        total += value;
+    }
+    return total;
+}
+const char* counter_name(Counter counter)
+{
+    return counter_names_[counter];
+}
+void phase_on(const char* name)
+{
+    if (!enabled_) return;
+    OpenPhase phase;
+    phase.name = name;
+    snapshot(phase.counters);
+    phase.start = wall_time();
+    int thread = thread_id();
+    #pragma omp critical(psi_diagnostics)
+    {
+        if (origin_ < 0.0) origin_ = phase.start;
+        open_[thread].push_back(phase);
+    }
+}
+void phase_off(const char* name)
+{
+    if (!enabled_) return;
+    double stop = wall_time();
+    double totals[NumCounters];
+    snapshot(totals);
+    int thread = thread_id();
+    #pragma omp critical(psi_diagnostics)
+    {
+        // Close the innermost open phase of this name; unmatched calls are ignored
+        std::vector<OpenPhase>& stack = open_[thread];
+        for (int ind = ((int) stack.size()) - 1; ind >= 0; ind--) {
+            if (::strcmp(stack[ind].name, name)) continue;
+            ClosedPhase record;
+            record.name = stack[ind].name;
+            record.iteration = iteration_;
+            record.thread = thread;
+            record.calls = 1;
+            record.start = stack[ind].start - origin_;
+            record.wall = stop - stack[ind].start;
+            for (int c = 0; c < NumCounters; c++) {
+                record.counters[c] = totals[c] - stack[ind].counters[c];
+            }
+            TotalRow key(TotalKey(std::make_pair(record.iteration, thread), record.name), totals_.size());
+            std::vector<TotalRow>::iterator it = std::lower_bound(total_rows_.begin(), total_rows_.end(), key, TotalRowLess());
+            if (it == total_rows_.end() || TotalRowLess()(key, *it)) {
+                total_rows_.insert(it, key);
+                totals_.push_back(record);
+            } else {
+                ClosedPhase& row = totals_[it->second];
+                row.calls++;
+                row.wall += record.wall;
+                for (int c = 0; c < NumCounters; c++) {
+                    row.counters[c] += record.counters[c];
+                }
+            }
+            if (trace_.size() < MAX_TRACE)
+                trace_.push_back(record);
+            else
+                trace_[closed_count_ % MAX_TRACE] = record;
+            closed_count_++;
+            stack.erase(stack.begin() + ind);
+            break;
+        }
+    }
+}
+std::vector<PhaseRecord> phases()
+{
+    std::vector<PhaseRecord> records;
+    #pragma omp critical(psi_diagnostics)
+    {
+        // Unroll the ring, oldest first
+        size_t first = (closed_count_ > MAX_TRACE) ? closed_count_ % MAX_TRACE : 0;
+        records.reserve(trace_.size());
+        for (size_t ind = 0; ind < trace_.size(); ind++) {
+            records.push_back(to_record(trace_[(first + ind) % trace_.size()]));
+        }
+    }
+    return records;
+}
+std::vector<PhaseRecord> phase_table()
+{
+    std::vector<PhaseRecord> records;
+    #pragma omp critical(psi_diagnostics)
+    {
+        records.reserve(totals_.size());
+        for (size_t ind = 0; ind < totals_.size(); ind++) {
+            records.push_back(to_record(totals_[ind]));
+        }
+    }
+    std::vector<PhaseRecord> table;
+    std::map<std::pair<int, std::string>, int> rows;
+    for (size_t ind = 0; ind < records.size(); ind++) {
+        const PhaseRecord& record = records[ind];
+        std::pair<int, std::string> key(record.iteration, record.name);
+        std::map<std::pair<int, std::string>, int>::iterator it = rows.find(key);
+        if (it == rows.end()) {
+            rows[key] = table.size();
+            table.push_back(record);
+            continue;
+        }
+        PhaseRecord& row = table[it->second];
+        row.calls += record.calls;
+        row.wall += record.wall;
+        for (int c = 0; c < NumCounters; c++) {
+            row.counters[c] += record.counters[c];
+        }
+    }
+    return table;
+}
+void write_chrome_trace(const std::string& filename)
+{
+    FILE* fh = fopen(filename.c_str(), "w");
+    if (!fh)
+        throw PSIEXCEPTION("diagnostics::write_chrome_trace: Unable to open " + filename);
+
+    std::vector<PhaseRecord> records = phases();
+    fprintf(fh, "{\"traceEvents\":[\n");
+    for (size_t ind = 0; ind < records.size(); ind++) {
+        const PhaseRecord& record = records[ind];
+        fprintf(fh, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"iteration\":%d",
+            record.name.c_str(), record.thread, 1.0E6 * record.start, 1.0E6 * record.wall, record.iteration);
+        for (int c = 0; c < NumCounters; c++) {
+            if (record.counters[c] != 0.0)
+                fprintf(fh, ",\"%s\":%.0f", counter_names_[c], record.counters[c]);
+        }
+        fprintf(fh, "}}%s\n", (ind + 1 < records.size() ? "," : ""));
+    }
+    fprintf(fh, "],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(fh);
+}
+
+}
+
+}
@@ -0,0 +1,110 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * PSI4: an ab initio quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *@END LICENSE
+ */
+
+#ifndef _psi_src_lib_libqt_diagnostics_h_
+#define _psi_src_lib_libqt_diagnostics_h_
+
+#include <string>
+#include <vector>
+
+/*!
+** \file
+** \brief Thread-safe phase timers and work counters
+** \ingroup QT
+**
+** Phases are named wall-clock spans (Form G, JK: JK, DIIS, ...) stamped
+** with the current SCF iteration. Counters (quartets, bytes, grid points,
+** flops) may be bumped from any thread; each phase is charged with what
+** the counters gained while it was open, so nested phases are inclusive.
+** Hot loops should accumulate locally and call count() once per task.
+** Closed phases are kept as running totals per (iteration, thread, name),
+** plus a bounded ring of the most recent ones for the trace, so memory
+** stays bounded however long collection is on.
+*/
+
+namespace psi {
+
+namespace diagnostics {
+
+enum Counter {
+    QuartetsComputed = 0,
+    QuartetsScreened,
+    BytesRead,
+    BytesWritten,
+    GridPoints,
+    GemmFlops,
+    NumCounters
+};
+
+/// One closed phase, or all calls of one phase in one iteration
+struct PhaseRecord {
+    std::string name;
+    int iteration;
+    int thread;
+    int calls;
+    /// Start (seconds since the last reset) and wall time of the phase
+    double start;
+    double wall;
+    double counters[NumCounters];
+};
+
+/// Turn collection on or off (on by default)
+void set_enabled(bool enabled);
+bool enabled();
+/// Drop all recorded phases and zero the counters
+void reset();
+/// SCF iteration stamped onto phases opened from now on (-1 outside the SCF loop)
+void set_iteration(int iteration);
+int iteration();
+
+/// Add value to a counter; safe to call from any thread
+void count(Counter counter, double value);
+/// Current total of a counter since the last reset
+double counter(Counter counter);
+/// Name of a counter, as used in tables and traces
+const char* counter_name(Counter counter);
+
+/// Open and close a named phase on the calling thread. The name is kept by
+/// pointer until the next reset(), so it should be a string literal.
+void phase_on(const char* name);
+void phase_off(const char* name);
+
+/// The last 4096 closed phases, in closing order
+std::vector<PhaseRecord> phases();
+/// All closed phases summed per (iteration, name), in order of first appearance
+std::vector<PhaseRecord> phase_table();
+/// Write phases() as Chrome trace ("X") events to filename
+void write_chrome_trace(const std::string& filename);
+
+/// Scoped phase: opened on construction, closed on destruction
+class PhaseTimer {
+    const char* name_;
+public:
+    PhaseTimer(const char* name) : name_(name) { phase_on(name_); }
+    ~PhaseTimer() { phase_off(name_); }
+};
+
+}
+
+}
+
+#endif
@@ -375,7 +375,8 @@ void CUHF::compute_orbital_gradient(bool save_diis)
         if (initialized_diis_manager_ == false) {
             diis_manager_ = boost::shared_ptr<DIISManager>(new DIISManager(
                                                                process_environment_, max_diis_vectors_, "HF DIIS vector", psio_, DIISManager::LargestError,
-                                                               DIISManager::OnDisk));
+                                                               DIISManager::InCore));
+            diis_manager_->set_workspace(workspace_);
             diis_manager_->set_error_vector_size(2, DIISEntry::Matrix,
                                                  grad_a.get(), DIISEntry::Matrix, grad_b.get());
             diis_manager_->set_vector_size(2, DIISEntry::Matrix,
@@ -39,6 +39,7 @@
 #include <sstream>
 #include <vector>
 #include <utility>
+#include <limits>
 
 #include <libmints/mints.h>
 
@@ -51,6 +52,7 @@
 #include <libparallel/parallel.h>
 #include <libiwl/iwl.hpp>
 #include <libqt/qt.h>
+#include <libqt/diagnostics.h>
 //~ #include <liboptions/liboptions_python.h>
 #include <psifiles.h>
 #include <libfock/jk.h>
@@ -113,6 +115,8 @@ void HF::common_init()
 
     attempt_number_ = 1;
 
+    workspace_ = boost::shared_ptr<MatrixWorkspace>(new MatrixWorkspace("SCF"));
+
     // This quantity is needed fairly soon
     nirrep_ = factory_->nirrep();
 
@@ -343,6 +347,13 @@ void HF::common_init()
     max_diis_vectors_ = options_.get_int("DIIS_MAX_VECS");
     diis_start_ = options_.get_int("DIIS_START");
     diis_enabled_ = options_.get_bool("DIIS");
+    diis_initial_acceleration_ = DIISManager::NoInitialAcceleration;
+    if (options_.get_str("SCF_INITIAL_ACCELERATION") == "ADIIS")
+        diis_initial_acceleration_ = DIISManager::ADIIS;
+    else if (options_.get_str("SCF_INITIAL_ACCELERATION") == "EDIIS")
+        diis_initial_acceleration_ = DIISManager::EDIIS;
+    diis_acceleration_start_ = options_.get_double("SCF_INITIAL_START_DIIS_TRANSITION");
+    diis_acceleration_finish_ = options_.get_double("SCF_INITIAL_FINISH_DIIS_TRANSITION");
 
     // Don't perform DIIS if less than 2 vectors requested, or user requested a negative number
     if (min_diis_vectors_ < 2) {
@@ -357,9 +368,34 @@ void HF::common_init()
     MOM_started_ = false;
     MOM_performed_ = false;
 
+    soscf_enabled_ = options_.get_bool("SOSCF");
+    soscf_start_convergence_ = options_.get_double("SOSCF_START_CONVERGENCE");
+    soscf_max_iter_ = options_.get_int("SOSCF_MAX_ITER");
+    soscf_conv_ = options_.get_double("SOSCF_CONV");
+    soscf_max_radius_ = options_.get_double("SOSCF_TRUST_RADIUS");
+    soscf_radius_ = soscf_max_radius_;
+    soscf_best_Drms_ = soscf_start_convergence_;
+    soscf_stalled_iterations_ = 0;
+    soscf_started_ = false;
+    soscf_performed_ = false;
+    if (soscf_max_iter_ < 1)
+        throw PSIEXCEPTION("SOSCF_MAX_ITER must be at least 1.");
+    fock_builds_ = 0;
+    soscf_fock_builds_ = 0;
+
     frac_enabled_ = (options_.get_int("FRAC_START") != 0);
     frac_performed_ = false;
 
+    density_update_ = options_.get_str("SCF_DENSITY_UPDATE");
+    partial_diagonalization_ = false;
+    partial_virtuals_ = options_.get_int("SCF_DENSITY_UPDATE_VIRTUALS");
+    purification_conv_ = options_.get_double("PURIFICATION_CONVERGENCE");
+    purification_max_iter_ = options_.get_int("PURIFICATION_MAX_ITER");
+    if (density_update_ != "DIAGONALIZE" && (soscf_enabled_ || MOM_enabled_ || frac_enabled_))
+        throw PSIEXCEPTION("SCF_DENSITY_UPDATE = " + density_update_ + " does not form all orbitals in each iteration, and cannot be combined with SOSCF, MOM or FRAC.");
+    if (partial_virtuals_ < 0)
+        throw PSIEXCEPTION("SCF_DENSITY_UPDATE_VIRTUALS must not be negative.");
+
     if(print_)
         print_header();
     
@@ -414,6 +450,9 @@ void HF::integrals()
         jk_->set_omega(functional->x_omega());
     }
 
+    // JK temporaries come from the wavefunction's workspace
+    jk_->set_workspace(workspace_);
+
     //~ // Initialize
     //~ jk_->initialize(); 
     //~ // Print the header
@@ -461,8 +500,12 @@ void HF::find_occupation()
     if (MOM_started_) {
         MOM();
     } else {
-        std::vector<std::pair<double, int> > pairs_a;
-        std::vector<std::pair<double, int> > pairs_b;
+        std::vector<std::pair<double, int> >& pairs_a = occupation_pairs_a_;
+        std::vector<std::pair<double, int> >& pairs_b = occupation_pairs_b_;
+        pairs_a.clear();
+        pairs_b.clear();
+        pairs_a.reserve(epsilon_a_->dim());
+        pairs_b.reserve(epsilon_b_->dim());
         for (int h=0; h<epsilon_a_->nirrep(); ++h) {
             for (int i=0; i<epsilon_a_->dimpi()[h]; ++i)
                 pairs_a.push_back(make_pair(epsilon_a_->get(h, i), h));
@@ -558,6 +601,8 @@ void HF::print_header()
         else
             fprintf(outfile, "  MOM %s.\n", MOM_enabled_ ? "enabled" : "disabled");
         fprintf(outfile, "  Fractional occupation %s.\n", frac_enabled_ ? "enabled" : "disabled");
+        if (density_update_ != "DIAGONALIZE")
+            fprintf(outfile, "  Density update by %s.\n", density_update_.c_str());
         fprintf(outfile, "  Guess Type is %s.\n", options_.get_str("GUESS").c_str());
         fprintf(outfile, "  Energy threshold   = %3.2e\n", energy_threshold_);
         fprintf(outfile, "  Density threshold  = %3.2e\n", density_threshold_);
@@ -1137,6 +1182,11 @@ void HF::guess()
         fprintf(outfile, "  Switching over to CORE guess.\n\n");
         guess_type = "CORE";
     }
+    if (guess_type == "DENSITY" && guessDensity_.empty()) {
+        fprintf(outfile, "  SCF Guess was DENSITY but guessDensity_ is empty.\n");
+        fprintf(outfile, "  Switching over to CORE guess.\n\n");
+        guess_type = "CORE";
+    }
 
     if (guess_type == "READ") {
 
@@ -1152,6 +1202,25 @@ void HF::guess()
         Cb_->copy(guessOrbital_[1]);
         form_D();
         guess_E = compute_initial_E();
+    } else if (guess_type == "DENSITY") {
+        if (print_ && (process_environment_.get_worldcomm()->me() == 0))
+            fprintf(outfile, "  SCF Guess: Density.\n\n");
+
+        density_guess_nalphapi_ = nalphapi_;
+        density_guess_nbetapi_ = nbetapi_;
+        Da_->copy(guessDensity_[0]);
+        factor_guess_density(Da_, Ca_, nalphapi_);
+        if (Db_ != Da_) {
+            Db_->copy(guessDensity_.size() > 1 ? guessDensity_[1] : guessDensity_[0]);
+            factor_guess_density(Db_, Cb_, nbetapi_);
+        } else {
+            nbetapi_ = nalphapi_;
+        }
+        for (int h = 0; h < nirrep_; ++h) {
+            doccpi_[h] = std::min(nalphapi_[h], nbetapi_[h]);
+            soccpi_[h] = std::abs(nalphapi_[h] - nbetapi_[h]);
+        }
+        guess_E = compute_initial_E();
     } else if (guess_type == "SAD") {
 
         if (print_ && (process_environment_.get_worldcomm()->me() == 0))
@@ -1449,8 +1518,16 @@ double HF::compute_energy()
     bool converged = false;
     MOM_performed_ = false;
     diis_performed_ = false;
+    soscf_started_ = false;
+    soscf_performed_ = false;
+    soscf_best_Drms_ = soscf_start_convergence_;
+    soscf_stalled_iterations_ = 0;
+    soscf_radius_ = soscf_max_radius_;
+    fock_builds_ = 0;
+    soscf_fock_builds_ = 0;
+    diagnostics::set_iteration(-1);
     // Neither of these are idempotent
-    if (options_.get_str("GUESS") == "SAD" || options_.get_str("GUESS") == "READ")
+    if (options_.get_str("GUESS") == "SAD" || options_.get_str("GUESS") == "READ" || options_.get_str("GUESS") == "DENSITY")
         iteration_ = -1;
     else
         iteration_ = 0;
@@ -1479,18 +1556,18 @@ double HF::compute_energy()
 
         integrals();
 
-        //~ timer_on("Form H");
+        diagnostics::phase_on("Form H");
         form_H(); //Core Hamiltonian
             
-        //~ timer_off("Form H");
+        diagnostics::phase_off("Form H");
 
-        //~ timer_on("Form S/X");
+        diagnostics::phase_on("Form S/X");
         form_Shalf(); //S and X Matrix
-        //~ timer_off("Form S/X");
+        diagnostics::phase_off("Form S/X");
 
-        //~ timer_on("Guess");
+        diagnostics::phase_on("Guess");
         guess(); // Guess
-        //~ timer_off("Guess");
+        diagnostics::phase_off("Guess");
 
     }else{
         form_D();
@@ -1506,25 +1583,32 @@ double HF::compute_energy()
     fflush(outfile);
 
     // SCF iterations
+    partial_diagonalization_ = (density_update_ == "PARTIAL_EIGEN");
+    // Looked up once, so that the loop does not build the key string every iteration
+    double& iteration_energy = process_environment_.globals["SCF ITERATION ENERGY"];
     do {
         iteration_++;
+        diagnostics::set_iteration(iteration_);
 
         save_density_and_energy();
 
         // Call any preiteration callbacks
         //~ call_preiteration_callbacks();
 
-        //~ timer_on("Form G");
+        diagnostics::phase_on("Form G");
         form_G();
-        //~ timer_off("Form G");
+        diagnostics::phase_off("Form G");
+        fock_builds_++;
 
         // Reset fractional SAD occupation
         if (iteration_ == 0 && options_.get_str("GUESS") == "SAD")
             reset_SAD_occupation();
+        else if (iteration_ == 0 && options_.get_str("GUESS") == "DENSITY" && !guessDensity_.empty())
+            reset_density_guess_occupation();
 
-        //~ timer_on("Form F");
+        diagnostics::phase_on("Form F");
         form_F();
-        //~ timer_off("Form F");
+        diagnostics::phase_off("Form F");
 
         if (print_>3) {
             Fa_->print(outfile);
@@ -1550,19 +1634,81 @@ double HF::compute_energy()
 	//E_ += efp_energy;
 	//}
 
-        //~ timer_on("DIIS");
+        diagnostics::phase_on("DIIS");
         bool add_to_diis_subspace = false;
         if (diis_enabled_ && iteration_ > 0 && iteration_ >= diis_start_ )
             add_to_diis_subspace = true;
 
         compute_orbital_gradient(add_to_diis_subspace);
 
-        if (diis_enabled_ == true && iteration_ >= diis_start_ + min_diis_vectors_ - 1) {
+        // Close to convergence, Newton steps replace extrapolation and diagonalization once DIIS
+        // stalls: two iterations in a row that raised the energy (beyond roundoff) or did not lower
+        // the orbital gradient below the best DIIS has reached. Where DIIS converges steadily it is
+        // cheaper, since each Newton step costs several JK builds.
+        // A Newton step that raised the energy is undone and retaken with half the trust radius.
+        bool soscf_step = false;
+        bool soscf_rejected = false;
+        if (soscf_enabled_ && !soscf_started_ && iteration_ > 0 && Drms_ < soscf_start_convergence_) {
+            if (E_ - Eold_ > 1.0E-12 * fabs(E_) || Drms_ >= soscf_best_Drms_)
+                soscf_stalled_iterations_++;
+            else
+                soscf_stalled_iterations_ = 0;
+            soscf_best_Drms_ = std::min(soscf_best_Drms_, Drms_);
+        }
+        bool diis_stalled = (soscf_stalled_iterations_ >= 2);
+        if (soscf_enabled_ && iteration_ > 0 && (soscf_started_ || diis_stalled) && !MOM_started_ && !frac_performed_) {
+            soscf_step = true;
+            if (soscf_performed_ && E_ - soscf_E_ > 1.0E-12 * fabs(soscf_E_)) {
+                soscf_rejected = true;
+                soscf_radius_ = 0.5 * soscf_step_norm_;
+                Ca_->copy(soscf_Ca_);
+                Cb_->copy(soscf_Cb_);
+                Fa_->copy(soscf_Fa_);
+                Fb_->copy(soscf_Fb_);
+            } else {
+                // Resize by how well the quadratic model predicted the energy change
+                if (soscf_performed_) {
+                    double ratio = (E_ - soscf_E_) / soscf_predicted_;
+                    if (ratio < 0.25)
+                        soscf_radius_ = 0.5 * soscf_step_norm_;
+                    else if (ratio > 0.75 && soscf_step_norm_ > 0.99 * soscf_radius_)
+                        soscf_radius_ = std::min(2.0 * soscf_radius_, soscf_max_radius_);
+                }
+                soscf_E_ = E_;
+                if (!soscf_Ca_) {
+                    soscf_Ca_ = Ca_->clone();
+                    soscf_Cb_ = Cb_->clone();
+                    soscf_Fa_ = Fa_->clone();
+                    soscf_Fb_ = Fb_->clone();
+                } else {
+                    soscf_Ca_->copy(Ca_);
+                    soscf_Cb_->copy(Cb_);
+                    soscf_Fa_->copy(Fa_);
+                    soscf_Fb_->copy(Fb_);
+                }
+            }
+        }
+
+        diagnostics::phase_off("DIIS");
+
+        soscf_performed_ = false;
+        if (soscf_step) {
+            diagnostics::phase_on("SOSCF");
+            int nproducts = soscf_update();
+            diagnostics::phase_off("SOSCF");
+            fock_builds_ += nproducts;
+            soscf_fock_builds_ += nproducts;
+            soscf_performed_ = (nproducts > 0);
+            soscf_started_ = soscf_started_ || soscf_performed_;
+        }
+
+        diagnostics::phase_on("DIIS");
+        if (!soscf_performed_ && diis_enabled_ == true && iteration_ >= diis_start_ + min_diis_vectors_ - 1) {
             diis_performed_ = diis();
         } else {
             diis_performed_ = false;
         }
-        //~ timer_off("DIIS");
+        diagnostics::phase_off("DIIS");
 
         if (print_>4 && diis_performed_ && (process_environment_.get_worldcomm()->me() == 0)) {
             fprintf(outfile,"  After DIIS:\n");
@@ -1571,13 +1717,17 @@ double HF::compute_energy()
         }
 
         // If we're too well converged, or damping wasn't enabled, do DIIS
-        damping_performed_ = (damping_enabled_ && iteration_ > 1 && Drms_ > damping_convergence_);
+        damping_performed_ = (damping_enabled_ && iteration_ > 1 && Drms_ > damping_convergence_ && !soscf_performed_);
 
         std::string status = "";
         if(diis_performed_){
             if(status != "") status += "/";
             status += "DIIS";
         }
+        if(soscf_performed_){
+            if(status != "") status += "/";
+            status += (soscf_rejected ? "SOSCF(REJECTED)" : "SOSCF");
+        }
         if(MOM_performed_){
             if(status != "") status += "/";
             status += "MOM";
@@ -1593,14 +1743,17 @@ double HF::compute_energy()
 
 
 
-        //~ timer_on("Form C");
-        form_C();
-        //~ timer_off("Form C");
-        //~ timer_on("Form D");
+        if (!soscf_performed_) {
+            diagnostics::phase_on("Form C");
+            if (density_update_ != "PURIFICATION" || !form_C_purified())
+                form_C();
+            diagnostics::phase_off("Form C");
+        }
+        diagnostics::phase_on("Form D");
         form_D();
-        //~ timer_off("Form D");
+        diagnostics::phase_off("Form D");
 
-        process_environment_.globals["SCF ITERATION ENERGY"] = E_;
+        iteration_energy = E_;
 
         // After we've built the new D, damp the update if
         if(damping_performed_) damp_update();
@@ -1612,7 +1765,7 @@ double HF::compute_energy()
             Db_->print(outfile);
         }
 
-        converged = test_convergency();
+        converged = test_convergency() && !soscf_rejected;
 
         df = (options_.get_str("SCF_TYPE") == "DF");
 
@@ -1640,10 +1793,27 @@ double HF::compute_energy()
             //~ integrals();
         }
 
+        // If a cheaper preliminary stage (e.g. a coarse DFT grid) is done, switch and keep running
+        if (iteration_ > 0 && advance_scf_stage()) {
+            converged = false;
+            if(initialized_diis_manager_)
+                diis_manager_->reset_subspace();
+        }
+
         // Call any postiteration callbacks
         //~ call_postiteration_callbacks();
 
     } while (!converged && iteration_ < maxiter_ );
+    diagnostics::set_iteration(-1);
+    partial_diagonalization_ = false;
+
+    // SOSCF and purified orbitals are not canonical and carry no orbital energies,
+    // and the partial eigensolver leaves out most virtuals
+    if (soscf_performed_ || density_update_ != "DIAGONALIZE") {
+        form_C();
+        form_D();
+    }
+    process_environment_.globals["SCF FOCK BUILDS"] = fock_builds_;
 
     //~ if (WorldComm->me() == 0)
         fprintf(outfile, "\n  ==> Post-Iterations <==\n\n");
@@ -1667,6 +1837,11 @@ double HF::compute_energy()
         if (process_environment_.get_worldcomm()->me() == 0 && !converged) {
             fprintf(outfile, "  Energy did not converge, but proceeding anyway.\n\n");
         }
+        if (soscf_enabled_) {
+            fprintf(outfile, "  Fock builds: %d (%d in SOSCF steps).\n\n", fock_builds_, soscf_fock_builds_);
+        }
+        if (print_ > 1)
+            workspace_->print(outfile);
         //~ if (WorldComm->me() == 0) {
             fprintf(outfile, "  @%s%s Final Energy: %20.14f", df ? "DF-" : "", reference.c_str(), E_);
             if (perturb_h_) {
@@ -1815,12 +1990,387 @@ void HF::diagonalize_F(const SharedMatrix& Fm, SharedMatrix& Cm, boost::shared_p
     diag_F_temp_->gemm(false, false, 1.0, diag_temp_, X_, 0.0);
 
     //Form C' = eig(F')
-    diag_F_temp_->diagonalize(diag_C_temp_, epsm);
+    if (partial_diagonalization_)
+        partial_diagonalize(diag_F_temp_, diag_C_temp_, epsm);
+    else
+        diag_F_temp_->diagonalize(diag_C_temp_, epsm);
 
     //Form C = XC'
     Cm->gemm(false, false, 1.0, X_, diag_C_temp_, 0.0);
 }
 
+void HF::partial_diagonalize(SharedMatrix& F, SharedMatrix& C, boost::shared_ptr<Vector>& eps)
+{
+    // Enough eigenpairs per irrep for the aufbau occupation over all irreps
+    Dimension nlowest(F->nirrep());
+    for (int h = 0; h < F->nirrep(); ++h)
+        nlowest[h] = std::min(F->rowspi()[h], nalpha_ + partial_virtuals_);
+    F->diagonalize_lowest(C, eps, nlowest);
+
+    // Orbitals left out get no coefficients and no energy
+    for (int h = 0; h < F->nirrep(); ++h) {
+        int n = F->rowspi()[h];
+        double** Cp = C->pointer(h);
+        double* ep = eps->pointer(h);
+        for (int i = 0; i < n; ++i)
+            for (int k = nlowest[h]; k < n; ++k)
+                Cp[i][k] = 0.0;
+        for (int k = nlowest[h]; k < n; ++k)
+            ep[k] = std::numeric_limits<double>::max();
+    }
+}
+
+bool HF::purify_density(const SharedMatrix& F, SharedMatrix& C, int nocc, Dimension& noccpi, bool fixed_occupation)
+{
+    //Form F' = X'FX
+    diag_temp_->gemm(true, false, 1.0, X_, F, 0.0);
+    diag_F_temp_->gemm(false, false, 1.0, diag_temp_, X_, 0.0);
+
+    // Irreps purified together: all of them, so that the occupation follows the
+    // aufbau principle across irreps, or each one alone if its occupation is fixed
+    std::vector<std::vector<int> > groups;
+    std::vector<int> targets;
+    if (fixed_occupation) {
+        for (int h = 0; h < nirrep_; ++h) {
+            if (!nmopi_[h]) continue;
+            groups.push_back(std::vector<int>(1, h));
+            targets.push_back(noccpi[h]);
+        }
+    } else {
+        groups.push_back(std::vector<int>());
+        for (int h = 0; h < nirrep_; ++h)
+            if (nmopi_[h]) groups[0].push_back(h);
+        targets.push_back(nocc);
+    }
+
+    SharedMatrix P = workspace_->acquire("Purified D", nmopi_, nmopi_);
+    SharedMatrix P2 = workspace_->acquire("Purified D^2", nmopi_, nmopi_);
+    bool converged = true;
+    double flops = 0.0;
+    for (size_t g = 0; g < groups.size() && converged; ++g) {
+        const std::vector<int>& irreps = groups[g];
+        double target = targets[g];
+
+        // Gershgorin bounds on the spectrum of F'
+        double emin = std::numeric_limits<double>::max();
+        double emax = -std::numeric_limits<double>::max();
+        for (size_t ind = 0; ind < irreps.size(); ++ind) {
+            int h = irreps[ind];
+            int n = nmopi_[h];
+            double** Fp = diag_F_temp_->pointer(h);
+            for (int i = 0; i < n; ++i) {
+                double radius = 0.0;
+                for (int j = 0; j < n; ++j)
+                    if (j != i) radius += fabs(Fp[i][j]);
+                emin = std::min(emin, Fp[i][i] - radius);
+                emax = std::max(emax, Fp[i][i] + radius);
+            }
+        }
+        if (emax - emin < 1.0E-12) emax = emin + 1.0;
+
+        // P0 maps the spectrum onto [0, 1], the occupied end at 1
+        for (size_t ind = 0; ind < irreps.size(); ++ind) {
+            int h = irreps[ind];
+            int n = nmopi_[h];
+            double** Fp = diag_F_temp_->pointer(h);
+            double** Pp = P->pointer(h);
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j)
+                    Pp[i][j] = -Fp[i][j] / (emax - emin);
+                Pp[i][i] += emax / (emax - emin);
+            }
+        }
+
+        // TC2: P <- P^2 or 2P - P^2, whichever brings the trace closer to nocc
+        bool done = false;
+        double trace = 0.0;
+        for (int iter = 0; iter < purification_max_iter_; ++iter) {
+            double trace2 = 0.0;
+            trace = 0.0;
+            for (size_t ind = 0; ind < irreps.size(); ++ind) {
+                int h = irreps[ind];
+                int n = nmopi_[h];
+                double** Pp = P->pointer(h);
+                double** P2p = P2->pointer(h);
+                C_DGEMM('N', 'N', n, n, n, 1.0, Pp[0], n, Pp[0], n, 0.0, P2p[0], n);
+                flops += 2.0 * n * n * (double) n;
+                for (int i = 0; i < n; ++i) {
+                    trace += Pp[i][i];
+                    trace2 += P2p[i][i];
+                }
+            }
+            // tr(P - P^2) is the sum of lambda (1 - lambda), zero for a projector
+            if (fabs(trace - trace2) < purification_conv_) {
+                done = true;
+                break;
+            }
+            bool square = (fabs(trace2 - target) < fabs(2.0 * trace - trace2 - target));
+            for (size_t ind = 0; ind < irreps.size(); ++ind) {
+                int h = irreps[ind];
+                size_t n2 = (size_t) nmopi_[h] * nmopi_[h];
+                double* Pp = P->pointer(h)[0];
+                double* P2p = P2->pointer(h)[0];
+                if (square) {
+                    C_DCOPY(n2, P2p, 1, Pp, 1);
+                } else {
+                    C_DSCAL(n2, 2.0, Pp, 1);
+                    C_DAXPY(n2, -1.0, P2p, 1, Pp, 1);
+                }
+            }
+        }
+        converged = done && fabs(trace - target) < 0.5;
+
+        if (!fixed_occupation && converged) {
+            int total = 0;
+            for (size_t ind = 0; ind < irreps.size(); ++ind) {
+                int h = irreps[ind];
+                double** Pp = P->pointer(h);
+                double occ = 0.0;
+                for (int i = 0; i < nmopi_[h]; ++i)
+                    occ += Pp[i][i];
+                noccpi[h] = (int) floor(occ + 0.5);
+                total += noccpi[h];
+            }
+            converged = (total == nocc);
+        }
+    }
+    diagnostics::count(diagnostics::GemmFlops, flops);
+
+    if (converged) {
+        // C' spans the occupied space: the Cholesky factor of the projector P = C'C'^T
+        SharedMatrix L = P->partial_cholesky_factorize(1.0E-6);
+        for (int h = 0; h < nirrep_ && converged; ++h) {
+            int nso = nsopi_[h];
+            int nmo = nmopi_[h];
+            if (!nso || !nmo) continue;
+            if (L->colspi()[h] < noccpi[h]) {
+                converged = false;
+                break;
+            }
+            double** Cp = C->pointer(h);
+            ::memset(static_cast<void*>(Cp[0]), '\0', sizeof(double) * nso * nmo);
+            if (noccpi[h])
+                C_DGEMM('N', 'N', nso, noccpi[h], nmo, 1.0, X_->pointer(h)[0], nmo, L->pointer(h)[0],
+                        L->colspi()[h], 0.0, Cp[0], nmo);
+        }
+    }
+    workspace_->release(P);
+    workspace_->release(P2);
+
+    if (!converged && print_)
+        fprintf(outfile, "    Purification did not converge, diagonalizing F instead.\n");
+    return converged;
+}
+
+namespace {
+
+/// Sum of elementwise products over all spins
+double soscf_dot(const std::vector<SharedMatrix>& a, const std::vector<SharedMatrix>& b)
+{
+    double value = 0.0;
+    for (size_t s = 0; s < a.size(); s++) {
+        value += a[s]->vector_dot(b[s]);
+    }
+    return value;
+}
+
+/// z = r / P, elementwise
+void soscf_precondition(const std::vector<SharedMatrix>& r, const std::vector<SharedMatrix>& P,
+                        std::vector<SharedMatrix>& z)
+{
+    for (size_t s = 0; s < r.size(); s++) {
+        z[s]->copy(r[s]);
+        z[s]->apply_denominator(P[s]);
+    }
+}
+
+}
+
+/*
+ * Orbital Hessian product (up to a common factor), one JK build for all spins:
+ * (Hx)_ia = (x F_ab - F_ij x)_ia + [C_occ^T dF C_vir]_ia, with dF the Coulomb,
+ * alpha-scaled exchange and (KS) XC response to the symmetric density change
+ * dD = C_occ x C_vir^T + C_vir x^T C_occ^T = [C_occ, C_vir x^T] [C_vir x^T, C_occ]^T
+ */
+void HF::soscf_product(bool restricted, const std::vector<SharedMatrix>& Cocc, const std::vector<SharedMatrix>& Cvir,
+                       const std::vector<SharedMatrix>& Foo, const std::vector<SharedMatrix>& Fvv,
+                       const std::vector<SharedMatrix>& x, std::vector<SharedMatrix>& Hx)
+{
+    double alpha = soscf_x_alpha();
+    std::vector<SharedMatrix>& C_left = jk_->C_left();
+    std::vector<SharedMatrix>& C_right = jk_->C_right();
+    C_left.clear();
+    C_right.clear();
+    for (size_t s = 0; s < x.size(); s++) {
+        const Dimension& nsopi = Cocc[s]->rowspi();
+        const Dimension& noccpi = Cocc[s]->colspi();
+        SharedMatrix Cx(new Matrix("C_vir x^T", nsopi, noccpi));
+        Cx->gemm(false, true, 1.0, Cvir[s], x[s], 0.0);
+        SharedMatrix L(new Matrix("dD Left", nsopi, noccpi + noccpi));
+        SharedMatrix R(new Matrix("dD Right", nsopi, noccpi + noccpi));
+        for (int h = 0; h < Cocc[s]->nirrep(); h++) {
+            int nocc = noccpi[h];
+            for (int m = 0; m < nsopi[h]; m++) {
+                for (int i = 0; i < nocc; i++) {
+                    L->set(h, m, i, Cocc[s]->get(h, m, i));
+                    L->set(h, m, nocc + i, Cx->get(h, m, i));
+                    R->set(h, m, i, Cx->get(h, m, i));
+                    R->set(h, m, nocc + i, Cocc[s]->get(h, m, i));
+                }
+            }
+        }
+        C_left.push_back(L);
+        C_right.push_back(R);
+    }
+
+    jk_->compute();
+
+    const std::vector<SharedMatrix>& J = jk_->J();
+    const std::vector<SharedMatrix>& K = jk_->K();
+    std::vector<SharedMatrix> dF;
+    for (size_t s = 0; s < x.size(); s++) {
+        dF.push_back(J[0]->clone());
+        if (restricted) {
+            dF[s]->scale(2.0);
+        } else {
+            dF[s]->add(J[1]);
+        }
+        if (alpha != 0.0) {
+            SharedMatrix Ks = K[s]->clone();
+            Ks->scale(alpha);
+            dF[s]->subtract(Ks);
+        }
+    }
+    C_left.clear();
+    C_right.clear();
+
+    soscf_xc_response(Cocc, Cvir, x, dF);
+
+    for (size_t s = 0; s < x.size(); s++) {
+        Hx[s]->transform(Cocc[s], dF[s], Cvir[s]);
+        Hx[s]->gemm(false, false, 1.0, x[s], Fvv[s], 1.0);
+        Hx[s]->gemm(false, false, -1.0, Foo[s], x[s], 1.0);
+    }
+}
+
+int HF::soscf_step(bool restricted)
+{
+    int nspin = (restricted ? 1 : 2);
+
+    // Occupied-virtual blocks of F in the current orbitals; the gradient is F_ia
+    std::vector<SharedMatrix> Cocc, Cvir, Foo, Fvv, grad, precon;
+    for (int s = 0; s < nspin; s++) {
+        SharedMatrix F = (s == 0 ? Fa_ : Fb_);
+        Cocc.push_back(s == 0 ? Ca_subset("SO", "OCC") : Cb_subset("SO", "OCC"));
+        Cvir.push_back(s == 0 ? Ca_subset("SO", "VIR") : Cb_subset("SO", "VIR"));
+
+        SharedMatrix Foo_s(new Matrix("F_ij", Cocc[s]->colspi(), Cocc[s]->colspi()));
+        SharedMatrix Fvv_s(new Matrix("F_ab", Cvir[s]->colspi(), Cvir[s]->colspi()));
+        SharedMatrix grad_s(new Matrix("F_ia", Cocc[s]->colspi(), Cvir[s]->colspi()));
+        Foo_s->transform(Cocc[s], F, Cocc[s]);
+        Fvv_s->transform(Cvir[s], F, Cvir[s]);
+        grad_s->transform(Cocc[s], F, Cvir[s]);
+
+        // Diagonal preconditioner F_aa - F_ii, floored for near-degenerate pairs
+        SharedMatrix precon_s(new Matrix("F_aa - F_ii", Cocc[s]->colspi(), Cvir[s]->colspi()));
+        for (int h = 0; h < nirrep_; h++) {
+            for (int i = 0; i < Foo_s->rowspi()[h]; i++) {
+                for (int a = 0; a < Fvv_s->rowspi()[h]; a++) {
+                    double d = Fvv_s->get(h, a, a) - Foo_s->get(h, i, i);
+                    precon_s->set(h, i, a, std::max(d, 0.05));
+                }
+            }
+        }
+
+        Foo.push_back(Foo_s);
+        Fvv.push_back(Fvv_s);
+        grad.push_back(grad_s);
+        precon.push_back(precon_s);
+    }
+
+    double gnorm = sqrt(soscf_dot(grad, grad));
+    if (gnorm == 0.0) return 0;
+
+    // Truncated (Steihaug) preconditioned CG on H x = -g inside the trust radius
+    std::vector<SharedMatrix> x, r, z, p, Hp;
+    for (int s = 0; s < nspin; s++) {
+        x.push_back(SharedMatrix(new Matrix("x", grad[s]->rowspi(), grad[s]->colspi())));
+        r.push_back(grad[s]->clone());
+        z.push_back(grad[s]->clone());
+        p.push_back(grad[s]->clone());
+        Hp.push_back(grad[s]->clone());
+        r[s]->scale(-1.0);
+    }
+    soscf_precondition(r, precon, z);
+    for (int s = 0; s < nspin; s++) {
+        p[s]->copy(z[s]);
+    }
+    double rz = soscf_dot(r, z);
+
+    // Model m(x) = g.x + x.Hx / 2, updated as m(x + a p) = m(x) - a r.p + a^2 p.Hp / 2
+    double model = 0.0;
+    int nproducts = 0;
+    while (nproducts < soscf_max_iter_ && sqrt(soscf_dot(r, r)) > soscf_conv_ * gnorm) {
+        soscf_product(restricted, Cocc, Cvir, Foo, Fvv, p, Hp);
+        nproducts++;
+        double pHp = soscf_dot(p, Hp);
+        double rp = soscf_dot(r, p);
+        double step = rz / pHp;
+        // Negative curvature or a step leaving the trust region: go to its boundary along p
+        double xx = soscf_dot(x, x);
+        double xp = soscf_dot(x, p);
+        double pp = soscf_dot(p, p);
+        if (pHp <= 0.0 || xx + 2.0 * step * xp + step * step * pp >= soscf_radius_ * soscf_radius_) {
+            step = (-xp + sqrt(xp * xp + pp * (soscf_radius_ * soscf_radius_ - xx))) / pp;
+            model += -step * rp + 0.5 * step * step * pHp;
+            for (int s = 0; s < nspin; s++) {
+                p[s]->scale(step);
+                x[s]->add(p[s]);
+            }
+            break;
+        }
+        model += -step * rp + 0.5 * step * step * pHp;
+        for (int s = 0; s < nspin; s++) {
+            p[s]->scale(step);
+            x[s]->add(p[s]);
+            p[s]->scale(1.0 / step);
+            Hp[s]->scale(step);
+            r[s]->subtract(Hp[s]);
+        }
+        soscf_precondition(r, precon, z);
+        double rz_new = soscf_dot(r, z);
+        for (int s = 0; s < nspin; s++) {
+            p[s]->scale(rz_new / rz);
+            p[s]->add(z[s]);
+        }
+        rz = rz_new;
+    }
+
+    // The energy gradient and Hessian are 4 (RHF) or 2 (UHF) times g and H
+    soscf_step_norm_ = sqrt(soscf_dot(x, x));
+    soscf_predicted_ = (restricted ? 4.0 : 2.0) * model;
+
+    // C <- C exp(K), K antisymmetric with K_ai = x_ia
+    for (int s = 0; s < nspin; s++) {
+        SharedMatrix C = (s == 0 ? Ca_ : Cb_);
+        SharedMatrix U(new Matrix("SOSCF Rotation", C->colspi(), C->colspi()));
+        for (int h = 0; h < nirrep_; h++) {
+            int nocc = x[s]->rowspi()[h];
+            for (int i = 0; i < nocc; i++) {
+                for (int a = 0; a < x[s]->colspi()[h]; a++) {
+                    U->set(h, nocc + a, i, x[s]->get(h, i, a));
+                    U->set(h, i, nocc + a, -x[s]->get(h, i, a));
+                }
+            }
+        }
+        U->expm(4, true);
+        SharedMatrix Cold = C->clone();
+        C->gemm(false, false, 1.0, Cold, U, 0.0);
+    }
+
+    return nproducts;
+}
+
 void HF::reset_SAD_occupation()
 {
     // RHF style for now
@@ -1831,6 +2381,36 @@ void HF::reset_SAD_occupation()
         soccpi_[h]   = 0;
     }
 }
+void HF::factor_guess_density(SharedMatrix D, SharedMatrix C, Dimension& noccpi)
+{
+    SharedMatrix V(new Matrix("Guess density eigenvectors", nirrep_, nsopi_, nsopi_));
+    SharedVector lambda(new Vector("Guess density eigenvalues", nirrep_, nsopi_));
+    D->diagonalize(V, lambda, descending);
+
+    C->zero();
+    for (int h = 0; h < nirrep_; ++h) {
+        noccpi[h] = 0;
+        double** Vp = V->pointer(h);
+        double** Cp = C->pointer(h);
+        for (int k = 0; k < nmopi_[h] && lambda->get(h, k) > 1.0E-10; ++k) {
+            double scale = sqrt(lambda->get(h, k));
+            for (int m = 0; m < nsopi_[h]; ++m)
+                Cp[m][k] = scale * Vp[m][k];
+            noccpi[h]++;
+        }
+    }
+}
+
+void HF::reset_density_guess_occupation()
+{
+    nalphapi_ = density_guess_nalphapi_;
+    nbetapi_ = density_guess_nbetapi_;
+    for (int h = 0; h < nirrep_; ++h) {
+        doccpi_[h] = std::min(nalphapi_[h], nbetapi_[h]);
+        soccpi_[h] = std::abs(nalphapi_[h] - nbetapi_[h]);
+    }
+}
+
 SharedMatrix HF::form_Fia(SharedMatrix Fso, SharedMatrix Cso, int* noccpi)
 {
     int* nsopi = Cso->rowspi();
@@ -1882,28 +2462,48 @@ SharedMatrix HF::form_Fia(SharedMatrix Fso, SharedMatrix Cso, int* noccpi)
 }
 SharedMatrix HF::form_FDSmSDF(SharedMatrix Fso, SharedMatrix Dso)
 {
-    SharedMatrix FDSmSDF(new Matrix("FDS-SDF", nirrep_, nsopi_, nsopi_));
-    SharedMatrix DS(new Matrix("DS", nirrep_, nsopi_, nsopi_));
+    SharedMatrix FDSmSDF = workspace_->acquire("FDS-SDF", nsopi_, nsopi_);
+    SharedMatrix DS = workspace_->acquire("DS", nsopi_, nsopi_);
 
     DS->gemm(false,false,1.0,Dso,S_,0.0);
     FDSmSDF->gemm(false,false,1.0,Fso,DS,0.0);
+    workspace_->release(DS);
+
+    // SDF is the transpose of FDS, so subtract it in place
+    for (int h = 0; h < nirrep_; ++h) {
+        double** Mp = FDSmSDF->pointer(h);
+        for (int i = 0; i < nsopi_[h]; ++i) {
+            Mp[i][i] = 0.0;
+            for (int j = 0; j < i; ++j) {
+                double val = Mp[i][j] - Mp[j][i];
+                Mp[i][j] = val;
+                Mp[j][i] = -val;
+            }
+        }
+    }
 
-    SharedMatrix SDF(FDSmSDF->transpose());
-    FDSmSDF->subtract(SDF);
-
-    DS.reset();
-    SDF.reset();
-
-    SharedMatrix XP(new Matrix("X'(FDS - SDF)", nirrep_, nmopi_, nsopi_));
-    SharedMatrix XPX(new Matrix("X'(FDS - SDF)X", nirrep_, nmopi_, nmopi_));
+    SharedMatrix XP = workspace_->acquire("X'(FDS - SDF)", nmopi_, nsopi_);
+    SharedMatrix XPX = workspace_->acquire("X'(FDS - SDF)X", nmopi_, nmopi_);
     XP->gemm(true,false,1.0,X_,FDSmSDF,0.0);
     XPX->gemm(false,false,1.0,XP,X_,0.0);
+    workspace_->release(XP);
+    workspace_->release(FDSmSDF);
 
     //XPX->print();
 
     return XPX;
 }
 
+SharedMatrix HF::occupied_C(SharedMatrix C, const Dimension& noccpi)
+{
+    SharedMatrix Cocc = workspace_->acquire("C SO OCC", nsopi_, noccpi);
+    for (int h = 0; h < nirrep_; ++h) {
+        if (!noccpi[h] || !nsopi_[h]) continue;
+        Cocc->slice(h).copy(C->slice(h, 0, 0, nsopi_[h], noccpi[h]));
+    }
+    return Cocc;
+}
+
 void HF::print_stability_analysis(std::vector<std::pair<double, int> > &vec)
 {
     std::sort(vec.begin(), vec.end());
@@ -1943,7 +2543,7 @@ SharedMatrix HF::GuessDensity()
     MOM_performed_ = false;
     diis_performed_ = false;
     // Neither of these are idempotent
-    if (options_.get_str("GUESS") == "SAD" || options_.get_str("GUESS") == "READ")
+    if (options_.get_str("GUESS") == "SAD" || options_.get_str("GUESS") == "READ" || options_.get_str("GUESS") == "DENSITY")
         iteration_ = -1;
     else
         iteration_ = 0;
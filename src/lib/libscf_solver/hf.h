@@ -37,6 +37,7 @@
 #include <libmints/wavefunction.h>
 #include <libmints/basisset.h>
 #include <libmints/vector.h>
+#include <libmints/workspace.h>
 #include <libdiis/diismanager.h>
 #include <libdiis/diisentry.h>
 #include <psi4-dec.h>
@@ -71,6 +72,11 @@ protected:
     SharedMatrix diag_F_temp_;
     /// Temporary matrix for diagonalize_F
     SharedMatrix diag_C_temp_;
+    /// Scratch matrices of the SCF iterations, shared with the JK and DIIS objects
+    boost::shared_ptr<MatrixWorkspace> workspace_;
+    /// (Orbital energy, irrep) lists sorted by find_occupation, kept between iterations
+    std::vector<std::pair<double, int> > occupation_pairs_a_;
+    std::vector<std::pair<double, int> > occupation_pairs_b_;
 
     /// Old C Alpha matrix (if needed for MOM)
     SharedMatrix Ca_old_;
@@ -159,6 +165,11 @@ protected:
     int diis_start_;
     /// Are we even using DIIS?
     int diis_enabled_;
+    /// Energy-based extrapolation blended into DIIS far from convergence
+    DIISManager::InitialAcceleration diis_initial_acceleration_;
+    /// The DIIS errors between which it hands over to DIIS
+    double diis_acceleration_start_;
+    double diis_acceleration_finish_;
 
     /// The amount (%) of the previous orbitals to mix in during SCF damping
     double damping_percentage_;
@@ -169,6 +180,49 @@ protected:
     /// Whether damping was actually performed this iteration
     bool damping_performed_;
 
+    /// Are we to take second-order (Newton) orbital steps near convergence?
+    bool soscf_enabled_;
+    /// Have SOSCF steps taken over (they do not hand back to DIIS)?
+    bool soscf_started_;
+    /// Was the last orbital update an SOSCF step?
+    bool soscf_performed_;
+    /// Energy, orbitals and Fock matrices the last SOSCF step started from (restored if it is rejected)
+    double soscf_E_;
+    SharedMatrix soscf_Ca_;
+    SharedMatrix soscf_Cb_;
+    SharedMatrix soscf_Fa_;
+    SharedMatrix soscf_Fb_;
+    /// The RMS orbital gradient below which SOSCF steps may be taken
+    double soscf_start_convergence_;
+    /// Smallest RMS orbital gradient DIIS has reached below soscf_start_convergence_, and the
+    /// number of consecutive iterations since that raised the energy or did not improve on it
+    double soscf_best_Drms_;
+    int soscf_stalled_iterations_;
+    /// Maximum number of Hessian products per SOSCF step
+    int soscf_max_iter_;
+    /// Relative residual at which the Newton equations are solved
+    double soscf_conv_;
+    /// Current and largest trust radius (norm of an orbital rotation)
+    double soscf_radius_;
+    double soscf_max_radius_;
+    /// Norm of the last SOSCF step, and the energy change its quadratic model predicted
+    double soscf_step_norm_;
+    double soscf_predicted_;
+    /// Fock (JK) builds in this SCF, including SOSCF Hessian products
+    int fock_builds_;
+    /// How many of those were SOSCF Hessian products
+    int soscf_fock_builds_;
+
+    /// How each iteration's density is obtained from F: DIAGONALIZE, PURIFICATION or PARTIAL_EIGEN
+    std::string density_update_;
+    /// Is diagonalize_F to compute only the lowest (occupied plus a few virtual) eigenpairs?
+    bool partial_diagonalization_;
+    /// Virtual eigenpairs per irrep kept by the partial eigensolver
+    int partial_virtuals_;
+    /// Idempotency error at which purification stops, and its iteration limit
+    double purification_conv_;
+    int purification_max_iter_;
+
     // parameters for hard-sphere potentials
     double radius_; // radius of spherical potential
     double thickness_; // thickness of spherical barrier
@@ -178,6 +232,11 @@ protected:
     
     // added by spring
     std::vector<SharedMatrix> guessOrbital_;
+    /// Alpha (and beta) density for GUESS = DENSITY
+    std::vector<SharedMatrix> guessDensity_;
+    /// Real occupations, while the density guess's factor ranks stand in for them
+    Dimension density_guess_nalphapi_;
+    Dimension density_guess_nbetapi_;
 
 public:
     /// Nuclear contributions
@@ -186,6 +245,8 @@ public:
 
     /// The number of iterations needed to reach convergence
     int iterations_needed() {return iterations_needed_;}
+    /// The number of Fock (JK) builds needed to reach convergence
+    int fock_builds() const {return fock_builds_;}
 
     /// The JK object (or null if it has been deleted)
     boost::shared_ptr<JK> jk() const { return jk_; }
@@ -284,6 +345,11 @@ protected:
 
     /// Reset to regular occupation from the fractional occupation
     void reset_SAD_occupation();
+    /** Factor a (not necessarily idempotent) density as D = CC^T for the first JK build of GUESS = DENSITY;
+        noccpi gets the number of columns used. Negative eigenvalues are dropped **/
+    void factor_guess_density(SharedMatrix D, SharedMatrix C, Dimension& noccpi);
+    /** Restore the occupations after the first Fock build from a density guess **/
+    void reset_density_guess_occupation();
 
     /// Form the guess (gaurantees C, D, and E)
     virtual void guess();
@@ -299,6 +365,14 @@ protected:
 
     /** Transformation, diagonalization, and backtransform of Fock matrix */
     virtual void diagonalize_F(const SharedMatrix& F, SharedMatrix& C, boost::shared_ptr<Vector>& eps);
+    /** Lowest (nalpha + partial_virtuals_) eigenpairs of each irrep of F (Matrix::diagonalize_lowest); the other columns of C are zeroed */
+    void partial_diagonalize(SharedMatrix& F, SharedMatrix& C, boost::shared_ptr<Vector>& eps);
+
+    /** Forms the occupied orbitals by density-matrix purification, returns false if that was not done (C must then be formed by form_C) */
+    virtual bool form_C_purified() { return false; }
+    /** Trace-correcting purification of F with nocc electrons: the first noccpi columns of C span the occupied
+        space (they are not canonical orbitals). noccpi is input if fixed_occupation, else output. Returns false on failure **/
+    bool purify_density(const SharedMatrix& F, SharedMatrix& C, int nocc, Dimension& noccpi, bool fixed_occupation);
 
     /** Computes the Fock matrix */
     virtual void form_F() =0;
@@ -315,6 +389,9 @@ protected:
     /** Test convergence of the wavefunction */
     virtual bool test_convergency() { return false; }
 
+    /** Leave a cheap preliminary stage (e.g. a coarse DFT grid) once it is loosely converged, returns true on a switch */
+    virtual bool advance_scf_stage() { return false; }
+
     /** Compute/print spin contamination information (if unrestricted) **/
     virtual void compute_spin_contamination();
 
@@ -327,11 +404,27 @@ protected:
     /** Performs DIIS extrapolation */
     virtual bool diis() { return false; }
 
+    /** Rotates the orbitals by an approximate Newton step, returns the number of Hessian products (0 if no step was taken) */
+    virtual int soscf_update() { return 0; }
+    /** The SOSCF step shared by RHF (restricted = true) and UHF */
+    int soscf_step(bool restricted);
+    /** SOSCF orbital Hessian products Hx for the rotations x of each spin (one JK build) */
+    void soscf_product(bool restricted, const std::vector<SharedMatrix>& Cocc, const std::vector<SharedMatrix>& Cvir,
+                       const std::vector<SharedMatrix>& Foo, const std::vector<SharedMatrix>& Fvv,
+                       const std::vector<SharedMatrix>& x, std::vector<SharedMatrix>& Hx);
+    /** Fraction of exact exchange in the SOSCF orbital Hessian */
+    virtual double soscf_x_alpha() const { return 1.0; }
+    /** Adds the XC response to the SOSCF Fock responses dF of each spin (KS only) */
+    virtual void soscf_xc_response(const std::vector<SharedMatrix>& Cocc, const std::vector<SharedMatrix>& Cvir,
+                                   const std::vector<SharedMatrix>& x, std::vector<SharedMatrix>& dF) {}
+
     /** Form Fia (for DIIS) **/
     virtual SharedMatrix form_Fia(SharedMatrix Fso, SharedMatrix Cso, int* noccpi);
 
     /** Form X'(FDS - SDF)X (for DIIS) **/
     virtual SharedMatrix form_FDSmSDF(SharedMatrix Fso, SharedMatrix Dso);
+    /** The first noccpi columns of C, in a workspace matrix (for JK and V builds) **/
+    SharedMatrix occupied_C(SharedMatrix C, const Dimension& noccpi);
 
     /** Save orbitals to use later as a guess **/
     virtual void save_orbitals();
@@ -358,6 +451,7 @@ public:
     double EHF() { return E_; }
     
     void SetGuessOrbital(std::vector<SharedMatrix> guessOrbital) { guessOrbital_ = guessOrbital; }
+    void SetGuessDensity(std::vector<SharedMatrix> guessDensity) { guessDensity_ = guessDensity; }
     
     // Finalize memory/files
     void extern_finalize();
@@ -80,6 +80,18 @@ void KS::common_init()
     sobasisset_ = boost::shared_ptr<SOBasisSet>(new SOBasisSet(basisset_, fact));
 
     potential_ = VBase::build_V(process_environment_, KS::options_,(options_.get_str("REFERENCE") == "RKS" ? "RV" : "UV"));
+
+    // Start on a coarse pruned grid if requested, the production grid is built in advance_grid_stage
+    adaptive_grid_stage_ = options_.get_bool("DFT_ADAPTIVE_GRID");
+    if (adaptive_grid_stage_) {
+        std::map<std::string, int> int_opts;
+        int_opts["DFT_RADIAL_POINTS"] = options_.get_int("DFT_ADAPTIVE_RADIAL_POINTS");
+        int_opts["DFT_SPHERICAL_POINTS"] = options_.get_int("DFT_ADAPTIVE_SPHERICAL_POINTS");
+        std::map<std::string, std::string> str_opts;
+        str_opts["DFT_PRUNING_SCHEME"] = options_.get_str("DFT_ADAPTIVE_PRUNING_SCHEME");
+        potential_->set_grid_options(int_opts, str_opts);
+    }
+
     potential_->initialize();
     functional_ = potential_->functional();
 
@@ -87,6 +99,55 @@ void KS::common_init()
     potential_->print_header();
 
 }
+bool KS::advance_grid_stage(double dE, double Drms)
+{
+    if (!adaptive_grid_stage_) return false;
+    if (fabs(dE) > options_.get_double("DFT_ADAPTIVE_E_CONVERGENCE") ||
+        Drms > options_.get_double("DFT_ADAPTIVE_D_CONVERGENCE")) return false;
+
+    fprintf(outfile, "\n  Coarse grid converged, switching to the production grid.\n\n");
+    potential_->finalize();
+    potential_->set_grid_options(std::map<std::string, int>(), std::map<std::string, std::string>());
+    potential_->initialize();
+    adaptive_grid_stage_ = false;
+
+    return true;
+}
+
+void KS::soscf_xc_difference(const std::vector<SharedMatrix>& Cocc, const std::vector<SharedMatrix>& Cvir,
+                             const std::vector<SharedMatrix>& x, std::vector<SharedMatrix>& dF)
+{
+    double xnorm = 0.0;
+    for (size_t s = 0; s < x.size(); s++) {
+        xnorm += x[s]->vector_dot(x[s]);
+    }
+    xnorm = sqrt(xnorm);
+    if (xnorm == 0.0) return;
+
+    // Forward difference along a rotation of norm 1E-4, from the V of the current orbitals
+    double h = 1.0E-4 / xnorm;
+    std::vector<SharedMatrix> V0;
+    std::vector<SharedMatrix>& C = potential_->C();
+    C.clear();
+    for (size_t s = 0; s < x.size(); s++) {
+        V0.push_back(potential_->V()[s]->clone());
+        SharedMatrix Ch = Cocc[s]->clone();
+        Ch->gemm(false, true, h, Cvir[s], x[s], 1.0);
+        C.push_back(Ch);
+    }
+
+    potential_->compute();
+
+    const std::vector<SharedMatrix>& V = potential_->V();
+    for (size_t s = 0; s < x.size(); s++) {
+        SharedMatrix dV = V[s]->clone();
+        dV->subtract(V0[s]);
+        dV->scale(1.0 / h);
+        dF[s]->add(dV);
+        // The SCF keeps aliases to V
+        V[s]->copy(V0[s]);
+    }
+}
 
 // added by spring
 RKS::RKS(Process::Environment& process_environment_in, boost::shared_ptr<JK> jk_in) :
@@ -126,12 +187,21 @@ void RKS::integrals()
         throw PSIEXCEPTION("SCF_TYPE is not supported by RC functionals");
     }
 }
+bool RKS::advance_scf_stage()
+{
+    return advance_grid_stage(E_ - Eold_, Drms_);
+}
+void RKS::soscf_xc_response(const std::vector<SharedMatrix>& Cocc, const std::vector<SharedMatrix>& Cvir,
+                            const std::vector<SharedMatrix>& x, std::vector<SharedMatrix>& dF)
+{
+    soscf_xc_difference(Cocc, Cvir, x, dF);
+}
 void RKS::form_V()
 {
     // Push the C matrix on
     std::vector<SharedMatrix> & C = potential_->C();
     C.clear();
-    C.push_back(Ca_subset("SO", "OCC"));
+    C.push_back(occupied_C(Ca_, nalphapi_));
     
     // Run the potential object
     potential_->compute();
@@ -149,7 +219,7 @@ void RKS::form_G()
     // Push the C matrix on
     std::vector<SharedMatrix> & C = jk_->C_left();
     C.clear();
-    C.push_back(Ca_subset("SO", "OCC"));
+    C.push_back(occupied_C(Ca_, nalphapi_));
     
     // Run the JK object
     jk_->compute();
@@ -167,25 +237,19 @@ void RKS::form_G()
         wK_ = wK[0];
     }
     
-    G_->copy(J_);
-        
-    G_->add(V_);
+    G_->linear_combination(1.0, J_, 1.0, V_);
 
     double alpha = functional_->x_alpha();
     double beta = 1.0 - alpha;
 
     if (alpha != 0.0) {
-        K_->scale(alpha);
-        G_->subtract(K_);
-        K_->scale(1.0/alpha);
+        G_->axpy(-alpha, K_);
     } else {
         K_->zero();
     }
 
     if (functional_->is_x_lrc()) {
-        wK_->scale(beta);
-        G_->subtract(wK_);
-        wK_->scale(1.0/beta);
+        G_->axpy(-beta, wK_);
     } else {
         wK_->zero();
     }
@@ -295,13 +359,22 @@ void UKS::integrals()
         throw PSIEXCEPTION("SCF_TYPE is not supported by RC functionals");
     }    
 }
+bool UKS::advance_scf_stage()
+{
+    return advance_grid_stage(E_ - Eold_, Drms_);
+}
+void UKS::soscf_xc_response(const std::vector<SharedMatrix>& Cocc, const std::vector<SharedMatrix>& Cvir,
+                            const std::vector<SharedMatrix>& x, std::vector<SharedMatrix>& dF)
+{
+    soscf_xc_difference(Cocc, Cvir, x, dF);
+}
 void UKS::form_V()
 {
     // Push the C matrix on
     std::vector<SharedMatrix> & C = potential_->C();
     C.clear();
-    C.push_back(Ca_subset("SO", "OCC"));
-    C.push_back(Cb_subset("SO", "OCC"));
+    C.push_back(occupied_C(Ca_, nalphapi_));
+    C.push_back(occupied_C(Cb_, nbetapi_));
     
     // Run the potential object
     potential_->compute();
@@ -320,8 +393,8 @@ void UKS::form_G()
     // Push the C matrix on
     std::vector<SharedMatrix> & C = jk_->C_left();
     C.clear();
-    C.push_back(Ca_subset("SO", "OCC"));
-    C.push_back(Cb_subset("SO", "OCC"));
+    C.push_back(occupied_C(Ca_, nalphapi_));
+    C.push_back(occupied_C(Cb_, nbetapi_));
     
     // Run the JK object
     jk_->compute();
@@ -330,8 +403,7 @@ void UKS::form_G()
     const std::vector<SharedMatrix> & J = jk_->J();
     const std::vector<SharedMatrix> & K = jk_->K();
     const std::vector<SharedMatrix> & wK = jk_->wK();
-    J_->copy(J[0]);
-    J_->add(J[1]);
+    J_->linear_combination(1.0, J[0], 1.0, J[1]);
     if (functional_->is_x_hybrid()) {
         Ka_ = K[0];
         Kb_ = K[1];
@@ -340,33 +412,22 @@ void UKS::form_G()
         wKa_ = wK[0];
         wKb_ = wK[1];
     }
-    Ga_->copy(J_);
-    Gb_->copy(J_);
-        
-    Ga_->add(Va_);
-    Gb_->add(Vb_);
+    Ga_->linear_combination(1.0, J_, 1.0, Va_);
+    Gb_->linear_combination(1.0, J_, 1.0, Vb_);
 
     double alpha = functional_->x_alpha();
     double beta = 1.0 - alpha;
     if (alpha != 0.0) {
-        Ka_->scale(alpha);
-        Kb_->scale(alpha);
-        Ga_->subtract(Ka_);
-        Gb_->subtract(Kb_);
-        Ka_->scale(1.0/alpha);
-        Kb_->scale(1.0/alpha);
+        Ga_->axpy(-alpha, Ka_);
+        Gb_->axpy(-alpha, Kb_);
     } else {
         Ka_->zero();
         Kb_->zero();
     }
 
     if (functional_->is_x_lrc()) {
-        wKa_->scale(beta);
-        wKb_->scale(beta);
-        Ga_->subtract(wKa_);
-        Gb_->subtract(wKb_);
-        wKa_->scale(1.0/beta);
-        wKb_->scale(1.0/beta);
+        Ga_->axpy(-beta, wKa_);
+        Gb_->axpy(-beta, wKb_);
     } else {
         wKa_->zero();
         wKb_->zero();
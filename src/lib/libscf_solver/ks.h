@@ -73,15 +73,26 @@ protected:
     /// Factory (for Spherical Harmonics)
     boost::shared_ptr<IntegralFactory> omega_factory_;
 
+    /// Is the SCF still running on the coarse grid (DFT_ADAPTIVE_GRID)?
+    bool adaptive_grid_stage_;
+
     /// Compute E_xc and the V matrix
     virtual void form_V() = 0;
     /// Build functional, grid, etc
     void common_init();
+    /// Swap the coarse grid for the production grid once dE and Drms are below the DFT_ADAPTIVE_* thresholds
+    bool advance_grid_stage(double dE, double Drms);
+    /// Add the XC response to the orbital rotations C_occ -> C_occ + C_vir x^T (finite difference of V) to dF
+    void soscf_xc_difference(const std::vector<SharedMatrix>& Cocc, const std::vector<SharedMatrix>& Cvir,
+                             const std::vector<SharedMatrix>& x, std::vector<SharedMatrix>& dF);
 
 public:
     KS(Process::Environment& process_environment_in);
     KS(Process::Environment& process_environment_in, Options & options, boost::shared_ptr<PSIO> psio);
     virtual ~KS();
+
+    /// The KS potential, with the grid the SCF converged on
+    boost::shared_ptr<VBase> V_potential() const { return potential_; }
 };
 
 class RKS : public RHF, public KS {
@@ -98,6 +109,10 @@ protected:
     virtual void stability_analysis();
     virtual void integrals();
     virtual void finalize();
+    virtual bool advance_scf_stage();
+    virtual double soscf_x_alpha() const { return functional_->x_alpha(); }
+    virtual void soscf_xc_response(const std::vector<SharedMatrix>& Cocc, const std::vector<SharedMatrix>& Cvir,
+                                   const std::vector<SharedMatrix>& x, std::vector<SharedMatrix>& dF);
 
     void common_init();
 public:
@@ -128,6 +143,10 @@ protected:
     virtual void stability_analysis();
     virtual void integrals();
     virtual void finalize();
+    virtual bool advance_scf_stage();
+    virtual double soscf_x_alpha() const { return functional_->x_alpha(); }
+    virtual void soscf_xc_response(const std::vector<SharedMatrix>& Cocc, const std::vector<SharedMatrix>& Cvir,
+                                   const std::vector<SharedMatrix>& x, std::vector<SharedMatrix>& dF);
 
     void common_init();
 public:
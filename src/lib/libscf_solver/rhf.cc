@@ -152,7 +152,7 @@ void RHF::form_G()
     // Push the C matrix on
     std::vector<SharedMatrix> & C = jk_->C_left();
     C.clear();
-    C.push_back(Ca_subset("SO", "OCC"));
+    C.push_back(occupied_C(Ca_, nalphapi_));
     
     // Run the JK object
     jk_->compute();
@@ -164,10 +164,8 @@ void RHF::form_G()
     //~ J_->scale(2.0); // move scaling down below 
     K_ = K[0];
 
-    G_->copy(J_);
-    // now scale here so J_ won't get doubled 
-    G_->scale(2.0);
-    G_->subtract(K_);
+    // G = 2J - K in one pass, so J_ won't get doubled
+    G_->linear_combination(2.0, J_, -1.0, K_);
 }
 
 void RHF::save_information()
@@ -186,11 +184,16 @@ void RHF::compute_orbital_gradient(bool save_fock)
                 diis_manager_ = boost::shared_ptr<DIISManager>(new DIISManager(process_environment_, max_diis_vectors_, "HF DIIS vector", psio_, DIISManager::LargestError, DIISManager::InCore));
             else
                 diis_manager_ = boost::shared_ptr<DIISManager>(new DIISManager(process_environment_, max_diis_vectors_, "HF DIIS vector", psio_, DIISManager::LargestError, DIISManager::InCore));
+            diis_manager_->set_workspace(workspace_);
             diis_manager_->set_error_vector_size(1, DIISEntry::Matrix, gradient.get());
             diis_manager_->set_vector_size(1, DIISEntry::Matrix, Fa_.get());
+            // Da stands for both spins
+            diis_manager_->set_initial_acceleration(diis_initial_acceleration_, 2.0, diis_acceleration_start_, diis_acceleration_finish_);
             initialized_diis_manager_ = true;
         }
         diis_manager_->add_entry(2, gradient.get(), Fa_.get());
+        if (diis_initial_acceleration_ != DIISManager::NoInitialAcceleration)
+            diis_manager_->set_entry_energy_and_density(E_, 1, Da_.get());
     }
 }
 
@@ -200,6 +203,11 @@ bool RHF::diis()
     return diis_manager_->extrapolate(1, Fa_.get());
 }
 
+int RHF::soscf_update()
+{
+    return soscf_step(true);
+}
+
 bool RHF::test_convergency()
 {
     // energy difference
@@ -215,8 +223,7 @@ bool RHF::test_convergency()
 
 void RHF::form_F()
 {
-    Fa_->copy(H_);
-    Fa_->add(G_);
+    Fa_->linear_combination(1.0, H_, 1.0, G_);
 
     if (debug_) {
         Fa_->print(outfile);
@@ -233,6 +240,18 @@ void RHF::form_C()
     find_occupation();
 }
 
+bool RHF::form_C_purified()
+{
+    if (!purify_density(Fa_, Ca_, nalpha_, nalphapi_, input_docc_ || input_socc_))
+        return false;
+    for (int h = 0; h < nirrep_; ++h) {
+        nbetapi_[h] = nalphapi_[h];
+        doccpi_[h] = nalphapi_[h];
+        soccpi_[h] = 0;
+    }
+    return true;
+}
+
 void RHF::form_D()
 {
     for (int h = 0; h < nirrep_; ++h) {
@@ -288,11 +307,7 @@ double RHF::compute_E()
     energies_["XC"] = 0.0;
     energies_["-D"] = 0.0;
 
-    Matrix HplusF;
-    HplusF.copy(H_);
-    HplusF.add(Fa_);
-
-    double Etotal = nuclearrep_ + D_->vector_dot(HplusF);
+    double Etotal = nuclearrep_ + D_->vector_dot(H_) + D_->vector_dot(Fa_);
     return Etotal;
 }
 
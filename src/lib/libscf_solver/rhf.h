@@ -58,6 +58,7 @@ protected:
     SharedMatrix K_;
 
     void form_C();
+    bool form_C_purified();
     void form_D();
     virtual void damp_update();
     double compute_initial_E();
@@ -75,6 +76,7 @@ protected:
     virtual void compute_orbital_gradient(bool save_fock);
 
     bool diis();
+    virtual int soscf_update();
 
     bool test_convergency();
     void save_information();
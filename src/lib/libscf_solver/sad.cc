@@ -34,6 +34,11 @@
 #include <algorithm>
 #include <vector>
 #include <utility>
+#include <map>
+#include <string>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <psifiles.h>
 #include <libciomr/libciomr.h>
@@ -55,6 +60,58 @@ using namespace psi;
 
 namespace psi { namespace scf {
 
+namespace {
+
+// Converged atomic UHF densities of this process, by atomic_density_key
+std::map<std::string, SharedMatrix> atomic_densities;
+
+// Library records are "SAD <key>", the number of functions, then the density row by row
+void read_atomic_density_library(const std::string& path)
+{
+    std::ifstream library(path.c_str());
+    std::string line;
+    while (std::getline(library, line)) {
+        if (line.compare(0, 4, "SAD ") != 0)
+            continue;
+        std::string key = line.substr(4);
+        int n = 0;
+        if (!(library >> n) || n <= 0)
+            break;
+        SharedMatrix D(new Matrix("SAD atomic density", n, n));
+        double** Dp = D->pointer();
+        for (int i = 0; i < n * n; i++)
+            library >> Dp[0][i];
+        if (!library)
+            break; // truncated record
+        atomic_densities[key] = D;
+    }
+}
+
+void append_atomic_density_library(const std::string& path, const std::string& key, SharedMatrix D)
+{
+    int n = D->rowspi()[0];
+    double** Dp = D->pointer();
+    std::string record = "SAD " + key + "\n";
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%d\n", n);
+    record += buffer;
+    for (int i = 0; i < n * n; i++) {
+        snprintf(buffer, sizeof(buffer), "%.17e%c", Dp[0][i], (i % n == n - 1) ? '\n' : ' ');
+        record += buffer;
+    }
+    // one appending write, so concurrent runs sharing the library do not interleave records
+    int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        fprintf(outfile, "  SAD: Unable to write the atomic density library %s.\n", path.c_str());
+        return;
+    }
+    if (write(fd, record.c_str(), record.size()) != (ssize_t)record.size())
+        fprintf(outfile, "  SAD: Incomplete write to the atomic density library %s.\n", path.c_str());
+    close(fd);
+}
+
+}
+
 SADGuess::SADGuess(boost::shared_ptr<BasisSet> basis, int nalpha, int nbeta, Options& options) :
     basis_(basis), nalpha_(nalpha), nbeta_(nbeta), options_(options)
 {
@@ -73,6 +130,12 @@ void SADGuess::common_init()
 
     print_ = options_.get_int("SAD_PRINT");
     debug_ = options_.get_int("DEBUG");
+
+    E_tol_ = options_.get_double("SAD_E_CONVERGENCE");
+    D_tol_ = options_.get_double("SAD_D_CONVERGENCE");
+    maxiter_ = options_.get_int("SAD_MAXITER");
+    f_mixing_iteration_ = options_.get_int("SAD_F_MIX_START");
+    library_ = options_.get_str("SAD_LIBRARY");
 }
 void SADGuess::compute_guess()
 {
@@ -245,13 +308,54 @@ SharedMatrix SADGuess::form_D_AO()
         atomic_D[A] = block_matrix(atomic_bases[atomic_indices[A]]->nbf(),atomic_bases[atomic_indices[A]]->nbf());
     }
 
+    // Look up the unique atoms in the density cache, then in the library
+    std::vector<std::string> keys(nunique);
+    std::vector<int> missing;
+    for (int A = 0; A<nunique; A++) {
+        int index = atomic_indices[A];
+        keys[A] = atomic_density_key(atomic_bases[index],nelec[index],nhigh[index]);
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        missing.clear();
+        for (int A = 0; A<nunique; A++)
+            if (atomic_densities.find(keys[A]) == atomic_densities.end())
+                missing.push_back(A);
+        if (missing.empty() || library_.empty() || pass == 1)
+            break;
+        read_atomic_density_library(library_);
+    }
+
     if (print_ > 1)
         fprintf(outfile,"\n  Performing Atomic UHF Computations:\n");
-    for (int A = 0; A<nunique; A++) {
+    // The atomic UHF runs are independent; run them serially when they print
+    std::vector<int> converged(missing.size());
+    #pragma omp parallel for schedule(dynamic) if(print_ <= 1)
+    for (int i = 0; i < (int)missing.size(); i++) {
+        int A = missing[i];
         int index = atomic_indices[A];
         if (print_ > 1)
             fprintf(outfile,"\n  UHF Computation for Unique Atom %d which is Atom %d:",A, index);
-        getUHFAtomicDensity(atomic_bases[index],nelec[index],nhigh[index],atomic_D[A]);
+        converged[i] = getUHFAtomicDensity(atomic_bases[index],nelec[index],nhigh[index],atomic_D[A]);
+    }
+    // A density that did not converge still serves this guess, but is neither cached nor written
+    for (int i = 0; i < (int)missing.size(); i++) {
+        int A = missing[i];
+        if (!converged[i])
+            continue;
+        int norbs = atomic_bases[atomic_indices[A]]->nbf();
+        SharedMatrix D(new Matrix("SAD atomic density", norbs, norbs));
+        C_DCOPY(norbs*norbs,atomic_D[A][0],1,D->pointer()[0],1);
+        atomic_densities[keys[A]] = D;
+        if (!library_.empty())
+            append_atomic_density_library(library_, keys[A], D);
+    }
+    for (int A = 0; A<nunique; A++) {
+        if (std::find(missing.begin(), missing.end(), A) != missing.end())
+            continue;
+        int norbs = atomic_bases[atomic_indices[A]]->nbf();
+        C_DCOPY(norbs*norbs,atomic_densities[keys[A]]->pointer()[0],1,atomic_D[A][0],1);
+        if (print_ > 1)
+            fprintf(outfile,"\n  Unique Atom %d which is Atom %d: cached atomic density",A, atomic_indices[A]);
     }
     if (print_)
         fprintf(outfile,"\n");
@@ -288,7 +392,25 @@ SharedMatrix SADGuess::form_D_AO()
 
     return DAO;
 }
-void SADGuess::getUHFAtomicDensity(boost::shared_ptr<BasisSet> bas, int nelec, int nhigh, double** D)
+std::string SADGuess::atomic_density_key(boost::shared_ptr<BasisSet> bas, int nelec, int nhigh)
+{
+    // The element, occupation and atomic UHF settings, then every shell of the atomic basis
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%d %d %d %.3e %.3e %d %d", (int)bas->molecule()->Z(0), nelec, nhigh,
+        E_tol_, D_tol_, maxiter_, f_mixing_iteration_);
+    std::string key = buffer;
+    for (int P = 0; P < bas->nshell(); P++) {
+        const GaussianShell& shell = bas->shell(P);
+        snprintf(buffer, sizeof(buffer), " %c%d", shell.is_pure() ? 'p' : 'c', shell.am());
+        key += buffer;
+        for (int K = 0; K < shell.nprimitive(); K++) {
+            snprintf(buffer, sizeof(buffer), " %.10e %.10e", shell.exp(K), shell.original_coefs()[K]);
+            key += buffer;
+        }
+    }
+    return key;
+}
+bool SADGuess::getUHFAtomicDensity(boost::shared_ptr<BasisSet> bas, int nelec, int nhigh, double** D)
 {
     boost::shared_ptr<Molecule> mol = bas->molecule();
 
@@ -435,10 +557,10 @@ void SADGuess::getUHFAtomicDensity(boost::shared_ptr<BasisSet> bas, int nelec, i
 
     const double* buffer = TEI->buffer();
 
-    double E_tol = options_.get_double("SAD_E_CONVERGENCE");
-    double D_tol = options_.get_double("SAD_D_CONVERGENCE");
-    int maxiter = options_.get_int("SAD_MAXITER");
-    int f_mixing_iteration = options_.get_int("SAD_F_MIX_START");
+    double E_tol = E_tol_;
+    double D_tol = D_tol_;
+    int maxiter = maxiter_;
+    int f_mixing_iteration = f_mixing_iteration_;
 
     double E_old;
     int iteration = 0;
@@ -585,6 +707,8 @@ void SADGuess::getUHFAtomicDensity(boost::shared_ptr<BasisSet> bas, int nelec, i
     free_block(Gb);
     free_block(H);
     free_block(Shalf);
+
+    return converged;
 }
 void SADGuess::atomicUHFHelperFormCandD(int nelec, int norbs,double** Shalf, double**F, double** C, double** D)
 {
@@ -23,6 +23,8 @@
 #ifndef LIBSCF_SAD_H
 #define LIBSCF_SAD_H
 
+#include <string>
+
 namespace boost {
 template<class T> class shared_ptr;
 }
@@ -51,6 +53,14 @@ protected:
 
     Options& options_;
 
+    // atomic UHF settings, read once so atoms can run in parallel
+    double E_tol_;
+    double D_tol_;
+    int maxiter_;
+    int f_mixing_iteration_;
+    // on-disk atomic density library (SAD_LIBRARY), empty for memory only
+    std::string library_;
+
     SharedMatrix Da_;
     SharedMatrix Db_;
     SharedMatrix Ca_;
@@ -59,7 +69,9 @@ protected:
     void common_init();
 
     SharedMatrix form_D_AO();
-    void getUHFAtomicDensity(boost::shared_ptr<BasisSet> atomic_basis, int n_electrons, int multiplicity, double** D);
+    std::string atomic_density_key(boost::shared_ptr<BasisSet> atomic_basis, int n_electrons, int multiplicity);
+    // returns false if the atomic UHF stopped at SAD_MAXITER; D is then the last iterate
+    bool getUHFAtomicDensity(boost::shared_ptr<BasisSet> atomic_basis, int n_electrons, int multiplicity, double** D);
     void atomicUHFHelperFormCandD(int nelec, int norbs,double** Shalf, double**F, double** C, double** D);
 
     void form_D();
@@ -138,8 +138,8 @@ void UHF::form_G()
     // Push the C matrix on
     std::vector<SharedMatrix> & C = jk_->C_left();
     C.clear();
-    C.push_back(Ca_subset("SO", "OCC"));
-    C.push_back(Cb_subset("SO", "OCC"));
+    C.push_back(occupied_C(Ca_, nalphapi_));
+    C.push_back(occupied_C(Cb_, nbetapi_));
     
     // Run the JK object
     jk_->compute();
@@ -147,15 +147,12 @@ void UHF::form_G()
     // Pull the J and K matrices off
     const std::vector<SharedMatrix> & J = jk_->J();
     const std::vector<SharedMatrix> & K = jk_->K();
-    J_->copy(J[0]);
-    J_->add(J[1]);
+    J_->linear_combination(1.0, J[0], 1.0, J[1]);
     Ka_ = K[0];
     Kb_ = K[1];
     
-    Ga_->copy(J_);
-    Gb_->copy(Ga_);
-    Ga_->subtract(Ka_);
-    Gb_->subtract(Kb_);
+    Ga_->linear_combination(1.0, J_, -1.0, Ka_);
+    Gb_->linear_combination(1.0, J_, -1.0, Kb_);
 }
 
 void UHF::save_information()
@@ -188,11 +185,8 @@ void UHF::form_initialF()
 
 void UHF::form_F()
 {
-    Fa_->copy(H_);
-    Fa_->add(Ga_);
-
-    Fb_->copy(H_);
-    Fb_->add(Gb_);
+    Fa_->linear_combination(1.0, H_, 1.0, Ga_);
+    Fb_->linear_combination(1.0, H_, 1.0, Gb_);
 
     if (debug_) {
         Fa_->print(outfile);
@@ -211,6 +205,19 @@ void UHF::form_C()
     }
 }
 
+bool UHF::form_C_purified()
+{
+    bool fixed = input_docc_ || input_socc_;
+    if (!purify_density(Fa_, Ca_, nalpha_, nalphapi_, fixed) ||
+        !purify_density(Fb_, Cb_, nbeta_, nbetapi_, fixed))
+        return false;
+    for (int h = 0; h < nirrep_; ++h) {
+        soccpi_[h] = std::abs(nalphapi_[h] - nbetapi_[h]);
+        doccpi_[h] = std::min(nalphapi_[h], nbetapi_[h]);
+    }
+    return true;
+}
+
 void UHF::form_D()
 {
     for (int h = 0; h < nirrep_; ++h) {
@@ -236,8 +243,7 @@ void UHF::form_D()
 
     }
 
-    Dt_->copy(Da_);
-    Dt_->add(Db_);
+    Dt_->linear_combination(1.0, Da_, 1.0, Db_);
 
     if (debug_) {
         fprintf(outfile, "in UHF::form_D:\n");
@@ -249,8 +255,7 @@ void UHF::form_D()
 // TODO: Once Dt_ is refactored to D_ the only difference between this and RHF::compute_initial_E is a factor of 0.5
 double UHF::compute_initial_E()
 {
-    Dt_->copy(Da_);
-    Dt_->add(Db_);
+    Dt_->linear_combination(1.0, Da_, 1.0, Db_);
     return nuclearrep_ + 0.5 * (Dt_->vector_dot(H_));
 }
 
@@ -282,17 +287,21 @@ void UHF::compute_orbital_gradient(bool save_fock)
 
     if(save_fock){
         if (initialized_diis_manager_ == false) {
-            diis_manager_ = boost::shared_ptr<DIISManager>(new DIISManager(process_environment_, max_diis_vectors_, "HF DIIS vector", psio_, DIISManager::LargestError, DIISManager::OnDisk));
+            diis_manager_ = boost::shared_ptr<DIISManager>(new DIISManager(process_environment_, max_diis_vectors_, "HF DIIS vector", psio_, DIISManager::LargestError, DIISManager::InCore));
+            diis_manager_->set_workspace(workspace_);
             diis_manager_->set_error_vector_size(2,
                                                  DIISEntry::Matrix, gradient_a.get(),
                                                  DIISEntry::Matrix, gradient_b.get());
             diis_manager_->set_vector_size(2,
                                            DIISEntry::Matrix, Fa_.get(),
                                            DIISEntry::Matrix, Fb_.get());
+            diis_manager_->set_initial_acceleration(diis_initial_acceleration_, 1.0, diis_acceleration_start_, diis_acceleration_finish_);
             initialized_diis_manager_ = true;
         }
 
         diis_manager_->add_entry(4, gradient_a.get(), gradient_b.get(), Fa_.get(), Fb_.get());
+        if (diis_initial_acceleration_ != DIISManager::NoInitialAcceleration)
+            diis_manager_->set_entry_energy_and_density(E_, 2, Da_.get(), Db_.get());
     }
 }
 
@@ -301,6 +310,11 @@ bool UHF::diis()
     return diis_manager_->extrapolate(2, Fa_.get(), Fb_.get());
 }
 
+int UHF::soscf_update()
+{
+    return soscf_step(false);
+}
+
 void UHF::stability_analysis()
 {
     if(scf_type_ == "DF" || scf_type_ == "CD"){
@@ -42,6 +42,7 @@ protected:
 
     void form_initialF();
     void form_C();
+    bool form_C_purified();
     void form_D();
     double compute_initial_E();
     virtual double compute_E();
@@ -52,6 +53,7 @@ protected:
 
     virtual void compute_orbital_gradient(bool save_diis);
     bool diis();
+    virtual int soscf_update();
 
     bool test_convergency();
     void save_information();
@@ -27,6 +27,7 @@
 #include <libfock/v.h>
 #include <libfunctional/superfunctional.h>
 #include <libdisp/dispersion.h>
+#include <libscf_solver/ks.h>
 #include "scf_grad.h"
 #include "jk_grad.h"
 
@@ -142,16 +143,29 @@ SharedMatrix SCFGrad::compute_gradient()
     boost::shared_ptr<SuperFunctional> functional;
     boost::shared_ptr<VBase> potential;
 
+    // Reuse the converged SCF grid (and its point workers) when the reference still holds it
+    boost::shared_ptr<scf::KS> ks = boost::dynamic_pointer_cast<scf::KS>(reference_wavefunction_);
+
     if (options_.get_str("REFERENCE") == "RKS") {
-        potential = VBase::build_V(process_environment_, options_, "RV"); 
-        potential->initialize();
+        if (ks && ks->V_potential()) {
+            potential = ks->V_potential();
+        } else {
+            potential = VBase::build_V(process_environment_, options_, "RV"); 
+            potential->initialize();
+        }
         std::vector<SharedMatrix>& C = potential->C();
+        C.clear();
         C.push_back(Ca_subset("SO", "OCC"));
         functional = potential->functional();
     } else if (options_.get_str("REFERENCE") == "UKS") { 
-        potential = VBase::build_V(process_environment_, options_, "UV"); 
-        potential->initialize();
+        if (ks && ks->V_potential()) {
+            potential = ks->V_potential();
+        } else {
+            potential = VBase::build_V(process_environment_, options_, "UV"); 
+            potential->initialize();
+        }
         std::vector<SharedMatrix>& C = potential->C();
+        C.clear();
         C.push_back(Ca_subset("SO", "OCC"));
         C.push_back(Cb_subset("SO", "OCC"));
         functional = potential->functional();
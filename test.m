@@ -53,6 +53,8 @@ matpsi.Integrals_NumUniqueTEIs();
 matpsi.Integrals_AllUniqueTEIs();
 matpsi.Integrals_AllTEIs();
 matpsi.Integrals_IndicesForK();
+matpsi.Integrals_ERIThroughput();
+matpsi.Integrals_BoysThroughput();
 
 % JK
 matpsi.JK_Initialize('PKJK');
@@ -99,6 +101,7 @@ matpsi.JK_OccOrbToK(testMat, testMat);
 matpsi.DFT_Initialize('b3lyp');
 matpsi.DFT_DensToV(testMat);
 matpsi.DFT_EnergyXC();
+matpsi.DFT_BlockStatistics();
 matpsi3.SCF_SetSCFType('uks');
 matpsi3.DFT_Initialize('b3lyp');
 matpsi3.DFT_DensToV(testMat, testMat);
@@ -128,8 +131,29 @@ matpsi.SCF_EnableDamping();
 matpsi.SCF_DisableDamping();
 matpsi.SCF_EnableDIIS();
 matpsi.SCF_DisableDIIS();
+matpsi.SCF_EnableSOSCF(1e-3);
+matpsi.SCF_RunSCF();
+matpsi.SCF_NumFockBuilds();
+matpsi.SCF_DisableSOSCF();
+matpsi.SCF_SetInitialAcceleration('ADIIS');
+matpsi.SCF_GuessCore();
+matpsi.SCF_RunSCF();
+matpsi.SCF_NumFockBuilds();
+matpsi.SCF_SetInitialAcceleration('NONE');
+matpsi.SCF_SetDensityUpdate('PURIFICATION');
+matpsi.SCF_RunSCF();
+matpsi.SCF_SetDensityUpdate('PARTIAL_EIGEN');
+matpsi.SCF_RunSCF();
+matpsi.SCF_SetDensityUpdate('DIAGONALIZE');
 matpsi.SCF_GuessSAD();
+matpsi.SCF_SetSADLibrary([tempdir 'matpsi2_sad.dat']);
+matpsi.SCF_RunSCF();
+matpsi.SCF_SetSADLibrary('');
 matpsi.SCF_GuessCore();
+matpsi.SCF_EnableSymmetry();
+matpsi.SCF_RunSCF();
+matpsi.SCF_PointGroup();
+matpsi.SCF_DisableSymmetry();
 matpsi.SCF_TotalEnergy();
 matpsi.SCF_OrbitalAlpha();
 matpsi.SCF_OrbitalBeta();
@@ -140,8 +164,47 @@ matpsi.SCF_DensityBeta();
 matpsi.SCF_FockAlpha();
 matpsi.SCF_FockBeta();
 matpsi.SCF_Gradient();
+matpsi.SCF_Hessian();
+matpsi.SCF_Hessian(2, 0.01);
 matpsi.SCF_GuessDensity();
 matpsi.SCF_RHF_J();
 matpsi.SCF_RHF_K();
 
+% Properties on points
+points = [0 0 0; 0 1 1; 2 -1 0.5];
+matpsi.Points_Density(points, matpsi.SCF_DensityAlpha());
+matpsi.Points_Orbitals(points, matpsi.SCF_OrbitalAlpha());
+matpsi.Points_ESP(points, matpsi.SCF_DensityAlpha());
+matpsi3.Points_Density(points, matpsi3.SCF_DensityAlpha(), matpsi3.SCF_DensityBeta());
+matpsi3.Points_ESP(points, matpsi3.SCF_DensityAlpha(), matpsi3.SCF_DensityBeta());
+
+% Born-Oppenheimer MD
+matpsi.SCF_SetGuessDensity(matpsi.SCF_DensityAlpha());
+matpsi.SCF_RunSCF();
+matpsi.BOMD_Initialize(zeros(matpsi.Molecule_NumAtoms(), 3), 10);
+matpsi.BOMD_SetSCFIterations(4);
+[energies, positions, forces] = matpsi.BOMD_Run(3);
+matpsi.BOMD_SetThermostat(300, 400);
+energies = matpsi.BOMD_Run(2);
+matpsi.BOMD_Velocities();
+matpsi.BOMD_Time();
+
+% Geometry optimization
+steps = matpsi.Opt_Run(20);
+steps = matpsi.Opt_Run(20, 1e-4);
+matpsi.Molecule_Geometry();
+
+% Batched energies and gradients
+geom = matpsi.Molecule_Geometry();
+geometries = [reshape(geom', 1, []); reshape((geom + 0.01)', 1, []); reshape((geom * 1.02)', 1, [])];
+[energies, gradients] = matpsi.Batch_EnergyGradient(geometries);
+matpsi.Batch_Submit(geometries, 1);
+matpsi.Batch_NumPending();
+[indices, energies, gradients] = matpsi.Batch_Results(false);
+[indices, energies, gradients] = matpsi.Batch_Results();
 
+% Diagnostics
+[timings, phases] = matpsi.Diagnostics_Timings();
+matpsi.Diagnostics_Timings([tempdir 'matpsi2_trace.json']);
+matpsi.Diagnostics_PhaseNames();
+matpsi.Diagnostics_Reset();